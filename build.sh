@@ -163,8 +163,26 @@ search_and_config_ssl() {
     fi
 }
 
+search_and_config_zlib() {
+    [[ $MAKE_TOOL == "cmake" ]] && return
+    echo "Checking zlib library."
+
+    LIB_Z=$(find_lib "libz.so")
+
+    # If zlib is found, enable WebSocket permessage-deflate
+    if [ -n "$LIB_Z" ]; then
+        echo "zlib library found!"
+        echo "Zlib: $LIB_Z"
+        export XUTILS_USE_ZLIB=y
+    else
+        echo 'zlib library not found!'
+        export XUTILS_USE_ZLIB=n
+    fi
+}
+
 # Build the library
 search_and_config_ssl
+search_and_config_zlib
 update_cpu_count
 clean_project
 build_library
@@ -0,0 +1,128 @@
+/*!
+ *  @file libxutils/examples/http-async.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Asynchronous HTTP client example. Sends the same GET request
+ * N times concurrently from a single event loop and compares the total
+ * time with sequential blocking requests.
+ */
+
+#include "xstd.h"
+#include "http.h"
+#include "api.h"
+#include "xtime.h"
+#include "str.h"
+
+#define ASYNC_DEFAULT_COUNT     100
+#define ASYNC_TIMEOUT_MS        5000
+
+typedef struct {
+    size_t nPending;
+    size_t nFailed;
+} async_ctx_t;
+
+static void response_cb(xapi_t *pApi, xhttp_t *pResponse, xhttp_status_t eStatus, void *pUserCtx)
+{
+    async_ctx_t *pCtx = (async_ctx_t*)pApi->pUserCtx;
+    size_t nID = (size_t)(uintptr_t)pUserCtx;
+
+    if (eStatus != XHTTP_COMPLETE || pResponse->nStatusCode != 200)
+    {
+        if (!pCtx->nFailed) printf("Request %zu failed: %s\n", nID, XHTTP_GetStatusStr(eStatus));
+        pCtx->nFailed++;
+    }
+
+    pCtx->nPending--;
+}
+
+static double bench_blocking(xlink_t *pLink, size_t nCount)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFailed = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xhttp_t handle;
+        xhttp_status_t eStatus = XHTTP_EINIT;
+
+        if (XHTTP_InitRequest(&handle, XHTTP_GET, pLink->sUri, "1.1") > 0 &&
+            XHTTP_AddHeader(&handle, "Host", "%s", pLink->sAddr) > 0)
+            eStatus = XHTTP_LinkPerform(&handle, pLink, NULL, 0);
+
+        if (eStatus != XHTTP_COMPLETE || handle.nStatusCode != 200) nFailed++;
+        XHTTP_Clear(&handle);
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFailed) printf("Failed blocking requests: %zu\n", nFailed);
+    return nElapsed / 1000.0;
+}
+
+static double bench_async(xlink_t *pLink, size_t nCount)
+{
+    async_ctx_t ctx;
+    ctx.nPending = 0;
+    ctx.nFailed = 0;
+
+    xapi_t api;
+    if (XAPI_Init(&api, NULL, &ctx) < 0)
+    {
+        printf("Failed to initialize API\n");
+        return 0.;
+    }
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xhttp_t handle;
+        if (XHTTP_InitRequest(&handle, XHTTP_GET, pLink->sUri, "1.1") < 0) break;
+
+        /* Request is copied to the session, handle can be cleared */
+        XSTATUS nStatus = XAPI_LinkRequest(&api, &handle, pLink, NULL, 0,
+                                           ASYNC_TIMEOUT_MS, response_cb, (void*)(uintptr_t)i);
+
+        XHTTP_Clear(&handle);
+        if (nStatus <= 0) break;
+        ctx.nPending++;
+    }
+
+    if (i < nCount) printf("Failed to submit request: %zu\n", i);
+
+    while (ctx.nPending)
+        if (XAPI_Service(&api, 100) != XEVENTS_SUCCESS) break;
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (ctx.nFailed) printf("Failed async requests: %zu\n", ctx.nFailed);
+
+    XAPI_Destroy(&api);
+    return nElapsed / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <link> [requests]\n", argv[0]);
+        printf("Example: %s http://127.0.0.1:6969/ 100\n", argv[0]);
+        return 1;
+    }
+
+    size_t nCount = argc > 2 ? (size_t)atol(argv[2]) : ASYNC_DEFAULT_COUNT;
+    if (!nCount) nCount = ASYNC_DEFAULT_COUNT;
+
+    xlink_t link;
+    if (XLink_Parse(&link, argv[1]) < 0)
+    {
+        printf("Invalid link: %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("Requests: %zu\n\n", nCount);
+    printf("  %-10s %8.1f ms\n", "blocking", bench_blocking(&link, nCount));
+    printf("  %-10s %8.1f ms\n", "async", bench_async(&link, nCount));
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*!
+ *  @file libxutils/examples/http-pool.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the keep-alive connection pool. Sends the same
+ * GET request to the server with a new connection per request and
+ * with connections reused from the pool.
+ */
+
+#include "xstd.h"
+#include "http.h"
+#include "xtime.h"
+#include "str.h"
+
+#define POOL_DEFAULT_COUNT  1000
+
+static xhttp_status_t perform(xhttp_pool_t *pPool, const char *pLink)
+{
+    xlink_t link;
+    if (XLink_Parse(&link, pLink) < 0) return XHTTP_ELINK;
+
+    xhttp_t handle;
+    if (XHTTP_InitRequest(&handle, XHTTP_GET, link.sUri, "1.1") < 0) return XHTTP_EINIT;
+    XHTTP_SetPool(&handle, pPool);
+
+    xhttp_status_t eStatus = XHTTP_ESETHDR;
+    if (XHTTP_AddHeader(&handle, "Host", "%s", link.sAddr) > 0)
+        eStatus = XHTTP_LinkPerform(&handle, &link, NULL, 0);
+
+    if (eStatus == XHTTP_COMPLETE && handle.nStatusCode != 200) eStatus = XHTTP_INVALID;
+
+    XHTTP_Clear(&handle);
+    return eStatus;
+}
+
+static double bench(xhttp_pool_t *pPool, const char *pLink, size_t nCount)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFailed = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xhttp_status_t eStatus = perform(pPool, pLink);
+        if (eStatus == XHTTP_COMPLETE) continue;
+
+        if (!nFailed) printf("Request failed: %s\n", XHTTP_GetStatusStr(eStatus));
+        nFailed++;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFailed) printf("Failed requests: %zu\n", nFailed);
+    return nElapsed / (double)nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <link> [requests]\n", argv[0]);
+        printf("Example: %s http://127.0.0.1:6969/ 1000\n", argv[0]);
+        return 1;
+    }
+
+    size_t nCount = argc > 2 ? (size_t)atol(argv[2]) : POOL_DEFAULT_COUNT;
+    if (!nCount) nCount = POOL_DEFAULT_COUNT;
+
+    xhttp_pool_t pool;
+    XHTTP_PoolInit(&pool, XSTDNON, XSTDNON);
+
+    printf("Requests: %zu\n\n", nCount);
+    printf("  %-10s %8.1f us/req\n", "one-shot", bench(NULL, argv[1], nCount));
+    printf("  %-10s %8.1f us/req\n", "pooled", bench(&pool, argv[1], nCount));
+    printf("\nOpened: %zu, reused: %zu\n", pool.nOpened, pool.nReused);
+
+    XHTTP_PoolDestroy(&pool);
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*!
+ *  @file libxutils/examples/http-router.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Microbenchmark of the HTTP request router. Compares the linear
+ * string compare chain with radix trie lookup on a generated route set.
+ */
+
+#include "xstd.h"
+#include "router.h"
+#include "xtime.h"
+#include "str.h"
+
+#define ROUTER_DEFAULT_COUNT    1000000
+#define ROUTER_RESOURCES        30
+#define ROUTER_ACTIONS          10
+#define ROUTER_ROUTES           (ROUTER_RESOURCES * ROUTER_ACTIONS)
+#define ROUTER_PATH_MAX         128
+
+static const char *g_actions[ROUTER_ACTIONS] =
+{
+    "list", "search", "export", "import", "stats",
+    "audit", "config", "health", "schema", "batch"
+};
+
+typedef struct {
+    char sStatic[ROUTER_PATH_MAX];
+    char sPattern[ROUTER_PATH_MAX];
+    char sRequest[ROUTER_PATH_MAX];
+} router_route_t;
+
+static router_route_t g_routes[ROUTER_ROUTES];
+
+static void init_routes(void)
+{
+    size_t i, j;
+
+    for (i = 0; i < ROUTER_RESOURCES; i++)
+    {
+        for (j = 0; j < ROUTER_ACTIONS; j++)
+        {
+            router_route_t *pRoute = &g_routes[i * ROUTER_ACTIONS + j];
+            xstrncpyf(pRoute->sStatic, sizeof(pRoute->sStatic), "/api/v2/resource%02zu/%s", i, g_actions[j]);
+            xstrncpyf(pRoute->sPattern, sizeof(pRoute->sPattern), "/api/v2/resource%02zu/:id/%s", i, g_actions[j]);
+            xstrncpyf(pRoute->sRequest, sizeof(pRoute->sRequest), "/api/v2/resource%02zu/%zu/%s?limit=10", i, i * 7919 + j, g_actions[j]);
+        }
+    }
+}
+
+/* Reference: what handlers do today, compare the URI with every route */
+static size_t find_linear(const char *pPath)
+{
+    size_t nLength = strcspn(pPath, "?");
+    size_t i;
+
+    for (i = 0; i < ROUTER_ROUTES; i++)
+    {
+        const char *pRoute = g_routes[i].sStatic;
+        if (!strncmp(pRoute, pPath, nLength) && pRoute[nLength] == '\0') return i + 1;
+    }
+
+    return 0;
+}
+
+static double bench_linear(size_t nCount)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFound = 0;
+
+    for (i = 0; i < nCount; i++)
+        nFound += find_linear(g_routes[i % ROUTER_ROUTES].sStatic) ? 1 : 0;
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFound != nCount) printf("Linear lookup missed %zu routes\n", nCount - nFound);
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_router(xrouter_t *pRouter, size_t nCount, xbool_t bParams)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFound = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        const router_route_t *pRoute = &g_routes[i % ROUTER_ROUTES];
+        const char *pPath = bParams ? pRoute->sRequest : pRoute->sStatic;
+
+        xrouter_match_t match;
+        if (XRouter_Find(pRouter, XHTTP_GET, pPath, &match) != NULL) nFound++;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFound != nCount) printf("Router lookup missed %zu routes\n", nCount - nFound);
+    return nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : ROUTER_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    init_routes();
+    xrouter_t router;
+    XRouter_Init(&router, NULL, NULL);
+    size_t i;
+
+    for (i = 0; i < ROUTER_ROUTES; i++)
+    {
+        if (XRouter_Add(&router, XHTTP_GET, g_routes[i].sStatic, &g_routes[i]) <= 0 ||
+            XRouter_Add(&router, XHTTP_GET, g_routes[i].sPattern, &g_routes[i]) <= 0)
+        {
+            printf("Failed to register route: %s\n", g_routes[i].sPattern);
+            XRouter_Destroy(&router);
+            return 1;
+        }
+    }
+
+    printf("Routes: %zu, iterations: %zu\n\n", router.nCount, nCount);
+    printf("  %-18s %8.1f ns/op\n", "linear/static", bench_linear(nCount));
+    printf("  %-18s %8.1f ns/op\n", "router/static", bench_router(&router, nCount, XFALSE));
+    printf("  %-18s %8.1f ns/op\n", "router/params", bench_router(&router, nCount, XTRUE));
+
+    XRouter_Destroy(&router);
+    return 0;
+}
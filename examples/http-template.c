@@ -0,0 +1,116 @@
+/*!
+ *  @file libxutils/examples/http-template.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Microbenchmark of the HTTP response serialization. Compares
+ * XHTTP_Assemble() with pre-serialized response template.
+ */
+
+#include "xstd.h"
+#include "http.h"
+#include "xtime.h"
+#include "str.h"
+
+#define TEMPLATE_DEFAULT_COUNT  1000000
+
+static const char *g_pBody = "{\"status\": \"ok\", \"id\": 42}";
+
+static int init_response(xhttp_t *pHttp)
+{
+    if (XHTTP_InitResponse(pHttp, 200, "1.1") <= 0) return XSTDERR;
+    pHttp->nKeepAlive = XTRUE;
+
+    if (XHTTP_AddHeader(pHttp, "Server", "xutils/%s", "bench") <= 0 ||
+        XHTTP_AddHeader(pHttp, "Content-Type", "application/json") <= 0 ||
+        XHTTP_AddHeader(pHttp, "Cache-Control", "no-cache") <= 0) return XSTDERR;
+
+    return XSTDOK;
+}
+
+static double bench_assemble(size_t nCount)
+{
+    xbyte_buffer_t buffer;
+    XByteBuffer_Init(&buffer, XSTR_BIG, XFALSE);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFailed = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        char sDate[XHTTP_DATE_MAX];
+        XTime_GetStr(sDate, sizeof(sDate), XTIME_STR_HTTP);
+
+        /* What handlers do today, build the response from scratch */
+        xhttp_t handle;
+        if (init_response(&handle) < 0 ||
+            XHTTP_AddHeader(&handle, "Date", "%s", sDate) <= 0 ||
+            XHTTP_Assemble(&handle, (const uint8_t*)g_pBody, strlen(g_pBody)) == NULL ||
+            XByteBuffer_AddBuff(&buffer, &handle.rawData) < 0) nFailed++;
+
+        XHTTP_Clear(&handle);
+        XByteBuffer_Reset(&buffer);
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFailed) printf("Failed to assemble %zu responses\n", nFailed);
+
+    XByteBuffer_Clear(&buffer);
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_template(const xhttp_template_t *pTemplate, size_t nCount)
+{
+    xbyte_buffer_t buffer;
+    XByteBuffer_Init(&buffer, XSTR_BIG, XFALSE);
+
+    xhttp_date_t date;
+    XHTTP_InitDate(&date);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFailed = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        if (XHTTP_WriteTemplate(pTemplate, &buffer, &date,
+            (const uint8_t*)g_pBody, strlen(g_pBody)) <= 0) nFailed++;
+
+        XByteBuffer_Reset(&buffer);
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFailed) printf("Failed to write %zu responses\n", nFailed);
+
+    XByteBuffer_Clear(&buffer);
+    return nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : TEMPLATE_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    xhttp_t handle;
+    xhttp_template_t template;
+
+    if (init_response(&handle) < 0 ||
+        XHTTP_InitTemplate(&template, &handle, XTRUE) <= 0)
+    {
+        printf("Failed to create response template\n");
+        XHTTP_Clear(&handle);
+        return 1;
+    }
+
+    XHTTP_Clear(&handle);
+    printf("Iterations: %zu\n\n", nCount);
+    printf("  %-10s %8.1f ns/op\n", "assemble", bench_assemble(nCount));
+    printf("  %-10s %8.1f ns/op\n", "template", bench_template(&template, nCount));
+
+    XHTTP_ClearTemplate(&template);
+    return 0;
+}
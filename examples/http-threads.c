@@ -0,0 +1,148 @@
+/*!
+ *  @file libxutils/examples/http-threads.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Multi-threaded HTTP server with one event loop per thread.
+ * Every thread owns SO_REUSEPORT listener, main thread broadcasts
+ * messages to the threads using cross-thread mailbox.
+ */
+
+#include "api.h"
+#include "sig.h"
+#include "cpu.h"
+#include "sync.h"
+#include "xdef.h"
+#include <stdio.h>
+
+#define HTTP_THREADS_MAX        64
+#define HTTP_STATS_INTERVAL     5000
+
+static volatile sig_atomic_t g_nInterrupted = 0;
+static uint64_t g_nRequests[HTTP_THREADS_MAX];
+
+static void signal_handler(int sig)
+{
+    (void)sig;
+    g_nInterrupted = 1;
+}
+
+static int on_request(xapi_ctx_t *ctx, xapi_session_t *s)
+{
+    g_nRequests[ctx->nWorkerIndex]++;
+    return XAPI_EnableEvent(s, XPOLLOUT);
+}
+
+static int on_write(xapi_ctx_t *ctx, xapi_session_t *s)
+{
+    (void)ctx;
+    xhttp_t res;
+    XHTTP_InitResponse(&res, 200, NULL);
+    XHTTP_AddHeader(&res, "Content-Type", "text/plain");
+
+    const char *body = "Hello from libxutils\n";
+    XHTTP_Assemble(&res, (const uint8_t*)body, strlen(body));
+
+    XAPI_PutTxBuff(s, &res.rawData);
+    XHTTP_Clear(&res);
+
+    return XAPI_EnableEvent(s, XPOLLOUT);
+}
+
+static int on_message(xapi_ctx_t *ctx)
+{
+    printf("Thread[%d] core(%d) %s: requests(%"PRIu64")\n",
+        ctx->nWorkerIndex, ctx->nCoreIndex,
+        (const char*)ctx->pMessage,
+        g_nRequests[ctx->nWorkerIndex]);
+
+    return XAPI_CONTINUE;
+}
+
+static int callback(xapi_ctx_t *ctx, xapi_session_t *s)
+{
+    switch (ctx->eCbType)
+    {
+        case XAPI_CB_ERROR:
+            fprintf(stderr, "Thread[%d] error: %s\n", ctx->nWorkerIndex, XAPI_GetStatus(ctx));
+            return XAPI_CONTINUE;
+
+        case XAPI_CB_LISTENING:
+            printf("Thread[%d] listening on %s:%u\n", ctx->nWorkerIndex, s->sAddr, (unsigned)s->nPort);
+            return XAPI_CONTINUE;
+
+        case XAPI_CB_ACCEPTED:
+            return XAPI_SetEvents(s, XPOLLIN);
+
+        case XAPI_CB_READ:
+            return on_request(ctx, s);
+
+        case XAPI_CB_WRITE:
+            return on_write(ctx, s);
+
+        case XAPI_CB_MESSAGE:
+            return on_message(ctx);
+
+        case XAPI_CB_COMPLETE:
+            return XAPI_DISCONNECT;
+
+        default:
+            return XAPI_CONTINUE;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int nSignals[2] = { SIGTERM, SIGINT };
+    XSig_Register(nSignals, 2, signal_handler);
+
+    size_t nThreads = argc > 1 ? (size_t)atoi(argv[1]) : (size_t)XCPU_GetCount();
+    uint16_t nPort = argc > 2 ? (uint16_t)atoi(argv[2]) : 8080;
+    if (!nThreads) nThreads = 2;
+    if (nThreads > HTTP_THREADS_MAX) nThreads = HTTP_THREADS_MAX;
+
+    xapi_t api;
+    XAPI_Init(&api, callback, NULL);
+
+    if (XAPI_InitThreads(&api, nThreads, XTRUE) <= 0)
+    {
+        xloge("Thread mode is unavailable in this build");
+        XAPI_Destroy(&api);
+        return 1;
+    }
+
+    xapi_endpoint_t ep;
+    XAPI_InitEndpoint(&ep);
+
+    ep.pAddr = "0.0.0.0";
+    ep.nPort = nPort;
+    ep.eType = XAPI_HTTP;
+    ep.eRole = XAPI_SERVER;
+
+    if (XAPI_AddEndpoint(&api, &ep) < 0 ||
+        XAPI_RunThreads(&api) < 0)
+    {
+        XAPI_Destroy(&api);
+        return 1;
+    }
+
+    uint32_t nElapsed = 0;
+    while (!g_nInterrupted)
+    {
+        xusleep(100000);
+        nElapsed += 100;
+
+        if (nElapsed >= HTTP_STATS_INTERVAL)
+        {
+            /* Broadcast, same pointer is delivered to every thread */
+            XAPI_PostMessage(&api, XAPI_BROADCAST, "stats");
+            nElapsed = 0;
+        }
+    }
+
+    XAPI_PostMessage(&api, XAPI_BROADCAST, "exit");
+    XAPI_StopThreads(&api);
+    XAPI_Destroy(&api);
+    return 0;
+}
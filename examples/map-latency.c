@@ -0,0 +1,118 @@
+/*!
+ *  @file libxutils/examples/map-latency.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the hash map put latency under the steady insert
+ * load. Compares the growth with the whole table rehashed at once and
+ * with the migration spread over the following puts.
+ */
+
+#include "xstd.h"
+#include "map.h"
+#include "str.h"
+#include "xtime.h"
+
+#define LATENCY_DEFAULT_COUNT   2000000
+#define LATENCY_KEY_SIZE        24
+
+static uint64_t get_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *pA, const void *pB)
+{
+    uint64_t nA = *(const uint64_t*)pA;
+    uint64_t nB = *(const uint64_t*)pB;
+    return (nA > nB) - (nA < nB);
+}
+
+static xbool_t bench_puts(char *pKeys, size_t nCount, xbool_t bBlocking, uint64_t *pLatency, uint64_t *pTotal)
+{
+    xmap_t map;
+    XMap_Init(&map, NULL, 0);
+
+    uint64_t nStart = get_nsec();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        char *pKey = &pKeys[i * LATENCY_KEY_SIZE];
+        uint64_t nPutStart = get_nsec();
+
+        /* Grow the whole table at once when the load reaches the limit */
+        if (bBlocking && (uint64_t)map.nCount * 10 >= (uint64_t)map.nTableSize * 7 &&
+            XMap_Realloc(&map) != XMAP_OK) break;
+
+        if (XMap_Put(&map, pKey, pKey) != XMAP_OK) break;
+        pLatency[i] = get_nsec() - nPutStart;
+    }
+
+    *pTotal = get_nsec() - nStart;
+    xbool_t bValid = i == nCount;
+
+    for (i = 0; i < nCount && bValid; i += 997)
+    {
+        char *pKey = &pKeys[i * LATENCY_KEY_SIZE];
+        bValid = XMap_Get(&map, pKey) == pKey;
+    }
+
+    XMap_Destroy(&map);
+    return bValid;
+}
+
+static void print_latency(const char *pName, uint64_t *pLatency, size_t nCount, uint64_t nTotal)
+{
+    qsort(pLatency, nCount, sizeof(uint64_t), compare_u64);
+
+    printf("  %-12s %8.1f %8llu %8llu %8llu %10llu %10.1f\n", pName,
+        (double)nTotal / nCount,
+        (unsigned long long)pLatency[nCount / 2],
+        (unsigned long long)pLatency[nCount * 99 / 100],
+        (unsigned long long)pLatency[nCount * 9999 / 10000],
+        (unsigned long long)pLatency[nCount - 1],
+        nTotal / 1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : LATENCY_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    char *pKeys = (char*)malloc(nCount * LATENCY_KEY_SIZE);
+    uint64_t *pLatency = (uint64_t*)malloc(nCount * sizeof(uint64_t));
+
+    if (pKeys == NULL || pLatency == NULL)
+    {
+        printf("Failed to allocate keys\n");
+        free(pKeys);
+        free(pLatency);
+        return 1;
+    }
+
+    size_t i;
+    for (i = 0; i < nCount; i++)
+        xstrncpyf(&pKeys[i * LATENCY_KEY_SIZE], LATENCY_KEY_SIZE, "session-%zu", i);
+
+    printf("Keys: %zu, put latency in ns\n\n", nCount);
+    printf("  %-12s %8s %8s %8s %8s %10s %10s\n", "", "avg", "p50", "p99", "p99.99", "max", "total ms");
+    uint64_t nTotal = 0;
+
+    if (bench_puts(pKeys, nCount, XTRUE, pLatency, &nTotal)) print_latency("blocking", pLatency, nCount, nTotal);
+    else printf("  %-12s failed\n", "blocking");
+
+    if (bench_puts(pKeys, nCount, XFALSE, pLatency, &nTotal)) print_latency("incremental", pLatency, nCount, nTotal);
+    else printf("  %-12s failed\n", "incremental");
+
+    free(pKeys);
+    free(pLatency);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*!
+ *  @file libxutils/examples/map-lookup.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the hash map with long URL path keys. Measures
+ * puts, lookups of existing and missing keys, and the full table growth.
+ */
+
+#include "xstd.h"
+#include "map.h"
+#include "str.h"
+#include "xtime.h"
+
+#define LOOKUP_DEFAULT_COUNT    1000000
+#define LOOKUP_KEY_SIZE         128
+
+static void make_path(char *pOutput, size_t nIndex, xbool_t bMissing)
+{
+    xstrncpyf(pOutput, LOOKUP_KEY_SIZE,
+        "/api/v2/tenants/%04zu/accounts/%08zu/transactions/history/%s?page=%zu&limit=100",
+        nIndex % 1000, nIndex, bMissing ? "archive" : "summary", nIndex % 50);
+}
+
+static double bench_get(xmap_t *pMap, const char *pKeys, size_t nCount, xbool_t bMissing)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nFound = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        /* Lookup keys are the copies, pointer does not match the stored key */
+        const char *pKey = &pKeys[i * LOOKUP_KEY_SIZE];
+        if (XMap_Get(pMap, pKey) != NULL) nFound++;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (nFound != (bMissing ? 0 : nCount)) return 0.;
+
+    return nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : LOOKUP_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [keys]\n", argv[0]);
+        return 1;
+    }
+
+    char *pKeys = (char*)malloc(nCount * LOOKUP_KEY_SIZE);
+    char *pHits = (char*)malloc(nCount * LOOKUP_KEY_SIZE);
+    char *pMisses = (char*)malloc(nCount * LOOKUP_KEY_SIZE);
+
+    if (pKeys == NULL || pHits == NULL || pMisses == NULL)
+    {
+        printf("Failed to allocate keys\n");
+        free(pKeys);
+        free(pHits);
+        free(pMisses);
+        return 1;
+    }
+
+    size_t i;
+    for (i = 0; i < nCount; i++)
+    {
+        /* Look up in the different order than inserted */
+        size_t nIndex = (i * 7919) % nCount;
+        make_path(&pKeys[i * LOOKUP_KEY_SIZE], i, XFALSE);
+        make_path(&pHits[i * LOOKUP_KEY_SIZE], nIndex, XFALSE);
+        make_path(&pMisses[i * LOOKUP_KEY_SIZE], nIndex, XTRUE);
+    }
+
+    printf("Keys: %zu, example: %s (%zu bytes)\n\n", nCount, pKeys, strlen(pKeys));
+
+    xmap_t map;
+    XMap_Init(&map, NULL, 0);
+
+    uint64_t nStart = XTime_GetStamp();
+    for (i = 0; i < nCount; i++)
+    {
+        char *pKey = &pKeys[i * LOOKUP_KEY_SIZE];
+        if (XMap_Put(&map, pKey, pKey) != XMAP_OK) break;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    if (i < nCount)
+    {
+        printf("Failed to put key: %s\n", &pKeys[i * LOOKUP_KEY_SIZE]);
+        XMap_Destroy(&map);
+        free(pKeys);
+        free(pHits);
+        free(pMisses);
+        return 1;
+    }
+
+    printf("  %-10s %8.1f ns/op\n", "put", nElapsed * 1000.0 / nCount);
+    printf("  %-10s %8.1f ns/op\n", "get hit", bench_get(&map, pHits, nCount, XFALSE));
+    printf("  %-10s %8.1f ns/op\n", "get miss", bench_get(&map, pMisses, nCount, XTRUE));
+
+    nStart = XTime_GetStamp();
+    int nStatus = XMap_Realloc(&map);
+    nElapsed = XTime_GetStamp() - nStart;
+
+    if (nStatus == XMAP_OK) printf("  %-10s %8.1f ms (table: %u)\n", "realloc", nElapsed / 1000.0, map.nTableSize);
+    else printf("  %-10s failed\n", "realloc");
+
+    XMap_Destroy(&map);
+    free(pKeys);
+    free(pHits);
+    free(pMisses);
+    return 0;
+}
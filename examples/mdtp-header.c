@@ -0,0 +1,105 @@
+/*!
+ *  @file libxutils/examples/mdtp-header.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the MDTP header encodings. Assembles and parses
+ * small packets with the JSON header and with the compact binary header.
+ */
+
+#include "xstd.h"
+#include "mdtp.h"
+#include "str.h"
+#include "xtime.h"
+
+#define MDTP_DEFAULT_COUNT  1000000
+#define MDTP_PAYLOAD_SIZE   64
+
+static xbyte_buffer_t *assemble(xpacket_t *pPacket, uint8_t *pPayload, xbool_t bBinary, uint32_t nID)
+{
+    if (XPacket_Init(pPacket, pPayload, MDTP_PAYLOAD_SIZE) != XPACKET_ERR_NONE) return NULL;
+
+    xpacket_header_t *pHeader = &pPacket->header;
+    xstrncpy(pHeader->sPayloadType, sizeof(pHeader->sPayloadType), "binary");
+    pHeader->eType = XPACKET_TYPE_DATA;
+    pHeader->nSessionID = 1234;
+    pHeader->nTimeStamp = 1700000000;
+    pHeader->nPacketID = nID;
+
+    pPacket->bBinary = bBinary;
+    return XPacket_Assemble(pPacket);
+}
+
+static double bench_assemble(uint8_t *pPayload, xbool_t bBinary, size_t nCount)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xpacket_t packet;
+        xbyte_buffer_t *pBuffer = assemble(&packet, pPayload, bBinary, (uint32_t)i + 1);
+
+        XPacket_Clear(&packet);
+        if (pBuffer == NULL) return 0.;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_parse(uint8_t *pPayload, xbool_t bBinary, size_t nCount)
+{
+    xpacket_t packet;
+    xbyte_buffer_t *pBuffer = assemble(&packet, pPayload, bBinary, 1);
+
+    if (pBuffer == NULL)
+    {
+        XPacket_Clear(&packet);
+        return 0.;
+    }
+
+    printf("  %-8s header: %u bytes, packet: %zu bytes\n",
+        bBinary ? "binary" : "json", packet.nHeaderLength, pBuffer->nUsed);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xpacket_t parsed;
+        xpacket_status_t eStatus = XPacket_Parse(&parsed, pBuffer->pData, pBuffer->nUsed);
+        xbool_t bValid = parsed.header.nPacketID == 1 && parsed.pPayload != NULL;
+
+        XPacket_Clear(&parsed);
+        if (eStatus != XPACKET_COMPLETE || !bValid) break;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    XPacket_Clear(&packet);
+
+    return i < nCount ? 0. : nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : MDTP_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [packets]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t payload[MDTP_PAYLOAD_SIZE];
+    memset(payload, 'x', sizeof(payload));
+
+    printf("Packets: %zu, payload: %d bytes\n\n", nCount, MDTP_PAYLOAD_SIZE);
+    double fJsonParse = bench_parse(payload, XFALSE, nCount);
+    double fBinParse = bench_parse(payload, XTRUE, nCount);
+
+    printf("\n  %-8s %10s %10s\n", "", "assemble", "parse");
+    printf("  %-8s %7.1f ns %7.1f ns\n", "json", bench_assemble(payload, XFALSE, nCount), fJsonParse);
+    printf("  %-8s %7.1f ns %7.1f ns\n", "binary", bench_assemble(payload, XTRUE, nCount), fBinParse);
+    return 0;
+}
@@ -0,0 +1,225 @@
+/*!
+ *  @file libxutils/examples/mdtp-stream.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the MDTP stream framing. Encodes packets one by one
+ * and in batches to the single tx buffer, sends them with one write per
+ * packet and per batch, then parses the stream with the per packet
+ * buffer advance and with the framer.
+ */
+
+#include "xstd.h"
+#include "mdtp.h"
+#include "str.h"
+#include "xtime.h"
+
+#define STREAM_DEFAULT_COUNT    1000000
+#define STREAM_PAYLOAD_SIZE     64
+#define STREAM_BATCH_SIZE       64
+
+static void set_header(xpacket_t *pPacket, uint32_t nID)
+{
+    xpacket_header_t *pHeader = &pPacket->header;
+    pHeader->eType = XPACKET_TYPE_DATA;
+    pHeader->nSessionID = 1234;
+    pHeader->nPacketID = nID;
+    pPacket->bBinary = XTRUE;
+}
+
+static double bench_encode_single(xbyte_buffer_t *pTx, uint8_t *pPayload, size_t nCount)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        if (i % STREAM_BATCH_SIZE == 0) XByteBuffer_Reset(pTx);
+
+        xpacket_t packet;
+        XPacket_Init(&packet, pPayload, STREAM_PAYLOAD_SIZE);
+        set_header(&packet, (uint32_t)i);
+
+        xbyte_buffer_t *pBuffer = XPacket_Assemble(&packet);
+        int nStatus = pBuffer != NULL ? XByteBuffer_AddBuff(pTx, pBuffer) : XSTDERR;
+
+        XPacket_Clear(&packet);
+        if (nStatus < 0) return 0.;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_encode_batch(xbyte_buffer_t *pTx, uint8_t *pPayload, size_t nCount)
+{
+    xpacket_t packet;
+    XPacket_Init(&packet, pPayload, STREAM_PAYLOAD_SIZE);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        if (i % STREAM_BATCH_SIZE == 0) XByteBuffer_Reset(pTx);
+        set_header(&packet, (uint32_t)i);
+
+        if (XPacket_AssembleTo(&packet, pTx) != XPACKET_ERR_NONE)
+        {
+            XPacket_Clear(&packet);
+            return 0.;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    XPacket_Clear(&packet);
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_write(int *pFDs, const xbyte_buffer_t *pTx, size_t nCount, xbool_t bBatch)
+{
+    size_t nPacketSize = pTx->nUsed / STREAM_BATCH_SIZE;
+    uint8_t sBuffer[XSTR_BIG];
+    if (!nPacketSize) return 0.;
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, j;
+
+    for (i = 0; i < nCount; i += STREAM_BATCH_SIZE)
+    {
+        if (bBatch)
+        {
+            if (write(pFDs[0], pTx->pData, pTx->nUsed) != (ssize_t)pTx->nUsed) return 0.;
+        }
+        else
+        {
+            for (j = 0; j < STREAM_BATCH_SIZE; j++)
+            {
+                const uint8_t *pPacket = &pTx->pData[j * nPacketSize];
+                if (write(pFDs[0], pPacket, nPacketSize) != (ssize_t)nPacketSize) return 0.;
+            }
+        }
+
+        size_t nReceived = 0;
+        while (nReceived < pTx->nUsed)
+        {
+            ssize_t nRead = read(pFDs[1], sBuffer, sizeof(sBuffer));
+            if (nRead <= 0) return 0.;
+            nReceived += (size_t)nRead;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_parse_advance(const xbyte_buffer_t *pTx, size_t nCount)
+{
+    xbyte_buffer_t rx;
+    XByteBuffer_Init(&rx, pTx->nUsed, XFALSE);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nParsed = 0;
+
+    for (i = 0; i < nCount; i += STREAM_BATCH_SIZE)
+    {
+        XByteBuffer_Add(&rx, pTx->pData, pTx->nUsed);
+
+        while (rx.nUsed)
+        {
+            xpacket_t packet;
+            xpacket_status_t eStatus = XPacket_Parse(&packet, rx.pData, rx.nUsed);
+
+            if (eStatus == XPACKET_COMPLETE)
+            {
+                XByteBuffer_Advance(&rx, XPacket_GetSize(&packet));
+                nParsed++;
+            }
+
+            XPacket_Clear(&packet);
+            if (eStatus != XPACKET_COMPLETE) break;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    XByteBuffer_Clear(&rx);
+
+    return nParsed == nCount ? nElapsed * 1000.0 / nCount : 0.;
+}
+
+static double bench_parse_framer(const xbyte_buffer_t *pTx, size_t nCount)
+{
+    xbyte_buffer_t rx;
+    XByteBuffer_Init(&rx, pTx->nUsed, XFALSE);
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, nParsed = 0;
+
+    for (i = 0; i < nCount; i += STREAM_BATCH_SIZE)
+    {
+        XByteBuffer_Add(&rx, pTx->pData, pTx->nUsed);
+
+        xpacket_framer_t framer;
+        XPacket_InitFramer(&framer, rx.pData, rx.nUsed);
+
+        xpacket_t packet;
+        while (XPacket_NextFrame(&framer, &packet) == XPACKET_COMPLETE)
+        {
+            XPacket_Clear(&packet);
+            nParsed++;
+        }
+
+        XPacket_Clear(&packet);
+        XByteBuffer_Advance(&rx, framer.nOffset);
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    XByteBuffer_Clear(&rx);
+
+    return nParsed == nCount ? nElapsed * 1000.0 / nCount : 0.;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : STREAM_DEFAULT_COUNT;
+    nCount -= nCount % STREAM_BATCH_SIZE;
+
+    if (!nCount)
+    {
+        printf("Usage: %s [packets]\n", argv[0]);
+        return 1;
+    }
+
+    int nFDs[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, nFDs) < 0)
+    {
+        printf("Failed to create socket pair: %s\n", strerror(errno));
+        return 1;
+    }
+
+    uint8_t payload[STREAM_PAYLOAD_SIZE];
+    memset(payload, 'x', sizeof(payload));
+
+    xbyte_buffer_t tx;
+    XByteBuffer_Init(&tx, XSTDNON, XFALSE);
+
+    printf("Packets: %zu, payload: %d bytes, batch: %d\n\n",
+        nCount, STREAM_PAYLOAD_SIZE, STREAM_BATCH_SIZE);
+
+    printf("  %-8s %10s %10s %10s\n", "", "encode", "write", "parse");
+    double fEncode = bench_encode_single(&tx, payload, nCount);
+    double fWrite = bench_write(nFDs, &tx, nCount, XFALSE);
+    double fParse = bench_parse_advance(&tx, nCount);
+    printf("  %-8s %7.1f ns %7.1f ns %7.1f ns\n", "single", fEncode, fWrite, fParse);
+
+    fEncode = bench_encode_batch(&tx, payload, nCount);
+    fWrite = bench_write(nFDs, &tx, nCount, XTRUE);
+    fParse = bench_parse_framer(&tx, nCount);
+    printf("  %-8s %7.1f ns %7.1f ns %7.1f ns\n", "batch", fEncode, fWrite, fParse);
+
+    XByteBuffer_Clear(&tx);
+    close(nFDs[0]);
+    close(nFDs[1]);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*!
+ *  @file libxutils/examples/rtp-jitter.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the RTP jitter buffer. Replays the RTP stream with
+ * random network delay through XJitter and through the ordered insert
+ * to the linked list and compares the cost per packet.
+ */
+
+#include "xstd.h"
+#include "jitter.h"
+#include "list.h"
+#include "xtime.h"
+
+#define JITTER_DEFAULT_COUNT    1000000
+#define JITTER_DEFAULT_DELAY    50
+#define JITTER_PACKET_SIZE      172
+#define JITTER_PACKETS_PER_MS   10
+#define JITTER_TS_STEP          (XJITTER_CLOCK_RATE / 1000 / JITTER_PACKETS_PER_MS)
+#define JITTER_SLOTS            8192
+#define JITTER_SSRC             0x12345678
+
+typedef struct {
+    uint64_t nArrival;
+    uint32_t nIndex;
+} arrival_t;
+
+typedef struct {
+    uint32_t nTimeStamp;
+    uint16_t nSequence;
+    uint8_t data[JITTER_PACKET_SIZE];
+} list_packet_t;
+
+static int compare_arrival(const void *pA, const void *pB)
+{
+    const arrival_t *pFirst = (const arrival_t*)pA;
+    const arrival_t *pSecond = (const arrival_t*)pB;
+
+    if (pFirst->nArrival != pSecond->nArrival)
+        return pFirst->nArrival < pSecond->nArrival ? -1 : 1;
+
+    return pFirst->nIndex < pSecond->nIndex ? -1 : 1;
+}
+
+static void build_packet(uint8_t *pPacket, uint32_t nIndex)
+{
+    uint16_t nSequence = htons((uint16_t)nIndex);
+    uint32_t nTimeStamp = htonl(nIndex * JITTER_TS_STEP);
+    uint32_t nSSRC = htonl(JITTER_SSRC);
+
+    memset(pPacket, 0, JITTER_PACKET_SIZE);
+    pPacket[0] = 0x80;
+    pPacket[1] = 96;
+    memcpy(&pPacket[2], &nSequence, sizeof(nSequence));
+    memcpy(&pPacket[4], &nTimeStamp, sizeof(nTimeStamp));
+    memcpy(&pPacket[8], &nSSRC, sizeof(nSSRC));
+}
+
+static double bench_jitter(const arrival_t *pArrivals, size_t nCount, uint32_t nDelay)
+{
+    xjitter_t jitter;
+    if (XJitter_Init(&jitter, 1, JITTER_SLOTS, XJITTER_CLOCK_RATE) < 0) return 0.;
+
+    jitter.nSlotSize = JITTER_PACKET_SIZE;
+    jitter.nMinDelay = nDelay;
+
+    uint8_t packet[JITTER_PACKET_SIZE];
+    xjitter_packet_t out;
+    size_t i, nPlayed = 0;
+
+    uint64_t nStart = XTime_GetStamp();
+
+    for (i = 0; i < nCount; i++)
+    {
+        build_packet(packet, pArrivals[i].nIndex);
+        XJitter_Push(&jitter, packet, sizeof(packet), pArrivals[i].nArrival);
+        while (XJitter_Pop(&jitter, pArrivals[i].nArrival, &out) > 0) nPlayed++;
+    }
+
+    while (XJitter_Pop(&jitter, UINT64_MAX / 2, &out) > 0) nPlayed++;
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+
+    xjitter_stream_t *pStream = XJitter_GetStream(&jitter, JITTER_SSRC);
+    if (pStream != NULL)
+    {
+        printf("  played: %zu, lost: %"PRIu64", late: %"PRIu64", reordered: %"PRIu64", delay: %u ms\n",
+            nPlayed, pStream->stats.nLost, pStream->stats.nLate,
+            pStream->stats.nReordered, pStream->stats.nDelay);
+    }
+
+    XJitter_Destroy(&jitter);
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_list(const arrival_t *pArrivals, size_t nCount, uint32_t nDelay)
+{
+    xlist_t *pHead = NULL;
+    xlist_t *pTail = NULL;
+    size_t i, nPlayed = 0;
+    uint64_t nNow = 0;
+
+    uint64_t nStart = XTime_GetStamp();
+
+    for (i = 0; i <= nCount; i++)
+    {
+        if (i < nCount)
+        {
+            list_packet_t *pPacket = (list_packet_t*)malloc(sizeof(list_packet_t));
+            if (pPacket == NULL) break;
+
+            build_packet(pPacket->data, pArrivals[i].nIndex);
+            pPacket->nSequence = (uint16_t)pArrivals[i].nIndex;
+            pPacket->nTimeStamp = pArrivals[i].nIndex * JITTER_TS_STEP;
+            nNow = pArrivals[i].nArrival;
+
+            xlist_t *pNode = XList_New(pPacket, sizeof(list_packet_t), NULL, NULL);
+            if (pNode == NULL)
+            {
+                free(pPacket);
+                break;
+            }
+
+            /* Walk back from the tail to the ordered position */
+            xlist_t *pPos = pTail;
+            while (pPos != NULL)
+            {
+                list_packet_t *pQueued = (list_packet_t*)pPos->data.pData;
+                if ((int16_t)(uint16_t)(pPacket->nSequence - pQueued->nSequence) > 0) break;
+                pPos = pPos->pPrev;
+            }
+
+            if (pPos != NULL) XList_InsertNext(pPos, pNode);
+            else if (pHead != NULL) XList_InsertPrev(pHead, pNode);
+
+            if (pPos == NULL) pHead = pNode;
+            if (pPos == pTail) pTail = pNode;
+        }
+        else nNow = UINT64_MAX / 2;
+
+        /* Fixed playout delay, media clock starts at zero like the arrivals */
+        while (pHead != NULL)
+        {
+            list_packet_t *pQueued = (list_packet_t*)pHead->data.pData;
+            uint64_t nPlayTime = pQueued->nTimeStamp / (XJITTER_CLOCK_RATE / 1000) + nDelay;
+            if (nPlayTime > nNow) break;
+
+            xlist_t *pNext = pHead->pNext;
+            XList_Detach(pHead);
+            XList_Free(pHead);
+
+            pHead = pNext;
+            if (pHead == NULL) pTail = NULL;
+            nPlayed++;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    printf("  played: %zu\n", nPlayed);
+
+    XList_Clear(pHead);
+    return nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : JITTER_DEFAULT_COUNT;
+    uint32_t nJitter = argc > 2 ? (uint32_t)atoi(argv[2]) : JITTER_DEFAULT_DELAY;
+
+    if (!nCount || !nJitter)
+    {
+        printf("Usage: %s [packets] [jitter-ms]\n", argv[0]);
+        return 1;
+    }
+
+    arrival_t *pArrivals = (arrival_t*)malloc(nCount * sizeof(arrival_t));
+    if (pArrivals == NULL)
+    {
+        printf("Failed to allocate arrivals\n");
+        return 1;
+    }
+
+    /* Uniform random network delay up to the jitter value */
+    srand(1);
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        pArrivals[i].nIndex = (uint32_t)i;
+        pArrivals[i].nArrival = i / JITTER_PACKETS_PER_MS + (uint64_t)(rand() % nJitter);
+    }
+
+    qsort(pArrivals, nCount, sizeof(arrival_t), compare_arrival);
+
+    printf("Packets: %zu, rate: %d/ms, jitter: %u ms\n\n",
+        nCount, JITTER_PACKETS_PER_MS, nJitter);
+
+    printf("xjitter:\n");
+    double fJitter = bench_jitter(pArrivals, nCount, nJitter);
+    printf("  %8.1f ns/pkt\n\n", fJitter);
+
+    printf("xlist:\n");
+    double fList = bench_list(pArrivals, nCount, nJitter);
+    printf("  %8.1f ns/pkt\n", fList);
+
+    free(pArrivals);
+    return 0;
+}
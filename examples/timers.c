@@ -0,0 +1,157 @@
+/*!
+ *  @file libxutils/examples/timers.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the event timers with constant re-arming.
+ * Timers are handled by the hierarchical timer wheel only when the library
+ * and this example are built with _XEVENTS_USE_EVENT_LIST (default on non
+ * linux platforms), otherwise each timer would need its own timerfd.
+ */
+
+#include "xstd.h"
+#include "event.h"
+#include "xtime.h"
+
+#define TIMERS_DEFAULT_COUNT    1000000
+#define TIMERS_DEFAULT_SECONDS  5
+#define TIMERS_TIMEOUT_MAX      1000
+
+typedef struct {
+    xevent_data_t **pTimers;
+    uint64_t nExpired;
+    uint64_t nExtended;
+    uint32_t nSeed;
+} timers_bench_t;
+
+#ifdef _XEVENTS_USE_EVENT_LIST
+static int get_timeout(timers_bench_t *pBench)
+{
+    /* xorshift32, cheap enough to not affect the results */
+    uint32_t x = pBench->nSeed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pBench->nSeed = x;
+    return (int)(x % TIMERS_TIMEOUT_MAX) + 1;
+}
+
+static int timer_callback(void *events, void* data, XSOCKET fd, xevent_cb_type_t reason)
+{
+    (void)fd;
+    if (reason != XEVENT_CB_TIMEOUT) return XEVENTS_CONTINUE;
+
+    xevents_t *pEvents = (xevents_t*)events;
+    xevent_data_t *pTimer = (xevent_data_t*)data;
+    timers_bench_t *pBench = (timers_bench_t*)pEvents->pUserSpace;
+
+    pBench->nExpired++;
+    XEvents_ExtendTimer(pEvents, pTimer, get_timeout(pBench));
+    return XEVENTS_CONTINUE;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+#if !defined(_XEVENTS_USE_EVENT_LIST)
+    (void)argc;
+    (void)argv;
+    printf("Timer wheel is not enabled, rebuild libxutils and\n");
+    printf("this example with -D_XEVENTS_USE_EVENT_LIST flag.\n");
+    return 0;
+#else
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : TIMERS_DEFAULT_COUNT;
+    int nSeconds = argc > 2 ? atoi(argv[2]) : TIMERS_DEFAULT_SECONDS;
+    if (!nCount || nSeconds <= 0)
+    {
+        printf("Usage: %s [timer-count] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    timers_bench_t bench;
+    bench.nExpired = bench.nExtended = 0;
+    bench.nSeed = 2463534242u;
+
+    bench.pTimers = (xevent_data_t**)calloc(nCount, sizeof(xevent_data_t*));
+    if (bench.pTimers == NULL)
+    {
+        printf("Failed to allocate timer array: %s\n", XSTRERR);
+        return 1;
+    }
+
+    xevents_t events;
+    xevent_status_t status = XEvents_Create(&events, 0, &bench, timer_callback, XTRUE);
+    if (status != XEVENTS_SUCCESS)
+    {
+        printf("Failed to create events: %s\n", XEvents_GetStatusStr(status));
+        free(bench.pTimers);
+        return 1;
+    }
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        bench.pTimers[i] = XEvents_AddTimer(&events, NULL, get_timeout(&bench));
+        if (bench.pTimers[i] == NULL)
+        {
+            printf("Failed to add timer: %zu\n", i);
+            XEvents_Destroy(&events);
+            free(bench.pTimers);
+            return 1;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    printf("Added %zu timers in %.3f ms (%.1f ns/op)\n", nCount,
+        nElapsed / 1000.0, nElapsed * 1000.0 / nCount);
+
+    uint64_t nEndTime = XTime_GetMs() + (uint64_t)nSeconds * 1000;
+    uint64_t nServiceMax = 0, nServiceTotal = 0, nLoops = 0;
+    uint64_t nExtendTotal = 0;
+    size_t nBatch = nCount / 100 ? nCount / 100 : 1;
+    size_t nCursor = 0;
+
+    while (XTime_GetMs() < nEndTime)
+    {
+        /* Simulate activity on keep-alive sessions */
+        nStart = XTime_GetStamp();
+
+        for (i = 0; i < nBatch; i++)
+        {
+            XEvents_ExtendTimer(&events, bench.pTimers[nCursor], get_timeout(&bench));
+            nCursor = (nCursor + 1) % nCount;
+        }
+
+        nExtendTotal += XTime_GetStamp() - nStart;
+        bench.nExtended += nBatch;
+
+        nStart = XTime_GetStamp();
+        XEvents_Service(&events, 1);
+        nElapsed = XTime_GetStamp() - nStart;
+
+        if (nElapsed > nServiceMax) nServiceMax = nElapsed;
+        nServiceTotal += nElapsed;
+        nLoops++;
+    }
+
+    printf("Extended %"PRIu64" timers (%.1f ns/op)\n", bench.nExtended,
+        bench.nExtended ? nExtendTotal * 1000.0 / bench.nExtended : 0.0);
+
+    printf("Expired %"PRIu64" timers (%.0f/sec)\n", bench.nExpired,
+        (double)bench.nExpired / nSeconds);
+
+    printf("Service loops: %"PRIu64", avg: %.3f ms, max: %.3f ms\n", nLoops,
+        nLoops ? nServiceTotal / 1000.0 / nLoops : 0.0, nServiceMax / 1000.0);
+
+    nStart = XTime_GetStamp();
+    XEvents_Destroy(&events);
+    nElapsed = XTime_GetStamp() - nStart;
+
+    printf("Destroyed events in %.3f ms\n", nElapsed / 1000.0);
+    free(bench.pTimers);
+    return 0;
+#endif
+}
@@ -0,0 +1,166 @@
+/*!
+ *  @file libxutils/examples/udp-batch.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the batched datagram I/O. Sends RTP sized packets
+ * over loopback one per syscall, with XSock_SendBatch/XSock_RecvBatch
+ * and with UDP segmentation offload where the kernel supports it.
+ */
+
+#include "xstd.h"
+#include "sock.h"
+#include "xtime.h"
+#include "str.h"
+
+#define UDP_DEFAULT_COUNT   1000000
+#define UDP_PACKET_SIZE     172
+#define UDP_BATCH_SIZE      32
+#define UDP_PORT            6970
+
+static int recv_all(xsock_t *pRecv, xsock_batch_t *pBatch, size_t nCount)
+{
+    size_t nDone = 0;
+
+    while (nDone < nCount)
+    {
+        int nReceived = XSock_RecvBatch(pRecv, pBatch->pPackets, pBatch->nCount);
+        if (nReceived <= 0) return XSTDERR;
+
+        int i;
+        for (i = 0; i < nReceived; i++)
+        {
+            /* GRO merges segments into one buffer */
+            const xsock_packet_t *pPacket = &pBatch->pPackets[i];
+            size_t nSegment = pPacket->nSegment ? pPacket->nSegment : pPacket->nLength;
+            nDone += (pPacket->nLength + nSegment - 1) / nSegment;
+        }
+    }
+
+    return XSTDOK;
+}
+
+static double bench_single(xsock_t *pSend, xsock_t *pRecv, size_t nCount)
+{
+    uint8_t sPacket[UDP_PACKET_SIZE];
+    memset(sPacket, 0x80, sizeof(sPacket));
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i, j;
+
+    for (i = 0; i < nCount; i += UDP_BATCH_SIZE)
+    {
+        for (j = 0; j < UDP_BATCH_SIZE; j++)
+            if (XSock_Send(pSend, sPacket, sizeof(sPacket)) <= 0) return 0.;
+
+        for (j = 0; j < UDP_BATCH_SIZE; j++)
+            if (XSock_Recv(pRecv, sPacket, sizeof(sPacket)) <= 0) return 0.;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_batch(xsock_t *pSend, xsock_t *pRecv, xsock_batch_t *pBatch, size_t nCount)
+{
+    xsock_batch_t send;
+    if (XSock_InitBatch(&send, UDP_BATCH_SIZE, UDP_PACKET_SIZE) < 0) return 0.;
+
+    size_t i;
+    for (i = 0; i < send.nCount; i++)
+    {
+        memset(send.pPackets[i].pData, 0x80, UDP_PACKET_SIZE);
+        send.pPackets[i].nLength = UDP_PACKET_SIZE;
+    }
+
+    uint64_t nStart = XTime_GetStamp();
+
+    for (i = 0; i < nCount; i += UDP_BATCH_SIZE)
+    {
+        if (XSock_SendBatch(pSend, send.pPackets, send.nCount) != (int)send.nCount ||
+            recv_all(pRecv, pBatch, UDP_BATCH_SIZE) < 0)
+        {
+            XSock_ClearBatch(&send);
+            return 0.;
+        }
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    XSock_ClearBatch(&send);
+    return nElapsed * 1000.0 / nCount;
+}
+
+static double bench_gso(xsock_t *pSend, xsock_t *pRecv, xsock_batch_t *pBatch, size_t nCount)
+{
+    uint8_t sBuffer[UDP_PACKET_SIZE * UDP_BATCH_SIZE];
+    memset(sBuffer, 0x80, sizeof(sBuffer));
+
+    /* One super packet is split to UDP_BATCH_SIZE datagrams by the kernel */
+    xsock_packet_t packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.pData = sBuffer;
+    packet.nSize = sizeof(sBuffer);
+    packet.nLength = sizeof(sBuffer);
+    packet.nSegment = UDP_PACKET_SIZE;
+
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i += UDP_BATCH_SIZE)
+    {
+        if (XSock_SendBatch(pSend, &packet, 1) != 1 ||
+            recv_all(pRecv, pBatch, UDP_BATCH_SIZE) < 0) return 0.;
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed * 1000.0 / nCount;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : UDP_DEFAULT_COUNT;
+    if (!nCount)
+    {
+        printf("Usage: %s [packets]\n", argv[0]);
+        return 1;
+    }
+
+    xsock_t recvSock, sendSock;
+    XSock_Create(&recvSock, XSOCK_UDP_UCAST, "127.0.0.1", UDP_PORT);
+    XSock_Bind(&recvSock);
+    XSock_Create(&sendSock, XSOCK_UDP_CLIENT, "127.0.0.1", UDP_PORT);
+
+    if (recvSock.nFD == XSOCK_INVALID || sendSock.nFD == XSOCK_INVALID)
+    {
+        xsock_t *pSock = recvSock.nFD == XSOCK_INVALID ? &recvSock : &sendSock;
+        printf("Failed to create socket: %s\n", XSock_ErrStr(pSock));
+        XSock_Close(&recvSock);
+        XSock_Close(&sendSock);
+        return 1;
+    }
+
+    /* Large enough for GRO super packets */
+    xsock_batch_t batch;
+    if (XSock_InitBatch(&batch, UDP_BATCH_SIZE, UDP_PACKET_SIZE * UDP_BATCH_SIZE) < 0)
+    {
+        printf("Failed to allocate batch\n");
+        XSock_Close(&recvSock);
+        XSock_Close(&sendSock);
+        return 1;
+    }
+
+    printf("Packets: %zu, size: %d, batch: %d\n\n", nCount, UDP_PACKET_SIZE, UDP_BATCH_SIZE);
+    printf("  %-10s %8.1f ns/pkt\n", "single", bench_single(&sendSock, &recvSock, nCount));
+    printf("  %-10s %8.1f ns/pkt\n", "batch", bench_batch(&sendSock, &recvSock, &batch, nCount));
+
+    if (XSock_SetGRO(&recvSock, XTRUE) != XSOCK_INVALID)
+        printf("  %-10s %8.1f ns/pkt\n", "gso/gro", bench_gso(&sendSock, &recvSock, &batch, nCount));
+    else
+        printf("  %-10s %s\n", "gso/gro", XSock_ErrStr(&recvSock));
+
+    XSock_ClearBatch(&batch);
+    XSock_Close(&recvSock);
+    XSock_Close(&sendSock);
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*!
+ *  @file libxutils/examples/ws-broadcast.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the WebSocket broadcast. Connects local clients
+ * to the WS server and pushes messages to all of them with the frame
+ * created per session and with the single shared frame.
+ */
+
+#include "xstd.h"
+#include "api.h"
+#include "xtime.h"
+
+#define BCAST_DEFAULT_CLIENTS   400
+#define BCAST_DEFAULT_ROUNDS    200
+#define BCAST_DEFAULT_PAYLOAD   256
+#define BCAST_PORT              6975
+
+#define BCAST_HANDSHAKE \
+    "GET / HTTP/1.1\r\n" \
+    "Host: 127.0.0.1\r\n" \
+    "Upgrade: websocket\r\n" \
+    "Connection: Upgrade\r\n" \
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n" \
+    "Sec-WebSocket-Version: 13\r\n\r\n"
+
+typedef struct {
+    uint64_t nQueue;
+    uint64_t nTotal;
+} bcast_time_t;
+
+static int service_callback(xapi_ctx_t *pCtx, xapi_session_t *pSession)
+{
+    switch (pCtx->eCbType)
+    {
+        case XAPI_CB_ACCEPTED:
+            return XAPI_SetEvents(pSession, XPOLLIN);
+        case XAPI_CB_ERROR:
+            printf("%s\n", XAPI_GetStatus(pCtx));
+            return XAPI_DISCONNECT;
+        default:
+            break;
+    }
+
+    return XAPI_CONTINUE;
+}
+
+static int connect_client(uint16_t nPort)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(nPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int nFD = socket(AF_INET, SOCK_STREAM, 0);
+    if (nFD < 0) return XSTDERR;
+
+    if (connect(nFD, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        write(nFD, BCAST_HANDSHAKE, strlen(BCAST_HANDSHAKE)) < 0)
+    {
+        close(nFD);
+        return XSTDERR;
+    }
+
+    fcntl(nFD, F_SETFL, fcntl(nFD, F_GETFL, 0) | O_NONBLOCK);
+    return nFD;
+}
+
+static size_t drain_clients(const int *pClients, size_t nClients)
+{
+    uint8_t sBuffer[XSTR_BIG];
+    size_t i, nTotal = 0;
+
+    for (i = 0; i < nClients; i++)
+    {
+        ssize_t nRead;
+        while ((nRead = read(pClients[i], sBuffer, sizeof(sBuffer))) > 0)
+            nTotal += (size_t)nRead;
+    }
+
+    return nTotal;
+}
+
+static size_t get_pending(xapi_t *pApi)
+{
+    xapi_session_t *pSession = pApi->pWSHead;
+    size_t nPending = 0;
+
+    while (pSession != NULL)
+    {
+        nPending += XAPI_GetTxPending(pSession);
+        pSession = pSession->pWSNext;
+    }
+
+    return nPending;
+}
+
+static size_t queue_copy(xapi_t *pApi, const uint8_t *pPayload, size_t nLength)
+{
+    xapi_session_t *pSession = pApi->pWSHead;
+    size_t nCount = 0;
+
+    while (pSession != NULL)
+    {
+        xws_frame_t frame;
+        if (XWebFrame_Create(&frame, pPayload, nLength, XWS_BINARY, XFALSE, XTRUE) != XWS_ERR_NONE) break;
+
+        if (XAPI_PutTxBuff(pSession, &frame.buffer) > 0 &&
+            XAPI_EnableEvent(pSession, XPOLLOUT) > 0) nCount++;
+
+        XWebFrame_Clear(&frame);
+        pSession = pSession->pWSNext;
+    }
+
+    return nCount;
+}
+
+static xbool_t bench_broadcast(xapi_t *pApi, const int *pClients, size_t nClients, size_t nRounds,
+                               const uint8_t *pPayload, size_t nLength, xbool_t bShared, bcast_time_t *pTime)
+{
+    size_t nFrameSize = nLength + (nLength <= 125 ? 2 : nLength <= 65535 ? 4 : 10);
+    size_t i, nReceived = 0;
+
+    pTime->nQueue = 0;
+    pTime->nTotal = 0;
+
+    for (i = 0; i < nRounds; i++)
+    {
+        uint64_t nStart = XTime_GetStamp();
+
+        size_t nQueued = bShared ?
+            XAPI_Broadcast(pApi, pPayload, nLength, XWS_BINARY) :
+            queue_copy(pApi, pPayload, nLength);
+
+        uint64_t nQueueEnd = XTime_GetStamp();
+        if (nQueued != nClients) return XFALSE;
+
+        while (get_pending(pApi))
+            if (XAPI_Service(pApi, 0) != XEVENTS_SUCCESS) return XFALSE;
+
+        uint64_t nEnd = XTime_GetStamp();
+        pTime->nQueue += nQueueEnd - nStart;
+        pTime->nTotal += nEnd - nStart;
+
+        /* Clients are drained outside of the measured part */
+        nReceived += drain_clients(pClients, nClients);
+    }
+
+    while (nReceived < nFrameSize * nClients * nRounds)
+    {
+        size_t nBytes = drain_clients(pClients, nClients);
+        if (!nBytes) break;
+        nReceived += nBytes;
+    }
+
+    return nReceived == nFrameSize * nClients * nRounds;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nClients = argc > 1 ? (size_t)atol(argv[1]) : BCAST_DEFAULT_CLIENTS;
+    size_t nRounds = argc > 2 ? (size_t)atol(argv[2]) : BCAST_DEFAULT_ROUNDS;
+    size_t nLength = argc > 3 ? (size_t)atol(argv[3]) : BCAST_DEFAULT_PAYLOAD;
+    uint16_t nPort = argc > 4 ? (uint16_t)atoi(argv[4]) : BCAST_PORT;
+
+    if (!nClients || !nRounds || !nLength || !nPort)
+    {
+        printf("Usage: %s [clients] [rounds] [payload] [port]\n", argv[0]);
+        return 1;
+    }
+
+    int *pClients = (int*)malloc(nClients * sizeof(int));
+    uint8_t *pPayload = (uint8_t*)malloc(nLength);
+
+    if (pClients == NULL || pPayload == NULL)
+    {
+        printf("Failed to allocate clients\n");
+        free(pClients);
+        free(pPayload);
+        return 1;
+    }
+
+    memset(pPayload, 'x', nLength);
+
+    xapi_t api;
+    XAPI_Init(&api, service_callback, NULL);
+
+    xapi_endpoint_t endpt;
+    XAPI_InitEndpoint(&endpt);
+
+    endpt.eType = XAPI_WS;
+    endpt.eRole = XAPI_SERVER;
+    endpt.pAddr = "127.0.0.1";
+    endpt.nPort = nPort;
+
+    if (XAPI_AddEndpoint(&api, &endpt) < 0)
+    {
+        XAPI_Destroy(&api);
+        free(pClients);
+        free(pPayload);
+        return 1;
+    }
+
+    size_t i, nConnected = 0;
+    for (i = 0; i < nClients; i++)
+    {
+        pClients[i] = connect_client(nPort);
+        if (pClients[i] < 0) break;
+
+        nConnected++;
+        XAPI_Service(&api, 0);
+    }
+
+    uint64_t nDeadline = XTime_GetMs() + 5000;
+    while (nConnected == nClients &&
+           XAPI_GetWSCount(&api) < nClients &&
+           XTime_GetMs() < nDeadline)
+    {
+        XAPI_Service(&api, 10);
+        drain_clients(pClients, nConnected);
+    }
+
+    while (get_pending(&api)) XAPI_Service(&api, 10);
+    drain_clients(pClients, nConnected);
+
+    if (XAPI_GetWSCount(&api) != nClients)
+    {
+        printf("Connected %zu of %zu clients, check the open file limit\n",
+            XAPI_GetWSCount(&api), nClients);
+
+        for (i = 0; i < nConnected; i++) close(pClients[i]);
+        XAPI_Destroy(&api);
+        free(pClients);
+        free(pPayload);
+        return 1;
+    }
+
+    printf("Clients: %zu, rounds: %zu, payload: %zu bytes\n\n",
+        nClients, nRounds, nLength);
+
+    printf("  %-8s %14s %14s\n", "", "queue", "total");
+    size_t nMessages = nClients * nRounds;
+    bcast_time_t times;
+
+    if (bench_broadcast(&api, pClients, nClients, nRounds, pPayload, nLength, XFALSE, &times))
+    {
+        printf("  %-8s %8.1f ns/ses %8.1f ns/ses\n", "copy",
+            times.nQueue * 1000.0 / nMessages, times.nTotal * 1000.0 / nMessages);
+    }
+    else printf("  copy: broadcast failed\n");
+
+    if (bench_broadcast(&api, pClients, nClients, nRounds, pPayload, nLength, XTRUE, &times))
+    {
+        printf("  %-8s %8.1f ns/ses %8.1f ns/ses\n", "shared",
+            times.nQueue * 1000.0 / nMessages, times.nTotal * 1000.0 / nMessages);
+    }
+    else printf("  shared: broadcast failed\n");
+
+    for (i = 0; i < nClients; i++) close(pClients[i]);
+    XAPI_Destroy(&api);
+    free(pClients);
+    free(pPayload);
+    return 0;
+}
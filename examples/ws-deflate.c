@@ -0,0 +1,400 @@
+/*!
+ *  @file libxutils/examples/ws-deflate.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the WebSocket permessage-deflate. Encodes JSON
+ * messages without compression, with per message context and with
+ * context takeover, then broadcasts them to the local deflate clients
+ * with compression disabled and enabled on the server.
+ */
+
+#include "xstd.h"
+#include "api.h"
+#include "xtime.h"
+
+#define DEFLATE_DEFAULT_COUNT   20000
+#define DEFLATE_DEFAULT_CLIENTS 100
+#define DEFLATE_BCAST_ROUNDS    200
+#define DEFLATE_PORT            6976
+
+#define DEFLATE_HANDSHAKE \
+    "GET / HTTP/1.1\r\n" \
+    "Host: 127.0.0.1\r\n" \
+    "Upgrade: websocket\r\n" \
+    "Connection: Upgrade\r\n" \
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n" \
+    "Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n" \
+    "Sec-WebSocket-Version: 13\r\n\r\n"
+
+typedef struct {
+    uint64_t nEncode;
+    uint64_t nDecode;
+    size_t nBytes;
+} deflate_stats_t;
+
+static size_t make_message(char *pOutput, size_t nSize, size_t nIndex)
+{
+    size_t i, nLength = xstrncpyf(pOutput, nSize, "{\"seq\":%zu,\"quotes\":[", nIndex);
+
+    for (i = 0; i < 12 && nLength < nSize; i++)
+    {
+        unsigned nPrice = (unsigned)((nIndex * 7919 + i * 104729) % 100000);
+        nLength += xstrncpyf(pOutput + nLength, nSize - nLength,
+            "%s{\"symbol\":\"SYM%02zu\",\"bid\":%u.%02u,\"ask\":%u.%02u,\"volume\":%u,\"exchange\":\"XNAS\"}",
+            i ? "," : "", i, nPrice / 100, nPrice % 100, nPrice / 100 + 1, nPrice % 100, nPrice * 13);
+    }
+
+    nLength += xstrncpyf(pOutput + nLength, nSize - nLength, "]}");
+    return nLength;
+}
+
+static xbool_t bench_messages(size_t nCount, int nMode, deflate_stats_t *pStats)
+{
+    xws_zpool_t deflatePool, inflatePool;
+    XWS_InitZPool(&deflatePool, XTRUE, XWS_DEFLATE_LEVEL, 1);
+    XWS_InitZPool(&inflatePool, XFALSE, XSTDNON, 1);
+
+    xws_zstream_t *pDeflater = XWS_GetZStream(&deflatePool, XWS_DEFLATE_BITS_MAX);
+    xws_zstream_t *pInflater = XWS_GetZStream(&inflatePool, XWS_DEFLATE_BITS_MAX);
+    xbool_t bReset = nMode == 1 ? XTRUE : XFALSE;
+    xbool_t bValid = nMode == 0 || (pDeflater != NULL && pInflater != NULL);
+
+    xbyte_buffer_t inflated;
+    XByteBuffer_Init(&inflated, XSTDNON, XFALSE);
+    memset(pStats, 0, sizeof(deflate_stats_t));
+
+    char sMessage[XSTR_BIG];
+    size_t i;
+
+    for (i = 0; i < nCount && bValid; i++)
+    {
+        size_t nLength = make_message(sMessage, sizeof(sMessage), i);
+        uint64_t nStart = XTime_GetStamp();
+        xws_frame_t frame;
+        xws_status_t eStatus;
+
+        if (nMode) eStatus = XWebFrame_CreateDeflated(&frame, pDeflater, (uint8_t*)sMessage, nLength, XWS_TEXT, XFALSE, bReset);
+        else eStatus = XWebFrame_Create(&frame, (uint8_t*)sMessage, nLength, XWS_TEXT, XFALSE, XTRUE);
+
+        pStats->nEncode += XTime_GetStamp() - nStart;
+        pStats->nBytes += frame.buffer.nUsed;
+        bValid = eStatus == XWS_ERR_NONE;
+
+        if (bValid && nMode)
+        {
+            const uint8_t *pPayload = XWebFrame_GetPayload(&frame);
+            size_t nPayload = XWebFrame_GetPayloadLength(&frame);
+
+            XByteBuffer_Reset(&inflated);
+            nStart = XTime_GetStamp();
+            eStatus = XWS_Inflate(pInflater, pPayload, nPayload, &inflated, XSTR_BIG, bReset);
+            pStats->nDecode += XTime_GetStamp() - nStart;
+
+            bValid = eStatus == XWS_ERR_NONE && inflated.nUsed == nLength &&
+                     !memcmp(inflated.pData, sMessage, nLength);
+        }
+
+        XWebFrame_Clear(&frame);
+    }
+
+    XByteBuffer_Clear(&inflated);
+    XWS_PutZStream(&deflatePool, pDeflater);
+    XWS_PutZStream(&inflatePool, pInflater);
+    XWS_DestroyZPool(&deflatePool);
+    XWS_DestroyZPool(&inflatePool);
+    return bValid;
+}
+
+static int service_callback(xapi_ctx_t *pCtx, xapi_session_t *pSession)
+{
+    switch (pCtx->eCbType)
+    {
+        case XAPI_CB_ACCEPTED:
+            return XAPI_SetEvents(pSession, XPOLLIN);
+        case XAPI_CB_ERROR:
+            printf("%s\n", XAPI_GetStatus(pCtx));
+            return XAPI_DISCONNECT;
+        default:
+            break;
+    }
+
+    return XAPI_CONTINUE;
+}
+
+static int connect_client(uint16_t nPort)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(nPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int nFD = socket(AF_INET, SOCK_STREAM, 0);
+    if (nFD < 0) return XSTDERR;
+
+    if (connect(nFD, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        write(nFD, DEFLATE_HANDSHAKE, strlen(DEFLATE_HANDSHAKE)) < 0)
+    {
+        close(nFD);
+        return XSTDERR;
+    }
+
+    fcntl(nFD, F_SETFL, fcntl(nFD, F_GETFL, 0) | O_NONBLOCK);
+    return nFD;
+}
+
+/* First client keeps the received stream to check the messages */
+static size_t drain_clients(const int *pClients, size_t nClients, xbyte_buffer_t *pStream)
+{
+    uint8_t sBuffer[XSTR_BIG];
+    size_t i, nTotal = 0;
+
+    for (i = 0; i < nClients; i++)
+    {
+        ssize_t nRead;
+        while ((nRead = read(pClients[i], sBuffer, sizeof(sBuffer))) > 0)
+        {
+            if (!i && pStream != NULL) XByteBuffer_Add(pStream, sBuffer, (size_t)nRead);
+            nTotal += (size_t)nRead;
+        }
+    }
+
+    return nTotal;
+}
+
+static size_t get_pending(xapi_t *pApi)
+{
+    xapi_session_t *pSession = pApi->pWSHead;
+    size_t nPending = 0;
+
+    while (pSession != NULL)
+    {
+        nPending += XAPI_GetTxPending(pSession);
+        pSession = pSession->pWSNext;
+    }
+
+    return nPending;
+}
+
+static xbool_t check_stream(xbyte_buffer_t *pStream, size_t nRounds)
+{
+    xws_zpool_t pool;
+    XWS_InitZPool(&pool, XFALSE, XSTDNON, 1);
+
+    xws_zstream_t *pInflater = XWS_GetZStream(&pool, XWS_DEFLATE_BITS_MAX);
+    xbool_t bValid = pInflater != NULL;
+    size_t nOffset = 0, i;
+
+    xbyte_buffer_t inflated;
+    XByteBuffer_Init(&inflated, XSTDNON, XFALSE);
+
+    for (i = 0; i < nRounds && bValid; i++)
+    {
+        char sMessage[XSTR_BIG];
+        size_t nLength = make_message(sMessage, sizeof(sMessage), i);
+
+        xws_frame_t frame;
+        xws_status_t eStatus = XWebFrame_ParseView(&frame, pStream->pData + nOffset, pStream->nUsed - nOffset);
+        bValid = eStatus == XWS_FRAME_COMPLETE;
+
+        if (bValid)
+        {
+            const uint8_t *pPayload = XWebFrame_GetPayload(&frame);
+            size_t nPayload = XWebFrame_GetPayloadLength(&frame);
+            XByteBuffer_Reset(&inflated);
+
+            if (frame.bCompressed) eStatus = XWS_Inflate(pInflater, pPayload, nPayload, &inflated, XSTR_BIG, XFALSE);
+            else XByteBuffer_Add(&inflated, pPayload, nPayload);
+
+            bValid = eStatus == XWS_FRAME_COMPLETE || eStatus == XWS_ERR_NONE;
+            bValid = bValid && inflated.nUsed == nLength && !memcmp(inflated.pData, sMessage, nLength);
+            nOffset += XWebFrame_GetFrameLength(&frame);
+        }
+
+        XWebFrame_Clear(&frame);
+    }
+
+    XByteBuffer_Clear(&inflated);
+    XWS_PutZStream(&pool, pInflater);
+    XWS_DestroyZPool(&pool);
+    return bValid;
+}
+
+static xbool_t bench_broadcast(xapi_t *pApi, const int *pClients, size_t nClients,
+                               size_t nRounds, xbool_t bDeflate, deflate_stats_t *pStats)
+{
+    xws_deflate_t params;
+    XWS_InitDeflate(&params);
+    XAPI_SetDeflate(pApi, bDeflate ? &params : NULL, XWS_DEFLATE_LEVEL, XWS_DEFLATE_THRESHOLD);
+
+    xbyte_buffer_t stream;
+    XByteBuffer_Init(&stream, XSTDNON, XFALSE);
+    memset(pStats, 0, sizeof(deflate_stats_t));
+    size_t i;
+
+    for (i = 0; i < nRounds; i++)
+    {
+        char sMessage[XSTR_BIG];
+        size_t nLength = make_message(sMessage, sizeof(sMessage), i);
+
+        uint64_t nStart = XTime_GetStamp();
+        size_t nQueued = XAPI_Broadcast(pApi, (uint8_t*)sMessage, nLength, XWS_TEXT);
+        pStats->nEncode += XTime_GetStamp() - nStart;
+
+        if (nQueued != nClients)
+        {
+            XByteBuffer_Clear(&stream);
+            return XFALSE;
+        }
+
+        while (get_pending(pApi))
+        {
+            if (XAPI_Service(pApi, 0) != XEVENTS_SUCCESS)
+            {
+                XByteBuffer_Clear(&stream);
+                return XFALSE;
+            }
+        }
+
+        pStats->nBytes += drain_clients(pClients, nClients, &stream);
+    }
+
+    /* Check the messages received by the first client */
+    uint64_t nDeadline = XTime_GetMs() + 1000;
+    xbool_t bValid = check_stream(&stream, nRounds);
+
+    while (!bValid && XTime_GetMs() < nDeadline)
+    {
+        pStats->nBytes += drain_clients(pClients, nClients, &stream);
+        bValid = check_stream(&stream, nRounds);
+    }
+
+    XByteBuffer_Clear(&stream);
+    return bValid;
+}
+
+static void print_messages(const char *pName, size_t nCount, size_t nPlain, const deflate_stats_t *pStats)
+{
+    printf("  %-12s %8.1f B/msg %7.1f%% %8.1f ns/msg %8.1f ns/msg\n", pName,
+        (double)pStats->nBytes / nCount, nPlain ? pStats->nBytes * 100.0 / nPlain : 0.,
+        pStats->nEncode * 1000.0 / nCount, pStats->nDecode * 1000.0 / nCount);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nCount = argc > 1 ? (size_t)atol(argv[1]) : DEFLATE_DEFAULT_COUNT;
+    size_t nClients = argc > 2 ? (size_t)atol(argv[2]) : DEFLATE_DEFAULT_CLIENTS;
+    uint16_t nPort = argc > 3 ? (uint16_t)atoi(argv[3]) : DEFLATE_PORT;
+
+    if (!nCount || !nClients || !nPort)
+    {
+        printf("Usage: %s [messages] [clients] [port]\n", argv[0]);
+        return 1;
+    }
+
+    if (!XWS_HaveDeflate())
+    {
+        printf("Library is built without zlib, permessage-deflate is not available\n");
+        return 1;
+    }
+
+    char sMessage[XSTR_BIG];
+    printf("Messages: %zu, JSON payload: ~%zu bytes\n\n", nCount, make_message(sMessage, sizeof(sMessage), 0));
+    printf("  %-12s %14s %8s %15s %15s\n", "", "wire", "ratio", "encode", "decode");
+
+    const char *pModes[] = { "plain", "no takeover", "takeover" };
+    deflate_stats_t stats;
+    size_t nPlain = 0;
+    int nMode;
+
+    for (nMode = 0; nMode < 3; nMode++)
+    {
+        if (!bench_messages(nCount, nMode, &stats)) printf("  %-12s failed\n", pModes[nMode]);
+        else print_messages(pModes[nMode], nCount, nPlain, &stats);
+        if (!nMode) nPlain = stats.nBytes;
+    }
+
+    int *pClients = (int*)malloc(nClients * sizeof(int));
+    if (pClients == NULL) return 1;
+
+    xapi_t api;
+    XAPI_Init(&api, service_callback, NULL);
+
+    xws_deflate_t params;
+    XWS_InitDeflate(&params);
+    XAPI_SetDeflate(&api, &params, XWS_DEFLATE_LEVEL, XWS_DEFLATE_THRESHOLD);
+
+    xapi_endpoint_t endpt;
+    XAPI_InitEndpoint(&endpt);
+
+    endpt.eType = XAPI_WS;
+    endpt.eRole = XAPI_SERVER;
+    endpt.pAddr = "127.0.0.1";
+    endpt.nPort = nPort;
+
+    if (XAPI_AddEndpoint(&api, &endpt) < 0)
+    {
+        XAPI_Destroy(&api);
+        free(pClients);
+        return 1;
+    }
+
+    size_t i, nConnected = 0;
+    for (i = 0; i < nClients; i++)
+    {
+        pClients[i] = connect_client(nPort);
+        if (pClients[i] < 0) break;
+
+        nConnected++;
+        XAPI_Service(&api, 0);
+    }
+
+    uint64_t nDeadline = XTime_GetMs() + 5000;
+    while (nConnected == nClients &&
+           XAPI_GetWSCount(&api) < nClients &&
+           XTime_GetMs() < nDeadline)
+    {
+        XAPI_Service(&api, 10);
+        drain_clients(pClients, nConnected, NULL);
+    }
+
+    while (get_pending(&api)) XAPI_Service(&api, 10);
+    drain_clients(pClients, nConnected, NULL);
+
+    if (XAPI_GetWSCount(&api) != nClients)
+    {
+        printf("Connected %zu of %zu clients, check the open file limit\n",
+            XAPI_GetWSCount(&api), nClients);
+
+        for (i = 0; i < nConnected; i++) close(pClients[i]);
+        XAPI_Destroy(&api);
+        free(pClients);
+        return 1;
+    }
+
+    size_t nRounds = XSTD_MIN(nCount, (size_t)DEFLATE_BCAST_ROUNDS);
+    printf("\nBroadcast to %zu deflate clients, rounds: %zu\n\n", nClients, nRounds);
+    printf("  %-12s %14s %17s\n", "", "wire", "queue");
+
+    for (nMode = 0; nMode < 2; nMode++)
+    {
+        const char *pName = nMode ? "deflate" : "plain";
+        size_t nMessages = nClients * nRounds;
+
+        if (!bench_broadcast(&api, pClients, nClients, nRounds, nMode, &stats))
+        {
+            printf("  %-12s broadcast failed\n", pName);
+            continue;
+        }
+
+        printf("  %-12s %8.1f B/msg %10.1f ns/ses\n", pName,
+            (double)stats.nBytes / nMessages, stats.nEncode * 1000.0 / nMessages);
+    }
+
+    for (i = 0; i < nClients; i++) close(pClients[i]);
+    XAPI_Destroy(&api);
+    free(pClients);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*!
+ *  @file libxutils/examples/ws-unmask.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Benchmark of the WebSocket unmasking. Compares the byte loop
+ * with the available masking kernels, then parses the masked frame
+ * with the copy to the frame buffer and in place.
+ */
+
+#include "xstd.h"
+#include "ws.h"
+#include "xtime.h"
+
+#define UNMASK_DEFAULT_SIZE     (4 * 1024 * 1024)
+#define UNMASK_DEFAULT_COUNT    200
+#define UNMASK_KEY              0x5a3c9617
+
+static void mask_bytes(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    const uint8_t *pMaskKey = (const uint8_t*)&nMaskKey;
+    size_t i;
+
+    for (i = 0; i < nLength; i++)
+        pData[i] ^= pMaskKey[i % 4];
+}
+
+static xbool_t check_masker(void)
+{
+    uint8_t expected[300];
+    uint8_t data[300];
+    size_t nOffset, nLength;
+
+    for (nOffset = 0; nOffset < 8; nOffset++)
+    {
+        for (nLength = 0; nLength + nOffset <= sizeof(data); nLength += 7)
+        {
+            size_t i;
+            for (i = 0; i < sizeof(data); i++) data[i] = expected[i] = (uint8_t)(i * 31 + nLength);
+
+            mask_bytes(&expected[nOffset], nLength, UNMASK_KEY);
+            XWS_MaskData(&data[nOffset], nLength, UNMASK_KEY);
+            if (memcmp(data, expected, sizeof(data))) return XFALSE;
+        }
+    }
+
+    return XTRUE;
+}
+
+static double bench_mask(uint8_t *pData, size_t nSize, size_t nCount, xbool_t bBytes)
+{
+    uint64_t nStart = XTime_GetStamp();
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        if (bBytes) mask_bytes(pData, nSize, UNMASK_KEY);
+        else XWS_MaskData(pData, nSize, UNMASK_KEY);
+    }
+
+    uint64_t nElapsed = XTime_GetStamp() - nStart;
+    return nElapsed ? (double)nSize * nCount / nElapsed / 1000.0 : 0.;
+}
+
+static double bench_parse(xbyte_buffer_t *pFrame, size_t nPayload, size_t nCount, xbool_t bView)
+{
+    uint64_t nElapsed = 0;
+    size_t i;
+
+    for (i = 0; i < nCount; i++)
+    {
+        uint64_t nStart = XTime_GetStamp();
+        xws_frame_t frame;
+
+        xws_status_t eStatus = bView ?
+            XWebFrame_ParseView(&frame, pFrame->pData, pFrame->nUsed) :
+            XWebFrame_ParseData(&frame, pFrame->pData, pFrame->nUsed);
+
+        size_t nLength = XWebFrame_GetPayloadLength(&frame);
+        uint32_t nMaskKey = frame.nMaskKey;
+        nElapsed += XTime_GetStamp() - nStart;
+
+        XWebFrame_Clear(&frame);
+        if (eStatus != XWS_FRAME_COMPLETE || nLength != nPayload) return 0.;
+
+        /* Frame parsed in place is unmasked, mask it back for the next round */
+        if (bView) XWS_MaskData(pFrame->pData + pFrame->nUsed - nPayload, nPayload, nMaskKey);
+    }
+
+    return nElapsed ? (double)nPayload * nCount / nElapsed / 1000.0 : 0.;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t nSize = argc > 1 ? (size_t)atol(argv[1]) : UNMASK_DEFAULT_SIZE;
+    size_t nCount = argc > 2 ? (size_t)atol(argv[2]) : UNMASK_DEFAULT_COUNT;
+
+    if (!nSize || !nCount)
+    {
+        printf("Usage: %s [payload] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t *pData = (uint8_t*)malloc(nSize);
+    if (pData == NULL)
+    {
+        printf("Failed to allocate payload\n");
+        return 1;
+    }
+
+    memset(pData, 'x', nSize);
+    printf("Payload: %zu bytes, rounds: %zu\n\n", nSize, nCount);
+    printf("  %-8s %10.1f GB/s\n", "bytes", bench_mask(pData, nSize, nCount, XTRUE));
+
+    xws_mask_t eMasker;
+    for (eMasker = XWS_MASK_SCALAR; eMasker <= XWS_MASK_AVX2; eMasker++)
+    {
+        if (XWS_SetMasker(eMasker) != eMasker) continue;
+        const char *pName = XWS_GetMaskerStr(eMasker);
+
+        if (!check_masker()) printf("  %-8s invalid result\n", pName);
+        else printf("  %-8s %10.1f GB/s\n", pName, bench_mask(pData, nSize, nCount, XFALSE));
+    }
+
+    XWS_SetMasker(XWS_MASK_AUTO);
+    xws_frame_t frame;
+
+    if (XWebFrame_Create(&frame, pData, nSize, XWS_BINARY, XTRUE, XTRUE) != XWS_ERR_NONE)
+    {
+        printf("Failed to create masked frame\n");
+        free(pData);
+        return 1;
+    }
+
+    printf("\nParse with %s kernel:\n", XWS_GetMaskerStr(XWS_GetMasker()));
+    printf("  %-8s %10.1f GB/s\n", "copy", bench_parse(&frame.buffer, nSize, nCount, XFALSE));
+    printf("  %-8s %10.1f GB/s\n", "view", bench_parse(&frame.buffer, nSize, nCount, XTRUE));
+
+    XWebFrame_Clear(&frame);
+    free(pData);
+    return 0;
+}
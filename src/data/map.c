@@ -18,33 +18,67 @@
 #define XFNV_OFFSET_32 2166136261
 #define XFNV_PRIME_32  16777619
 
-static int XMap_Alloc(xmap_t *pMap, xpool_t *pPool, uint32_t nSize)
-{
-    XCHECK((pMap != NULL), XMAP_OINV);
-    if (!nSize) return XMAP_OK;
-
-    pMap->pPairs = (xmap_pair_t*)xalloc(pPool, (size_t)nSize * sizeof(xmap_pair_t));
-    if (pMap->pPairs == NULL) return XMAP_OMEM;
+typedef struct XMapKey {
+    const char *pStr;
+    uint32_t nLength;
+    uint32_t nHash;
+} xmap_key_t;
 
+static void XMap_InitPairs(xmap_pair_t *pPairs, uint32_t nSize)
+{
     uint32_t i;
     for (i = 0; i < nSize; i++)
     {
-        pMap->pPairs[i].eStatus = XMAP_PAIR_UNUSED;
-        pMap->pPairs[i].pData = NULL;
-        pMap->pPairs[i].pKey = NULL;
+        pPairs[i].eStatus = XMAP_PAIR_UNUSED;
+        pPairs[i].nDistance = 0;
+        pPairs[i].nLength = 0;
+        pPairs[i].nHash = 0;
+        pPairs[i].pData = NULL;
+        pPairs[i].pKey = NULL;
     }
+}
 
-    return XMAP_OK;
+static uint32_t XMap_TableSize(uint32_t nSize)
+{
+    if (!nSize) return 0;
+    uint32_t nTableSize = 1;
+
+    /* Bucket index is masked, table size must be a power of two */
+    while (nTableSize < nSize && nTableSize < (UINT32_MAX / 2 + 1))
+        nTableSize <<= 1;
+
+    return nTableSize;
+}
+
+static xmap_pair_t *XMap_AllocPairs(xpool_t *pPool, uint32_t nSize)
+{
+    /* Zeroed pages of the large table are mapped on first use, not all at once */
+    if (pPool == NULL) return (xmap_pair_t*)calloc(nSize, sizeof(xmap_pair_t));
+
+    xmap_pair_t *pPairs = (xmap_pair_t*)xalloc(pPool, (size_t)nSize * sizeof(xmap_pair_t));
+    if (pPairs != NULL) XMap_InitPairs(pPairs, nSize);
+    return pPairs;
+}
+
+static int XMap_Alloc(xmap_t *pMap, xpool_t *pPool, uint32_t nSize)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    if (!nSize) return XMAP_OK;
+
+    pMap->pPairs = XMap_AllocPairs(pPool, nSize);
+    return pMap->pPairs != NULL ? XMAP_OK : XMAP_OMEM;
 }
 
 int XMap_Init(xmap_t *pMap, xpool_t *pPool, uint32_t nSize)
 {
     XCHECK((pMap != NULL), XMAP_OINV);
 
-    pMap->nTableSize = nSize;
+    pMap->nTableSize = XMap_TableSize(nSize);
     pMap->clearCb = NULL;
     pMap->pPairs = NULL;
-    pMap->nDeleted = 0;
+    pMap->pOldPairs = NULL;
+    pMap->nOldSize = 0;
+    pMap->nMigrated = 0;
     pMap->nCount = 0;
     pMap->pPool = pPool;
     pMap->eHashType = XMAP_HASH_FNV;
@@ -52,7 +86,7 @@ int XMap_Init(xmap_t *pMap, xpool_t *pPool, uint32_t nSize)
     pMap->bAllowUpdate = XTRUE;
     pMap->bAlloc = XFALSE;
 
-    return XMap_Alloc(pMap, pPool, nSize);
+    return XMap_Alloc(pMap, pPool, pMap->nTableSize);
 }
 
 xmap_t *XMap_New(xpool_t *pPool, uint32_t nSize)
@@ -70,11 +104,24 @@ xmap_t *XMap_New(xpool_t *pPool, uint32_t nSize)
     return pMap;
 }
 
+static void XMap_FreeOld(xmap_t *pMap)
+{
+    if (pMap->pOldPairs != NULL)
+    {
+        xfree(pMap->pPool, pMap->pOldPairs);
+        pMap->pOldPairs = NULL;
+    }
+
+    pMap->nOldSize = 0;
+    pMap->nMigrated = 0;
+}
+
 void XMap_Free(xmap_t *pMap)
 {
     if (pMap != NULL)
     {
         xpool_t *pPool = pMap->pPool;
+        XMap_FreeOld(pMap);
 
         if (pMap->pPairs != NULL)
         {
@@ -90,7 +137,6 @@ void XMap_Free(xmap_t *pMap)
         {
             pMap->nTableSize = 0;
             pMap->clearCb = NULL;
-            pMap->nDeleted = 0;
             pMap->nCount = 0;
         }
     }
@@ -106,24 +152,22 @@ static int XMap_ClearIt(xmap_pair_t *pPair, void *pCtx)
         pMap->clearCb(pPair);
 
     pPair->eStatus = XMAP_PAIR_UNUSED;
+    pPair->nDistance = 0;
+    pPair->nLength = 0;
+    pPair->nHash = 0;
     pPair->pData = NULL;
     pPair->pKey = NULL;
     return XMAP_OK;
 }
 
-int XMap_Iterate(xmap_t *pMap, xmap_iterator_t itfunc, void *pCtx)
+static int XMap_IteratePairs(xmap_pair_t *pPairs, uint32_t nFrom, uint32_t nSize, xmap_iterator_t itfunc, void *pCtx)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
-    XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
-
-    if (!XMap_UsedSize(pMap)) return XMAP_EMPTY;
     uint32_t i;
-
-    for (i = 0; i < pMap->nTableSize; i++)
+    for (i = nFrom; i < nSize; i++)
     {
-        if (pMap->pPairs[i].eStatus == XMAP_PAIR_USED)
+        if (pPairs[i].eStatus == XMAP_PAIR_USED)
         {
-            int nStatus = itfunc(&pMap->pPairs[i], pCtx);
+            int nStatus = itfunc(&pPairs[i], pCtx);
             if (nStatus != XMAP_OK) return nStatus;
         }
     }
@@ -131,22 +175,35 @@ int XMap_Iterate(xmap_t *pMap, xmap_iterator_t itfunc, void *pCtx)
     return XMAP_OK;
 }
 
+int XMap_Iterate(xmap_t *pMap, xmap_iterator_t itfunc, void *pCtx)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
+
+    if (!XMap_UsedSize(pMap)) return XMAP_EMPTY;
+    int nStatus = XMap_IteratePairs(pMap->pPairs, 0, pMap->nTableSize, itfunc, pCtx);
+
+    /* Pairs that are not migrated yet are still in the old table */
+    if (nStatus == XMAP_OK && pMap->pOldPairs != NULL)
+        nStatus = XMap_IteratePairs(pMap->pOldPairs, pMap->nMigrated, pMap->nOldSize, itfunc, pCtx);
+
+    return nStatus;
+}
+
 void XMap_Reset(xmap_t *pMap)
 {
     XCHECK_VOID((pMap != NULL));
     XCHECK_VOID_NL((pMap->pPairs != NULL));
 
-    uint32_t i;
-    for (i = 0; i < pMap->nTableSize; i++)
+    XMap_IteratePairs(pMap->pPairs, 0, pMap->nTableSize, XMap_ClearIt, pMap);
+
+    if (pMap->pOldPairs != NULL)
     {
-        if (pMap->pPairs[i].eStatus == XMAP_PAIR_USED)
-            XMap_ClearIt(&pMap->pPairs[i], pMap);
-        else if (pMap->pPairs[i].eStatus == XMAP_PAIR_DELETED)
-            pMap->pPairs[i].eStatus = XMAP_PAIR_UNUSED;
+        XMap_IteratePairs(pMap->pOldPairs, pMap->nMigrated, pMap->nOldSize, XMap_ClearIt, pMap);
+        XMap_FreeOld(pMap);
     }
 
     pMap->nCount = 0;
-    pMap->nDeleted = 0;
 }
 
 void XMap_Destroy(xmap_t *pMap)
@@ -155,11 +212,24 @@ void XMap_Destroy(xmap_t *pMap)
     XMap_Free(pMap);
 }
 
+static uint32_t XMap_FNV32(const char *pStr, uint32_t *pLength)
+{
+    const char *pEnd = pStr;
+    uint32_t nHash = XFNV_OFFSET_32;
+
+    while (*pEnd)
+    {
+        nHash ^= (uint8_t)*pEnd++;
+        nHash *= XFNV_PRIME_32;
+    }
+
+    if (pLength != NULL) *pLength = (uint32_t)(pEnd - pStr);
+    return nHash;
+}
+
 #ifdef _XMAP_USE_CRYPT
-int XMap_HashMIX(xmap_t *pMap, const char *pStr)
+static uint32_t XMap_MIX32(const char *pStr)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
-    if (!pMap->nTableSize) return XMAP_EINIT;
     uint32_t nHash = XCRC32_Compute((unsigned char*)(pStr), strlen(pStr));
 
     /* Robert Jenkins' 32 bit Mix Function */
@@ -173,27 +243,20 @@ int XMap_HashMIX(xmap_t *pMap, const char *pStr)
     nHash ^= (nHash >> 12);
 
     /* Knuth's Multiplicative Method */
-    nHash = (nHash >> 3) * 2654435761;
-    return nHash % pMap->nTableSize;
+    return (nHash >> 3) * 2654435761;
 }
 
-int XMap_HashCRC32(xmap_t *pMap, const char *pStr)
+static uint32_t XMap_CRC32(const char *pStr)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
-    if (!pMap->nTableSize) return XMAP_EINIT;
     uint32_t nHash = XCRC32_Compute((unsigned char*)(pStr), strlen(pStr));
 
     nHash = ((nHash >> 16) ^ nHash) * 0x45d9f3b;
     nHash = ((nHash >> 16) ^ nHash) * 0x45d9f3b;
-    nHash = (nHash >> 16) ^ nHash;
-    return nHash % pMap->nTableSize;
+    return (nHash >> 16) ^ nHash;
 }
 
-int XMap_HashSHA256(xmap_t *pMap, const char *pStr)
+static uint32_t XMap_SHA256(const char *pStr)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
-    if (!pMap->nTableSize) return XMAP_EINIT;
-
     unsigned char hash[XSHA256_LENGTH + 1];
     XSHA256_ComputeSum((char*)hash, sizeof(hash), (const uint8_t*)pStr, strlen(pStr));
 
@@ -209,209 +272,279 @@ int XMap_HashSHA256(xmap_t *pMap, const char *pStr)
     nHash ^= (nHash >> 11);
     nHash += (nHash << 15);
 
-    return nHash % pMap->nTableSize;
+    return nHash;
 }
-#endif /* _XMAP_USE_CRYPT */
 
-int XMap_HashFNV(xmap_t *pMap, const char *pStr)
+int XMap_HashMIX(xmap_t *pMap, const char *pStr)
 {
     XCHECK((pMap != NULL), XMAP_OINV);
     if (!pMap->nTableSize) return XMAP_EINIT;
-    uint32_t nHash = XFNV_OFFSET_32;
+    return (int)(XMap_MIX32(pStr) & (pMap->nTableSize - 1));
+}
 
-    while (*pStr)
-    {
-        nHash ^= (uint8_t)*pStr++;
-        nHash *= XFNV_PRIME_32;
-    }
+int XMap_HashCRC32(xmap_t *pMap, const char *pStr)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    if (!pMap->nTableSize) return XMAP_EINIT;
+    return (int)(XMap_CRC32(pStr) & (pMap->nTableSize - 1));
+}
 
-    return nHash % pMap->nTableSize;
+int XMap_HashSHA256(xmap_t *pMap, const char *pStr)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    if (!pMap->nTableSize) return XMAP_EINIT;
+    return (int)(XMap_SHA256(pStr) & (pMap->nTableSize - 1));
 }
+#endif /* _XMAP_USE_CRYPT */
 
-int XMap_Hash(xmap_t *pMap, const char *pStr)
+int XMap_HashFNV(xmap_t *pMap, const char *pStr)
 {
     XCHECK((pMap != NULL), XMAP_OINV);
-    XCHECK((pStr != NULL), XMAP_OINV);
+    if (!pMap->nTableSize) return XMAP_EINIT;
+    return (int)(XMap_FNV32(pStr, NULL) & (pMap->nTableSize - 1));
+}
+
+/* Full hash does not depend on the table size, it is kept in the pair and reused on growth */
+static void XMap_InitKey(xmap_t *pMap, xmap_key_t *pKey, const char *pStr)
+{
+    pKey->pStr = pStr;
 
     switch (pMap->eHashType)
     {
-        case XMAP_HASH_FNV:
-            return XMap_HashFNV(pMap, pStr);
 #ifdef _XMAP_USE_CRYPT
         case XMAP_HASH_MIX:
-            return XMap_HashMIX(pMap, pStr);
+            pKey->nLength = (uint32_t)strlen(pStr);
+            pKey->nHash = XMap_MIX32(pStr);
+            return;
         case XMAP_HASH_CRC32:
-            return XMap_HashCRC32(pMap, pStr);
+            pKey->nLength = (uint32_t)strlen(pStr);
+            pKey->nHash = XMap_CRC32(pStr);
+            return;
         case XMAP_HASH_SHA256:
-            return XMap_HashSHA256(pMap, pStr);
+            pKey->nLength = (uint32_t)strlen(pStr);
+            pKey->nHash = XMap_SHA256(pStr);
+            return;
 #endif
+        case XMAP_HASH_FNV:
         default:
             break;
     }
 
-    return XMap_HashFNV(pMap, pStr);
+    pKey->nHash = XMap_FNV32(pStr, &pKey->nLength);
 }
 
-int XMap_GetHash(xmap_t *pMap, const char* pKey)
+int XMap_Hash(xmap_t *pMap, const char *pStr)
 {
     XCHECK((pMap != NULL), XMAP_OINV);
-    XCHECK_NL((pKey != NULL), XMAP_OINV);
-    XCHECK_NL((pMap->nTableSize > 0), XMAP_EINIT);
-    XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
-    XCHECK_NL((pMap->nCount <= pMap->nTableSize), XMAP_OINV);
+    XCHECK((pStr != NULL), XMAP_OINV);
+    if (!pMap->nTableSize) return XMAP_EINIT;
 
-    int nIndex = XMap_Hash(pMap, pKey);
-    if (nIndex < 0) return nIndex;
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pStr);
+    return (int)(key.nHash & (pMap->nTableSize - 1));
+}
 
-    int nFirstAvail = -1;
-    uint32_t i;
+/*
+ * Robin Hood probing: every pair keeps the distance from its home bucket
+ * and the probe stops at the pair that is closer to home than the key.
+ */
+static int XMap_Find(const xmap_pair_t *pPairs, uint32_t nSize, const xmap_key_t *pKey)
+{
+    uint32_t i, nMask = nSize - 1;
+    uint32_t nIndex = pKey->nHash & nMask;
 
-    for (i = 0; i < pMap->nTableSize; i++)
+    for (i = 0; i < nSize; i++)
     {
-        xmap_pair_t *pPair = &pMap->pPairs[nIndex];
+        const xmap_pair_t *pPair = &pPairs[nIndex];
+        if (pPair->eStatus == XMAP_PAIR_UNUSED || pPair->nDistance < i) break;
 
-        if (pPair->eStatus == XMAP_PAIR_UNUSED)
-        {
-            // Return the first available slot for insertion
-            return (nFirstAvail >= 0) ? nFirstAvail : nIndex;
-        }
+        /* Cached hash and length reject almost every other key without touching it */
+        if (pPair->nHash == pKey->nHash &&
+            pPair->nLength == pKey->nLength &&
+            pPair->eStatus == XMAP_PAIR_USED &&
+            !memcmp(pPair->pKey, pKey->pStr, pKey->nLength)) return (int)nIndex;
 
-        if (pPair->eStatus == XMAP_PAIR_DELETED)
-        {
-            // Remember the first available slot for potential insertion
-            if (nFirstAvail < 0) nFirstAvail = nIndex;
-        }
-        else if (xstrcmp(pPair->pKey, pKey))
+        nIndex = (nIndex + 1) & nMask;
+    }
+
+    return XMAP_MISSING;
+}
+
+/* Caller makes sure that the key is missing and the table has a free slot */
+static uint32_t XMap_Insert(xmap_pair_t *pPairs, uint32_t nSize, const xmap_pair_t *pNew)
+{
+    uint32_t nMask = nSize - 1;
+    uint32_t nIndex = pNew->nHash & nMask;
+    uint32_t nPlaced = nSize;
+
+    xmap_pair_t pair = *pNew;
+    pair.eStatus = XMAP_PAIR_USED;
+    pair.nDistance = 0;
+
+    while (pPairs[nIndex].eStatus != XMAP_PAIR_UNUSED)
+    {
+        xmap_pair_t *pSlot = &pPairs[nIndex];
+
+        /* Pair that is closer to its home gives the slot away */
+        if (pSlot->nDistance < pair.nDistance)
         {
-            // Key already exists, return index for update
-            return nIndex;
+            xmap_pair_t tmp = *pSlot;
+            *pSlot = pair;
+            pair = tmp;
+
+            if (nPlaced == nSize) nPlaced = nIndex;
         }
 
-        nIndex = (nIndex + 1) % (int)pMap->nTableSize;
+        pair.nDistance++;
+        nIndex = (nIndex + 1) & nMask;
     }
 
-    return (nFirstAvail >= 0) ? nFirstAvail : XMAP_FULL;
+    pPairs[nIndex] = pair;
+    return nPlaced < nSize ? nPlaced : nIndex;
 }
 
-static int XMap_PutRaw(xmap_t *pMap, char *pKey, void *pValue)
+/* Backward shift deletion, following pairs move one slot closer to home */
+static void XMap_Erase(xmap_pair_t *pPairs, uint32_t nSize, uint32_t nIndex)
 {
-    int nHash = XMap_GetHash(pMap, pKey);
-    if (nHash < 0) return nHash;
+    uint32_t nMask = nSize - 1;
+    uint32_t nNext = (nIndex + 1) & nMask;
 
-    if (pMap->pPairs[nHash].eStatus == XMAP_PAIR_DELETED &&
-        pMap->nDeleted > 0) pMap->nDeleted--;
+    while (pPairs[nNext].eStatus == XMAP_PAIR_USED &&
+           pPairs[nNext].nDistance > 0)
+    {
+        pPairs[nIndex] = pPairs[nNext];
+        pPairs[nIndex].nDistance--;
 
-    if (pMap->pPairs[nHash].eStatus != XMAP_PAIR_USED)
-        pMap->nCount++;
+        nIndex = nNext;
+        nNext = (nNext + 1) & nMask;
+    }
 
-    pMap->pPairs[nHash].pKey = pKey;
-    pMap->pPairs[nHash].pData = pValue;
-    pMap->pPairs[nHash].eStatus = XMAP_PAIR_USED;
-    return XMAP_OK;
+    pPairs[nIndex].eStatus = XMAP_PAIR_UNUSED;
+    pPairs[nIndex].nDistance = 0;
+    pPairs[nIndex].nLength = 0;
+    pPairs[nIndex].nHash = 0;
+    pPairs[nIndex].pData = NULL;
+    pPairs[nIndex].pKey = NULL;
 }
 
-int XMap_Realloc(xmap_t *pMap)
+/*
+ * Old table is read only while it is migrated. Moved pairs are marked and
+ * not shifted, so the probe chains of the pairs that are left stay valid.
+ */
+static void XMap_MarkMoved(xmap_pair_t *pPair)
+{
+    pPair->eStatus = XMAP_PAIR_MOVED;
+    pPair->pData = NULL;
+    pPair->pKey = NULL;
+}
+
+static void XMap_Migrate(xmap_t *pMap, uint32_t nSlots)
+{
+    XCHECK_VOID_NL((pMap->pOldPairs != NULL));
+
+    while (nSlots-- && pMap->nMigrated < pMap->nOldSize)
+    {
+        xmap_pair_t *pPair = &pMap->pOldPairs[pMap->nMigrated++];
+        if (pPair->eStatus != XMAP_PAIR_USED) continue;
+
+        XMap_Insert(pMap->pPairs, pMap->nTableSize, pPair);
+        XMap_MarkMoved(pPair);
+    }
+
+    if (pMap->nMigrated >= pMap->nOldSize)
+        XMap_FreeOld(pMap);
+}
+
+static int XMap_Grow(xmap_t *pMap)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
     XCHECK((pMap->nTableSize < UINT32_MAX / 2), XMAP_OINV);
 
-    xpool_t *pPool = pMap->pPool;
-    int nStatus = XMAP_OK;
+    /* Previous growth must be complete before the next one */
+    XMap_Migrate(pMap, UINT32_MAX);
 
-    uint32_t i, nNewSize = pMap->nTableSize ? pMap->nTableSize * 2 : XMAP_INITIAL_SIZE;
-    xmap_pair_t *pPairs = (xmap_pair_t*)xalloc(pPool, (size_t)nNewSize * sizeof(xmap_pair_t));
+    uint32_t nNewSize = pMap->nTableSize ? pMap->nTableSize * 2 : XMAP_INITIAL_SIZE;
+    xmap_pair_t *pPairs = XMap_AllocPairs(pMap->pPool, nNewSize);
     XCHECK((pPairs != NULL), XMAP_OMEM);
 
-    for (i = 0; i < nNewSize; i++)
+    if (pMap->pPairs != NULL && pMap->nCount > 0)
     {
-        pPairs[i].eStatus = XMAP_PAIR_UNUSED;
-        pPairs[i].pData = NULL;
-        pPairs[i].pKey = NULL;
+        pMap->pOldPairs = pMap->pPairs;
+        pMap->nOldSize = pMap->nTableSize;
+        pMap->nMigrated = 0;
+    }
+    else if (pMap->pPairs != NULL)
+    {
+        xfree(pMap->pPool, pMap->pPairs);
     }
 
-    xmap_pair_t* pOldPairs = pMap->pPairs;
-    uint32_t nOldSize = pMap->nTableSize;
-    uint32_t nDeleted = pMap->nDeleted;
-    uint32_t nCount = pMap->nCount;
-
-    pMap->nCount = 0;
-    pMap->nDeleted = 0;
     pMap->pPairs = pPairs;
     pMap->nTableSize = nNewSize;
-    if (pOldPairs == NULL) return nStatus;
+    return XMAP_OK;
+}
 
-    for (i = 0; i < nOldSize; i++)
-    {
-        if (pOldPairs[i].eStatus != XMAP_PAIR_USED) continue;
-        nStatus = XMap_PutRaw(pMap, pOldPairs[i].pKey, pOldPairs[i].pData);
+int XMap_Realloc(xmap_t *pMap)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    int nStatus = XMap_Grow(pMap);
+    if (nStatus < 0) return nStatus;
 
-        if (nStatus != XMAP_OK)
-        {
-            pMap->nTableSize = nOldSize;
-            pMap->nDeleted = nDeleted;
-            pMap->pPairs = pOldPairs;
-            pMap->nCount = nCount;
+    XMap_Migrate(pMap, UINT32_MAX);
+    return XMAP_OK;
+}
 
-            xfree(pPool, pPairs);
-            return nStatus;
-        }
-    }
+static xmap_pair_t *XMap_FindPair(xmap_t *pMap, const xmap_key_t *pKey)
+{
+    int nIndex = XMap_Find(pMap->pPairs, pMap->nTableSize, pKey);
+    if (nIndex >= 0) return &pMap->pPairs[nIndex];
+    XCHECK_NL((pMap->pOldPairs != NULL), NULL);
 
-    xfree(pPool, pOldPairs);
-    return nStatus;
+    nIndex = XMap_Find(pMap->pOldPairs, pMap->nOldSize, pKey);
+    return nIndex >= 0 ? &pMap->pOldPairs[nIndex] : NULL;
 }
 
-static int XMap_Rehash(xmap_t *pMap)
+/* Returns the index in the new table, pair found in the old table is moved first */
+static int XMap_FindIndex(xmap_t *pMap, const xmap_key_t *pKey)
 {
-    XCHECK((pMap != NULL), XMAP_OINV);
-    XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
-    XCHECK_NL((pMap->nTableSize > 0), XMAP_EINIT);
+    int nIndex = XMap_Find(pMap->pPairs, pMap->nTableSize, pKey);
+    if (nIndex >= 0 || pMap->pOldPairs == NULL) return nIndex;
 
-    uint32_t nOldSize = pMap->nTableSize;
-    xpool_t *pPool = pMap->pPool;
+    nIndex = XMap_Find(pMap->pOldPairs, pMap->nOldSize, pKey);
+    if (nIndex < 0) return nIndex;
 
-    size_t nAllocSize = (size_t)nOldSize * sizeof(xmap_pair_t);
-    xmap_pair_t *pNew = (xmap_pair_t*)xalloc(pPool, nAllocSize);
-    XCHECK((pNew != NULL), XMAP_OMEM);
+    xmap_pair_t *pPair = &pMap->pOldPairs[nIndex];
+    nIndex = (int)XMap_Insert(pMap->pPairs, pMap->nTableSize, pPair);
 
-    uint32_t i;
-    for (i = 0; i < nOldSize; i++)
-    {
-        pNew[i].eStatus = XMAP_PAIR_UNUSED;
-        pNew[i].pKey = NULL;
-        pNew[i].pData = NULL;
-    }
+    XMap_MarkMoved(pPair);
+    return nIndex;
+}
 
-    xmap_pair_t *pOld = pMap->pPairs;
-    pMap->pPairs = pNew;
-    pMap->nCount = 0;
-    pMap->nDeleted = 0;
+int XMap_GetHash(xmap_t *pMap, const char* pKey)
+{
+    XCHECK((pMap != NULL), XMAP_OINV);
+    XCHECK_NL((pKey != NULL), XMAP_OINV);
+    XCHECK_NL((pMap->nTableSize > 0), XMAP_EINIT);
+    XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
 
-    for (i = 0; i < nOldSize; i++)
-    {
-        if (pOld[i].eStatus != XMAP_PAIR_USED) continue;
-        int nStatus = XMap_PutRaw(pMap, pOld[i].pKey, pOld[i].pData);
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pKey);
 
-        if (nStatus != XMAP_OK)
-        {
-            pMap->nTableSize = nOldSize;
-            pMap->pPairs = pOld;
-            pMap->nDeleted = 0;
-            pMap->nCount = 0;
+    int nIndex = XMap_FindIndex(pMap, &key);
+    if (nIndex >= 0) return nIndex;
 
-            for (uint32_t j = 0; j < nOldSize; j++)
-            {
-                if (pOld[j].eStatus == XMAP_PAIR_DELETED) pMap->nDeleted++;
-                else if (pOld[j].eStatus == XMAP_PAIR_USED) pMap->nCount++;
-            }
+    uint32_t i, nMask = pMap->nTableSize - 1;
+    nIndex = (int)(key.nHash & nMask);
 
-            xfree(pPool, pNew);
-            return nStatus;
-        }
+    /* Slot where the key would be placed by XMap_Put() */
+    for (i = 0; i < pMap->nTableSize; i++)
+    {
+        xmap_pair_t *pPair = &pMap->pPairs[nIndex];
+        if (pPair->eStatus == XMAP_PAIR_UNUSED ||
+            pPair->nDistance < i) return nIndex;
+
+        nIndex = (int)(((uint32_t)nIndex + 1) & nMask);
     }
 
-    xfree(pPool, pOld);
-    return XMAP_OK;
+    return XMAP_FULL;
 }
 
 int XMap_Put(xmap_t *pMap, char* pKey, void *pValue)
@@ -419,38 +552,39 @@ int XMap_Put(xmap_t *pMap, char* pKey, void *pValue)
     XCHECK((pMap != NULL), XMAP_OINV);
     XCHECK_NL((pKey != NULL), XMAP_OINV);
 
-    if ((!pMap->nTableSize || pMap->pPairs == NULL) ||
-        ((uint64_t)pMap->nCount * 10 >= (uint64_t)pMap->nTableSize * 7))
-    {
-        int nStatus = XMap_Realloc(pMap);
-        if (nStatus < 0) return nStatus;
-    }
+    /* Growth is spread over the puts instead of one long rehash */
+    if (pMap->pOldPairs != NULL) XMap_Migrate(pMap, XMAP_MIGRATE_STEP);
+
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pKey);
 
-    int nHash = XMap_GetHash(pMap, pKey);
-    while (nHash == XMAP_FULL)
+    if (pMap->pPairs != NULL && pMap->nTableSize)
     {
-        int nStatus = XMap_Realloc(pMap);
-        if (nStatus < 0) return nStatus;
-        nHash = XMap_GetHash(pMap, pKey);
+        int nIndex = XMap_FindIndex(pMap, &key);
+        if (nIndex >= 0)
+        {
+            if (!pMap->bAllowUpdate) return XMAP_EEXIST;
+            pMap->pPairs[nIndex].pData = pValue;
+            pMap->pPairs[nIndex].pKey = pKey;
+            return XMAP_OK;
+        }
     }
 
-    if (nHash < 0) return nHash;
-    if (pMap->pPairs[nHash].eStatus == XMAP_PAIR_DELETED && pMap->nDeleted > 0) pMap->nDeleted--;
-    if (pMap->pPairs[nHash].eStatus != XMAP_PAIR_USED) pMap->nCount++;
-    else if (!pMap->bAllowUpdate) return XMAP_EEXIST;
-
-    /* Set the data */
-    pMap->pPairs[nHash].pData = pValue;
-    pMap->pPairs[nHash].pKey = pKey;
-    pMap->pPairs[nHash].eStatus = XMAP_PAIR_USED;
-
-    /* Tombstone pressure trigger */
-    if (pMap->nDeleted > pMap->nTableSize / 4)
+    if ((!pMap->nTableSize || pMap->pPairs == NULL) ||
+        ((uint64_t)pMap->nCount * 10 >= (uint64_t)pMap->nTableSize * 7))
     {
-        int nStatus = XMap_Rehash(pMap);
+        int nStatus = XMap_Grow(pMap);
         if (nStatus < 0) return nStatus;
     }
 
+    xmap_pair_t pair;
+    pair.nLength = key.nLength;
+    pair.nHash = key.nHash;
+    pair.pData = pValue;
+    pair.pKey = pKey;
+
+    XMap_Insert(pMap->pPairs, pMap->nTableSize, &pair);
+    pMap->nCount++;
     return XMAP_OK;
 }
 
@@ -466,16 +600,11 @@ int XMap_Update(xmap_t *pMap, int nHash, void *pValue)
     XCHECK((pMap != NULL), XMAP_OINV);
     XCHECK_NL((nHash >= 0), XMAP_OINV);
 
-    if ((uint32_t)nHash >= pMap->nTableSize)
+    if ((uint32_t)nHash >= pMap->nTableSize ||
+        pMap->pPairs[nHash].eStatus != XMAP_PAIR_USED)
         return XMAP_MISSING;
 
-    xmap_pair_t *pPair = &pMap->pPairs[nHash];
-    if (pPair->eStatus == XMAP_PAIR_DELETED && pMap->nDeleted > 0) pMap->nDeleted--;
-    if (pPair->eStatus != XMAP_PAIR_USED) pMap->nCount++;
-
-    pPair->pData = pValue;
-    pPair->eStatus = XMAP_PAIR_USED;
-
+    pMap->pPairs[nHash].pData = pValue;
     return XMAP_OK;
 }
 
@@ -484,23 +613,11 @@ xmap_pair_t *XMap_GetPair(xmap_t *pMap, const char* pKey)
     XCHECK((pMap != NULL), NULL);
     XCHECK_NL((pKey != NULL), NULL);
     XCHECK_NL((pMap->pPairs != NULL), NULL);
+    XCHECK_NL((pMap->nTableSize > 0), NULL);
 
-    uint32_t i;
-    int nIndex = XMap_Hash(pMap, pKey);
-    if (nIndex < 0) return NULL;
-
-    for (i = 0; i < pMap->nTableSize; i++)
-    {
-        xmap_pair_t *pPair = &pMap->pPairs[nIndex];
-
-        if (pPair->eStatus == XMAP_PAIR_UNUSED) break;
-        if (pPair->eStatus == XMAP_PAIR_USED &&
-            xstrcmp(pPair->pKey, pKey)) return pPair;
-
-        nIndex = (nIndex + 1) % (int)pMap->nTableSize;
-    }
-
-    return NULL;
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pKey);
+    return XMap_FindPair(pMap, &key);
 }
 
 void* XMap_GetIndex(xmap_t *pMap, const char* pKey, int *pIndex)
@@ -508,35 +625,27 @@ void* XMap_GetIndex(xmap_t *pMap, const char* pKey, int *pIndex)
     XCHECK((pMap != NULL), NULL);
     XCHECK((pKey != NULL), NULL);
     XCHECK((pIndex != NULL), NULL);
-    XCHECK_NL((pMap->pPairs != NULL), NULL);
 
     *pIndex = -1;
-    uint32_t i;
-
-    *pIndex = XMap_Hash(pMap, pKey);
-    if (*pIndex < 0) return NULL;
-
-    for (i = 0; i < pMap->nTableSize; i++)
-    {
-        xmap_pair_t *pPair = &pMap->pPairs[*pIndex];
+    XCHECK_NL((pMap->pPairs != NULL), NULL);
+    XCHECK_NL((pMap->nTableSize > 0), NULL);
 
-        if (pPair->eStatus == XMAP_PAIR_UNUSED) break;
-        if (pPair->eStatus == XMAP_PAIR_USED &&
-            xstrcmp(pPair->pKey, pKey)) return pPair->pData;
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pKey);
 
-        *pIndex = (*pIndex + 1) % (int)pMap->nTableSize;
-    }
+    int nIndex = XMap_FindIndex(pMap, &key);
+    if (nIndex < 0) return NULL;
 
-    *pIndex = -1;
-    return NULL;
+    *pIndex = nIndex;
+    return pMap->pPairs[nIndex].pData;
 }
 
 void* XMap_Get(xmap_t *pMap, const char* pKey)
 {
     XCHECK((pMap != NULL), NULL);
     XCHECK_NL((pKey != NULL), NULL);
-    int nDummy = 0;
-    return XMap_GetIndex(pMap, pKey, &nDummy);
+    xmap_pair_t *pPair = XMap_GetPair(pMap, pKey);
+    return pPair != NULL ? pPair->pData : NULL;
 }
 
 int XMap_Remove(xmap_t *pMap, const char* pKey)
@@ -544,33 +653,32 @@ int XMap_Remove(xmap_t *pMap, const char* pKey)
     XCHECK((pMap != NULL), XMAP_OINV);
     XCHECK_NL((pKey != NULL), XMAP_OINV);
     XCHECK_NL((pMap->pPairs != NULL), XMAP_EINIT);
+    XCHECK_NL((pMap->nTableSize > 0), XMAP_EINIT);
 
-    int nIndex = XMap_Hash(pMap, pKey);
-    if (nIndex < 0) return nIndex;
+    xmap_key_t key;
+    XMap_InitKey(pMap, &key, pKey);
+    int nIndex = XMap_Find(pMap->pPairs, pMap->nTableSize, &key);
 
-    uint32_t i;
-    for (i = 0; i < pMap->nTableSize; i++)
+    if (nIndex >= 0)
     {
         xmap_pair_t *pPair = &pMap->pPairs[nIndex];
-        if (pPair->eStatus == XMAP_PAIR_UNUSED) break;
+        if (pMap->clearCb != NULL) pMap->clearCb(pPair);
 
-        if (pPair->eStatus == XMAP_PAIR_USED && xstrcmp(pPair->pKey, pKey))
-        {
-            if (pMap->clearCb != NULL) pMap->clearCb(pPair);
-            if (pMap->nCount > 0) pMap->nCount--;
+        XMap_Erase(pMap->pPairs, pMap->nTableSize, (uint32_t)nIndex);
+        if (pMap->nCount > 0) pMap->nCount--;
+        return XMAP_OK;
+    }
 
-            pPair->eStatus = XMAP_PAIR_DELETED;
-            pPair->pData = NULL;
-            pPair->pKey = NULL;
+    XCHECK_NL((pMap->pOldPairs != NULL), XMAP_MISSING);
+    nIndex = XMap_Find(pMap->pOldPairs, pMap->nOldSize, &key);
+    XCHECK_NL((nIndex >= 0), XMAP_MISSING);
 
-            pMap->nDeleted++;
-            return XMAP_OK;
-        }
+    xmap_pair_t *pPair = &pMap->pOldPairs[nIndex];
+    if (pMap->clearCb != NULL) pMap->clearCb(pPair);
 
-        nIndex = (nIndex + 1) % (int)pMap->nTableSize;
-    }
-
-    return XMAP_MISSING;
+    XMap_MarkMoved(pPair);
+    if (pMap->nCount > 0) pMap->nCount--;
+    return XMAP_OK;
 }
 
 int XMap_UsedSize(xmap_t *pMap)
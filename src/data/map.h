@@ -18,6 +18,7 @@ extern "C" {
 #include "pool.h"
 
 #define XMAP_INITIAL_SIZE   64
+#define XMAP_MIGRATE_STEP   8   /* Old table slots moved per put while growing */
 
 #define XMAP_EEXIST         -7  /* Element already exists */
 #define XMAP_EINIT          -6  /* Map is not initialized */
@@ -32,11 +33,14 @@ extern "C" {
 typedef enum XMapPairStatus {
     XMAP_PAIR_UNUSED = 0,
     XMAP_PAIR_USED,
-    XMAP_PAIR_DELETED
+    XMAP_PAIR_MOVED
 } xmap_pair_status_t;
 
 typedef struct XMapPair {
     xmap_pair_status_t eStatus;
+    uint32_t nDistance;
+    uint32_t nLength;   /* Key length */
+    uint32_t nHash;     /* Full key hash, probe and growth do not rehash */
     char *pKey;
     void *pData;
 } xmap_pair_t;
@@ -61,8 +65,12 @@ typedef struct XMap {
     xmap_pair_t *pPairs;
     xpool_t *pPool;
 
+    /* Previous table while it is migrated to the new one */
+    xmap_pair_t *pOldPairs;
+    uint32_t nOldSize;
+    uint32_t nMigrated;
+
     uint32_t nTableSize;
-    uint32_t nDeleted;
     uint32_t nCount;
 
     xbool_t bAllowUpdate;
@@ -26,6 +26,26 @@
 #define XAPI_RX_MAX         (5000 * 1024)
 #define XAPI_RX_SIZE        4096
 #define XAPI_SSL_DRAIN_MAX  64
+#define XAPI_POOL_SIZE      4096
+#define XAPI_POOL_SLAB      64
+#define XAPI_POOL_BUFFER_MAX (64 * 1024)
+#define XAPI_TXQ_SIZE       8
+#define XAPI_ZPOOL_SIZE     32
+
+typedef struct XAPIRoute {
+    xapi_cb_t callback;
+    void *pRouteCtx;
+} xapi_route_t;
+
+struct xapi_request_ {
+    xapi_response_cb_t callback;
+    xhttp_status_t eStatus;     // Reported if the session ends before the response
+    xhttp_method_t eMethod;     // HEAD response has no body
+    xhttp_t response;
+    void *pUserCtx;
+    xbool_t bConnecting;
+    xbool_t bDone;
+};
 
 typedef struct XAPIWorkerEvents {
     xevent_data_t **ppEvents;
@@ -34,6 +54,7 @@ typedef struct XAPIWorkerEvents {
 } xapi_worker_events_t;
 
 static void XAPI_CloseEventBackend(xevents_t *pEvents);
+static void XAPI_DestroyThreads(xapi_t *pApi);
 XSTATUS XAPI_SpawnWorker(xapi_t *pApi, size_t nIndex);
 XSTATUS XAPI_WaitWorkerPIDs(xpid_t *pWorkerPIDs, size_t nWorkers);
 XSTATUS XAPI_StopWorkerPIDs(xpid_t *pWorkerPIDs, size_t nWorkers, int nSignal);
@@ -70,6 +91,10 @@ const char* XAPI_GetStatusStr(xapi_status_t eStatus)
             return "Unsupported API feature or runtime configuration";
         case XAPI_ERR_FORK:
             return "Failed to fork worker process";
+        case XAPI_ERR_THREAD:
+            return "Failed to start worker thread";
+        case XAPI_ERR_FILE:
+            return "Failed to open file for sending";
         case XAPI_ERR_ALLOC:
             return "Memory allocation failure";
         case XAPI_ERR_ASSEMBLE:
@@ -281,32 +306,251 @@ static xbool_t XAPI_ShouldDispatchSession(xapi_session_t *pSession)
     return XAPI_IsSupportedRole(pSession->eRole);
 }
 
+static void XAPI_ReleaseSegment(xapi_txseg_t *pSegment)
+{
+    if (pSegment->releaseCb != NULL)
+        pSegment->releaseCb(pSegment->pReleaseCtx, pSegment->pData, pSegment->nSize);
+    else if (pSegment->bFile && pSegment->bOwned)
+        xclose(pSegment->nFileFD);
+    else if (pSegment->bOwned)
+        free(pSegment->pData);
+
+    pSegment->nFileFD = XSTDERR;
+    pSegment->pData = NULL;
+    pSegment->nSize = XSTDNON;
+}
+
+static void XAPI_ResetTxQueue(xapi_txq_t *pQueue, xbool_t bFree)
+{
+    size_t i;
+    for (i = pQueue->nHead; i < pQueue->nCount; i++)
+        XAPI_ReleaseSegment(&pQueue->pSegments[i]);
+
+    if (bFree)
+    {
+        free(pQueue->pSegments);
+        pQueue->pSegments = NULL;
+        pQueue->nSize = XSTDNON;
+    }
+
+    pQueue->nOffset = XSTDNON;
+    pQueue->nBytes = XSTDNON;
+    pQueue->nHead = XSTDNON;
+    pQueue->nCount = XSTDNON;
+}
+
+static XSTATUS XAPI_PushSegment(xapi_txq_t *pQueue, xapi_txseg_t *pSegment)
+{
+    if (pQueue->nCount >= pQueue->nSize && pQueue->nHead > 0)
+    {
+        size_t nPending = pQueue->nCount - pQueue->nHead;
+        memmove(pQueue->pSegments, &pQueue->pSegments[pQueue->nHead], nPending * sizeof(xapi_txseg_t));
+        pQueue->nCount = nPending;
+        pQueue->nHead = XSTDNON;
+    }
+
+    if (pQueue->nCount >= pQueue->nSize)
+    {
+        size_t nSize = pQueue->nSize ? pQueue->nSize * 2 : XAPI_TXQ_SIZE;
+        xapi_txseg_t *pSegments = (xapi_txseg_t*)realloc(pQueue->pSegments, nSize * sizeof(xapi_txseg_t));
+        XCHECK((pSegments != NULL), XSTDERR);
+
+        pQueue->pSegments = pSegments;
+        pQueue->nSize = nSize;
+    }
+
+    pQueue->pSegments[pQueue->nCount++] = *pSegment;
+    pQueue->nBytes += pSegment->nSize;
+    return XSTDOK;
+}
+
+static void XAPI_AdvanceTxQueue(xapi_txq_t *pQueue, size_t nSent)
+{
+    pQueue->nBytes -= XSTD_MIN(nSent, pQueue->nBytes);
+
+    while (nSent > 0 && pQueue->nHead < pQueue->nCount)
+    {
+        xapi_txseg_t *pSegment = &pQueue->pSegments[pQueue->nHead];
+        size_t nRemaining = pSegment->nSize - pQueue->nOffset;
+
+        if (nSent < nRemaining)
+        {
+            pQueue->nOffset += nSent;
+            break;
+        }
+
+        XAPI_ReleaseSegment(pSegment);
+        pQueue->nOffset = XSTDNON;
+        pQueue->nHead++;
+        nSent -= nRemaining;
+    }
+
+    if (pQueue->nHead >= pQueue->nCount)
+        XAPI_ResetTxQueue(pQueue, XFALSE);
+}
+
+static xapi_session_t* XAPI_AllocSessions(size_t nCount)
+{
+    xapi_session_t *pSessions = (xapi_session_t*)malloc(sizeof(xapi_session_t) * nCount);
+    XCHECK((pSessions != NULL), NULL);
+
+    size_t i;
+    for (i = 0; i < nCount; i++)
+    {
+        xapi_session_t *pSession = &pSessions[i];
+        XByteBuffer_Init(&pSession->rxBuffer, XSTDNON, XFALSE);
+        XByteBuffer_Init(&pSession->txBuffer, XSTDNON, XFALSE);
+        XByteBuffer_Init(&pSession->wsBuffer, XSTDNON, XFALSE);
+        memset(&pSession->txQueue, 0, sizeof(xapi_txq_t));
+        pSession->pUserAgent = NULL;
+        pSession->pHttp = NULL;
+        pSession->pUri = NULL;
+    }
+
+    return pSessions;
+}
+
+static XSTATUS XAPI_GrowPool(xapi_pool_t *pPool)
+{
+    /* Cap may be lowered below the current capacity with XAPI_SetPoolSize() */
+    XCHECK_NL((pPool->nCapacity < pPool->nMaxSize), XSTDNON);
+
+    size_t nCount = pPool->nMaxSize - pPool->nCapacity;
+    if (nCount > XAPI_POOL_SLAB) nCount = XAPI_POOL_SLAB;
+
+    xapi_slab_t *pSlab = (xapi_slab_t*)malloc(sizeof(xapi_slab_t));
+    XCHECK((pSlab != NULL), XSTDERR);
+
+    pSlab->pSessions = XAPI_AllocSessions(nCount);
+    XCHECK_CALL((pSlab->pSessions != NULL), free, pSlab, XSTDERR);
+
+    pSlab->nCount = nCount;
+    pSlab->pNext = pPool->pSlabs;
+    pPool->pSlabs = pSlab;
+
+    size_t i;
+    for (i = 0; i < nCount; i++)
+    {
+        xapi_session_t *pSession = &pSlab->pSessions[i];
+        pSession->pPoolNext = pPool->pFree;
+        pSession->bPooled = XTRUE;
+        pPool->pFree = pSession;
+    }
+
+    pPool->nCapacity += nCount;
+    pPool->nFree += nCount;
+    return XSTDOK;
+}
+
+static xapi_session_t* XAPI_GetSession(xapi_t *pApi)
+{
+    xapi_pool_t *pPool = &pApi->pool;
+    xapi_session_t *pSession = NULL;
+
+    if (pPool->pFree != NULL) pPool->nHits++;
+    else
+    {
+        pPool->nMisses++;
+        XAPI_GrowPool(pPool);
+    }
+
+    if (pPool->pFree != NULL)
+    {
+        pSession = pPool->pFree;
+        pPool->pFree = pSession->pPoolNext;
+        pPool->nFree--;
+    }
+    else
+    {
+        /* Pool is full or disabled, fallback to the heap */
+        pSession = XAPI_AllocSessions(1);
+        XCHECK((pSession != NULL), NULL);
+        pSession->bPooled = XFALSE;
+    }
+
+    pSession->pPoolNext = NULL;
+    pPool->nInUse++;
+    return pSession;
+}
+
+static void XAPI_RecycleBuffer(xbyte_buffer_t *pBuffer)
+{
+    /* Keep only owned storage of the reasonable size */
+    if (!pBuffer->nSize || pBuffer->nSize > XAPI_POOL_BUFFER_MAX)
+        XByteBuffer_Clear(pBuffer);
+    else
+        XByteBuffer_Reset(pBuffer);
+}
+
+static void XAPI_PutSession(xapi_t *pApi, xapi_session_t *pSession)
+{
+    xapi_pool_t *pPool = &pApi->pool;
+    if (pPool->nInUse) pPool->nInUse--;
+
+    XAPI_RecycleBuffer(&pSession->rxBuffer);
+    XAPI_RecycleBuffer(&pSession->txBuffer);
+    XByteBuffer_Clear(&pSession->wsBuffer);
+
+    pSession->pPoolNext = pPool->pFree;
+    pPool->pFree = pSession;
+    pPool->nFree++;
+}
+
+static void XAPI_DestroyPool(xapi_pool_t *pPool)
+{
+    xapi_slab_t *pSlab = pPool->pSlabs;
+
+    while (pSlab != NULL)
+    {
+        xapi_slab_t *pNext = pSlab->pNext;
+        size_t i;
+
+        for (i = 0; i < pSlab->nCount; i++)
+        {
+            xapi_session_t *pSession = &pSlab->pSessions[i];
+            XByteBuffer_Clear(&pSession->rxBuffer);
+            XByteBuffer_Clear(&pSession->txBuffer);
+            XByteBuffer_Clear(&pSession->wsBuffer);
+            XAPI_ResetTxQueue(&pSession->txQueue, XTRUE);
+            XHTTP_Free(&pSession->pHttp);
+        }
+
+        free(pSlab->pSessions);
+        free(pSlab);
+        pSlab = pNext;
+    }
+
+    pPool->pSlabs = NULL;
+    pPool->pFree = NULL;
+    pPool->nCapacity = XSTDNON;
+    pPool->nInUse = XSTDNON;
+    pPool->nFree = XSTDNON;
+}
+
 static xapi_session_t* XAPI_NewData(xapi_t *pApi, xapi_type_t eType)
 {
     XCHECK((pApi != NULL), NULL);
 
-    xapi_session_t *pSession = (xapi_session_t*)malloc(sizeof(xapi_session_t));
+    xapi_session_t *pSession = XAPI_GetSession(pApi);
     XCHECK((pSession != NULL), NULL);
 
-    xstrncpyf(pSession->sUserAgent, sizeof(pSession->sUserAgent), "xutils/%s", XUtils_VersionShort());
     XSock_Init(&pSession->sock, XSOCK_UNDEFINED, XSOCK_INVALID);
-    XByteBuffer_Init(&pSession->rxBuffer, XSTDNON, XFALSE);
-    XByteBuffer_Init(&pSession->txBuffer, XSTDNON, XFALSE);
-    XByteBuffer_Init(&pSession->wsBuffer, XSTDNON, XFALSE);
-
     pSession->sRealIP[0] = XSTR_NUL;
     pSession->sAddr[0] = XSTR_NUL;
     pSession->sKey[0] = XSTR_NUL;
-    pSession->sUri[0] = XSTR_NUL;
+    pSession->pUserAgent = NULL;
+    pSession->pUri = NULL;
     pSession->nPort = XSTDNON;
     pSession->nEvents = XSTDNON;
 
     pSession->bHandshakeStart = XFALSE;
     pSession->bHandshakeDone = XFALSE;
     pSession->bWSFragStart = XFALSE;
+    pSession->bWSFragDeflate = XFALSE;
     pSession->bReadOnWrite = XFALSE;
     pSession->bWriteOnRead = XFALSE;
     pSession->bKeepRxBuffer = XFALSE;
+    pSession->bPipelineWait = XFALSE;
     pSession->bKeepAlive = XFALSE;
     pSession->bCancel = XFALSE;
     pSession->bAlloc = XTRUE;
@@ -320,37 +564,220 @@ static xapi_session_t* XAPI_NewData(xapi_t *pApi, xapi_type_t eType)
 
     pSession->pSessionData = NULL;
     pSession->pPacket = NULL;
+    pSession->pRoute = NULL;
+    pSession->pRequest = NULL;
+    pSession->pWSNext = NULL;
+    pSession->pWSPrev = NULL;
+    pSession->bWSLinked = XFALSE;
+    pSession->pDeflater = NULL;
+    pSession->pInflater = NULL;
+    pSession->bDeflateReset = XFALSE;
+    pSession->bDeflate = XFALSE;
     pSession->nID = ++pApi->nSessionCounter;
 
     return pSession;
 }
 
+static void XAPI_FinishRequest(xapi_session_t *pSession, xhttp_status_t eStatus)
+{
+    xapi_request_t *pRequest = pSession->pRequest;
+    XCHECK_VOID_NL((pRequest != NULL && !pRequest->bDone));
+
+    pRequest->bDone = XTRUE;
+    pRequest->callback(pSession->pApi, &pRequest->response, eStatus, pRequest->pUserCtx);
+}
+
+static void XAPI_ReleaseRequest(xapi_session_t *pSession)
+{
+    xapi_request_t *pRequest = pSession->pRequest;
+    XCHECK_VOID_NL((pRequest != NULL));
+
+    /* Every submitted request is completed exactly once */
+    XAPI_FinishRequest(pSession, pRequest->eStatus);
+    XHTTP_Clear(&pRequest->response);
+
+    free(pRequest);
+    pSession->pRequest = NULL;
+}
+
+static void XAPI_LinkWS(xapi_t *pApi, xapi_session_t *pSession)
+{
+    XCHECK_VOID_NL((!pSession->bWSLinked));
+    pSession->pWSNext = pApi->pWSHead;
+    pSession->pWSPrev = NULL;
+
+    if (pApi->pWSHead != NULL) pApi->pWSHead->pWSPrev = pSession;
+    pApi->pWSHead = pSession;
+    pSession->bWSLinked = XTRUE;
+    pApi->nWSCount++;
+}
+
+static void XAPI_UnlinkWS(xapi_session_t *pSession)
+{
+    XCHECK_VOID_NL((pSession->bWSLinked));
+    xapi_t *pApi = pSession->pApi;
+
+    if (pSession->pWSPrev != NULL) pSession->pWSPrev->pWSNext = pSession->pWSNext;
+    else pApi->pWSHead = pSession->pWSNext;
+    if (pSession->pWSNext != NULL) pSession->pWSNext->pWSPrev = pSession->pWSPrev;
+
+    pSession->pWSNext = NULL;
+    pSession->pWSPrev = NULL;
+    pSession->bWSLinked = XFALSE;
+    pApi->nWSCount--;
+}
+
+static void XAPI_ReleaseDeflate(xapi_session_t *pSession)
+{
+    xapi_t *pApi = pSession->pApi;
+    XCHECK_VOID_NL((pApi != NULL));
+
+    XWS_PutZStream(&pApi->deflatePool, pSession->pDeflater);
+    XWS_PutZStream(&pApi->inflatePool, pSession->pInflater);
+
+    pSession->pDeflater = NULL;
+    pSession->pInflater = NULL;
+    pSession->bDeflateReset = XFALSE;
+    pSession->bDeflate = XFALSE;
+}
+
 static void XAPI_ClearData(xapi_session_t *pSession)
 {
     XCHECK_VOID_NL(pSession);
+    XAPI_UnlinkWS(pSession);
+    XAPI_ReleaseDeflate(pSession);
     XAPI_DeleteTimer(pSession);
+    XAPI_ReleaseRequest(pSession);
     XSock_Close(&pSession->sock);
-    XByteBuffer_Clear(&pSession->rxBuffer);
-    XByteBuffer_Clear(&pSession->txBuffer);
-    XByteBuffer_Clear(&pSession->wsBuffer);
+
+    /* Pooled sessions keep segment array for the next session */
+    XAPI_ResetTxQueue(&pSession->txQueue, !pSession->bPooled);
+
+    /* And the request parser with its header table */
+    if (!pSession->bPooled) XHTTP_Free(&pSession->pHttp);
+    else if (pSession->pHttp != NULL) XHTTP_Recycle(pSession->pHttp);
+
+    free(pSession->pUserAgent);
+    pSession->pUserAgent = NULL;
+
+    free(pSession->pUri);
+    pSession->pUri = NULL;
 }
 
 static void XAPI_FreeData(xapi_session_t **pSession)
 {
     XCHECK_VOID((pSession && *pSession));
     xapi_session_t *pSessionPtr = *pSession;
-
     XAPI_ClearData(pSessionPtr);
+
+    if (pSessionPtr->bPooled)
+    {
+        XAPI_PutSession(pSessionPtr->pApi, pSessionPtr);
+        *pSession = NULL;
+        return;
+    }
+
+    XByteBuffer_Clear(&pSessionPtr->rxBuffer);
+    XByteBuffer_Clear(&pSessionPtr->txBuffer);
+    XByteBuffer_Clear(&pSessionPtr->wsBuffer);
+
     if (pSessionPtr->bAlloc)
     {
+        if (pSessionPtr->pApi && pSessionPtr->pApi->pool.nInUse)
+            pSessionPtr->pApi->pool.nInUse--;
+
         free(pSessionPtr);
         *pSession = NULL;
     }
 }
 
+static XSTATUS XAPI_SetString(char **ppDst, const char *pSrc)
+{
+    char *pNew = NULL;
+
+    if (xstrused(pSrc))
+    {
+        pNew = xstrdup(pSrc);
+        XCHECK((pNew != NULL), XSTDERR);
+    }
+
+    free(*ppDst);
+    *ppDst = pNew;
+    return XSTDOK;
+}
+
+const char* XAPI_GetUri(const xapi_session_t *pSession)
+{
+    XCHECK_NL((pSession != NULL), NULL);
+    return pSession->pUri != NULL ? pSession->pUri : XSTR_EMPTY;
+}
+
+const char* XAPI_GetUserAgent(const xapi_session_t *pSession)
+{
+    XCHECK_NL((pSession != NULL), NULL);
+    if (pSession->pUserAgent != NULL) return pSession->pUserAgent;
+    return pSession->pApi != NULL ? pSession->pApi->sUserAgent : XSTR_EMPTY;
+}
+
+XSTATUS XAPI_SetUserAgent(xapi_session_t *pSession, const char *pUserAgent)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    return XAPI_SetString(&pSession->pUserAgent, pUserAgent);
+}
+
+static xbool_t XAPI_IsCloseDelimited(const xhttp_t *pResponse)
+{
+    return pResponse->nHeaderLength &&
+           !pResponse->bChunked &&
+           !pResponse->nContentLength;
+}
+
+static int XAPI_RequestCb(xapi_session_t *pSession, xapi_cb_type_t eCbType, xapi_type_t eType, uint8_t nStat)
+{
+    xapi_request_t *pRequest = pSession->pRequest;
+
+    switch (eCbType)
+    {
+        case XAPI_CB_ERROR:
+            /* Socket and event errors keep the status of the current stage */
+            if (eType == XAPI_HTTP) pRequest->eStatus = (xhttp_status_t)nStat;
+            else if (eType == XAPI_SELF && nStat == XAPI_ERR_ALLOC) pRequest->eStatus = XHTTP_EALLOC;
+            return XAPI_DISCONNECT;
+        case XAPI_CB_STATUS:
+            /* Body without length and chunked coding ends with the connection */
+            if (eType == XAPI_SOCK && nStat == XSOCK_EOF &&
+                XAPI_IsCloseDelimited(&pRequest->response))
+            {
+                pRequest->response.nComplete = XTRUE;
+                XAPI_FinishRequest(pSession, XHTTP_COMPLETE);
+            }
+            return XAPI_CONTINUE;
+        case XAPI_CB_COMPLETE:
+            /* Request is sent, wait for the response */
+            pRequest->eStatus = XHTTP_EREAD;
+            if (XAPI_EnableEvent(pSession, XPOLLIN) <= XSTDNON) return XAPI_DISCONNECT;
+            return XAPI_CONTINUE;
+        case XAPI_CB_TIMEOUT:
+            XAPI_FinishRequest(pSession, XHTTP_ETIMEO);
+            return XAPI_DISCONNECT;
+        case XAPI_CB_CLOSED:
+            XAPI_FinishRequest(pSession, pRequest->eStatus);
+            return XAPI_CONTINUE;
+        default:
+            break;
+    }
+
+    return XAPI_CONTINUE;
+}
+
 static int XAPI_Callback(xapi_t *pApi, xapi_session_t *pSession, xapi_cb_type_t eCbType, xapi_type_t eType, uint8_t nStat)
 {
     XCHECK((pApi != NULL), XSTDINV);
+
+    /* Async request sessions are not visible to the main callback */
+    if (pSession != NULL && pSession->pRequest != NULL)
+        return XAPI_RequestCb(pSession, eCbType, eType, nStat);
+
     XCHECK_NL(pApi->callback, XSTDOK);
 
     xapi_ctx_t ctx;
@@ -359,11 +786,29 @@ static int XAPI_Callback(xapi_t *pApi, xapi_session_t *pSession, xapi_cb_type_t
     ctx.eCbType = eCbType;
     ctx.eStatType = eType;
     ctx.nStatus = nStat;
+    ctx.pMessage = NULL;
     ctx.pApi = pApi;
 
     return pApi->callback(&ctx, pSession);
 }
 
+static int XAPI_MessageCb(xapi_t *pApi, void *pMessage)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK_NL(pApi->callback, XSTDOK);
+
+    xapi_ctx_t ctx;
+    ctx.nWorkerIndex = pApi->nWorkerIndex;
+    ctx.nCoreIndex = pApi->nCoreIndex;
+    ctx.eCbType = XAPI_CB_MESSAGE;
+    ctx.eStatType = XAPI_SELF;
+    ctx.nStatus = XAPI_UNKNOWN;
+    ctx.pMessage = pMessage;
+    ctx.pApi = pApi;
+
+    return pApi->callback(&ctx, NULL);
+}
+
 static int XAPI_ServiceCb(xapi_t *pApi, xapi_session_t *pSession, xapi_cb_type_t eCbType)
 {
     return XAPI_Callback(pApi, pSession,
@@ -413,40 +858,29 @@ static int XAPI_DropInvalidRoleEvent(xapi_session_t *pSession)
     return XEVENTS_DISCONNECT;
 }
 
-static int XAPI_WorkerEventCb(xhash_pair_t *pPair, void *pCtx)
+static int XAPI_WorkerEventCb(xevent_data_t *pData, void *pCtx)
 {
-    XCHECK_NL((pPair != NULL), XSTDNON);
+    XCHECK_NL((pData != NULL), XSTDERR);
     XCHECK_NL((pCtx != NULL), XSTDERR);
 
     xapi_worker_events_t *pEvents = (xapi_worker_events_t*)pCtx;
-    XCHECK_NL((pPair->pData != NULL), XSTDERR);
     XCHECK_NL((pEvents->nCount < pEvents->nSize), XSTDERR);
 
-    pEvents->ppEvents[pEvents->nCount++] = (xevent_data_t*)pPair->pData;
+    pEvents->ppEvents[pEvents->nCount++] = pData;
     return XSTDNON;
 }
 
-static void XAPI_DetachWorkerEventMap(xevents_t *pEvents)
-{
-    XCHECK_VOID_NL((pEvents != NULL));
-    XCHECK_VOID_NL(pEvents->bUseHash);
-
-    pEvents->eventsMap.clearCb = NULL;
-    pEvents->eventsMap.pUserContext = NULL;
-
-    XHash_Destroy(&pEvents->eventsMap);
-    pEvents->bUseHash = XFALSE;
-}
-
 static void XAPI_CloseEventBackend(xevents_t *pEvents)
 {
     XCHECK_VOID_NL((pEvents != NULL));
 
+#if !defined(_XEVENTS_USE_URING)
     if (pEvents->pEventArray != NULL)
     {
         free(pEvents->pEventArray);
         pEvents->pEventArray = NULL;
     }
+#endif
 
 #if defined(_XEVENTS_USE_EPOLL)
     if (pEvents->nEventFd >= 0)
@@ -462,7 +896,7 @@ static void XAPI_ResetWorkerEvents(xevents_t *pEvents)
     XCHECK_VOID_NL((pEvents != NULL));
 
     XAPI_CloseEventBackend(pEvents);
-    XAPI_DetachWorkerEventMap(pEvents);
+    XEvents_DetachData(pEvents);
     pEvents->nEventCount = XSTDNON;
     pEvents->bResync = XFALSE;
 }
@@ -475,7 +909,7 @@ xevent_status_t XAPI_RebuildWorkerEvents(xapi_t *pApi)
     xevents_t *pEvents = &pApi->events;
     XCHECK((pEvents->bUseHash), XEVENTS_EINVALID);
 
-    const size_t nEventCount = pEvents->eventsMap.nPairCount;
+    const size_t nEventCount = XEvents_GetDataCount(pEvents);
     XCHECK_NL((nEventCount > 0), XEVENTS_SUCCESS);
 
     xevent_data_t **ppEvents = (xevent_data_t**)calloc(nEventCount, sizeof(xevent_data_t*));
@@ -486,7 +920,7 @@ xevent_status_t XAPI_RebuildWorkerEvents(xapi_t *pApi)
     workerEvents.nCount = XSTDNON;
     workerEvents.nSize = nEventCount;
 
-    XHash_Iterate(&pEvents->eventsMap, XAPI_WorkerEventCb, &workerEvents);
+    XEvents_IterateData(pEvents, XAPI_WorkerEventCb, &workerEvents);
     if (workerEvents.nCount != nEventCount)
     {
         free(ppEvents);
@@ -890,103 +1324,644 @@ XSTATUS XAPI_PutTxBuff(xapi_session_t *pSession, xbyte_buffer_t *pBuffer)
     return XSTDOK;
 }
 
-static xbool_t XAPI_CopyTrimmedIP(char *pDst, size_t nDstSize, const char *pSrc)
+XSTATUS XAPI_PutTxChunk(xapi_session_t *pSession, const uint8_t *pData, size_t nSize)
 {
-    XCHECK_NL((pDst != NULL), XFALSE);
-    XCHECK_NL((nDstSize > 0), XFALSE);
-
-    pDst[0] = '\0';
-    if (!xstrused(pSrc)) return XFALSE;
-    while (*pSrc == ' ' || *pSrc == '\t') pSrc++;
-
-    size_t nLen = 0;
-    while (pSrc[nLen] != '\0' &&
-           pSrc[nLen] != ',' &&
-           pSrc[nLen] != ' ' &&
-           pSrc[nLen] != '\t' &&
-           nLen + 1 < nDstSize) nLen++;
+    XCHECK((pSession != NULL), XSTDINV);
 
-    if (!nLen) return XFALSE;
-    memcpy(pDst, pSrc, nLen);
-    pDst[nLen] = '\0';
+    /* Zero length or NULL data writes the last chunk of the body */
+    if (XHTTP_AddChunk(&pSession->txBuffer, pData, nSize) <= 0)
+    {
+        XAPI_ErrorCb(pSession->pApi, pSession, XAPI_SELF, XAPI_ERR_ALLOC);
+        return XSTDERR;
+    }
 
-    return XTRUE;
+    return XSTDOK;
 }
 
-static int XAPI_DetectRealIP(xapi_session_t *pSession, xhttp_t *pHandle)
+static XSTATUS XAPI_FlushTxBuffer(xapi_session_t *pSession)
 {
-    XCHECK((pSession != NULL), XSTDINV);
-    XCHECK((pHandle != NULL), XSTDINV);
+    xbyte_buffer_t *pBuffer = &pSession->txBuffer;
+    XCHECK_NL(pBuffer->nUsed, XSTDOK);
+
+    /* Data in tx buffer is newer than queued segments, keep the order */
+    xapi_txseg_t segment;
+    segment.releaseCb = NULL;
+    segment.pReleaseCtx = NULL;
+    segment.nSize = pBuffer->nUsed;
+    segment.bOwned = XTRUE;
+    segment.nFileOffset = XSTDNON;
+    segment.nFileFD = XSTDERR;
+    segment.bFile = XFALSE;
+
+    if (pBuffer->nSize > 0)
+    {
+        segment.pData = pBuffer->pData;
+        pBuffer->pData = NULL;
+        pBuffer->nSize = XSTDNON;
+    }
+    else
+    {
+        segment.pData = XByteData_Dup(pBuffer->pData, pBuffer->nUsed);
+        XCHECK((segment.pData != NULL), XSTDERR);
+        pBuffer->pData = NULL;
+    }
 
-    if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
-        XHTTP_GetHeader(pHandle, "X-Client-IP"))) return XSTDOK;
+    pBuffer->nUsed = XSTDNON;
 
-    if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
-        XHTTP_GetHeader(pHandle, "X-Forwarded-For"))) return XSTDOK;
+    if (XAPI_PushSegment(&pSession->txQueue, &segment) < 0)
+    {
+        free(segment.pData);
+        return XSTDERR;
+    }
 
-    if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
-        XHTTP_GetHeader(pHandle, "X-Real-IP"))) return XSTDOK;
+    return XSTDOK;
+}
 
-    if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
-        pSession->sAddr)) return XSTDNON;
+static XSTATUS XAPI_PutTxSegment(xapi_session_t *pSession, xapi_txseg_t *pSegment)
+{
+    if (XAPI_FlushTxBuffer(pSession) < 0 ||
+        XAPI_PushSegment(&pSession->txQueue, pSegment) < 0)
+    {
+        XAPI_ReleaseSegment(pSegment);
+        XAPI_ErrorCb(pSession->pApi, pSession, XAPI_SELF, XAPI_ERR_ALLOC);
+        return XSTDERR;
+    }
 
-    return XSTDERR;
+    return XSTDOK;
 }
 
-XSTATUS XAPI_RespondHTTP(xapi_session_t *pSession, int nCode, xapi_status_t eStatus)
+XSTATUS XAPI_PutTxData(xapi_session_t *pSession, const uint8_t *pData, size_t nSize, xapi_release_cb_t releaseCb, void *pCtx)
 {
     XCHECK((pSession != NULL), XSTDINV);
-    XCHECK((pSession->pApi != NULL), XSTDINV);
-    xapi_t *pApi = pSession->pApi;
-
-    xhttp_t handle;
-    XHTTP_InitResponse(&handle, nCode, NULL);
-
-    char sContent[XSTR_MID];
-    size_t nLength = xstrncpyf(sContent, sizeof(sContent), "{\"status\": \"%s\"}",
-        eStatus != XAPI_UNKNOWN ? XAPI_GetStatusStr(eStatus) : XHTTP_GetCodeStr(nCode));
-
-    if ((eStatus == XAPI_MISSING_TOKEN &&
-        XHTTP_AddHeader(&handle, "WWW-Authenticate", "Basic realm=\"XAPI\"") < 0) ||
-        XHTTP_AddHeader(&handle, "Server", "%s", pSession->sUserAgent) < 0 ||
-        XHTTP_AddHeader(&handle, "Content-Type", "application/json") < 0 ||
-        XHTTP_Assemble(&handle, (const uint8_t*)sContent, nLength) == NULL)
+    XCHECK((pData != NULL), XSTDINV);
+
+    xapi_txseg_t segment;
+    segment.releaseCb = releaseCb;
+    segment.pReleaseCtx = pCtx;
+    segment.pData = (uint8_t*)pData;
+    segment.nSize = nSize;
+    segment.bOwned = XFALSE;
+    segment.nFileOffset = XSTDNON;
+    segment.nFileFD = XSTDERR;
+    segment.bFile = XFALSE;
+
+    if (!nSize)
     {
-        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ASSEMBLE);
-        XHTTP_Clear(&handle);
-
-        pSession->bCancel = XTRUE;
-        return XEVENTS_DISCONNECT;
+        XAPI_ReleaseSegment(&segment);
+        return XSTDNON;
     }
 
-    if (eStatus > XAPI_UNKNOWN && eStatus < XAPI_STATUS_OK)
-        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, eStatus);
-    else if (eStatus != XAPI_UNKNOWN)
-        XAPI_StatusCb(pApi, pSession, XAPI_SELF, eStatus);
-
-    XAPI_PutTxBuff(pSession, &handle.rawData);
-    XHTTP_Clear(&handle);
-
-    if (!pSession->txBuffer.nUsed) return XEVENTS_DISCONNECT;
-    XSTATUS nStatus = XAPI_EnableEvent(pSession, XPOLLOUT);
-    return XAPI_StatusToEvent(pApi, nStatus);
+    return XAPI_PutTxSegment(pSession, &segment);
 }
 
-XSTATUS XAPI_AuthorizeHTTP(xapi_session_t *pSession, const char *pToken, const char *pKey)
+XSTATUS XAPI_PutTxOwned(xapi_session_t *pSession, uint8_t *pData, size_t nSize)
 {
     XCHECK((pSession != NULL), XSTDINV);
-    XCHECK((pSession->pPacket != NULL), XSTDINV);
-    xhttp_t *pHandle = (xhttp_t*)pSession->pPacket;
-
-    size_t nTokenLength = xstrused(pToken) ? strlen(pToken) : XSTDNON;
-    size_t nKeyLength = xstrused(pKey) ? strlen(pKey) : XSTDNON;
-    if (!nTokenLength && !nKeyLength) return XSTDOK;
-
-    if (nKeyLength)
+    XCHECK((pData != NULL), XSTDINV);
+
+    xapi_txseg_t segment;
+    segment.releaseCb = NULL;
+    segment.pReleaseCtx = NULL;
+    segment.pData = pData;
+    segment.nSize = nSize;
+    segment.bOwned = XTRUE;
+    segment.nFileOffset = XSTDNON;
+    segment.nFileFD = XSTDERR;
+    segment.bFile = XFALSE;
+
+    if (!nSize)
     {
-        const char *pXKey = XHTTP_GetHeader(pHandle, "X-API-KEY");
-        if (!xstrused(pXKey)) return XAPI_RespondHTTP(pSession, 401, XAPI_MISSING_KEY);
-        if (strncmp(pXKey, pKey, nKeyLength)) return XAPI_RespondHTTP(pSession, 401, XAPI_INVALID_KEY);
+        XAPI_ReleaseSegment(&segment);
+        return XSTDNON;
+    }
+
+    return XAPI_PutTxSegment(pSession, &segment);
+}
+
+XSTATUS XAPI_MoveTxBuff(xapi_session_t *pSession, xbyte_buffer_t *pBuffer)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pBuffer != NULL), XSTDINV);
+    XCHECK_NL(pBuffer->nUsed, XSTDNON);
+
+    /* Borrowed buffer data can not be moved */
+    if (!pBuffer->nSize) return XAPI_PutTxBuff(pSession, pBuffer);
+
+    uint8_t *pData = pBuffer->pData;
+    size_t nUsed = pBuffer->nUsed;
+
+    pBuffer->pData = NULL;
+    pBuffer->nSize = XSTDNON;
+    pBuffer->nUsed = XSTDNON;
+
+    return XAPI_PutTxOwned(pSession, pData, nUsed);
+}
+
+XSTATUS XAPI_SendFileFD(xapi_session_t *pSession, int nFD, uint64_t nOffset, size_t nLength, xbool_t bCloseFD)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((nFD >= 0), XSTDINV);
+
+    xapi_txseg_t segment;
+    segment.releaseCb = NULL;
+    segment.pReleaseCtx = NULL;
+    segment.pData = NULL;
+    segment.nSize = nLength;
+    segment.bOwned = bCloseFD;
+    segment.nFileOffset = nOffset;
+    segment.nFileFD = nFD;
+    segment.bFile = XTRUE;
+
+    if (!nLength)
+    {
+        xstat_t fileStat;
+        if (fstat(nFD, &fileStat) < 0 || (uint64_t)fileStat.st_size < nOffset)
+        {
+            XAPI_ReleaseSegment(&segment);
+            XAPI_ErrorCb(pSession->pApi, pSession, XAPI_SELF, XAPI_ERR_FILE);
+            return XSTDERR;
+        }
+
+        segment.nSize = (size_t)((uint64_t)fileStat.st_size - nOffset);
+        if (!segment.nSize)
+        {
+            XAPI_ReleaseSegment(&segment);
+            return XSTDNON;
+        }
+    }
+
+    return XAPI_PutTxSegment(pSession, &segment);
+}
+
+XSTATUS XAPI_SendFile(xapi_session_t *pSession, const char *pPath, uint64_t nOffset, size_t nLength)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pPath != NULL), XSTDINV);
+
+    xfile_t file;
+    if (XFile_Open(&file, pPath, "r", NULL) < 0)
+    {
+        XAPI_ErrorCb(pSession->pApi, pSession, XAPI_SELF, XAPI_ERR_FILE);
+        return XSTDERR;
+    }
+
+    return XAPI_SendFileFD(pSession, file.nFD, nOffset, nLength, XTRUE);
+}
+
+size_t XAPI_GetTxPending(xapi_session_t *pSession)
+{
+    XCHECK_NL((pSession != NULL), XSTDNON);
+    return pSession->txBuffer.nUsed + pSession->txQueue.nBytes;
+}
+
+xapi_frame_t* XAPI_NewFrame(const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType)
+{
+    xapi_frame_t *pFrame = (xapi_frame_t*)malloc(sizeof(xapi_frame_t));
+    XCHECK((pFrame != NULL), NULL);
+
+    /* Server frames are not masked, so one encoded copy fits every session */
+    pFrame->pData = XWS_CreateFrame(pPayload, nLength, XWS_OpCode(eType), XTRUE, &pFrame->nSize);
+    XCHECK_CALL((pFrame->pData != NULL), free, pFrame, NULL);
+
+    pFrame->nHeaderSize = pFrame->nSize - nLength;
+    pFrame->pDeflated = NULL;
+    pFrame->nDeflatedSize = XSTDNON;
+    pFrame->nDeflateBits = XSTDNON;
+    pFrame->nRefs = XSTDOK;
+    return pFrame;
+}
+
+xapi_frame_t* XAPI_HoldFrame(xapi_frame_t *pFrame)
+{
+    XCHECK_NL((pFrame != NULL), NULL);
+    XSYNC_ATOMIC_ADD(&pFrame->nRefs, 1);
+    return pFrame;
+}
+
+void XAPI_ReleaseFrame(xapi_frame_t *pFrame)
+{
+    XCHECK_VOID_NL((pFrame != NULL));
+    if (XSYNC_ATOMIC_SUB(&pFrame->nRefs, 1) > 0) return;
+
+    free(pFrame->pDeflated);
+    free(pFrame->pData);
+    free(pFrame);
+}
+
+static void XAPI_FrameReleaseCb(void *pCtx, uint8_t *pData, size_t nSize)
+{
+    (void)pData;
+    (void)nSize;
+    XAPI_ReleaseFrame((xapi_frame_t*)pCtx);
+}
+
+XSTATUS XAPI_DeflateFrame(xapi_t *pApi, xapi_frame_t *pFrame)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK((pFrame != NULL), XSTDINV);
+    XCHECK_NL((pApi->bDeflate && pFrame->pDeflated == NULL), XSTDNON);
+
+    size_t nLength = pFrame->nSize - pFrame->nHeaderSize;
+    uint8_t nOpCode = pFrame->pData[0] & 0x0F;
+    xws_frame_type_t eType = XWS_FrameType(nOpCode);
+
+    XCHECK_NL((eType == XWS_TEXT || eType == XWS_BINARY), XSTDNON);
+    XCHECK_NL((nLength >= pApi->nDeflateThreshold), XSTDNON);
+
+    /* Fresh stream does not refer to the history of any session */
+    uint8_t nBits = pApi->deflate.nServerBits;
+    xws_zstream_t *pStream = XWS_GetZStream(&pApi->deflatePool, nBits);
+    XCHECK((pStream != NULL), XSTDERR);
+
+    xbyte_buffer_t deflated;
+    XByteBuffer_Init(&deflated, XSTDNON, XFALSE);
+
+    const uint8_t *pPayload = pFrame->pData + pFrame->nHeaderSize;
+    xws_status_t eStatus = XWS_Deflate(pStream, pPayload, nLength, &deflated, XFALSE);
+    XWS_PutZStream(&pApi->deflatePool, pStream);
+
+    /* Sessions get the original frame if compression does not pay off */
+    if (eStatus == XWS_ERR_NONE && deflated.nUsed < nLength)
+    {
+        pFrame->pDeflated = XWS_CreateFrame(deflated.pData, deflated.nUsed,
+            nOpCode | XWS_RSV1, XTRUE, &pFrame->nDeflatedSize);
+        pFrame->nDeflateBits = nBits;
+    }
+
+    XByteBuffer_Clear(&deflated);
+    XCHECK((eStatus == XWS_ERR_NONE), XSTDERR);
+    return pFrame->pDeflated != NULL ? XSTDOK : XSTDNON;
+}
+
+XSTATUS XAPI_PutTxFrame(xapi_session_t *pSession, xapi_frame_t *pFrame)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pFrame != NULL), XSTDINV);
+
+    /* The reference is dropped when the segment is sent or discarded */
+    XAPI_HoldFrame(pFrame);
+
+    if (pFrame->pDeflated == NULL ||
+        !pSession->bDeflate ||
+        pSession->eRole == XAPI_CLIENT ||
+        pSession->deflate.nServerBits < pFrame->nDeflateBits)
+        return XAPI_PutTxData(pSession, pFrame->pData, pFrame->nSize, XAPI_FrameReleaseCb, pFrame);
+
+    /* Peer window gets this message, session compressor does not */
+    pSession->bDeflateReset = XTRUE;
+    return XAPI_PutTxData(pSession, pFrame->pDeflated, pFrame->nDeflatedSize, XAPI_FrameReleaseCb, pFrame);
+}
+
+size_t XAPI_BroadcastFrame(xapi_t *pApi, xapi_frame_t *pFrame)
+{
+    XCHECK((pApi != NULL), XSTDNON);
+    XCHECK((pFrame != NULL), XSTDNON);
+
+    xapi_session_t *pSession = pApi->pWSHead;
+    size_t nCount = XSTDNON;
+
+    while (pSession != NULL)
+    {
+        /* Error callback may disconnect the current session */
+        xapi_session_t *pNext = pSession->pWSNext;
+
+        if (!pSession->bCancel &&
+            XAPI_PutTxFrame(pSession, pFrame) > 0 &&
+            XAPI_EnableEvent(pSession, XPOLLOUT) > 0) nCount++;
+
+        pSession = pNext;
+    }
+
+    return nCount;
+}
+
+size_t XAPI_Broadcast(xapi_t *pApi, const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType)
+{
+    XCHECK((pApi != NULL), XSTDNON);
+    XCHECK_NL(pApi->nWSCount, XSTDNON);
+
+    xapi_frame_t *pFrame = XAPI_NewFrame(pPayload, nLength, eType);
+    XCHECK((pFrame != NULL), XSTDNON);
+
+    /* Compressed once for all deflate sessions */
+    XAPI_DeflateFrame(pApi, pFrame);
+    size_t nCount = XAPI_BroadcastFrame(pApi, pFrame);
+    XAPI_ReleaseFrame(pFrame);
+    return nCount;
+}
+
+size_t XAPI_GetWSCount(const xapi_t *pApi)
+{
+    XCHECK_NL((pApi != NULL), XSTDNON);
+    return pApi->nWSCount;
+}
+
+XSTATUS XAPI_SetDeflate(xapi_t *pApi, const xws_deflate_t *pParams, int nLevel, size_t nThreshold)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+
+    if (pParams == NULL)
+    {
+        pApi->bDeflate = XFALSE;
+        return XSTDOK;
+    }
+
+    XCHECK_NL(XWS_HaveDeflate(), XSTDNON);
+    XCHECK((nLevel >= 0 && nLevel <= 9), XSTDINV);
+    XCHECK((pParams->nServerBits >= XWS_DEFLATE_BITS_MIN && pParams->nServerBits <= XWS_DEFLATE_BITS_MAX), XSTDINV);
+    XCHECK((pParams->nClientBits >= XWS_DEFLATE_BITS_MIN && pParams->nClientBits <= XWS_DEFLATE_BITS_MAX), XSTDINV);
+
+    /* Pooled streams keep the level they were created with */
+    if (pApi->deflatePool.nLevel != nLevel)
+    {
+        XWS_DestroyZPool(&pApi->deflatePool);
+        XWS_InitZPool(&pApi->deflatePool, XTRUE, nLevel, XAPI_ZPOOL_SIZE);
+    }
+
+    pApi->deflate = *pParams;
+    pApi->nDeflateThreshold = nThreshold;
+    pApi->bDeflate = XTRUE;
+    return XSTDOK;
+}
+
+/* Local compressor is the client one for client sessions and the server one otherwise */
+static uint8_t XAPI_GetDeflateBits(const xapi_session_t *pSession, xbool_t bLocal)
+{
+    xbool_t bClient = (pSession->eRole == XAPI_CLIENT) == bLocal;
+    return bClient ? pSession->deflate.nClientBits : pSession->deflate.nServerBits;
+}
+
+static xbool_t XAPI_GetNoTakeover(const xapi_session_t *pSession, xbool_t bLocal)
+{
+    xbool_t bClient = (pSession->eRole == XAPI_CLIENT) == bLocal;
+    return bClient ? pSession->deflate.bClientNoTakeover : pSession->deflate.bServerNoTakeover;
+}
+
+static xws_zstream_t* XAPI_GetDeflater(xapi_session_t *pSession)
+{
+    xapi_t *pApi = pSession->pApi;
+    uint8_t nBits = XAPI_GetDeflateBits(pSession, XTRUE);
+
+    /* Without context takeover the stream is borrowed for one message */
+    if (XAPI_GetNoTakeover(pSession, XTRUE))
+        return XWS_GetZStream(&pApi->deflatePool, nBits);
+
+    if (pSession->pDeflater == NULL)
+        pSession->pDeflater = XWS_GetZStream(&pApi->deflatePool, nBits);
+    else if (pSession->bDeflateReset)
+        XWS_ResetZStream(pSession->pDeflater);
+
+    pSession->bDeflateReset = XFALSE;
+    return pSession->pDeflater;
+}
+
+static xws_zstream_t* XAPI_GetInflater(xapi_session_t *pSession)
+{
+    xapi_t *pApi = pSession->pApi;
+    uint8_t nBits = XAPI_GetDeflateBits(pSession, XFALSE);
+
+    if (XAPI_GetNoTakeover(pSession, XFALSE))
+        return XWS_GetZStream(&pApi->inflatePool, nBits);
+
+    if (pSession->pInflater == NULL)
+        pSession->pInflater = XWS_GetZStream(&pApi->inflatePool, nBits);
+
+    return pSession->pInflater;
+}
+
+XSTATUS XAPI_PutTxMessage(xapi_session_t *pSession, const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType)
+{
+    XCHECK((pSession != NULL && pSession->pApi != NULL), XSTDINV);
+    XCHECK((pPayload != NULL || !nLength), XSTDINV);
+
+    xapi_t *pApi = pSession->pApi;
+    xbool_t bMask = pSession->eRole == XAPI_CLIENT;
+    xws_status_t eStatus = XWS_ERR_NONE;
+
+    xws_frame_t frame;
+    XWebFrame_Init(&frame);
+
+    /* Small messages are not worth the compression cost */
+    if (pSession->bDeflate &&
+        nLength >= pApi->nDeflateThreshold &&
+        (eType == XWS_TEXT || eType == XWS_BINARY))
+    {
+        xws_zstream_t *pStream = XAPI_GetDeflater(pSession);
+        if (pStream == NULL) eStatus = XWS_ERR_ALLOC;
+        else eStatus = XWebFrame_CreateDeflated(&frame, pStream, pPayload, nLength, eType, bMask, XFALSE);
+
+        /* Borrowed stream is reset by the pool */
+        if (pStream != pSession->pDeflater) XWS_PutZStream(&pApi->deflatePool, pStream);
+        else if (eStatus != XWS_ERR_NONE) pSession->bDeflateReset = XTRUE;
+    }
+    else
+    {
+        eStatus = XWebFrame_Create(&frame, pPayload, nLength, eType, bMask, XTRUE);
+    }
+
+    if (eStatus != XWS_ERR_NONE)
+    {
+        XAPI_ErrorCb(pApi, pSession, XAPI_WS, eStatus);
+        XWebFrame_Clear(&frame);
+        return XSTDERR;
+    }
+
+    XSTATUS nStatus = XAPI_MoveTxBuff(pSession, &frame.buffer);
+    XWebFrame_Clear(&frame);
+
+    /* Peer never gets the message that is already in the compressor history */
+    if (nStatus <= 0 && frame.bCompressed) pSession->bDeflateReset = XTRUE;
+    return nStatus;
+}
+
+static xbool_t XAPI_CopyTrimmedIP(char *pDst, size_t nDstSize, const char *pSrc, size_t nSrcLen)
+{
+    XCHECK_NL((pDst != NULL), XFALSE);
+    XCHECK_NL((nDstSize > 0), XFALSE);
+
+    pDst[0] = '\0';
+    if (pSrc == NULL || !nSrcLen) return XFALSE;
+
+    while (nSrcLen && (*pSrc == ' ' || *pSrc == '\t'))
+    {
+        nSrcLen--;
+        pSrc++;
+    }
+
+    size_t nLen = 0;
+    while (nLen < nSrcLen &&
+           pSrc[nLen] != '\0' &&
+           pSrc[nLen] != ',' &&
+           pSrc[nLen] != ' ' &&
+           pSrc[nLen] != '\t' &&
+           nLen + 1 < nDstSize) nLen++;
+
+    if (!nLen) return XFALSE;
+    memcpy(pDst, pSrc, nLen);
+    pDst[nLen] = '\0';
+
+    return XTRUE;
+}
+
+static int XAPI_DetectRealIP(xapi_session_t *pSession, xhttp_t *pHandle)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pHandle != NULL), XSTDINV);
+
+    const char *pHeaders[] = { "X-Client-IP", "X-Forwarded-For", "X-Real-IP" };
+    size_t i, nLength = XSTDNON;
+
+    for (i = 0; i < sizeof(pHeaders) / sizeof(pHeaders[0]); i++)
+    {
+        const char *pValue = XHTTP_GetHeaderSlice(pHandle, pHeaders[i], &nLength);
+        if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
+            pValue, nLength)) return XSTDOK;
+    }
+
+    if (XAPI_CopyTrimmedIP(pSession->sRealIP, sizeof(pSession->sRealIP),
+        pSession->sAddr, strlen(pSession->sAddr))) return XSTDNON;
+
+    return XSTDERR;
+}
+
+static void XAPI_ClearRoute(void *pCtx, void *pData)
+{
+    (void)pCtx;
+    free(pData);
+}
+
+XSTATUS XAPI_AddRoute(xapi_t *pApi, xhttp_method_t eMethod, const char *pPattern, xapi_cb_t callback, void *pRouteCtx)
+{
+    XCHECK((pApi != NULL && pPattern != NULL && callback != NULL), XSTDINV);
+    XCHECK((pApi->pThread == NULL), XSTDINV);
+
+    xapi_route_t *pRoute = (xapi_route_t*)malloc(sizeof(xapi_route_t));
+    XCHECK((pRoute != NULL), XSTDERR);
+
+    pRoute->callback = callback;
+    pRoute->pRouteCtx = pRouteCtx;
+
+    XSTATUS nStatus = XRouter_Add(&pApi->router, eMethod, pPattern, pRoute);
+    if (nStatus <= 0) free(pRoute);
+
+    return nStatus;
+}
+
+const xrouter_match_t* XAPI_GetRoute(const xapi_session_t *pSession)
+{
+    XCHECK_NL((pSession != NULL), NULL);
+    return pSession->pRoute;
+}
+
+const char* XAPI_GetParam(const xapi_session_t *pSession, const char *pName, size_t *pLength)
+{
+    XCHECK_NL((pSession != NULL && pSession->pRoute != NULL), NULL);
+    return XRouter_GetParam(pSession->pRoute, pName, pLength);
+}
+
+void* XAPI_GetRouteCtx(const xapi_session_t *pSession)
+{
+    XCHECK_NL((pSession != NULL && pSession->pRoute != NULL), NULL);
+    const xapi_route_t *pRoute = (const xapi_route_t*)pSession->pRoute->pData;
+    return pRoute->pRouteCtx;
+}
+
+XSTATUS XAPI_RespondHTTP(xapi_session_t *pSession, int nCode, xapi_status_t eStatus)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pSession->pApi != NULL), XSTDINV);
+    xapi_t *pApi = pSession->pApi;
+
+    char sContent[XSTR_MIN];
+    size_t nLength = xstrncpyf(sContent, sizeof(sContent), "{\"status\": \"%s\"}",
+        eStatus != XAPI_UNKNOWN ? XAPI_GetStatusStr(eStatus) : XHTTP_GetCodeStr(nCode));
+
+    const char *pAuth = eStatus == XAPI_MISSING_TOKEN ?
+        "WWW-Authenticate: Basic realm=\"XAPI\"\r\n" : XSTR_EMPTY;
+
+    const char *pAgent = XAPI_GetUserAgent(pSession);
+    const char *pCodeStr = XHTTP_GetCodeStr(nCode);
+    size_t nDateLength = 0;
+    const char *pDate = XHTTP_GetDate(&pApi->date, &nDateLength);
+
+    /* Whole response is formatted once into the tx buffer, Date is cached per second */
+    xbyte_buffer_t *pBuffer = &pSession->txBuffer;
+    size_t nReserve = strlen(pAgent) + strlen(pCodeStr) + strlen(pAuth) + nDateLength + nLength + XSTR_TINY;
+    size_t nResponse = 0, nAvail = 0;
+
+    if (XByteBuffer_Reserve(pBuffer, nReserve) > 0)
+    {
+        nAvail = pBuffer->nSize - pBuffer->nUsed;
+        nResponse = xstrncpyf((char*)&pBuffer->pData[pBuffer->nUsed], nAvail,
+            "HTTP/%s %d %s\r\n%sServer: %s\r\nContent-Type: application/json\r\n"
+            "Date: %s\r\nContent-Length: %zu\r\n\r\n%s", XHTTP_VER_DEFAULT, nCode,
+            pCodeStr, pAuth, pAgent, pDate, nLength, sContent);
+    }
+
+    if (!nResponse || nResponse >= nAvail - 1)
+    {
+        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ASSEMBLE);
+        pSession->bCancel = XTRUE;
+        return XEVENTS_DISCONNECT;
+    }
+
+    pBuffer->nUsed += nResponse;
+
+    if (eStatus > XAPI_UNKNOWN && eStatus < XAPI_STATUS_OK)
+        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, eStatus);
+    else if (eStatus != XAPI_UNKNOWN)
+        XAPI_StatusCb(pApi, pSession, XAPI_SELF, eStatus);
+
+    XSTATUS nStatus = XAPI_EnableEvent(pSession, XPOLLOUT);
+    return XAPI_StatusToEvent(pApi, nStatus);
+}
+
+XSTATUS XAPI_PutTxTemplate(xapi_session_t *pSession, const xhttp_template_t *pTemplate, const uint8_t *pContent, size_t nLength)
+{
+    XCHECK((pSession != NULL && pSession->pApi != NULL), XSTDINV);
+    xapi_t *pApi = pSession->pApi;
+
+    if (XHTTP_WriteTemplate(pTemplate, &pSession->txBuffer, &pApi->date, pContent, nLength) <= 0)
+    {
+        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ASSEMBLE);
+        return XSTDERR;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XAPI_PutTxPacket(xapi_session_t *pSession, xpacket_t *pPacket)
+{
+    XCHECK((pSession != NULL && pPacket != NULL), XSTDINV);
+
+    /* Packets are appended to the tx buffer and sent with one write */
+    if (XPacket_AssembleTo(pPacket, &pSession->txBuffer) != XPACKET_ERR_NONE)
+    {
+        XAPI_ErrorCb(pSession->pApi, pSession, XAPI_SELF, XAPI_ERR_ASSEMBLE);
+        return XSTDERR;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XAPI_AuthorizeHTTP(xapi_session_t *pSession, const char *pToken, const char *pKey)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    XCHECK((pSession->pPacket != NULL), XSTDINV);
+    xhttp_t *pHandle = (xhttp_t*)pSession->pPacket;
+
+    size_t nTokenLength = xstrused(pToken) ? strlen(pToken) : XSTDNON;
+    size_t nKeyLength = xstrused(pKey) ? strlen(pKey) : XSTDNON;
+    if (!nTokenLength && !nKeyLength) return XSTDOK;
+
+    if (nKeyLength)
+    {
+        size_t nXKeyLength = XSTDNON;
+        const char *pXKey = XHTTP_GetHeaderSlice(pHandle, "X-API-KEY", &nXKeyLength);
+        if (!nXKeyLength) return XAPI_RespondHTTP(pSession, 401, XAPI_MISSING_KEY);
+
+        if (nXKeyLength < nKeyLength || strncmp(pXKey, pKey, nKeyLength))
+            return XAPI_RespondHTTP(pSession, 401, XAPI_INVALID_KEY);
     }
 
     if (nTokenLength)
@@ -1004,46 +1979,104 @@ XSTATUS XAPI_AuthorizeHTTP(xapi_session_t *pSession, const char *pToken, const c
     return XSTDOK;
 }
 
-static int XAPI_HandleMDTP(xapi_t *pApi, xapi_session_t *pSession)
+static int XAPI_HandleMDTP(xapi_t *pApi, xapi_session_t *pSession)
+{
+    XCHECK((pSession != NULL), XSTDINV);
+    xbyte_buffer_t *pBuffer = &pSession->rxBuffer;
+    xpacket_status_t eStatus = XPACKET_COMPLETE;
+    int nRetVal = XEVENTS_CONTINUE;
+
+    /* Packets are parsed in place, consumed bytes are dropped at once */
+    xpacket_framer_t framer;
+    XPacket_InitFramer(&framer, pBuffer->pData, pBuffer->nUsed);
+
+    while (eStatus == XPACKET_COMPLETE &&
+           nRetVal == XEVENTS_CONTINUE &&
+           framer.nOffset < framer.nSize)
+    {
+        xpacket_t packet;
+        eStatus = XPacket_NextFrame(&framer, &packet);
+
+        if (eStatus == XPACKET_COMPLETE)
+        {
+            pSession->pPacket = &packet;
+
+            int nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
+            nRetVal = XAPI_StatusToEvent(pApi, nStatus);
+        }
+        else if (eStatus != XPACKET_PARSED && eStatus != XPACKET_INCOMPLETE)
+        {
+            XAPI_ErrorCb(pApi, pSession, XAPI_MDTP, eStatus);
+            nRetVal = XEVENTS_DISCONNECT;
+        }
+        else if (eStatus == XPACKET_INCOMPLETE &&
+                 framer.nSize - framer.nOffset > pApi->nRxSize)
+        {
+            XAPI_ErrorCb(pApi, pSession, XAPI_MDTP, XPACKET_BIGDATA);
+            nRetVal = XEVENTS_DISCONNECT;
+        }
+
+        pSession->pPacket = NULL;
+        XPacket_Clear(&packet);
+    }
+
+    XByteBuffer_Advance(pBuffer, framer.nOffset);
+    return nRetVal;
+}
+
+static const xrouter_t* XAPI_GetRouter(const xapi_t *pApi)
+{
+    return pApi->pThread != NULL ?
+        &pApi->pThread->pParent->router :
+        &pApi->router;
+}
+
+static int XAPI_DispatchHTTP(xapi_t *pApi, xapi_session_t *pSession, xhttp_t *pHandle)
+{
+    const xrouter_t *pRouter = XAPI_GetRouter(pApi);
+    if (!pRouter->nCount || pSession->eRole != XAPI_PEER)
+        return XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
+
+    /* Unmatched requests are passed to the main callback */
+    xrouter_match_t match;
+    xapi_route_t *pRoute = (xapi_route_t*)XRouter_Find(pRouter, pHandle->eMethod, pHandle->sUri, &match);
+    if (pRoute == NULL) return XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
+
+    xapi_ctx_t ctx;
+    ctx.nWorkerIndex = pApi->nWorkerIndex;
+    ctx.nCoreIndex = pApi->nCoreIndex;
+    ctx.eCbType = XAPI_CB_READ;
+    ctx.eStatType = XAPI_SELF;
+    ctx.nStatus = XAPI_UNKNOWN;
+    ctx.pMessage = NULL;
+    ctx.pApi = pApi;
+
+    pSession->pRoute = &match;
+    int nStatus = pRoute->callback(&ctx, pSession);
+    pSession->pRoute = NULL;
+
+    return nStatus;
+}
+
+static xhttp_status_t XAPI_ParseHTTP(xapi_session_t *pSession, size_t nOffset)
 {
-    XCHECK((pSession != NULL), XSTDINV);
     xbyte_buffer_t *pBuffer = &pSession->rxBuffer;
-    xpacket_status_t eStatus = XPACKET_ERR_NONE;
-    int nRetVal = XEVENTS_CONTINUE;
+    xhttp_t *pHandle = pSession->pHttp;
 
-    xpacket_t packet;
-    eStatus = XPacket_Parse(&packet, pBuffer->pData, pBuffer->nSize);
-
-    if (eStatus == XPACKET_COMPLETE)
+    if (pHandle == NULL)
     {
-        pSession->pPacket = &packet;
-
-        int nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
-        nRetVal = XAPI_StatusToEvent(pApi, nStatus);
+        pHandle = XHTTP_Alloc(XHTTP_DUMMY, XSTDNON);
+        XCHECK_NL((pHandle != NULL), XHTTP_EALLOC);
 
-        size_t nPacketSize = XPacket_GetSize(&packet);
-        XByteBuffer_Advance(pBuffer, nPacketSize);
-    }
-    else if (eStatus != XPACKET_PARSED && eStatus != XPACKET_INCOMPLETE)
-    {
-        XAPI_ErrorCb(pApi, pSession, XAPI_MDTP, eStatus);
-        nRetVal = XEVENTS_DISCONNECT;
+        pSession->pHttp = pHandle;
     }
-    else if (eStatus == XPACKET_INCOMPLETE && pBuffer->nUsed > pApi->nRxSize)
-    {
-        XAPI_ErrorCb(pApi, pSession, XAPI_MDTP, XPACKET_BIGDATA);
-        nRetVal = XEVENTS_DISCONNECT;
-    }
-
-    pSession->pPacket = NULL;
-    XPacket_Clear(&packet);
 
-    if (eStatus == XPACKET_COMPLETE &&
-        nRetVal == XEVENTS_CONTINUE &&
-        XByteBuffer_HasData(pBuffer))
-        return XAPI_HandleMDTP(pApi, pSession);
+    /* Recycled parser starts a new request, it may have fallen back to the map */
+    if (!pHandle->rawData.nUsed) pHandle->bSlices = XTRUE;
 
-    return nRetVal;
+    /* Incomplete request is resumed, only the newly received bytes are parsed */
+    uint8_t *pData = &pBuffer->pData[nOffset];
+    return XHTTP_Resume(pHandle, pData, pBuffer->nUsed - nOffset);
 }
 
 static int XAPI_HandleHTTP(xapi_t *pApi, xapi_session_t *pSession)
@@ -1052,45 +2085,68 @@ static int XAPI_HandleHTTP(xapi_t *pApi, xapi_session_t *pSession)
     xbyte_buffer_t *pBuffer = &pSession->rxBuffer;
     xhttp_status_t eStatus = XHTTP_NONE;
     int nRetVal = XEVENTS_CONTINUE;
+    size_t nOffset = 0;
 
-    xhttp_t handle;
-    XHTTP_Init(&handle, XHTTP_DUMMY, XSTDNON);
-    eStatus = XHTTP_ParseBuff(&handle, pBuffer);
-
-    if (!xstrused(pSession->sRealIP) &&
-        (eStatus == XHTTP_COMPLETE ||
-         eStatus == XHTTP_PARSED))
-        XAPI_DetectRealIP(pSession, &handle);
+    /* Pipelined requests are buffered until the response is sent */
+    if (pSession->bPipelineWait)
+    {
+        XCHECK_NL((pBuffer->nUsed > pApi->nRxSize), XEVENTS_CONTINUE);
+        XAPI_ErrorCb(pApi, pSession, XAPI_HTTP, XHTTP_BIGCNT);
+        return XEVENTS_DISCONNECT;
+    }
 
-    if (eStatus == XHTTP_COMPLETE)
+    /* Handle every complete request of the rx buffer in one pass */
+    while (nRetVal == XEVENTS_CONTINUE && nOffset < pBuffer->nUsed)
     {
-        pSession->pPacket = &handle;
-        pSession->bKeepAlive = handle.nKeepAlive;
+        eStatus = XAPI_ParseHTTP(pSession, nOffset);
+        xhttp_t *pHandle = pSession->pHttp;
 
-        int nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
+        if (!xstrused(pSession->sRealIP) &&
+            (eStatus == XHTTP_COMPLETE ||
+             eStatus == XHTTP_PARSED))
+            XAPI_DetectRealIP(pSession, pHandle);
+
+        if (eStatus != XHTTP_COMPLETE)
+        {
+            if (eStatus != XHTTP_PARSED && eStatus != XHTTP_INCOMPLETE)
+            {
+                XAPI_ErrorCb(pApi, pSession, XAPI_HTTP, eStatus);
+                nRetVal = XEVENTS_DISCONNECT;
+            }
+            else if (eStatus == XHTTP_INCOMPLETE && pBuffer->nUsed - nOffset > pApi->nRxSize)
+            {
+                XAPI_ErrorCb(pApi, pSession, XAPI_HTTP, XHTTP_BIGCNT);
+                nRetVal = XEVENTS_DISCONNECT;
+            }
+
+            break;
+        }
+
+        pSession->pPacket = pHandle;
+        pSession->bKeepAlive = pHandle->nKeepAlive;
+
+        int nStatus = XAPI_DispatchHTTP(pApi, pSession, pHandle);
         nRetVal = XAPI_StatusToEvent(pApi, nStatus);
 
-        size_t nPacketSize = XHTTP_GetPacketSize(&handle);
-        XByteBuffer_Advance(pBuffer, nPacketSize);
-    }
-    else if (eStatus != XHTTP_PARSED && eStatus != XHTTP_INCOMPLETE)
-    {
-        XAPI_ErrorCb(pApi, pSession, XAPI_HTTP, eStatus);
-        nRetVal = XEVENTS_DISCONNECT;
-    }
-    else if (eStatus == XHTTP_INCOMPLETE && pBuffer->nUsed > pApi->nRxSize)
-    {
-        XAPI_ErrorCb(pApi, pSession, XAPI_HTTP, XHTTP_BIGCNT);
-        nRetVal = XEVENTS_DISCONNECT;
-    }
+        nOffset += XHTTP_GetPacketSize(pHandle);
+        pSession->pPacket = NULL;
 
-    pSession->pPacket = NULL;
-    XHTTP_Clear(&handle);
+        /* Recycle parser in place, the request is referenced from rx buffer */
+        XHTTP_Recycle(pHandle);
 
-    if (eStatus == XHTTP_COMPLETE &&
-        nRetVal == XEVENTS_CONTINUE &&
-        XByteBuffer_HasData(pBuffer))
-        return XAPI_HandleHTTP(pApi, pSession);
+        /* Response will be assembled on write event, keep the order */
+        if (pSession->eRole == XAPI_PEER &&
+            XFLAGS_CHECK(pSession->nEvents, XPOLLOUT) &&
+            !XAPI_GetTxPending(pSession))
+        {
+            pSession->bPipelineWait = XTRUE;
+            break;
+        }
+    }
+
+    /* Incomplete request keeps its parser state, it is moved to the buffer start */
+    if (pSession->pHttp != NULL && nRetVal != XEVENTS_CONTINUE) XHTTP_Recycle(pSession->pHttp);
+    if (nOffset > 0) XByteBuffer_Advance(pBuffer, nOffset);
 
     return nRetVal;
 }
@@ -1157,10 +2213,14 @@ static int XAPI_AnswerUpgrade(xapi_t *pApi, xapi_session_t *pSession)
         return XEVENTS_DISCONNECT;
     }
 
+    char sExtensions[XSTR_MIN];
+    if (pSession->bDeflate) XWS_GetDeflateHeader(&pSession->deflate, XFALSE, sExtensions, sizeof(sExtensions));
+
     if (XHTTP_AddHeader(&handle, "Upgrade", "websocket") < 0 ||
         XHTTP_AddHeader(&handle, "Connection", "Upgrade") < 0 ||
         XHTTP_AddHeader(&handle, "Sec-WebSocket-Accept", "%s", pSecKey) < 0 ||
-        XHTTP_AddHeader(&handle, "Server", "%s", pSession->sUserAgent) < 0 ||
+        (pSession->bDeflate && XHTTP_AddHeader(&handle, "Sec-WebSocket-Extensions", "%s", sExtensions) < 0) ||
+        XHTTP_AddHeader(&handle, "Server", "%s", XAPI_GetUserAgent(pSession)) < 0 ||
         XHTTP_Assemble(&handle, NULL, XSTDNON) == NULL)
     {
         XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ASSEMBLE);
@@ -1196,7 +2256,7 @@ static int XAPI_RequestUpgrade(xapi_t *pApi, xapi_session_t *pSession)
     XCHECK((pSession != NULL), XSTDINV);
 
     xhttp_t handle;
-    XHTTP_InitRequest(&handle, XHTTP_GET, pSession->sUri, NULL);
+    XHTTP_InitRequest(&handle, XHTTP_GET, XAPI_GetUri(pSession), NULL);
 
     char sNonce[XWS_NONCE_LENGTH + 1];
     size_t nLength = XWS_NONCE_LENGTH;
@@ -1224,11 +2284,15 @@ static int XAPI_RequestUpgrade(xapi_t *pApi, xapi_session_t *pSession)
     if (bDefaultPort) xstrncpy(sHost, sizeof(sHost), pSession->sAddr);
     else xstrncpyf(sHost, sizeof(sHost), "%s:%u", pSession->sAddr, (unsigned)pSession->nPort);
 
+    char sExtensions[XSTR_MIN];
+    if (pApi->bDeflate) XWS_GetDeflateHeader(&pApi->deflate, XTRUE, sExtensions, sizeof(sExtensions));
+
     if (XHTTP_AddHeader(&handle, "Upgrade", "websocket") < 0 ||
         XHTTP_AddHeader(&handle, "Connection", "Upgrade") < 0 ||
         XHTTP_AddHeader(&handle, "Sec-WebSocket-Version", "%d", XWS_SEC_WS_VERSION) < 0 ||
         XHTTP_AddHeader(&handle, "Sec-WebSocket-Key", "%s", pSession->sKey) < 0 ||
-        XHTTP_AddHeader(&handle, "User-Agent", "%s", pSession->sUserAgent) < 0 ||
+        (pApi->bDeflate && XHTTP_AddHeader(&handle, "Sec-WebSocket-Extensions", "%s", sExtensions) < 0) ||
+        XHTTP_AddHeader(&handle, "User-Agent", "%s", XAPI_GetUserAgent(pSession)) < 0 ||
         XHTTP_AddHeader(&handle, "Host", "%s", sHost) < 0 ||
         XHTTP_Assemble(&handle, NULL, XSTDNON) == NULL)
     {
@@ -1283,7 +2347,7 @@ static int XAPI_ServerHandshake(xapi_t *pApi, xapi_session_t *pSession)
 
     xhttp_t handle;
     XHTTP_Init(&handle, XHTTP_DUMMY, XSTDNON);
-    eStatus = XHTTP_ParseBuff(&handle, pBuffer);
+    eStatus = XHTTP_ParseSlices(&handle, pBuffer);
 
     if (!xstrused(pSession->sRealIP) &&
         (eStatus == XHTTP_COMPLETE ||
@@ -1312,6 +2376,13 @@ static int XAPI_ServerHandshake(xapi_t *pApi, xapi_session_t *pSession)
             return XEVENTS_DISCONNECT;
         }
 
+        if (pApi->bDeflate)
+        {
+            const char *pExtensions = XHTTP_GetHeader(&handle, "Sec-WebSocket-Extensions");
+            XSTATUS nAccepted = XWS_AcceptDeflate(&pApi->deflate, pExtensions, &pSession->deflate);
+            pSession->bDeflate = nAccepted == XSTDOK ? XTRUE : XFALSE;
+        }
+
         pSession->bHandshakeStart = XTRUE;
         pSession->pPacket = &handle;
 
@@ -1398,6 +2469,22 @@ static int XAPI_ClientHandshake(xapi_t *pApi, xapi_session_t *pSession)
             return XEVENTS_DISCONNECT;
         }
 
+        /* Server must not enable extension that was not offered */
+        const char *pExtensions = XHTTP_GetHeader(&handle, "Sec-WebSocket-Extensions");
+        XSTATUS nAccepted = !pApi->bDeflate ? (xstrused(pExtensions) ? XSTDERR : XSTDNON) :
+                            XWS_CheckDeflate(&pApi->deflate, pExtensions, &pSession->deflate);
+
+        if (nAccepted < 0)
+        {
+            XAPI_ErrorCb(pApi, pSession, XAPI_WS, XWS_ERR_EXTENSION);
+            XHTTP_Clear(&handle);
+
+            pSession->bCancel = XTRUE;
+            return XEVENTS_DISCONNECT;
+        }
+
+        pSession->bDeflate = nAccepted == XSTDOK ? XTRUE : XFALSE;
+
         pSession->bHandshakeStart = XFALSE;
         pSession->bHandshakeDone = XTRUE;
         pSession->pPacket = &handle;
@@ -1438,6 +2525,7 @@ static void XAPI_ResetWSFragments(xapi_session_t *pSession)
     XCHECK_VOID_NL((pSession != NULL));
     XByteBuffer_Clear(&pSession->wsBuffer);
     pSession->bWSFragStart = XFALSE;
+    pSession->bWSFragDeflate = XFALSE;
     pSession->eWSFragType = XWS_INVALID;
 }
 
@@ -1468,6 +2556,38 @@ static int XAPI_DispatchWSFrame(xapi_t *pApi, xapi_session_t *pSession, xws_fram
     return nRetVal;
 }
 
+static int XAPI_DispatchDeflated(xapi_t *pApi, xapi_session_t *pSession,
+                                 const uint8_t *pData, size_t nLength, xws_frame_type_t eType)
+{
+    xws_zstream_t *pStream = XAPI_GetInflater(pSession);
+    xws_status_t eStatus = XWS_ERR_ALLOC;
+
+    xbyte_buffer_t inflated;
+    XByteBuffer_Init(&inflated, XSTDNON, XFALSE);
+
+    xws_frame_t frame;
+    XWebFrame_Init(&frame);
+
+    if (pStream != NULL)
+    {
+        /* Decompressed message has the same size limit as the received one */
+        eStatus = XWS_Inflate(pStream, pData, nLength, &inflated, pApi->nRxSize, XFALSE);
+        if (pStream != pSession->pInflater) XWS_PutZStream(&pApi->inflatePool, pStream);
+    }
+
+    if (eStatus == XWS_ERR_NONE)
+        eStatus = XWebFrame_Create(&frame, inflated.pData, inflated.nUsed, eType, XFALSE, XTRUE);
+
+    XByteBuffer_Clear(&inflated);
+    int nRetVal = XEVENTS_DISCONNECT;
+
+    if (eStatus != XWS_ERR_NONE) XAPI_ErrorCb(pApi, pSession, XAPI_WS, eStatus);
+    else nRetVal = XAPI_DispatchWSFrame(pApi, pSession, &frame);
+
+    XWebFrame_Clear(&frame);
+    return nRetVal;
+}
+
 static int XAPI_HandleWS(xapi_t *pApi, xapi_session_t *pSession)
 {
     XCHECK((pApi != NULL), XSTDINV);
@@ -1501,7 +2621,14 @@ static int XAPI_HandleWS(xapi_t *pApi, xapi_session_t *pSession)
         xbool_t bData = XAPI_IsWSDataFrame(frame.eType);
         xbool_t bContinuation = frame.eType == XWS_CONTINUATION;
 
-        if (bControl)
+        if (frame.bCompressed && (!pSession->bDeflate || !bData))
+        {
+            // RSV1 is allowed only on the first frame of the compressed message
+            XAPI_ResetWSFragments(pSession);
+            XAPI_ErrorCb(pApi, pSession, XAPI_WS, XWS_FRAME_INVALID);
+            nRetVal = XEVENTS_DISCONNECT;
+        }
+        else if (bControl)
         {
             // Control frames must not be fragmented
             nRetVal = XAPI_DispatchWSFrame(pApi, pSession, &frame);
@@ -1526,6 +2653,18 @@ static int XAPI_HandleWS(xapi_t *pApi, xapi_session_t *pSession)
                 XAPI_ErrorCb(pApi, pSession, XAPI_WS, XWS_FRAME_TOOBIG);
                 nRetVal = XEVENTS_DISCONNECT;
             }
+            else if (frame.bFin && pSession->bWSFragDeflate)
+            {
+                /* Take the message, fragment state is reset before the callback */
+                xbyte_buffer_t message = pSession->wsBuffer;
+                xws_frame_type_t eType = pSession->eWSFragType;
+
+                XByteBuffer_Init(&pSession->wsBuffer, XSTDNON, XFALSE);
+                XAPI_ResetWSFragments(pSession);
+
+                nRetVal = XAPI_DispatchDeflated(pApi, pSession, message.pData, message.nUsed, eType);
+                XByteBuffer_Clear(&message);
+            }
             else if (frame.bFin)
             {
                 xws_frame_t assembled;
@@ -1567,6 +2706,7 @@ static int XAPI_HandleWS(xapi_t *pApi, xapi_session_t *pSession)
             else
             {
                 pSession->bWSFragStart = XTRUE;
+                pSession->bWSFragDeflate = frame.bCompressed;
                 pSession->eWSFragType = frame.eType;
             }
         }
@@ -1575,6 +2715,10 @@ static int XAPI_HandleWS(xapi_t *pApi, xapi_session_t *pSession)
             XAPI_ErrorCb(pApi, pSession, XAPI_WS, XWS_FRAME_INVALID);
             nRetVal = XEVENTS_DISCONNECT;
         }
+        else if (frame.bCompressed)
+        {
+            nRetVal = XAPI_DispatchDeflated(pApi, pSession, pPayload, nPayloadLength, frame.eType);
+        }
         else
         {
             nRetVal = XAPI_DispatchWSFrame(pApi, pSession, &frame);
@@ -1621,6 +2765,54 @@ static int XAPI_HandleRAW(xapi_t *pApi, xapi_session_t *pSession)
     return nRetVal;
 }
 
+static int XAPI_HandleResponse(xapi_session_t *pSession, uint8_t *pData, size_t nSize)
+{
+    xapi_request_t *pRequest = pSession->pRequest;
+    xhttp_t *pResponse = &pRequest->response;
+    xhttp_status_t eStatus = XHTTP_INCOMPLETE;
+
+    /* Header is parsed once, then body is appended or chunk decoded */
+    if (XHTTP_AppendData(pResponse, pData, nSize) <= 0)
+        eStatus = pResponse->bChunked ? XHTTP_INVALID : XHTTP_EALLOC;
+    else if (!pResponse->nHeaderLength)
+        eStatus = XHTTP_Parse(pResponse);
+    else if (pResponse->bChunked)
+        eStatus = pResponse->nComplete ? XHTTP_COMPLETE : XHTTP_INCOMPLETE;
+    else if (pResponse->nContentLength && XHTTP_GetBodySize(pResponse) >= pResponse->nContentLength)
+        eStatus = XHTTP_COMPLETE;
+
+    if (eStatus == XHTTP_PARSED || eStatus == XHTTP_INCOMPLETE)
+    {
+        xbool_t bHeader = pResponse->nHeaderLength ? XTRUE : XFALSE;
+        uint16_t nCode = pResponse->nStatusCode;
+
+        /* Responses that never have a body are complete with the header */
+        if (bHeader && (pRequest->eMethod == XHTTP_HEAD ||
+            nCode < 200 || nCode == 204 || nCode == 304))
+        {
+            eStatus = XHTTP_COMPLETE;
+        }
+        else
+        {
+            size_t nMax = bHeader ? pResponse->nContentMax : pResponse->nHeaderMax;
+            if (!nMax || pResponse->rawData.nUsed <= nMax) return XEVENTS_CONTINUE;
+            eStatus = bHeader ? XHTTP_BIGCNT : XHTTP_BIGHDR;
+        }
+    }
+
+    if (eStatus == XHTTP_COMPLETE)
+    {
+        pResponse->nComplete = XTRUE;
+        XAPI_FinishRequest(pSession, XHTTP_COMPLETE);
+    }
+    else
+    {
+        pRequest->eStatus = eStatus;
+    }
+
+    return XEVENTS_DISCONNECT;
+}
+
 static int XAPI_ReadOnce(xapi_t *pApi, xapi_session_t *pSession)
 {
     XCHECK((pSession != NULL), XEVENTS_DISCONNECT);
@@ -1655,6 +2847,9 @@ static int XAPI_ReadOnce(xapi_t *pApi, xapi_session_t *pSession)
         return XEVENTS_DISCONNECT;
     }
 
+    if (pSession->pRequest != NULL)
+        return XAPI_HandleResponse(pSession, sBuffer, (size_t)nBytes);
+
     if (XByteBuffer_Add(&pSession->rxBuffer, sBuffer, nBytes) <= 0)
     {
         XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ALLOC);
@@ -1762,67 +2957,173 @@ static int XAPI_Accept(xapi_t *pApi, xapi_session_t *pSession)
     return XEVENTS_ACCEPT;
 }
 
+static int XAPI_WriteFailed(xapi_t *pApi, xapi_session_t *pSession)
+{
+    xsock_t *pSock = &pSession->sock;
+
+    if (pSock->eStatus == XSOCK_WANT_READ)
+    {
+        pSession->bWriteOnRead = XTRUE;
+        int nEvents = pSession->nEvents;
+
+        XSTATUS nStatus = XAPI_SetEvents(pSession, XPOLLIN);
+        XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+
+        pSession->nEvents = nEvents;
+        return XEVENTS_CONTINUE;
+    }
+    else if (pSock->eStatus == XSOCK_WANT_WRITE)
+    {
+        return XEVENTS_CONTINUE;
+    }
+
+    XAPI_ErrorCb(pApi, pSession, XAPI_SOCK, pSock->eStatus);
+    return XEVENTS_DISCONNECT;
+}
+
+static int XAPI_WriteComplete(xapi_t *pApi, xapi_session_t *pSession)
+{
+    XSTATUS nStatus = XAPI_DisableEvent(pSession, XPOLLOUT);
+    XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+
+    if (pSession->eType != XAPI_WS || pSession->bHandshakeDone)
+    {
+        nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_COMPLETE);
+        XCHECK_NL((nStatus >= XSTDNON), XEVENTS_DISCONNECT);
+    }
+    else if (pSession->eRole == XAPI_CLIENT)
+    {
+        nStatus = XAPI_EnableEvent(pSession, XPOLLIN);
+        XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+    }
+
+    if (pSession->eRole != XAPI_CLIENT &&
+        pSession->eType == XAPI_WS &&
+        pSession->bHandshakeStart)
+    {
+        pSession->bHandshakeStart = XFALSE;
+        pSession->bHandshakeDone = XTRUE;
+        XAPI_LinkWS(pApi, pSession);
+    }
+
+    int nRetVal = XAPI_StatusToEvent(pApi, nStatus);
+    if (!pSession->bPipelineWait) return nRetVal;
+
+    /* Response is sent, continue with the next pipelined request */
+    pSession->bPipelineWait = XFALSE;
+
+    if (nRetVal == XEVENTS_CONTINUE &&
+        XByteBuffer_HasData(&pSession->rxBuffer))
+        return XAPI_HandleHTTP(pApi, pSession);
+
+    return nRetVal;
+}
+
+static int XAPI_WriteFile(xapi_t *pApi, xapi_session_t *pSession, xapi_txseg_t *pSegment)
+{
+    xapi_txq_t *pQueue = &pSession->txQueue;
+    uint64_t nOffset = pSegment->nFileOffset + pQueue->nOffset;
+    size_t nLength = pSegment->nSize - pQueue->nOffset;
+
+    int nSent = XSock_SendFile(&pSession->sock, pSegment->nFileFD, nOffset, nLength);
+    if (nSent <= 0) return XAPI_WriteFailed(pApi, pSession);
+
+    XAPI_AdvanceTxQueue(pQueue, (size_t)nSent);
+    if (pQueue->nBytes) return XEVENTS_CONTINUE;
+
+    return XAPI_WriteComplete(pApi, pSession);
+}
+
+static int XAPI_WriteQueue(xapi_t *pApi, xapi_session_t *pSession)
+{
+    xapi_txq_t *pQueue = &pSession->txQueue;
+    xsock_iov_t iov[XSOCK_IOV_MAX];
+    size_t i, nCount = 0;
+
+    if (XAPI_FlushTxBuffer(pSession) < 0)
+    {
+        XAPI_ErrorCb(pApi, pSession, XAPI_SELF, XAPI_ERR_ALLOC);
+        return XEVENTS_DISCONNECT;
+    }
+
+    xapi_txseg_t *pHead = &pQueue->pSegments[pQueue->nHead];
+    if (pHead->bFile) return XAPI_WriteFile(pApi, pSession, pHead);
+
+    for (i = pQueue->nHead; i < pQueue->nCount && nCount < XSOCK_IOV_MAX; i++)
+    {
+        xapi_txseg_t *pSegment = &pQueue->pSegments[i];
+        size_t nOffset = i == pQueue->nHead ? pQueue->nOffset : XSTDNON;
+        if (pSegment->bFile) break;
+
+        iov[nCount].iov_base = pSegment->pData + nOffset;
+        iov[nCount].iov_len = pSegment->nSize - nOffset;
+        nCount++;
+    }
+
+    int nSent = XSock_WriteV(&pSession->sock, iov, nCount);
+    if (nSent <= 0) return XAPI_WriteFailed(pApi, pSession);
+
+    XAPI_AdvanceTxQueue(pQueue, (size_t)nSent);
+    if (!pQueue->nBytes) return XAPI_WriteComplete(pApi, pSession);
+
+    /* TLS write of the next segment may stop on renegotiation after a partial count */
+    if (pSession->sock.eStatus == XSOCK_WANT_READ) return XAPI_WriteFailed(pApi, pSession);
+    return XEVENTS_CONTINUE;
+}
+
 static int XAPI_Write(xapi_t *pApi, xapi_session_t *pSession)
 {
     XCHECK((pApi != NULL), XEVENTS_DISCONNECT);
     XCHECK((pSession != NULL), XEVENTS_DISCONNECT);
     XCHECK((!pSession->bCancel), XEVENTS_DISCONNECT);
 
+    if (pSession->txQueue.nBytes)
+        return XAPI_WriteQueue(pApi, pSession);
+
     xbyte_buffer_t *pBuffer = &pSession->txBuffer;
     XCHECK_NL(pBuffer->nUsed, XEVENTS_CONTINUE);
 
-    xsock_t *pSock = &pSession->sock;
-    XSTATUS nStatus = XSTDNON;
+    int nSent = XSock_Write(&pSession->sock, pBuffer->pData, pBuffer->nUsed);
+    if (nSent <= 0) return XAPI_WriteFailed(pApi, pSession);
 
-    int nSent = XSock_Write(pSock, pBuffer->pData, pBuffer->nUsed);
-    if (nSent <= 0)
-    {
-        if (pSock->eStatus == XSOCK_WANT_READ)
-        {
-            pSession->bWriteOnRead = XTRUE;
-            int nEvents = pSession->nEvents;
+    /* Keep buffer storage when everything is sent */
+    if ((size_t)nSent >= pBuffer->nUsed) XAPI_RecycleBuffer(pBuffer);
+    else if (XByteBuffer_Advance(pBuffer, nSent)) return XEVENTS_CONTINUE;
 
-            XSTATUS nStatus = XAPI_SetEvents(pSession, XPOLLIN);
-            XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+    return XAPI_WriteComplete(pApi, pSession);
+}
 
-            pSession->nEvents = nEvents;
-            return XEVENTS_CONTINUE;
-        }
-        else if (pSock->eStatus == XSOCK_WANT_WRITE)
-        {
-            return XEVENTS_CONTINUE;
-        }
+static int XAPI_ConnectRequest(xapi_t *pApi, xapi_session_t *pSession)
+{
+    xapi_request_t *pRequest = pSession->pRequest;
+    xsock_t *pSock = &pSession->sock;
 
+    XSTATUS nStatus = XSock_CheckConnect(pSock);
+    if (nStatus == XSOCK_ERROR)
+    {
         XAPI_ErrorCb(pApi, pSession, XAPI_SOCK, pSock->eStatus);
         return XEVENTS_DISCONNECT;
     }
-
-    if (!XByteBuffer_Advance(pBuffer, nSent))
+    else if (nStatus == XSOCK_NONE)
     {
-        nStatus = XAPI_DisableEvent(pSession, XPOLLOUT);
-        XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+        /* TLS handshake is in progress */
+        int nEvents = pSock->eStatus == XSOCK_WANT_READ ? XPOLLIN : XPOLLOUT;
+        if (pSession->nEvents == nEvents) return XEVENTS_CONTINUE;
 
-        if (pSession->eType != XAPI_WS || pSession->bHandshakeDone)
-        {
-            nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_COMPLETE);
-            XCHECK_NL((nStatus >= XSTDNON), XEVENTS_DISCONNECT);
-        }
-        else if (pSession->eRole == XAPI_CLIENT)
-        {
-            nStatus = XAPI_EnableEvent(pSession, XPOLLIN);
-            XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
-        }
+        nStatus = XAPI_SetEvents(pSession, nEvents);
+        return nStatus > XSTDNON ? XEVENTS_CONTINUE : XEVENTS_DISCONNECT;
+    }
 
-        if (pSession->eRole != XAPI_CLIENT &&
-            pSession->eType == XAPI_WS &&
-            pSession->bHandshakeStart)
-        {
-            pSession->bHandshakeStart = XFALSE;
-            pSession->bHandshakeDone = XTRUE;
-        }
+    pRequest->bConnecting = XFALSE;
+    pRequest->eStatus = XHTTP_EWRITE;
+
+    if (pSession->nEvents != XPOLLOUT)
+    {
+        nStatus = XAPI_SetEvents(pSession, XPOLLOUT);
+        XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
     }
 
-    return XAPI_StatusToEvent(pApi, nStatus);
+    return XAPI_Write(pApi, pSession);
 }
 
 static int XAPI_WriteEvent(xevents_t *pEvents, xevent_data_t *pEvData)
@@ -1852,6 +3153,9 @@ static int XAPI_WriteEvent(xevents_t *pEvents, xevent_data_t *pEvData)
         return XAPI_Read(pApi, pSession);
     }
 
+    if (pSession->pRequest != NULL && pSession->pRequest->bConnecting)
+        return XAPI_ConnectRequest(pApi, pSession);
+
     if (pSession->eRole == XAPI_CUSTOM)
     {
         nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_WRITE);
@@ -1868,37 +3172,87 @@ static int XAPI_WriteEvent(xevents_t *pEvents, xevent_data_t *pEvData)
         XCHECK((pBuffer->nUsed > 0), XEVENTS_DISCONNECT);
     }
 
-    if (!pBuffer->nUsed)
+    if (!XAPI_GetTxPending(pSession))
+    {
+        nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_WRITE);
+        int nRetVal = XAPI_StatusToEvent(pApi, nStatus);
+
+        XCHECK_NL((nRetVal == XEVENTS_CONTINUE), nRetVal);
+        if (!XAPI_GetTxPending(pSession))
+        {
+            if (pSession->eRole != XAPI_CUSTOM &&
+                (pSession->nEvents & XPOLLOUT))
+            {
+                nStatus = XAPI_DisableEvent(pSession, XPOLLOUT);
+                XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
+            }
+
+            return XEVENTS_CONTINUE;
+        }
+    }
+
+    return XAPI_Write(pApi, pSession);
+}
+
+static xapi_message_t* XAPI_TakeMessages(xapi_thread_t *pThread)
+{
+    XSync_Lock(&pThread->mailLock);
+    xapi_message_t *pMessages = pThread->pMailHead;
+    pThread->pMailHead = NULL;
+    pThread->pMailTail = NULL;
+    XSync_Unlock(&pThread->mailLock);
+    return pMessages;
+}
+
+static void XAPI_FreeMessages(xapi_message_t *pMessages)
+{
+    while (pMessages != NULL)
+    {
+        xapi_message_t *pNext = pMessages->pNext;
+        free(pMessages);
+        pMessages = pNext;
+    }
+}
+
+static int XAPI_MailboxEvent(xapi_thread_t *pThread)
+{
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
+    uint64_t nCounter = 0;
+    if (read(pThread->pMailbox->nFD, &nCounter, sizeof(nCounter)) < 0 &&
+        errno != EAGAIN && errno != EINTR) return XEVENTS_DISCONNECT;
+#endif
+
+    xapi_message_t *pMessages = XAPI_TakeMessages(pThread);
+    xapi_t *pApi = &pThread->api;
+
+    while (pMessages != NULL)
     {
-        nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_WRITE);
-        int nRetVal = XAPI_StatusToEvent(pApi, nStatus);
+        xapi_message_t *pNext = pMessages->pNext;
+        int nStatus = XAPI_MessageCb(pApi, pMessages->pMessage);
 
-        XCHECK_NL((nRetVal == XEVENTS_CONTINUE), nRetVal);
-        if (!pBuffer->nUsed)
-        {
-            if (pSession->eRole != XAPI_CUSTOM &&
-                (pSession->nEvents & XPOLLOUT))
-            {
-                nStatus = XAPI_DisableEvent(pSession, XPOLLOUT);
-                XCHECK((nStatus > XSTDNON), XEVENTS_DISCONNECT);
-            }
+        /* Same as tick callback, negative status stops the thread */
+        if (nStatus < XAPI_NO_ACTION) XSYNC_ATOMIC_SET(&pThread->nStop, XTRUE);
 
-            return XEVENTS_CONTINUE;
-        }
+        free(pMessages);
+        pMessages = pNext;
     }
 
-    return XAPI_Write(pApi, pSession);
+    return XEVENTS_CONTINUE;
 }
 
 static int XAPI_ReadEvent(xevents_t *pEvents, xevent_data_t *pEvData)
 {
     XCHECK((pEvents != NULL), XEVENTS_DISCONNECT);
     XCHECK((pEvData != NULL), XEVENTS_DISCONNECT);
-    XCHECK((pEvData->pContext != NULL), XEVENTS_DISCONNECT);
 
     xapi_t *pApi = (xapi_t*)pEvents->pUserSpace;
     XCHECK((pApi != NULL), XEVENTS_DISCONNECT);
 
+    if (pApi->pThread != NULL && pApi->pThread->pMailbox == pEvData)
+        return XAPI_MailboxEvent(pApi->pThread);
+
+    XCHECK((pEvData->pContext != NULL), XEVENTS_DISCONNECT);
+
     xapi_session_t *pSession = (xapi_session_t*)pEvData->pContext;
     if (pSession->bCancel) return XEVENTS_DISCONNECT;
 
@@ -1914,6 +3268,9 @@ static int XAPI_ReadEvent(xevents_t *pEvents, xevent_data_t *pEvData)
         return XAPI_Write(pApi, pSession);
     }
 
+    if (pSession->pRequest != NULL && pSession->pRequest->bConnecting)
+        return XAPI_ConnectRequest(pApi, pSession);
+
     if (pSession->eRole == XAPI_CUSTOM)
     {
         int nStatus = XAPI_ServiceCb(pApi, pSession, XAPI_CB_READ);
@@ -2073,9 +3430,47 @@ XSTATUS XAPI_Init(xapi_t *pApi, xapi_cb_t callback, void *pUserCtx)
     pApi->nCoreIndex = XSTDERR;
     pApi->pWorkerPIDs = NULL;
     pApi->nWorkerPID = XSTDNON;
+    pApi->nThreadCount = XSTDNON;
+    pApi->pThreads = NULL;
+    pApi->pThread = NULL;
+    pApi->pWSHead = NULL;
+    pApi->nWSCount = XSTDNON;
+    pApi->nDeflateThreshold = XWS_DEFLATE_THRESHOLD;
+    pApi->bDeflate = XFALSE;
     pApi->callback = callback;
     pApi->pUserCtx = pUserCtx;
     pApi->nRxSize = XAPI_RX_MAX;
+
+    xstrncpyf(pApi->sUserAgent, sizeof(pApi->sUserAgent), "xutils/%s", XUtils_VersionShort());
+    XRouter_Init(&pApi->router, XAPI_ClearRoute, NULL);
+    XHTTP_InitDate(&pApi->date);
+    XWS_InitDeflate(&pApi->deflate);
+    XWS_InitZPool(&pApi->deflatePool, XTRUE, XWS_DEFLATE_LEVEL, XAPI_ZPOOL_SIZE);
+    XWS_InitZPool(&pApi->inflatePool, XFALSE, XSTDNON, XAPI_ZPOOL_SIZE);
+    memset(&pApi->pool, 0, sizeof(pApi->pool));
+    pApi->pool.nMaxSize = XAPI_POOL_SIZE;
+    return XSTDOK;
+}
+
+XSTATUS XAPI_SetPoolSize(xapi_t *pApi, size_t nMaxSize)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    pApi->pool.nMaxSize = nMaxSize;
+    return XSTDOK;
+}
+
+XSTATUS XAPI_GetPoolStats(const xapi_t *pApi, xapi_pool_stats_t *pStats)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK((pStats != NULL), XSTDINV);
+
+    const xapi_pool_t *pPool = &pApi->pool;
+    pStats->nCapacity = pPool->nCapacity;
+    pStats->nMaxSize = pPool->nMaxSize;
+    pStats->nInUse = pPool->nInUse;
+    pStats->nFree = pPool->nFree;
+    pStats->nHits = pPool->nHits;
+    pStats->nMisses = pPool->nMisses;
     return XSTDOK;
 }
 
@@ -2142,6 +3537,239 @@ XSTATUS XAPI_InitWorkers(xapi_t *pApi, size_t nWorkers, xbool_t bSetAffinity)
 #endif
 }
 
+static void* XAPI_ThreadMain(void *pArg)
+{
+    xapi_thread_t *pThread = (xapi_thread_t*)pArg;
+    xapi_t *pApi = &pThread->api;
+
+    if (XAPI_SetWorkerCPUAffinity(pApi, pThread->nIndex) < 0)
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_SUPPORT);
+
+    while (!XSYNC_ATOMIC_GET(&pThread->nStop))
+    {
+        xevent_status_t eStatus = XAPI_Service(pApi, XSTDERR);
+        if (eStatus != XEVENTS_SUCCESS) break;
+    }
+
+    return NULL;
+}
+
+static void XAPI_WakeThread(xapi_thread_t *pThread)
+{
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
+    uint64_t nCounter = 1;
+    if (write(pThread->pMailbox->nFD, &nCounter, sizeof(nCounter)) < 0) return;
+#else
+    (void)pThread;
+#endif
+}
+
+static void XAPI_DestroyThreads(xapi_t *pApi)
+{
+    XAPI_StopThreads(pApi);
+    size_t i;
+
+    for (i = 0; i < pApi->nThreadCount; i++)
+    {
+        xapi_thread_t *pThread = &pApi->pThreads[i];
+        XAPI_Destroy(&pThread->api);
+
+        XAPI_FreeMessages(pThread->pMailHead);
+        XSync_Destroy(&pThread->mailLock);
+    }
+
+    free(pApi->pThreads);
+    pApi->pThreads = NULL;
+    pApi->nThreadCount = XSTDNON;
+}
+
+static XSTATUS XAPI_InitThread(xapi_t *pApi, xapi_thread_t *pThread, size_t nIndex)
+{
+    xapi_t *pThreadApi = &pThread->api;
+    XAPI_Init(pThreadApi, pApi->callback, pApi->pUserCtx);
+
+    pThreadApi->bAllowMissingKey = pApi->bAllowMissingKey;
+    pThreadApi->bSetAffinity = pApi->bSetAffinity;
+    pThreadApi->bUseHashMap = pApi->bUseHashMap;
+    pThreadApi->nWorkerIndex = (int)nIndex;
+    pThreadApi->pool.nMaxSize = pApi->pool.nMaxSize;
+    pThreadApi->nRxSize = pApi->nRxSize;
+    pThreadApi->pThread = pThread;
+
+    if (pApi->bDeflate)
+    {
+        XAPI_SetDeflate(pThreadApi, &pApi->deflate,
+            pApi->deflatePool.nLevel, pApi->nDeflateThreshold);
+    }
+
+    XSync_Init(&pThread->mailLock);
+    pThread->pMailHead = NULL;
+    pThread->pMailTail = NULL;
+    pThread->pMailbox = NULL;
+    pThread->bRunning = XFALSE;
+    pThread->pParent = pApi;
+    pThread->nIndex = nIndex;
+    pThread->nStop = XFALSE;
+
+    xevents_t *pEvents = XAPI_GetOrCreateEvents(pThreadApi);
+    XCHECK((pEvents != NULL), XSTDERR);
+
+    pThread->pMailbox = XEvents_CreateEvent(pEvents, NULL);
+    if (pThread->pMailbox == NULL)
+    {
+        XAPI_ErrorCb(pThreadApi, NULL, XAPI_SELF, XAPI_ERR_REGISTER);
+        return XSTDERR;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XAPI_InitThreads(xapi_t *pApi, size_t nThreads, xbool_t bSetAffinity)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK((nThreads > 0), XSTDINV);
+
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
+    XCHECK((pApi->pThread == NULL), XSTDINV);
+    XCHECK((pApi->pThreads == NULL && !pApi->nWorkerCount), XSTDEXC);
+
+    pApi->pThreads = (xapi_thread_t*)calloc(nThreads, sizeof(xapi_thread_t));
+    if (pApi->pThreads == NULL)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        return XSTDERR;
+    }
+
+    /* Scanner and masker are selected lazily on first use, do it before threads run concurrently */
+    XHTTP_GetScanner();
+    XWS_GetMasker();
+
+    pApi->bSetAffinity = bSetAffinity;
+    size_t i;
+
+    for (i = 0; i < nThreads; i++)
+    {
+        pApi->nThreadCount = i + 1;
+
+        if (XAPI_InitThread(pApi, &pApi->pThreads[i], i) < 0)
+        {
+            XAPI_DestroyThreads(pApi);
+            return XSTDERR;
+        }
+    }
+
+    return XSTDOK;
+#else
+    (void)bSetAffinity;
+    return XSTDNON;
+#endif
+}
+
+XSTATUS XAPI_RunThreads(xapi_t *pApi)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK((pApi->pThreads != NULL), XSTDINV);
+    size_t i;
+
+    for (i = 0; i < pApi->nThreadCount; i++)
+    {
+        xapi_thread_t *pThread = &pApi->pThreads[i];
+        if (pThread->bRunning) continue;
+
+        if (XThread_Create(&pThread->thread, XAPI_ThreadMain, pThread, XFALSE) < 0)
+        {
+            XAPI_ErrorCb(&pThread->api, NULL, XAPI_SELF, XAPI_ERR_THREAD);
+            XAPI_StopThreads(pApi);
+            return XSTDERR;
+        }
+
+        pThread->bRunning = XTRUE;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XAPI_StopThreads(xapi_t *pApi)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    XCHECK_NL((pApi->pThreads != NULL), XSTDNON);
+    size_t i;
+
+    for (i = 0; i < pApi->nThreadCount; i++)
+    {
+        xapi_thread_t *pThread = &pApi->pThreads[i];
+        XSYNC_ATOMIC_SET(&pThread->nStop, XTRUE);
+        if (pThread->bRunning) XAPI_WakeThread(pThread);
+    }
+
+    for (i = 0; i < pApi->nThreadCount; i++)
+    {
+        xapi_thread_t *pThread = &pApi->pThreads[i];
+        if (!pThread->bRunning) continue;
+
+        XThread_Join(&pThread->thread);
+        pThread->bRunning = XFALSE;
+    }
+
+    return XSTDOK;
+}
+
+static XSTATUS XAPI_PostThread(xapi_thread_t *pThread, void *pMessage)
+{
+    xapi_message_t *pNode = (xapi_message_t*)malloc(sizeof(xapi_message_t));
+    XCHECK((pNode != NULL), XSTDERR);
+
+    pNode->pMessage = pMessage;
+    pNode->pNext = NULL;
+
+    XSync_Lock(&pThread->mailLock);
+    xbool_t bWake = pThread->pMailHead == NULL;
+
+    if (pThread->pMailTail != NULL) pThread->pMailTail->pNext = pNode;
+    else pThread->pMailHead = pNode;
+
+    pThread->pMailTail = pNode;
+    XSync_Unlock(&pThread->mailLock);
+
+    /* Queue was not empty, receiver is already signaled */
+    if (bWake) XAPI_WakeThread(pThread);
+    return XSTDOK;
+}
+
+XSTATUS XAPI_PostMessage(xapi_t *pApi, int nThread, void *pMessage)
+{
+    XCHECK((pApi != NULL), XSTDINV);
+    if (pApi->pThread != NULL) pApi = pApi->pThread->pParent;
+
+    XCHECK((pApi->pThreads != NULL), XSTDINV);
+    XCHECK((nThread < (int)pApi->nThreadCount), XSTDINV);
+
+    if (nThread >= 0)
+        return XAPI_PostThread(&pApi->pThreads[nThread], pMessage);
+
+    size_t i;
+    for (i = 0; i < pApi->nThreadCount; i++)
+    {
+        if (XAPI_PostThread(&pApi->pThreads[i], pMessage) < 0)
+            return XSTDERR;
+    }
+
+    return XSTDOK;
+}
+
+xapi_t* XAPI_GetThreadApi(xapi_t *pApi, size_t nIndex)
+{
+    XCHECK_NL((pApi != NULL), NULL);
+    XCHECK_NL((nIndex < pApi->nThreadCount), NULL);
+    return &pApi->pThreads[nIndex].api;
+}
+
+size_t XAPI_GetThreadCount(const xapi_t *pApi)
+{
+    XCHECK_NL((pApi != NULL), XSTDNON);
+    return pApi->nThreadCount;
+}
+
 XSTATUS XAPI_SetRxSize(xapi_t *pApi, size_t nSize)
 {
     XCHECK((pApi != NULL), XSTDINV);
@@ -2153,6 +3781,9 @@ void XAPI_Destroy(xapi_t *pApi)
 {
     XCHECK_VOID_NL((pApi != NULL));
 
+    if (pApi->pThreads != NULL)
+        XAPI_DestroyThreads(pApi);
+
     if (pApi->pWorkerPIDs != NULL)
     {
         free(pApi->pWorkerPIDs);
@@ -2165,9 +3796,19 @@ void XAPI_Destroy(xapi_t *pApi)
     pApi->nWorkerPID = XSTDNON;
     pApi->bIsWorker = XFALSE;
 
-    XCHECK_VOID_NL(pApi->bHaveEvents);
-    xevents_t *pEvents = &pApi->events;
-    XEvents_Destroy(pEvents);
+    if (pApi->bHaveEvents)
+    {
+        xevents_t *pEvents = &pApi->events;
+        XEvents_Destroy(pEvents);
+    }
+
+    /* Sessions are returned to the pool by event clear callbacks */
+    XAPI_DestroyPool(&pApi->pool);
+    XRouter_Destroy(&pApi->router);
+
+    /* Along with their compression streams */
+    XWS_DestroyZPool(&pApi->deflatePool);
+    XWS_DestroyZPool(&pApi->inflatePool);
 }
 
 xevent_status_t XAPI_Service(xapi_t *pApi, int nTimeoutMs)
@@ -2199,9 +3840,28 @@ void XAPI_InitEndpoint(xapi_endpoint_t *pEndpt)
     pEndpt->bUnix = XFALSE;
     pEndpt->bForce = XFALSE;
     pEndpt->bExclusive = XTRUE;
+    pEndpt->bReusePort = XFALSE;
     pEndpt->nFD = XSOCK_INVALID;
 }
 
+static XSTATUS XAPI_ListenThreads(xapi_t *pApi, xapi_endpoint_t *pEndpt)
+{
+    xapi_endpoint_t endpt = *pEndpt;
+    size_t i, nCount = pApi->nThreadCount;
+
+    /* Unix sockets can not be balanced by kernel, first thread owns it */
+    if (endpt.bUnix) nCount = 1;
+    else endpt.bReusePort = XTRUE;
+
+    for (i = 0; i < nCount; i++)
+    {
+        XSTATUS nStatus = XAPI_Listen(&pApi->pThreads[i].api, &endpt);
+        if (nStatus != XSTDOK) return nStatus;
+    }
+
+    return XSTDOK;
+}
+
 XSTATUS XAPI_Listen(xapi_t *pApi, xapi_endpoint_t *pEndpt)
 {
     XCHECK((pApi != NULL), XSTDINV);
@@ -2215,6 +3875,9 @@ XSTATUS XAPI_Listen(xapi_t *pApi, xapi_endpoint_t *pEndpt)
         return XSTDINV;
     }
 
+    if (pApi->pThreads != NULL)
+        return XAPI_ListenThreads(pApi, pEndpt);
+
     xapi_session_t *pSession = XAPI_NewData(pApi, pEndpt->eType);
     if (pSession == NULL)
     {
@@ -2227,13 +3890,20 @@ XSTATUS XAPI_Listen(xapi_t *pApi, xapi_endpoint_t *pEndpt)
     xsock_t *pSock = &pSession->sock;
 
     xstrncpy(pSession->sAddr, sizeof(pSession->sAddr), pEndpt->pAddr);
-    xstrncpy(pSession->sUri, sizeof(pSession->sUri), pEndpointUri);
+
+    if (XAPI_SetString(&pSession->pUri, pEndpointUri) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        XAPI_FreeData(&pSession);
+        return XSTDERR;
+    }
 
     pSession->pSessionData = pEndpt->pSessionData;
     pSession->nPort = pEndpt->nPort;
     pSession->eRole = XAPI_SERVER;
 
     uint32_t nFlags = XSOCK_SERVER | XSOCK_REUSEADDR | XSOCK_NB;
+    if (pEndpt->bReusePort) nFlags |= XSOCK_REUSEPORT;
     if (pEndpt->bForce) nFlags |= XSOCK_FORCE;
     if (pEndpt->bTLS) nFlags |= XSOCK_SSL;
     if (pEndpt->bUnix) nFlags |= XSOCK_UNIX;
@@ -2349,7 +4019,13 @@ XSTATUS XAPI_Connect(xapi_t *pApi, xapi_endpoint_t *pEndpt)
     xsock_t *pSock = &pSession->sock;
 
     xstrncpy(pSession->sAddr, sizeof(pSession->sAddr), pEndpt->pAddr);
-    xstrncpy(pSession->sUri, sizeof(pSession->sUri), pEndpointUri);
+
+    if (XAPI_SetString(&pSession->pUri, pEndpointUri) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        XAPI_FreeData(&pSession);
+        return XSTDERR;
+    }
 
     pSession->pSessionData = pEndpt->pSessionData;
     pSession->nPort = pEndpt->nPort;
@@ -2404,6 +4080,139 @@ XSTATUS XAPI_Connect(xapi_t *pApi, xapi_endpoint_t *pEndpt)
     return XSTDOK;
 }
 
+static XSTATUS XAPI_DropRequest(xapi_session_t *pSession)
+{
+    /* Submit failed, caller gets the error instead of the callback */
+    if (pSession->pRequest != NULL) pSession->pRequest->bDone = XTRUE;
+    XAPI_FreeData(&pSession);
+    return XSTDERR;
+}
+
+XSTATUS XAPI_LinkRequest(xapi_t *pApi, xhttp_t *pRequest, xlink_t *pLink, const uint8_t *pBody, size_t nLength,
+                         int nTimeoutMs, xapi_response_cb_t callback, void *pUserCtx)
+{
+    XCHECK((pApi != NULL && pRequest != NULL), XSTDINV);
+    XCHECK((pLink != NULL && callback != NULL), XSTDINV);
+
+    if (!xstrused(pLink->sProtocol)) xstrncpy(pLink->sProtocol, sizeof(pLink->sProtocol), "http");
+    XCHECK((!strncmp(pLink->sProtocol, "http", 4)), XSTDINV);
+
+    xbool_t bTLS = !strncmp(pLink->sProtocol, "https", 5);
+    xbool_t bUnix = xstrused(pRequest->sUnixAddr);
+    uint16_t nPort = (uint16_t)pLink->nPort;
+    if (!nPort) nPort = bTLS ? XHTTP_SSL_PORT : XHTTP_DEF_PORT;
+
+    if (!pRequest->nComplete &&
+        XHTTP_GetHeader(pRequest, "Host") == NULL &&
+        XHTTP_AddHeader(pRequest, "Host", "%s", pLink->sAddr) <= 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_HTTP, XHTTP_ESETHDR);
+        return XSTDERR;
+    }
+
+    if (XHTTP_SetAuthBasic(pRequest, pLink->sUser, pLink->sPass) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_HTTP, XHTTP_EAUTH);
+        return XSTDERR;
+    }
+
+    xbyte_buffer_t *pBuffer = XHTTP_Assemble(pRequest, pBody, nLength);
+    if (pBuffer == NULL)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_HTTP, XHTTP_EASSEMBLE);
+        return XSTDERR;
+    }
+
+    xapi_session_t *pSession = XAPI_NewData(pApi, XAPI_HTTP);
+    if (pSession == NULL)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        return XSTDERR;
+    }
+
+    xapi_request_t *pReq = (xapi_request_t*)malloc(sizeof(xapi_request_t));
+    if (pReq == NULL || XByteBuffer_AddBuff(&pSession->txBuffer, pBuffer) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        XAPI_FreeData(&pSession);
+        free(pReq);
+        return XSTDERR;
+    }
+
+    XHTTP_Init(&pReq->response, XHTTP_DUMMY, XSTDNON);
+    pReq->eStatus = XHTTP_ECONNECT;
+    pReq->eMethod = pRequest->eMethod;
+    pReq->bConnecting = XTRUE;
+    pReq->callback = callback;
+    pReq->pUserCtx = pUserCtx;
+    pReq->bDone = XFALSE;
+
+    pSession->pRequest = pReq;
+    pSession->eRole = XAPI_CLIENT;
+    pSession->nPort = nPort;
+
+    const char *pAddr = bUnix ? pRequest->sUnixAddr : pLink->sAddr;
+    xstrncpy(pSession->sAddr, sizeof(pSession->sAddr), pAddr);
+
+    uint32_t nFlags = XSOCK_CLIENT | XSOCK_ASYNC;
+    nFlags |= bUnix ? XSOCK_UNIX : XSOCK_TCP;
+
+    if (bTLS)
+    {
+        nFlags |= XSOCK_SSL;
+        XSock_InitSSL();
+    }
+
+    /* Name is used for SNI and certificate verification, see XAPI_Connect() */
+    xsock_t *pSock = &pSession->sock;
+    XSock_CreateAdv(pSock, nFlags, 0, pAddr, nPort, pLink->sAddr);
+
+    if (pSock->nFD == XSOCK_INVALID)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SOCK, pSock->eStatus);
+        return XAPI_DropRequest(pSession);
+    }
+
+    xevents_t *pEvents = XAPI_GetOrCreateEvents(pApi);
+    if (pEvents == NULL) return XAPI_DropRequest(pSession);
+
+    /* Write readiness reports the completion of connect() */
+    xevent_data_t *pEvData = XEvents_RegisterEvent(pEvents, pSession, pSock->nFD, XPOLLOUT, XAPI_CLIENT);
+    if (pEvData == NULL)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_REGISTER);
+        return XAPI_DropRequest(pSession);
+    }
+
+    pSession->pEvData = pEvData;
+    pSession->nEvents = XPOLLOUT;
+
+    /* Deadline covers connect, handshake, write and read */
+    if (nTimeoutMs > 0 && XAPI_AddTimer(pSession, nTimeoutMs) < 0)
+    {
+        pReq->bDone = XTRUE;
+        XEvents_Delete(pEvents, pEvData);
+        return XSTDERR;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XAPI_EasyRequest(xapi_t *pApi, xhttp_t *pRequest, const char *pLink, const uint8_t *pBody, size_t nLength,
+                         int nTimeoutMs, xapi_response_cb_t callback, void *pUserCtx)
+{
+    XCHECK((pLink != NULL), XSTDINV);
+    xlink_t link;
+
+    if (XLink_Parse(&link, pLink) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_HTTP, XHTTP_ELINK);
+        return XSTDINV;
+    }
+
+    return XAPI_LinkRequest(pApi, pRequest, &link, pBody, nLength, nTimeoutMs, callback, pUserCtx);
+}
+
 XSTATUS XAPI_AddEvent(xapi_t *pApi, xapi_endpoint_t *pEndpt)
 {
     XCHECK((pApi != NULL), XSTDINV);
@@ -2421,7 +4230,13 @@ XSTATUS XAPI_AddEvent(xapi_t *pApi, xapi_endpoint_t *pEndpt)
     const char *pEndpointUri = pEndpt->pUri ? pEndpt->pUri : "/";
     uint32_t nEvents = pEndpt->nEvents ? pEndpt->nEvents : XPOLLIO;
 
-    xstrncpy(pSession->sUri, sizeof(pSession->sUri), pEndpointUri);
+    if (XAPI_SetString(&pSession->pUri, pEndpointUri) < 0)
+    {
+        XAPI_ErrorCb(pApi, NULL, XAPI_SELF, XAPI_ERR_ALLOC);
+        XAPI_FreeData(&pSession);
+        return XSTDERR;
+    }
+
     pSession->pSessionData = pEndpt->pSessionData;
     pSession->nPort = pEndpt->nPort;
     pSession->eRole = pEndpt->eRole;
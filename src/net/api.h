@@ -17,14 +17,19 @@
 #include "event.h"
 #include "sock.h"
 #include "http.h"
+#include "router.h"
 #include "mdtp.h"
 #include "ws.h"
+#include "sync.h"
+#include "thread.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct xapi_ xapi_t;
+typedef struct xapi_thread_ xapi_thread_t;
+typedef struct xapi_request_ xapi_request_t;
 
 #define XAPI_CONTINUE   XSTDOK
 #define XAPI_DISCONNECT XSTDERR
@@ -33,6 +38,8 @@ typedef struct xapi_ xapi_t;
 #define XAPI_RELOOP     XSTDACT
 #define XAPI_DELETE     XSTDDEL
 
+#define XAPI_BROADCAST  -1
+
 typedef enum {
     XAPI_CB_ERROR = 0,
     XAPI_CB_STATUS,
@@ -53,7 +60,8 @@ typedef enum {
     XAPI_CB_PONG,
     XAPI_CB_USER,
     XAPI_CB_TIMER,
-    XAPI_CB_TICK
+    XAPI_CB_TICK,
+    XAPI_CB_MESSAGE
 } xapi_cb_type_t;
 
 typedef enum {
@@ -77,6 +85,8 @@ typedef enum {
     XAPI_ERR_CHMOD,
     XAPI_ERR_CHOWN,
     XAPI_ERR_CRTDIR,
+    XAPI_ERR_THREAD,
+    XAPI_ERR_FILE,
     XAPI_STATUS_OK = 100,
     XAPI_TIMER_DESTROY,
     XAPI_DESTROY,
@@ -115,18 +125,58 @@ typedef struct xapi_endpoint_ {
     uint32_t nEvents;
     uint16_t nPort;
     xbool_t bExclusive;
+    xbool_t bReusePort;
     xbool_t bForce;
     xbool_t bUnix;
     xbool_t bTLS;
     XSOCKET nFD;
 } xapi_endpoint_t;
 
+typedef void(*xapi_release_cb_t)(void *pCtx, uint8_t *pData, size_t nSize);
+
+typedef struct xapi_txseg_ {
+    xapi_release_cb_t releaseCb;
+    void *pReleaseCtx;
+    uint8_t *pData;
+    size_t nSize;
+    xbool_t bOwned;
+
+    /* File segments are sent from nFileFD without loading in memory */
+    uint64_t nFileOffset;
+    xbool_t bFile;
+    int nFileFD;
+} xapi_txseg_t;
+
+typedef struct xapi_txq_ {
+    xapi_txseg_t *pSegments;
+    size_t nOffset;
+    size_t nBytes;
+    size_t nHead;
+    size_t nCount;
+    size_t nSize;
+} xapi_txq_t;
+
+/* Encoded once and shared by tx queues of many sessions */
+typedef struct xapi_frame_ {
+    xatomic_t nRefs;
+    uint8_t *pData;
+    size_t nSize;
+    size_t nHeaderSize;
+
+    /* Compressed variant for permessage-deflate sessions, see XAPI_DeflateFrame() */
+    uint8_t *pDeflated;
+    size_t nDeflatedSize;
+    uint8_t nDeflateBits;
+} xapi_frame_t;
+
 typedef struct xapi_session_ {
-    char sUserAgent[XSTR_MID];
     char sRealIP[XSOCK_ADDR_MAX];
     char sAddr[XSOCK_ADDR_MAX];
     char sKey[XSOCK_ADDR_MAX];
-    char sUri[XHTTP_URL_MAX];
+
+    /* Allocated on demand, use XAPI_GetUri() and XAPI_GetUserAgent() */
+    char *pUserAgent;
+    char *pUri;
 
     uint16_t nPort;
     xsock_t sock;
@@ -142,14 +192,19 @@ typedef struct xapi_session_ {
     xbool_t bWriteOnRead;
     xbool_t bKeepRxBuffer;
 
+    /* HTTP pipelining, next request waits for the response */
+    xbool_t bPipelineWait;
+
     /* WebSocket handshake routine */
     xbool_t bHandshakeStart;
     xbool_t bHandshakeDone;
     xbool_t bWSFragStart;
+    xbool_t bWSFragDeflate;
 
     xbyte_buffer_t rxBuffer;
     xbyte_buffer_t txBuffer;
     xbyte_buffer_t wsBuffer;
+    xapi_txq_t txQueue;
     xevent_data_t *pEvData;
     xevent_data_t *pTimer;
 
@@ -160,28 +215,106 @@ typedef struct xapi_session_ {
 
     void *pSessionData;
     void *pPacket;
+
+    /* Matched route, valid only while the route handler runs */
+    const xrouter_match_t *pRoute;
+
+    /* Request parser, recycled for keep-alive and pooled sessions */
+    xhttp_t *pHttp;
+
+    /* Async HTTP client request, see XAPI_LinkRequest() */
+    xapi_request_t *pRequest;
+
+    /* Session pool link */
+    struct xapi_session_ *pPoolNext;
+    xbool_t bPooled;
+
+    /* Broadcast list link, see XAPI_Broadcast() */
+    struct xapi_session_ *pWSNext;
+    struct xapi_session_ *pWSPrev;
+    xbool_t bWSLinked;
+
+    /* Negotiated permessage-deflate, streams are taken from the pools of xapi_t */
+    xws_deflate_t deflate;
+    xws_zstream_t *pDeflater;
+    xws_zstream_t *pInflater;
+    xbool_t bDeflateReset;
+    xbool_t bDeflate;
 } xapi_session_t;
 
+typedef struct xapi_slab_ {
+    struct xapi_slab_ *pNext;
+    xapi_session_t *pSessions;
+    size_t nCount;
+} xapi_slab_t;
+
+typedef struct xapi_pool_ {
+    xapi_session_t *pFree;
+    xapi_slab_t *pSlabs;
+    size_t nCapacity;
+    size_t nMaxSize;
+    size_t nInUse;
+    size_t nFree;
+    size_t nHits;
+    size_t nMisses;
+} xapi_pool_t;
+
+typedef struct xapi_pool_stats_ {
+    size_t nCapacity;
+    size_t nMaxSize;
+    size_t nInUse;
+    size_t nFree;
+    size_t nHits;
+    size_t nMisses;
+} xapi_pool_stats_t;
+
 typedef struct xapi_ctx_ {
     xapi_cb_type_t eCbType;
     xapi_type_t eStatType;
     uint8_t nStatus;
     int nWorkerIndex;
     int nCoreIndex;
+    void *pMessage;
     xapi_t *pApi;
 } xapi_ctx_t;
 
 typedef int(*xapi_cb_t)(xapi_ctx_t *pCtx, xapi_session_t *pData);
+typedef void(*xapi_response_cb_t)(xapi_t *pApi, xhttp_t *pResponse, xhttp_status_t eStatus, void *pUserCtx);
 
 struct xapi_ {
+    char sUserAgent[XSTR_TINY];
     xapi_cb_t callback;
     xevents_t events;
+    xapi_pool_t pool;
+
+    /* HTTP routes, thread APIs use the router of the parent */
+    xrouter_t router;
+
+    /* Per-second Date header cache of this runtime */
+    xhttp_date_t date;
+
+    /* Server WebSocket sessions with completed handshake */
+    xapi_session_t *pWSHead;
+    size_t nWSCount;
+
+    /* WebSocket permessage-deflate, see XAPI_SetDeflate() */
+    xws_deflate_t deflate;
+    xws_zpool_t deflatePool;
+    xws_zpool_t inflatePool;
+    size_t nDeflateThreshold;
+    xbool_t bDeflate;
+
     size_t nRxSize;
     void *pUserCtx;
 
     xpid_t *pWorkerPIDs;
     xpid_t nWorkerPID;
 
+    /* Thread mode */
+    xapi_thread_t *pThreads;
+    xapi_thread_t *pThread;
+    size_t nThreadCount;
+
     xuint_t nSessionCounter;
     size_t nWorkerCount;
     int nWorkerIndex;
@@ -194,6 +327,27 @@ struct xapi_ {
     xbool_t bIsWorker;
 };
 
+typedef struct xapi_message_ {
+    struct xapi_message_ *pNext;
+    void *pMessage;
+} xapi_message_t;
+
+struct xapi_thread_ {
+    xapi_t api;
+    xapi_t *pParent;
+    xthread_t thread;
+
+    /* Cross-thread mailbox */
+    xsync_mutex_t mailLock;
+    xapi_message_t *pMailHead;
+    xapi_message_t *pMailTail;
+    xevent_data_t *pMailbox;
+
+    xatomic_t nStop;
+    xbool_t bRunning;
+    size_t nIndex;
+};
+
 const char* XAPI_GetStatus(xapi_ctx_t *pCtx);
 const char* XAPI_GetStatusStr(xapi_status_t eStatus);
 const char* XAPI_GetTypeStr(xapi_type_t eType);
@@ -204,10 +358,38 @@ xbool_t XAPI_IsSupportedRole(xapi_role_t eRole);
 xbyte_buffer_t* XAPI_GetTxBuff(xapi_session_t *pSession);
 xbyte_buffer_t* XAPI_GetRxBuff(xapi_session_t *pSession);
 XSTATUS XAPI_PutTxBuff(xapi_session_t *pSession, xbyte_buffer_t *pBuffer);
+XSTATUS XAPI_PutTxTemplate(xapi_session_t *pSession, const xhttp_template_t *pTemplate, const uint8_t *pContent, size_t nLength);
+XSTATUS XAPI_PutTxPacket(xapi_session_t *pSession, xpacket_t *pPacket);
+XSTATUS XAPI_PutTxChunk(xapi_session_t *pSession, const uint8_t *pData, size_t nSize);
+XSTATUS XAPI_MoveTxBuff(xapi_session_t *pSession, xbyte_buffer_t *pBuffer);
+XSTATUS XAPI_PutTxOwned(xapi_session_t *pSession, uint8_t *pData, size_t nSize);
+XSTATUS XAPI_PutTxData(xapi_session_t *pSession, const uint8_t *pData, size_t nSize, xapi_release_cb_t releaseCb, void *pCtx);
+XSTATUS XAPI_SendFile(xapi_session_t *pSession, const char *pPath, uint64_t nOffset, size_t nLength);
+XSTATUS XAPI_SendFileFD(xapi_session_t *pSession, int nFD, uint64_t nOffset, size_t nLength, xbool_t bCloseFD);
+size_t XAPI_GetTxPending(xapi_session_t *pSession);
+
+xapi_frame_t* XAPI_NewFrame(const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType);
+xapi_frame_t* XAPI_HoldFrame(xapi_frame_t *pFrame);
+void XAPI_ReleaseFrame(xapi_frame_t *pFrame);
+
+XSTATUS XAPI_DeflateFrame(xapi_t *pApi, xapi_frame_t *pFrame);
+XSTATUS XAPI_PutTxFrame(xapi_session_t *pSession, xapi_frame_t *pFrame);
+size_t XAPI_BroadcastFrame(xapi_t *pApi, xapi_frame_t *pFrame);
+size_t XAPI_Broadcast(xapi_t *pApi, const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType);
+size_t XAPI_GetWSCount(const xapi_t *pApi);
+
+XSTATUS XAPI_SetDeflate(xapi_t *pApi, const xws_deflate_t *pParams, int nLevel, size_t nThreshold);
+XSTATUS XAPI_PutTxMessage(xapi_session_t *pSession, const uint8_t *pPayload, size_t nLength, xws_frame_type_t eType);
+
+const char* XAPI_GetUri(const xapi_session_t *pSession);
+const char* XAPI_GetUserAgent(const xapi_session_t *pSession);
+XSTATUS XAPI_SetUserAgent(xapi_session_t *pSession, const char *pUserAgent);
 
 XSTATUS XAPI_Init(xapi_t *pApi, xapi_cb_t callback, void *pUserCtx);
 XSTATUS XAPI_SetRxSize(xapi_t *pApi, size_t nSize);
 XSTATUS XAPI_SetWorkerAffinity(xapi_t *pApi, xbool_t bEnable);
+XSTATUS XAPI_SetPoolSize(xapi_t *pApi, size_t nMaxSize);
+XSTATUS XAPI_GetPoolStats(const xapi_t *pApi, xapi_pool_stats_t *pStats);
 void XAPI_Destroy(xapi_t *pApi);
 
 xpid_t XAPI_WaitWorker(xapi_t *pApi, int *pWaitStatus);
@@ -223,6 +405,13 @@ size_t XAPI_GetWorkerCount(const xapi_t *pApi);
 xpid_t XAPI_GetWorkerPID(const xapi_t *pApi);
 const xpid_t* XAPI_GetWorkerPIDs(const xapi_t *pApi);
 
+XSTATUS XAPI_InitThreads(xapi_t *pApi, size_t nThreads, xbool_t bSetAffinity);
+XSTATUS XAPI_RunThreads(xapi_t *pApi);
+XSTATUS XAPI_StopThreads(xapi_t *pApi);
+XSTATUS XAPI_PostMessage(xapi_t *pApi, int nThread, void *pMessage);
+xapi_t* XAPI_GetThreadApi(xapi_t *pApi, size_t nIndex);
+size_t XAPI_GetThreadCount(const xapi_t *pApi);
+
 XSTATUS XAPI_Disconnect(xapi_session_t *pData);
 XSTATUS XAPI_DeleteTimer(xapi_session_t *pData);
 XSTATUS XAPI_AddTimer(xapi_session_t *pData, int nTimeoutMs);
@@ -233,6 +422,11 @@ XSTATUS XAPI_EnableEvent(xapi_session_t *pData, int nEvent);
 XSTATUS XAPI_SetEvents(xapi_session_t *pData, int nEvents);
 size_t XAPI_GetEventCount(xapi_t *pApi);
 
+XSTATUS XAPI_AddRoute(xapi_t *pApi, xhttp_method_t eMethod, const char *pPattern, xapi_cb_t callback, void *pRouteCtx);
+const xrouter_match_t* XAPI_GetRoute(const xapi_session_t *pSession);
+const char* XAPI_GetParam(const xapi_session_t *pSession, const char *pName, size_t *pLength);
+void* XAPI_GetRouteCtx(const xapi_session_t *pSession);
+
 XSTATUS XAPI_RespondHTTP(xapi_session_t *pSession, int nCode, xapi_status_t eStatus);
 XSTATUS XAPI_AuthorizeHTTP(xapi_session_t *pSession, const char *pToken, const char *pKey);
 
@@ -241,6 +435,12 @@ XSTATUS XAPI_AddEndpoint(xapi_t *pApi, xapi_endpoint_t *pEndpt);
 XSTATUS XAPI_AddEvent(xapi_t *pApi, xapi_endpoint_t *pEndpt);
 XSTATUS XAPI_AddPeer(xapi_t *pApi, xapi_endpoint_t *pEndpt);
 XSTATUS XAPI_Connect(xapi_t *pApi, xapi_endpoint_t *pEndpt);
+
+XSTATUS XAPI_LinkRequest(xapi_t *pApi, xhttp_t *pRequest, xlink_t *pLink, const uint8_t *pBody, size_t nLength,
+                         int nTimeoutMs, xapi_response_cb_t callback, void *pUserCtx);
+
+XSTATUS XAPI_EasyRequest(xapi_t *pApi, xhttp_t *pRequest, const char *pLink, const uint8_t *pBody, size_t nLength,
+                         int nTimeoutMs, xapi_response_cb_t callback, void *pUserCtx);
 XSTATUS XAPI_Listen(xapi_t *pApi, xapi_endpoint_t *pEndpt);
 
 xevent_status_t XAPI_Service(xapi_t *pApi, int nTimeoutMs);
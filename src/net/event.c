@@ -12,6 +12,17 @@
 #include "event.h"
 #include "xtime.h"
 
+#if defined(_XEVENTS_USE_URING)
+#include <sys/syscall.h>
+#include <sys/mman.h>
+
+#define XEVENTS_URING_ENTRIES       1024
+#define XEVENTS_URING_CQ_MAX        65536
+#define XEVENTS_URING_DATA(seq, fd) (((uint64_t)(seq) << 32) | (uint32_t)(fd))
+#define XEVENTS_URING_SEQ(data)     ((uint32_t)((data) >> 32))
+#define XEVENTS_URING_FD(data)      ((XSOCKET)(int32_t)((data) & 0xFFFFFFFF))
+#endif
+
 #define XEVENTS_DEFAULT_FD_MAX      1024
 #define XEVENTS_RETURN_VALUE(val)   ((val != XEVENTS_CONTINUE) ? val : XEVENTS_ACTION)
 
@@ -71,7 +82,7 @@ static void XEvents_ClearCb(void *pCtx, void *pData, int nKey)
 
     if (pEvData != NULL)
     {
-#if defined(_XEVENTS_USE_EPOLL)
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
         // Close fd for timer and event types
         // All other types are managed by user
         if (pEvData->nType == XEVENT_TYPE_TIMER ||
@@ -179,7 +190,7 @@ xevent_data_t* XEvents_CreateEvent(xevents_t *pEvents, void *pCtx)
 {
     XCHECK((pEvents != NULL), NULL);
 
-#if defined(_XEVENTS_USE_EPOLL)
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
     int nEventFD = eventfd(0, EFD_NONBLOCK);
     XCHECK((nEventFD >= 0), NULL);
 
@@ -195,47 +206,112 @@ xevent_data_t* XEvents_CreateEvent(xevents_t *pEvents, void *pCtx)
 }
 
 #if defined(_XEVENTS_USE_EVENT_LIST)
-static void XEvents_ListClearCb(void *pCtx, void *pData)
+/*
+    Timers are kept in a hashed hierarchical wheel with 1 ms tick resolution.
+    Level N slot is selected by the bits (8 * N .. 8 * N + 7) of expiry time,
+    upper level slots are cascaded down when the lower level wraps around.
+    Timers are linked intrusively, so add, extend and delete are O(1).
+*/
+static void XEvents_TimerLink(xevent_data_t **ppHead, xevent_data_t *pTimer)
 {
-    xevents_t *pEvents = (xevents_t*)pCtx;
-    xevent_data_t *pEvData = (xevent_data_t*)pData;
-    XSOCKET nFD = pEvData ? pEvData->nFD : XSOCK_INVALID;
-    XEvents_ClearCb(pEvents, pEvData, (int)nFD);
+    pTimer->pTimerNext = *ppHead;
+    if (*ppHead != NULL) (*ppHead)->ppTimerPrev = &pTimer->pTimerNext;
+    pTimer->ppTimerPrev = ppHead;
+    *ppHead = pTimer;
+}
+
+static void XEvents_TimerUnlink(xevent_data_t *pTimer)
+{
+    XCHECK_VOID_NL((pTimer->ppTimerPrev != NULL));
+    *pTimer->ppTimerPrev = pTimer->pTimerNext;
+
+    if (pTimer->pTimerNext != NULL)
+        pTimer->pTimerNext->ppTimerPrev = pTimer->ppTimerPrev;
+
+    pTimer->ppTimerPrev = NULL;
+    pTimer->pTimerNext = NULL;
+}
+
+static void XEvents_WheelInsert(xevents_t *pEvents, xevent_data_t *pTimer)
+{
+    uint64_t nRange = (uint64_t)1 << (XEVENTS_WHEEL_BITS * XEVENTS_WHEEL_LEVELS);
+    uint64_t nExpire = pTimer->nTimerValue;
+    uint64_t nTick = pEvents->nTimerTick;
+    int nLevel = 0;
+
+    if (nExpire < nTick) nExpire = nTick;
+    else if (nExpire - nTick >= nRange) nExpire = nTick + nRange - 1;
+    uint64_t nDelta = nExpire - nTick;
+
+    while (nLevel < XEVENTS_WHEEL_LEVELS - 1 &&
+           nDelta >= ((uint64_t)1 << (XEVENTS_WHEEL_BITS * (nLevel + 1))))
+        nLevel++;
+
+    int nSlot = (int)((nExpire >> (XEVENTS_WHEEL_BITS * nLevel)) & XEVENTS_WHEEL_MASK);
+    XEvents_TimerLink(&pEvents->pTimerWheel[nLevel][nSlot], pTimer);
+}
+
+static void XEvents_WheelCascade(xevents_t *pEvents, int nLevel, int nSlot)
+{
+    xevent_data_t *pTimer = pEvents->pTimerWheel[nLevel][nSlot];
+    pEvents->pTimerWheel[nLevel][nSlot] = NULL;
+
+    while (pTimer != NULL)
+    {
+        xevent_data_t *pNext = pTimer->pTimerNext;
+        pTimer->ppTimerPrev = NULL;
+        pTimer->pTimerNext = NULL;
+
+        XEvents_WheelInsert(pEvents, pTimer);
+        pTimer = pNext;
+    }
 }
 
-static int XEvents_NodeSearchCb(void *pUserPtr, xlist_t *pNode)
+static void XEvents_ArmTimer(xevents_t *pEvents, xevent_data_t *pTimer, int nTimeoutMs)
 {
-    xevent_data_t *pSearchData = (xevent_data_t*)pUserPtr;
-    XCHECK_NL((pNode && pNode->data.pData), XFALSE);
-    xevent_data_t *pNodeData = (xevent_data_t*)pNode->data.pData;
-    if (!pNodeData->nTimerValue) return XTRUE; // Placed at the end if no timer value
-    return (pSearchData->nTimerValue <= pNodeData->nTimerValue) ? XTRUE : XFALSE;
+    if (pTimer->nTimerValue && pEvents->nTimerCount) pEvents->nTimerCount--;
+    XEvents_TimerUnlink(pTimer);
+
+    pTimer->nTimerValue = XTime_GetMs() + nTimeoutMs;
+    XEvents_WheelInsert(pEvents, pTimer);
+    pEvents->nTimerCount++;
 }
 
-static int XEvents_TimerSearchCb(void *pUserPtr, xlist_t *pNode)
+static void XEvents_DeleteTimer(xevents_t *pEvents, xevent_data_t *pTimer)
 {
-    xevent_data_t *pSearchData = (xevent_data_t*)pUserPtr;
-    XCHECK_NL((pNode && pNode->data.pData), XFALSE);
-    xevent_data_t *pNodeData = (xevent_data_t*)pNode->data.pData;
-    return (pNodeData->nTimerValue == pSearchData->nTimerValue &&
-            pNodeData->pContext == pSearchData->pContext) ? XTRUE : XFALSE;
+    if (pTimer->nTimerValue && pEvents->nTimerCount) pEvents->nTimerCount--;
+    XEvents_TimerUnlink(pTimer);
+    pTimer->nTimerValue = XSTDNON;
 }
 
-static xlist_t* XEvents_AddNodeSorted(xlist_t *pList, xlist_t *pNode)
+static void XEvents_ClearTimerList(xevents_t *pEvents, xevent_data_t **ppHead)
 {
-    XCHECK_NL((pList != NULL && pNode != NULL), NULL);
-    xevent_data_t *pData = (xevent_data_t*)pNode->data.pData;
-    xlist_t *pSearchNode = XList_Search(pList, pData, XEvents_NodeSearchCb);
-    if (pSearchNode != NULL) return XList_InsertPrev(pSearchNode, pNode);
-    return XList_InsertTail(pList, pNode);
+    while (*ppHead != NULL)
+    {
+        xevent_data_t *pTimer = *ppHead;
+        XEvents_TimerUnlink(pTimer);
+        XEvents_ClearCb(pEvents, pTimer, (int)pTimer->nFD);
+    }
 }
 
-static xlist_t* XEvents_AddTimerSorted(xlist_t *pList, void *pData)
+static void XEvents_ClearTimers(xevents_t *pEvents)
 {
-    XCHECK_NL((pList != NULL && pData != NULL), NULL);
-    xlist_t *pNode = XList_Search(pList, pData, XEvents_TimerSearchCb);
-    if (pNode != NULL) return XList_PushPrev(pNode, pData, XSTDNON);
-    return XList_PushBack(pList, pData, XSTDNON);
+    int nLevel, nSlot;
+
+    for (nLevel = 0; nLevel < XEVENTS_WHEEL_LEVELS; nLevel++)
+        for (nSlot = 0; nSlot < XEVENTS_WHEEL_SLOTS; nSlot++)
+            XEvents_ClearTimerList(pEvents, &pEvents->pTimerWheel[nLevel][nSlot]);
+
+    XEvents_ClearTimerList(pEvents, &pEvents->pTimerIdle);
+    pEvents->nTimerCount = 0;
+}
+
+static void XEvents_InitTimers(xevents_t *pEvents)
+{
+    memset(pEvents->pTimerWheel, 0, sizeof(pEvents->pTimerWheel));
+    pEvents->nTimerTick = XTime_GetMs();
+    pEvents->pTimerIdle = NULL;
+    pEvents->nTimerCount = 0;
 }
 
 static xevent_data_t* XEvents_AddTimerCommon(xevents_t *pEvents, void *pCtx, int nTimeoutMs)
@@ -246,64 +322,119 @@ static xevent_data_t* XEvents_AddTimerCommon(xevents_t *pEvents, void *pCtx, int
     xevent_data_t* pData = XEvents_NewData(pCtx, XSOCK_INVALID, XEVENT_TYPE_TIMER);
     XCHECK((pData != NULL), NULL);
 
-    pData->nTimerValue = XTime_GetMs() + nTimeoutMs;
-    pData->pTimerNode = XEvents_AddTimerSorted(&pEvents->timerList, pData);
-    XCHECK_CALL((pData->pTimerNode != NULL), free, pData, NULL);
-
+    XEvents_ArmTimer(pEvents, pData, nTimeoutMs);
     return pData;
 }
 
 static xevent_status_t XEvents_ExtendTimerCommon(xevents_t *pEvents, xevent_data_t *pTimer, int nTimeoutMs)
 {
+    XCHECK((pEvents != NULL), XEVENTS_EINVALID);
     XCHECK((pTimer != NULL), XEVENTS_EINVALID);
     XCHECK((nTimeoutMs > 0), XEVENTS_EINVALID);
     XCHECK((pTimer->nType == XEVENT_TYPE_TIMER), XEVENTS_EINVALID);
 
-    if (pTimer->pTimerNode == NULL)
+    XEvents_ArmTimer(pEvents, pTimer, nTimeoutMs);
+    return XEVENTS_SUCCESS;
+}
+
+static int XEvents_TimerNextCommon(xevents_t *pEvents, uint64_t nNowMs)
+{
+    XCHECK_NL((pEvents->nTimerCount > 0), XSTDNON);
+    uint64_t nTick = pEvents->nTimerTick;
+    uint64_t nNext = 0;
+    int nLevel, i;
+
+    for (nLevel = 0; nLevel < XEVENTS_WHEEL_LEVELS; nLevel++)
     {
-        pTimer->nTimerValue = XTime_GetMs() + nTimeoutMs;
-        pTimer->pTimerNode = XEvents_AddTimerSorted(&pEvents->timerList, pTimer);
-        return (pTimer->pTimerNode == NULL) ? XEVENTS_EEXTEND : XEVENTS_SUCCESS;
-    }
+        int nShift = XEVENTS_WHEEL_BITS * nLevel;
+        uint64_t nBase = nTick >> nShift;
 
-    pTimer->nTimerValue = XTime_GetMs() + nTimeoutMs;
-    XList_Detach(pTimer->pTimerNode);
+        /* Upper level slot is cascaded when the tick reaches its
+           boundary, so this is the earliest time it may expire. */
+        int nFirst = (nLevel && (nTick & (((uint64_t)1 << nShift) - 1))) ? 1 : 0;
 
-    xlist_t *pNode = XEvents_AddNodeSorted(&pEvents->timerList, pTimer->pTimerNode);
-    return (pNode != NULL) ? XEVENTS_SUCCESS : XEVENTS_EEXTEND;
+        for (i = nFirst; i < nFirst + XEVENTS_WHEEL_SLOTS; i++)
+        {
+            int nSlot = (int)((nBase + i) & XEVENTS_WHEEL_MASK);
+            if (pEvents->pTimerWheel[nLevel][nSlot] == NULL) continue;
+
+            uint64_t nExpire = (nBase + i) << nShift;
+            if (!nNext || nExpire < nNext) nNext = nExpire;
+            break;
+        }
+    }
+
+    if (!nNext) return XSTDNON;
+    if (nNext <= nNowMs) return XSTDOK;
+    if (nNext - nNowMs > INT_MAX) return INT_MAX;
+    return (int)(nNext - nNowMs);
 }
 
 static int XEvents_TimerServiceCommon(xevents_t *pEvents, uint64_t nNowMs, xbool_t *pBreak)
 {
     XCHECK_NL((pEvents != NULL), XSTDNON);
-    XCHECK_NL((pEvents->timerList.pNext != NULL), XSTDNON);
 
-    xlist_t *pNode = pEvents->timerList.pNext;
-    xevent_data_t *pTimerData = (xevent_data_t*)pNode->data.pData;
+    if (!pEvents->nTimerCount)
+    {
+        // Nothing is armed, just move the wheel forward
+        if (pEvents->nTimerTick <= nNowMs) pEvents->nTimerTick = nNowMs + 1;
+        return XSTDNON;
+    }
 
-    while (pTimerData && pTimerData->nTimerValue && pTimerData->nTimerValue <= nNowMs)
+    while (pEvents->nTimerTick <= nNowMs)
     {
-        pTimerData->nTimerValue = XSTDNON;
+        uint64_t nTick = pEvents->nTimerTick;
+        int nLevel;
 
-        int nRetVal = XEvents_EventCb(pEvents, pTimerData, pTimerData->nFD, XEVENT_CB_TIMEOUT);
-        if (nRetVal > XEVENTS_DISCONNECT && pEvents->timerList.pNext == pNode)
+        for (nLevel = 1; nLevel < XEVENTS_WHEEL_LEVELS; nLevel++)
         {
-            XList_Detach(pNode);
-            XEvents_AddNodeSorted(&pEvents->timerList, pNode);
+            int nShift = XEVENTS_WHEEL_BITS * nLevel;
+            if ((nTick >> (nShift - XEVENTS_WHEEL_BITS)) & XEVENTS_WHEEL_MASK) break;
+            XEvents_WheelCascade(pEvents, nLevel, (int)((nTick >> nShift) & XEVENTS_WHEEL_MASK));
         }
 
-        if (nRetVal == XEVENTS_BREAK)
+        /* Detach the whole slot as one batch. Callbacks may delete or
+           extend any timer from this batch, unlink keeps it consistent. */
+        int nSlot = (int)(nTick & XEVENTS_WHEEL_MASK);
+        xevent_data_t *pExpired = pEvents->pTimerWheel[0][nSlot];
+        pEvents->pTimerWheel[0][nSlot] = NULL;
+        if (pExpired != NULL) pExpired->ppTimerPrev = &pExpired;
+        pEvents->nTimerTick++;
+
+        while (pExpired != NULL)
         {
-            if (pBreak) *pBreak = XTRUE;
-            return XSTDERR;
-        }
+            xevent_data_t *pTimer = pExpired;
+            XEvents_TimerUnlink(pTimer);
 
-        pNode = pEvents->timerList.pNext;
-        pTimerData = pNode ? (xevent_data_t*)pNode->data.pData : NULL;
+            if (pTimer->nTimerValue > nTick)
+            {
+                // Clamped to the wheel range
+                XEvents_WheelInsert(pEvents, pTimer);
+                continue;
+            }
+
+            // Keep fired timer inactive until extended or deleted
+            XEvents_DeleteTimer(pEvents, pTimer);
+            XEvents_TimerLink(&pEvents->pTimerIdle, pTimer);
+
+            int nRetVal = XEvents_EventCb(pEvents, pTimer, pTimer->nFD, XEVENT_CB_TIMEOUT);
+            if (nRetVal == XEVENTS_BREAK)
+            {
+                // Unprocessed timers will fire on the next service
+                while (pExpired != NULL)
+                {
+                    pTimer = pExpired;
+                    XEvents_TimerUnlink(pTimer);
+                    XEvents_WheelInsert(pEvents, pTimer);
+                }
+
+                if (pBreak) *pBreak = XTRUE;
+                return XSTDERR;
+            }
+        }
     }
 
-    return pTimerData != NULL && pTimerData->nTimerValue ?
-        (int)(pTimerData->nTimerValue - nNowMs) : XSTDNON;
+    return XEvents_TimerNextCommon(pEvents, nNowMs);
 }
 #else
 static xevent_data_t* XEvents_AddTimerLinux(xevents_t *pEvents, void *pContext, int nTimeoutMs)
@@ -434,27 +565,427 @@ static int XEvents_ServiceCb(xevents_t *pEvents, xevent_data_t *pData, XSOCKET n
     return XEVENTS_CONTINUE;
 }
 
+#if defined(_XEVENTS_USE_URING)
+/*
+    io_uring backend keeps the readiness contract of epoll/poll backends.
+    Every registered fd has a multishot poll request identified by fd and
+    registration sequence, so completions of removed or re-registered fds
+    are silently dropped. Add, modify and delete only queue entries, they
+    are submitted in one batch with the wait call inside XEvents_Service.
+*/
+static int XEvents_UringEnter(xevent_ring_t *pRing, uint32_t nSubmit, uint32_t nWait, uint32_t nFlags, void *pArg, size_t nSize)
+{
+    return (int)syscall(__NR_io_uring_enter, pRing->nRingFd, nSubmit, nWait, nFlags, pArg, nSize);
+}
+
+static int XEvents_UringSubmit(xevent_ring_t *pRing)
+{
+    XCHECK_NL((pRing->nPending > 0), XSTDNON);
+    int nRet = XEvents_UringEnter(pRing, pRing->nPending, 0, 0, NULL, 0);
+    XCHECK((nRet >= 0), XSTDERR);
+
+    pRing->nPending = (uint32_t)nRet < pRing->nPending ? pRing->nPending - (uint32_t)nRet : 0;
+    return nRet;
+}
+
+static struct io_uring_sqe* XEvents_UringGetSqe(xevent_ring_t *pRing)
+{
+    uint32_t nTail = *pRing->pSqTail;
+    uint32_t nHead = __atomic_load_n(pRing->pSqHead, __ATOMIC_ACQUIRE);
+
+    if (nTail - nHead >= pRing->nSqEntries)
+    {
+        // Submission ring is full, flush it now
+        XCHECK((XEvents_UringSubmit(pRing) >= 0), NULL);
+        nHead = __atomic_load_n(pRing->pSqHead, __ATOMIC_ACQUIRE);
+        XCHECK((nTail - nHead < pRing->nSqEntries), NULL);
+    }
+
+    uint32_t nIndex = nTail & pRing->nSqMask;
+    struct io_uring_sqe *pSqe = &pRing->pSqes[nIndex];
+    memset(pSqe, 0, sizeof(struct io_uring_sqe));
+
+    pRing->pSqArray[nIndex] = nIndex;
+    __atomic_store_n(pRing->pSqTail, nTail + 1, __ATOMIC_RELEASE);
+    pRing->nPending++;
+
+    return pSqe;
+}
+
+static xevent_status_t XEvents_UringPollAdd(xevents_t *pEvents, xevent_data_t *pData, uint32_t nEvents)
+{
+    xevent_ring_t *pRing = &pEvents->ring;
+    struct io_uring_sqe *pSqe = XEvents_UringGetSqe(pRing);
+    XCHECK((pSqe != NULL), XEVENTS_ECTL);
+
+    if (!++pRing->nPollSeq) pRing->nPollSeq = XSTDOK;
+    pData->nPollSeq = pRing->nPollSeq;
+    pData->nPollMask = nEvents;
+
+    pSqe->opcode = IORING_OP_POLL_ADD;
+    pSqe->fd = (int)pData->nFD;
+    pSqe->poll32_events = nEvents;
+    pSqe->user_data = XEVENTS_URING_DATA(pData->nPollSeq, pData->nFD);
+    if (!pRing->bOneShot) pSqe->len = IORING_POLL_ADD_MULTI | IORING_POLL_ADD_LEVEL;
+
+    return XEVENTS_SUCCESS;
+}
+
+static xevent_status_t XEvents_UringPollRemove(xevents_t *pEvents, xevent_data_t *pData)
+{
+    XCHECK_NL((pData->nPollSeq != 0), XEVENTS_SUCCESS);
+    xevent_ring_t *pRing = &pEvents->ring;
+
+    struct io_uring_sqe *pSqe = XEvents_UringGetSqe(pRing);
+    XCHECK((pSqe != NULL), XEVENTS_ECTL);
+
+    pSqe->opcode = IORING_OP_POLL_REMOVE;
+    pSqe->fd = -1;
+    pSqe->addr = XEVENTS_URING_DATA(pData->nPollSeq, pData->nFD);
+    pSqe->user_data = XSTDNON;
+
+    pData->nPollSeq = XSTDNON;
+    return XEVENTS_SUCCESS;
+}
+
+static void XEvents_UringClose(xevent_ring_t *pRing)
+{
+    if (pRing->pSqes != NULL && pRing->pSqes != MAP_FAILED)
+        munmap(pRing->pSqes, pRing->nSqeMapSize);
+
+    if (pRing->pCqMap != NULL && pRing->pCqMap != MAP_FAILED &&
+        pRing->pCqMap != pRing->pSqMap) munmap(pRing->pCqMap, pRing->nCqMapSize);
+
+    if (pRing->pSqMap != NULL && pRing->pSqMap != MAP_FAILED)
+        munmap(pRing->pSqMap, pRing->nSqMapSize);
+
+    if (pRing->nRingFd >= 0) close(pRing->nRingFd);
+    memset(pRing, 0, sizeof(xevent_ring_t));
+    pRing->nRingFd = XSOCK_INVALID;
+}
+
+static xevent_status_t XEvents_UringCreate(xevent_ring_t *pRing, uint32_t nMax)
+{
+    memset(pRing, 0, sizeof(xevent_ring_t));
+    pRing->nRingFd = XSOCK_INVALID;
+
+    /* Multishot polls may complete at once for every registered
+       fd, so size the completion ring by the max number of fds. */
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = XEVENTS_URING_ENTRIES * 2;
+    if (nMax > params.cq_entries) params.cq_entries = nMax;
+    if (params.cq_entries > XEVENTS_URING_CQ_MAX) params.cq_entries = XEVENTS_URING_CQ_MAX;
+
+    pRing->nRingFd = (int)syscall(__NR_io_uring_setup, XEVENTS_URING_ENTRIES, &params);
+    XCHECK((pRing->nRingFd >= 0), XEVENTS_ECREATE);
+
+    // Timed wait without extra timeout requests needs IORING_FEAT_EXT_ARG (5.11+)
+    XCHECK_CALL((params.features & IORING_FEAT_EXT_ARG), XEvents_UringClose, pRing, XEVENTS_ECREATE);
+
+    pRing->nSqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    pRing->nCqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    pRing->nSqeMapSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (pRing->nCqMapSize > pRing->nSqMapSize) pRing->nSqMapSize = pRing->nCqMapSize;
+        pRing->nCqMapSize = pRing->nSqMapSize;
+    }
+
+    pRing->pSqMap = mmap(NULL, pRing->nSqMapSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, pRing->nRingFd, IORING_OFF_SQ_RING);
+    XCHECK_CALL((pRing->pSqMap != MAP_FAILED), XEvents_UringClose, pRing, XEVENTS_ECREATE);
+
+    pRing->pCqMap = (params.features & IORING_FEAT_SINGLE_MMAP) ? pRing->pSqMap :
+        mmap(NULL, pRing->nCqMapSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, pRing->nRingFd, IORING_OFF_CQ_RING);
+    XCHECK_CALL((pRing->pCqMap != MAP_FAILED), XEvents_UringClose, pRing, XEVENTS_ECREATE);
+
+    pRing->pSqes = (struct io_uring_sqe*)mmap(NULL, pRing->nSqeMapSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, pRing->nRingFd, IORING_OFF_SQES);
+    XCHECK_CALL((pRing->pSqes != MAP_FAILED), XEvents_UringClose, pRing, XEVENTS_ECREATE);
+
+    uint8_t *pSqMap = (uint8_t*)pRing->pSqMap;
+    uint8_t *pCqMap = (uint8_t*)pRing->pCqMap;
+
+    pRing->pSqHead = (uint32_t*)(pSqMap + params.sq_off.head);
+    pRing->pSqTail = (uint32_t*)(pSqMap + params.sq_off.tail);
+    pRing->pSqArray = (uint32_t*)(pSqMap + params.sq_off.array);
+    pRing->nSqMask = *(uint32_t*)(pSqMap + params.sq_off.ring_mask);
+    pRing->nSqEntries = *(uint32_t*)(pSqMap + params.sq_off.ring_entries);
+
+    pRing->pCqHead = (uint32_t*)(pCqMap + params.cq_off.head);
+    pRing->pCqTail = (uint32_t*)(pCqMap + params.cq_off.tail);
+    pRing->pCqes = (struct io_uring_cqe*)(pCqMap + params.cq_off.cqes);
+    pRing->nCqMask = *(uint32_t*)(pCqMap + params.cq_off.ring_mask);
+
+    return XEVENTS_SUCCESS;
+}
+
+static int XEvents_UringWait(xevents_t *pEvents, int nTimeoutMs)
+{
+    xevent_ring_t *pRing = &pEvents->ring;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+
+    memset(&arg, 0, sizeof(arg));
+    uint32_t nFlags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    uint32_t nWait = nTimeoutMs ? 1 : 0;
+
+    if (nTimeoutMs > 0)
+    {
+        ts.tv_sec = nTimeoutMs / 1000;
+        ts.tv_nsec = (nTimeoutMs % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+    int nRet = XEvents_UringEnter(pRing, pRing->nPending, nWait, nFlags, &arg, sizeof(arg));
+    if (nRet >= 0) pRing->nPending = (uint32_t)nRet < pRing->nPending ? pRing->nPending - (uint32_t)nRet : 0;
+    else if (errno == ETIME) nRet = XSTDNON;
+    else if (errno == EINTR) return XSTDERR;
+
+    uint32_t nHead = *pRing->pCqHead;
+    uint32_t nTail = __atomic_load_n(pRing->pCqTail, __ATOMIC_ACQUIRE);
+    if (nTail != nHead) return (int)(nTail - nHead);
+
+    return nRet < 0 ? XSTDERR : XSTDNON;
+}
+
+static int XEvents_UringService(xevents_t *pEvents)
+{
+    xevent_ring_t *pRing = &pEvents->ring;
+    int nRet = XEVENTS_CONTINUE;
+
+    uint32_t nHead = *pRing->pCqHead;
+    uint32_t nTail = __atomic_load_n(pRing->pCqTail, __ATOMIC_ACQUIRE);
+
+    while (nHead != nTail)
+    {
+        struct io_uring_cqe cqe = pRing->pCqes[nHead & pRing->nCqMask];
+        __atomic_store_n(pRing->pCqHead, ++nHead, __ATOMIC_RELEASE);
+
+        uint32_t nSeq = XEVENTS_URING_SEQ(cqe.user_data);
+        XSOCKET nFD = XEVENTS_URING_FD(cqe.user_data);
+        if (!nSeq) continue;
+
+        // Completion of already removed or re-registered poll
+        xevent_data_t *pData = XEvents_GetData(pEvents, nFD);
+        if (pData == NULL || pData->nPollSeq != nSeq) continue;
+
+        if (cqe.res == -EINVAL && !pRing->bOneShot)
+        {
+            // Old kernel without level triggered multishot poll
+            pRing->bOneShot = XTRUE;
+            pData->nPollSeq = XSTDNON;
+            XEvents_UringPollAdd(pEvents, pData, pData->nPollMask);
+            continue;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE))
+        {
+            // Poll is finished, arm it again before the callback
+            pData->nPollSeq = XSTDNON;
+            if (cqe.res != -ECANCELED) XEvents_UringPollAdd(pEvents, pData, pData->nPollMask);
+        }
+
+        if (cqe.res == -ECANCELED) continue;
+        uint32_t nEvents = cqe.res < 0 ? (uint32_t)XPOLLERR : (uint32_t)cqe.res;
+        nRet = XEvents_ServiceCb(pEvents, pData, nFD, nEvents);
+        if (nRet != XEVENTS_CONTINUE) break;
+    }
+
+    return nRet;
+}
+#endif
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+static xevent_status_t XEvents_TableInsert(xevent_table_t *pTable, xevent_data_t *pData)
+{
+    XCHECK((pData->nFD >= 0), XEVENTS_EINVALID);
+    uint32_t nIndex = (uint32_t)pData->nFD;
+
+    if (nIndex >= pTable->nSize)
+    {
+        uint32_t nSize = pTable->nSize ? pTable->nSize : XEVENTS_DEFAULT_FD_MAX;
+        while (nSize <= nIndex) nSize *= 2;
+
+        xevent_data_t **ppData = (xevent_data_t**)realloc(pTable->ppData, nSize * sizeof(xevent_data_t*));
+        XCHECK((ppData != NULL), XEVENTS_EALLOC);
+
+        memset(&ppData[pTable->nSize], 0, (nSize - pTable->nSize) * sizeof(xevent_data_t*));
+        pTable->ppData = ppData;
+        pTable->nSize = nSize;
+    }
+
+    if (pTable->ppData[nIndex] != NULL)
+        return (pTable->ppData[nIndex] == pData) ? XEVENTS_SUCCESS : XEVENTS_EINSERT;
+
+    pTable->ppData[nIndex] = pData;
+    pTable->nCount++;
+
+    return XEVENTS_SUCCESS;
+}
+
+static void XEvents_TableRemove(xevent_table_t *pTable, xevent_data_t *pData)
+{
+    XCHECK_VOID_NL((pData->nFD >= 0 && (uint32_t)pData->nFD < pTable->nSize));
+    XCHECK_VOID_NL((pTable->ppData[pData->nFD] == pData));
+
+    pTable->ppData[pData->nFD] = NULL;
+    if (pTable->nCount) pTable->nCount--;
+}
+
+static void XEvents_TableDestroy(xevents_t *pEvents, xevent_table_t *pTable, xbool_t bClear)
+{
+    uint32_t i;
+
+    for (i = 0; bClear && pTable->nCount && i < pTable->nSize; i++)
+    {
+        xevent_data_t *pData = pTable->ppData[i];
+        if (pData == NULL) continue;
+
+        pTable->ppData[i] = NULL;
+        pTable->nCount--;
+
+        XEvents_ClearCb(pEvents, pData, (int)i);
+    }
+
+    free(pTable->ppData);
+    pTable->ppData = NULL;
+    pTable->nCount = 0;
+    pTable->nSize = 0;
+}
+#else
+typedef struct XEventsIterator {
+    xevent_itfunc_t itfunc;
+    void *pUserCtx;
+} xevents_iterator_t;
+
+static int XEvents_HashIteratorCb(xhash_pair_t *pPair, void *pCtx)
+{
+    xevents_iterator_t *pIter = (xevents_iterator_t*)pCtx;
+    return pIter->itfunc((xevent_data_t*)pPair->pData, pIter->pUserCtx);
+}
+#endif
+
+static void XEvents_InitEventMap(xevents_t *pEvents)
+{
+    XCHECK_VOID_NL(pEvents->bUseHash);
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+    pEvents->eventsTable.ppData = NULL;
+    pEvents->eventsTable.nCount = 0;
+    pEvents->eventsTable.nSize = 0;
+#else
+    XHash_Init(&pEvents->eventsMap, XEvents_ClearCb, pEvents);
+#endif
+}
+
+static xevent_status_t XEvents_InsertEventMap(xevents_t *pEvents, xevent_data_t *pData)
+{
+    XCHECK_NL(pEvents->bUseHash, XEVENTS_SUCCESS);
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+    return XEvents_TableInsert(&pEvents->eventsTable, pData);
+#else
+    int nStatus = XHash_Insert(&pEvents->eventsMap, pData, XSTDNON, (int)pData->nFD);
+    return (nStatus < 0) ? XEVENTS_EINSERT : XEVENTS_SUCCESS;
+#endif
+}
+
+static void XEvents_DeleteEventMap(xevents_t *pEvents, xevent_data_t *pData)
+{
+#if defined(_XEVENTS_USE_FD_TABLE)
+    if (pEvents->bUseHash) XEvents_TableRemove(&pEvents->eventsTable, pData);
+    XEvents_ClearCb(pEvents, pData, (int)pData->nFD);
+#else
+    if (!pEvents->bUseHash || pData->nFD == XSOCK_INVALID ||
+        XHash_Delete(&pEvents->eventsMap, (int)pData->nFD) < 0)
+        XEvents_ClearCb(pEvents, pData, (int)pData->nFD);
+#endif
+}
+
 static void XEvents_DestroyEventMap(xevents_t *pEvents)
 {
     XCHECK_VOID_NL(pEvents);
     if (pEvents->bUseHash)
     {
+#if defined(_XEVENTS_USE_FD_TABLE)
+        XEvents_TableDestroy(pEvents, &pEvents->eventsTable, XTRUE);
+#else
         pEvents->eventsMap.clearCb = XEvents_ClearCb;
         pEvents->eventsMap.pUserContext = pEvents;
         XHash_Destroy(&pEvents->eventsMap);
+#endif
         pEvents->bUseHash = XFALSE;
     }
 }
 
+void XEvents_DetachData(xevents_t *pEvents)
+{
+    XCHECK_VOID_NL(pEvents);
+    XCHECK_VOID_NL(pEvents->bUseHash);
+
+    // Forget registered event data without clearing it
+#if defined(_XEVENTS_USE_FD_TABLE)
+    XEvents_TableDestroy(pEvents, &pEvents->eventsTable, XFALSE);
+#else
+    pEvents->eventsMap.clearCb = NULL;
+    pEvents->eventsMap.pUserContext = NULL;
+    XHash_Destroy(&pEvents->eventsMap);
+#endif
+
+    pEvents->bUseHash = XFALSE;
+}
+
+size_t XEvents_GetDataCount(xevents_t *pEvents)
+{
+    XCHECK_NL((pEvents != NULL && pEvents->bUseHash), XSTDNON);
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+    return pEvents->eventsTable.nCount;
+#else
+    return pEvents->eventsMap.nPairCount;
+#endif
+}
+
+void XEvents_IterateData(xevents_t *pEvents, xevent_itfunc_t itfunc, void *pCtx)
+{
+    XCHECK_VOID_NL((pEvents != NULL && itfunc != NULL));
+    XCHECK_VOID_NL(pEvents->bUseHash);
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+    xevent_table_t *pTable = &pEvents->eventsTable;
+    uint32_t i;
+
+    for (i = 0; i < pTable->nSize; i++)
+    {
+        if (pTable->ppData[i] == NULL) continue;
+        if (itfunc(pTable->ppData[i], pCtx)) break;
+    }
+#else
+    xevents_iterator_t iter;
+    iter.pUserCtx = pCtx;
+    iter.itfunc = itfunc;
+    XHash_Iterate(&pEvents->eventsMap, XEvents_HashIteratorCb, &iter);
+#endif
+}
+
 void XEvents_Destroy(xevents_t *pEvents)
 {
     XCHECK_VOID_NL(pEvents);
 
+#if defined(_XEVENTS_USE_URING)
+    XEvents_UringClose(&pEvents->ring);
+#else
     if (pEvents->pEventArray)
     {
         free(pEvents->pEventArray);
         pEvents->pEventArray = NULL;
     }
+#endif
 
 #if defined(_XEVENTS_USE_EPOLL)
     if (pEvents->nEventFd >= 0)
@@ -465,7 +996,7 @@ void XEvents_Destroy(xevents_t *pEvents)
 #endif
 
 #if defined(_XEVENTS_USE_EVENT_LIST)
-    XList_Clear(&pEvents->timerList);
+    XEvents_ClearTimers(pEvents);
 #endif
 
     XEvents_DestroyEventMap(pEvents);
@@ -496,15 +1027,14 @@ xevent_status_t XEvents_Create(xevents_t *pEvents, uint32_t nMax, void *pUser, x
     pEvents->pUserSpace = pUser;
     pEvents->bUseHash = bUseHash;
     pEvents->nEventCount = 0;
-    pEvents->pEventArray = NULL;
     pEvents->bCheckDup = XTRUE;
     pEvents->bResync = XFALSE;
 
 #if defined(_XEVENTS_USE_EVENT_LIST)
-    XList_Init(&pEvents->timerList, NULL, XSTDNON, XEvents_ListClearCb, pEvents);
+    XEvents_InitTimers(pEvents);
 #endif
 
-    if (pEvents->bUseHash) XHash_Init(&pEvents->eventsMap, XEvents_ClearCb, pEvents);
+    XEvents_InitEventMap(pEvents);
 
 #if defined(_XEVENTS_USE_EPOLL)
     struct epoll_event *pEventArray = calloc(pEvents->nEventMax, sizeof(struct epoll_event));
@@ -518,6 +1048,9 @@ xevent_status_t XEvents_Create(xevents_t *pEvents, uint32_t nMax, void *pUser, x
 
     pEvents->pEventArray = pEventArray;
     pEvents->nWaitCount = 0;
+#elif defined(_XEVENTS_USE_URING)
+    xevent_status_t eStatus = XEvents_UringCreate(&pEvents->ring, pEvents->nEventMax);
+    XCHECK_CALL((eStatus == XEVENTS_SUCCESS), XEvents_DestroyEventMap, pEvents, eStatus);
 #else
     pEvents->pEventArray = calloc(pEvents->nEventMax, sizeof(struct pollfd));
     XCHECK_CALL((pEvents->pEventArray != NULL), XEvents_DestroyEventMap, pEvents, XEVENTS_EALLOC);
@@ -541,7 +1074,13 @@ xevent_data_t *XEvents_NewData(void *pCtx, XSOCKET nFd, int nType)
 
 #if defined(_XEVENTS_USE_EVENT_LIST)
     pData->nTimerValue = XSTDNON;
-    pData->pTimerNode = NULL;
+    pData->ppTimerPrev = NULL;
+    pData->pTimerNext = NULL;
+#endif
+
+#if defined(_XEVENTS_USE_URING)
+    pData->nPollMask = 0;
+    pData->nPollSeq = 0;
 #endif
 
     pData->pContext = pCtx;
@@ -569,9 +1108,16 @@ xevent_status_t XEvents_Add(xevents_t *pEvents, xevent_data_t* pData, int nEvent
 #endif
 
     if (epoll_ctl(pEvents->nEventFd, EPOLL_CTL_ADD, pData->nFD, &event) < 0) return XEVENTS_ECTL;
+#elif defined(_XEVENTS_USE_URING)
+    if (pEvents->bCheckDup == XTRUE &&
+        XEvents_GetData(pEvents, pData->nFD) != NULL)
+        return XEVENTS_EINSERT;
+
+    if (pEvents->nEventCount >= pEvents->nEventMax) return XEVENTS_ECTL;
+    if (XEvents_UringPollAdd(pEvents, pData, (uint32_t)nEvents) != XEVENTS_SUCCESS) return XEVENTS_ECTL;
 #else
-    if (pEvents->bUseHash == XTRUE && pEvents->bCheckDup == XTRUE &&
-        XHash_GetData(&pEvents->eventsMap, (int)pData->nFD) != NULL)
+    if (pEvents->bCheckDup == XTRUE &&
+        XEvents_GetData(pEvents, pData->nFD) != NULL)
         return XEVENTS_EINSERT;
 
     if (pEvents->nEventCount >= pEvents->nEventMax) return XEVENTS_ECTL;
@@ -581,10 +1127,12 @@ xevent_status_t XEvents_Add(xevents_t *pEvents, xevent_data_t* pData, int nEvent
     pEvents->pEventArray[pData->nIndex].fd = pData->nFD;
 #endif
 
-    if (pEvents->bUseHash && XHash_Insert(&pEvents->eventsMap, pData, XSTDNON, (int)pData->nFD) < 0)
+    if (XEvents_InsertEventMap(pEvents, pData) != XEVENTS_SUCCESS)
     {
 #if defined(_XEVENTS_USE_EPOLL)
         epoll_ctl(pEvents->nEventFd, EPOLL_CTL_DEL, pData->nFD, NULL);
+#elif defined(_XEVENTS_USE_URING)
+        XEvents_UringPollRemove(pEvents, pData);
 #else
         pEvents->pEventArray[pData->nIndex].revents = 0;
         pEvents->pEventArray[pData->nIndex].events = 0;
@@ -618,6 +1166,15 @@ xevent_status_t XEvents_Modify(xevents_t *pEvents, xevent_data_t *pData, int nEv
 
     XCHECK((pData->nFD != XSOCK_INVALID), XEVENTS_ECTL);
     if (epoll_ctl(pEvents->nEventFd, EPOLL_CTL_MOD, pData->nFD, &event) < 0) return XEVENTS_ECTL;
+#elif defined(_XEVENTS_USE_URING)
+    XCHECK((pData->nFD != XSOCK_INVALID), XEVENTS_ECTL);
+
+    // Re-register poll only when the mask actually changes
+    if (!pData->nPollSeq || pData->nPollMask != (uint32_t)nEvents)
+    {
+        XCHECK((XEvents_UringPollRemove(pEvents, pData) == XEVENTS_SUCCESS), XEVENTS_ECTL);
+        XCHECK((XEvents_UringPollAdd(pEvents, pData, (uint32_t)nEvents) == XEVENTS_SUCCESS), XEVENTS_ECTL);
+    }
 #else
     XCHECK((pData->nIndex >= 0), XEVENTS_ECTL);
     XCHECK(((uint32_t)pData->nIndex < pEvents->nEventCount), XEVENTS_ECTL);
@@ -637,7 +1194,8 @@ xevent_status_t XEvents_Delete(xevents_t *pEvents, xevent_data_t *pData)
 #if defined(_XEVENTS_USE_EVENT_LIST)
     if (pData->nType == XEVENT_TYPE_TIMER)
     {
-        XList_Unlink(pData->pTimerNode);
+        XEvents_DeleteTimer(pEvents, pData);
+        XEvents_ClearCb(pEvents, pData, (int)pData->nFD);
         pEvents->bResync = XTRUE;
         return XEVENTS_SUCCESS;
     }
@@ -677,6 +1235,12 @@ xevent_status_t XEvents_Delete(xevents_t *pEvents, xevent_data_t *pData)
         nStatus = epoll_ctl(pEvents->nEventFd, EPOLL_CTL_DEL, pData->nFD, NULL);
         if (nStatus >= 0 && pEvents->nEventCount) pEvents->nEventCount--;
     }
+#elif defined(_XEVENTS_USE_URING)
+    if (pData->nFD >= 0 && XEvents_GetData(pEvents, pData->nFD) == pData)
+    {
+        nStatus = XEvents_UringPollRemove(pEvents, pData) == XEVENTS_SUCCESS ? XSTDOK : XSTDERR;
+        if (nStatus >= 0 && pEvents->nEventCount) pEvents->nEventCount--;
+    }
 #else
     if (pData->nIndex >= 0 && (uint32_t)pData->nIndex < pEvents->nEventCount)
     {
@@ -693,8 +1257,7 @@ xevent_status_t XEvents_Delete(xevents_t *pEvents, xevent_data_t *pData)
 
             if (pEvents->bUseHash && pEvents->pEventArray[i].fd != XSOCK_INVALID)
             {
-                xevent_data_t *pMovedData = (xevent_data_t*)XHash_GetData(
-                    &pEvents->eventsMap, (int)pEvents->pEventArray[i].fd);
+                xevent_data_t *pMovedData = XEvents_GetData(pEvents, pEvents->pEventArray[i].fd);
                 if (pMovedData != NULL) pMovedData->nIndex = i;
             }
         }
@@ -709,10 +1272,7 @@ xevent_status_t XEvents_Delete(xevents_t *pEvents, xevent_data_t *pData)
     }
 #endif
 
-    if (!pEvents->bUseHash || pData->nFD == XSOCK_INVALID ||
-        XHash_Delete(&pEvents->eventsMap, (int)pData->nFD) < 0)
-        XEvents_ClearCb(pEvents, pData, (int)pData->nFD);
-
+    XEvents_DeleteEventMap(pEvents, pData);
     return (nStatus < 0) ? XEVENTS_ECTL : XEVENTS_SUCCESS;
 }
 
@@ -720,24 +1280,32 @@ xevent_data_t* XEvents_GetData(xevents_t *pEvents, XSOCKET nFD)
 {
     XCHECK((pEvents != NULL), NULL);
     XCHECK_NL((pEvents->bUseHash && nFD != XSOCK_INVALID), NULL);
+
+#if defined(_XEVENTS_USE_FD_TABLE)
+    const xevent_table_t *pTable = &pEvents->eventsTable;
+    return ((uint32_t)nFD < pTable->nSize) ? pTable->ppData[nFD] : NULL;
+#else
     return (xevent_data_t*)XHash_GetData(&pEvents->eventsMap, (int)nFD);
+#endif
 }
 
 xevent_status_t XEvents_Service(xevents_t *pEvents, int nTimeoutMs)
 {
     XCHECK(pEvents, XEVENTS_EINVALID);
-    int i = 0, nCount = 0, nRet = 0;
+    int nCount = 0, nRet = 0;
     int nTimeout = nTimeoutMs;
 
 #if defined(_XEVENTS_USE_EVENT_LIST)
     xbool_t bBreak = XFALSE;
     nTimeout = XEvents_TimerServiceCommon(pEvents, XTime_GetMs(), &bBreak);
-    if (nTimeout <= 0 || nTimeout > nTimeoutMs) nTimeout = nTimeoutMs;
+    if (nTimeout <= 0 || (nTimeoutMs >= 0 && nTimeout > nTimeoutMs)) nTimeout = nTimeoutMs;
     if (bBreak) return XEVENTS_BREAK;
 #endif
 
 #if defined(_XEVENTS_USE_EPOLL)
     nCount = epoll_wait(pEvents->nEventFd, pEvents->pEventArray, pEvents->nEventMax, nTimeout);
+#elif defined(_XEVENTS_USE_URING)
+    nCount = XEvents_UringWait(pEvents, nTimeout);
 #elif defined(_XEVENTS_USE_WSAPOLL)
     /* WSAPoll() rejects an empty descriptor set with WSAEINVAL instead of
        sleeping like poll(); emulate the poll() timeout behavior to avoid
@@ -769,12 +1337,16 @@ xevent_status_t XEvents_Service(xevents_t *pEvents, int nTimeoutMs)
     if (!nCount) return XEVENTS_SUCCESS;
 
     XCHECK((nCount > 0), XEVENTS_EWAIT);
+
+#if defined(_XEVENTS_USE_URING)
+    nRet = XEvents_UringService(pEvents);
+#elif defined(_XEVENTS_USE_EPOLL)
     XCHECK(((uint32_t)nCount <= pEvents->nEventMax), XEVENTS_EWAIT);
 
-#if defined(_XEVENTS_USE_EPOLL)
     /* Publish the batch size so XEvents_Delete can invalidate stale ptr entries
      * if a user callback recursively deletes a sibling pData (see Delete). */
     pEvents->nWaitCount = (uint32_t)nCount;
+    int i = 0;
 
     for (i = 0; i < nCount; i++)
     {
@@ -789,6 +1361,9 @@ xevent_status_t XEvents_Service(xevents_t *pEvents, int nTimeoutMs)
 
     pEvents->nWaitCount = 0;
 #else
+    XCHECK(((uint32_t)nCount <= pEvents->nEventMax), XEVENTS_EWAIT);
+    int i = 0;
+
     for (i = 0; i < (int)pEvents->nEventCount; i++)
     {
         if (pEvents->pEventArray[i].revents <= 0) continue;
@@ -20,14 +20,18 @@ extern "C" {
 #endif
 
 #ifdef __linux__
-# ifndef _XEVENTS_USE_EPOLL
+# ifdef _XEVENTS_USE_URING
+# undef _XEVENTS_USE_EPOLL
+# elif !defined(_XEVENTS_USE_EPOLL)
 # define _XEVENTS_USE_EPOLL 1
 # endif
 #elif _WIN32
+# undef _XEVENTS_USE_URING
 # ifndef _XEVENTS_USE_WSAPOLL
 # define _XEVENTS_USE_WSAPOLL 1
 # endif
 #else
+# undef _XEVENTS_USE_URING
 # ifndef _XEVENTS_USE_POLL
 # define _XEVENTS_USE_POLL 1
 # endif
@@ -39,6 +43,12 @@ extern "C" {
 # endif
 #endif
 
+#ifndef _WIN32
+# ifndef _XEVENTS_USE_FD_TABLE
+# define _XEVENTS_USE_FD_TABLE 1
+# endif
+#endif
+
 #include "xstd.h"
 #include "sock.h"
 #include "hash.h"
@@ -47,6 +57,11 @@ extern "C" {
 #include <sys/timerfd.h>
 #include <sys/eventfd.h>
 #include <sys/epoll.h>
+#elif defined(_XEVENTS_USE_URING)
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <linux/io_uring.h>
+#include <poll.h>
 #elif defined(_XEVENTS_USE_POLL)
 #include <sys/poll.h>
 #endif
@@ -79,12 +94,20 @@ extern "C" {
 #define XEVENTS_USERCALL        3
 #define XEVENTS_BREAK           4
 
-#ifdef _XEVENTS_USE_EPOLL
+#if defined(_XEVENTS_USE_EPOLL) || defined(_XEVENTS_USE_URING)
 #define XEVENTS_ACTION          XEVENTS_CONTINUE
 #else
 #define XEVENTS_ACTION          XEVENTS_RELOOP
 #endif
 
+#ifdef _XEVENTS_USE_EVENT_LIST
+// Hierarchical timer wheel geometry (1 ms tick, 4 x 256 slots, ~49 days range)
+#define XEVENTS_WHEEL_BITS      8
+#define XEVENTS_WHEEL_LEVELS    4
+#define XEVENTS_WHEEL_SLOTS     (1 << XEVENTS_WHEEL_BITS)
+#define XEVENTS_WHEEL_MASK      (XEVENTS_WHEEL_SLOTS - 1)
+#endif
+
 // Event status codes
 typedef enum {
     XEVENTS_NONE = (int)0,
@@ -135,29 +158,72 @@ typedef enum {
 typedef struct XEventData {
 #ifdef _XEVENTS_USE_EVENT_LIST
     uint64_t nTimerValue;
-    xlist_t *pTimerNode;
+    struct XEventData *pTimerNext;
+    struct XEventData **ppTimerPrev;
 #endif
     void *pContext;
     uint32_t nEvents;
     xbool_t bIsOpen;
     XSOCKET nFD;
+#ifdef _XEVENTS_USE_URING
+    uint32_t nPollMask;
+    uint32_t nPollSeq;
+#endif
     int nIndex;
     int nType;
 } xevent_data_t;
 
+#ifdef _XEVENTS_USE_URING
+typedef struct XEventRing {
+    struct io_uring_sqe*    pSqes;              /* Submission queue entries */
+    struct io_uring_cqe*    pCqes;              /* Completion queue entries */
+    uint32_t*               pSqHead;            /* Submission ring head (kernel) */
+    uint32_t*               pSqTail;            /* Submission ring tail (user) */
+    uint32_t*               pSqArray;           /* Submission index array */
+    uint32_t*               pCqHead;            /* Completion ring head (user) */
+    uint32_t*               pCqTail;            /* Completion ring tail (kernel) */
+    uint32_t                nSqMask;            /* Submission ring mask */
+    uint32_t                nCqMask;            /* Completion ring mask */
+    uint32_t                nSqEntries;         /* Submission ring size */
+    uint32_t                nPending;           /* Queued entries waiting for submission */
+    uint32_t                nPollSeq;           /* Last used poll registration sequence */
+    xbool_t                 bOneShot;           /* Multishot poll is not supported by kernel */
+    void*                   pSqMap;             /* Mapped submission ring */
+    void*                   pCqMap;             /* Mapped completion ring */
+    size_t                  nSqMapSize;         /* Size of mapped submission ring */
+    size_t                  nCqMapSize;         /* Size of mapped completion ring */
+    size_t                  nSqeMapSize;        /* Size of mapped submission entries */
+    int                     nRingFd;            /* io_uring file descriptor */
+} xevent_ring_t;
+#endif
+
 typedef int(*xevent_cb_t)(void *events, void* data, XSOCKET fd, xevent_cb_type_t reason);
+typedef int(*xevent_itfunc_t)(xevent_data_t *pData, void *pCtx);
+
+#ifdef _XEVENTS_USE_FD_TABLE
+typedef struct XEventTable {
+    xevent_data_t**         ppData;             /* Event data directly indexed by fd */
+    uint32_t                nSize;              /* Number of allocated slots */
+    uint32_t                nCount;             /* Number of used slots */
+} xevent_table_t;
+#endif
 
 typedef struct XEvents {
 #ifdef _XEVENTS_USE_EPOLL
     struct epoll_event*     pEventArray;        /* EPOLL event array */
     int                     nEventFd;           /* EPOLL file decriptor */
     uint32_t                nWaitCount;         /* Active epoll_wait batch size; non-zero only while servicing */
+#elif defined(_XEVENTS_USE_URING)
+    xevent_ring_t           ring;               /* io_uring submission and completion rings */
 #else
     struct pollfd*          pEventArray;        /* POLL event array */
 #endif
 
 #ifdef _XEVENTS_USE_EVENT_LIST
-    xlist_t                 timerList;          /* Linked list for timer events */
+    xevent_data_t*          pTimerWheel[XEVENTS_WHEEL_LEVELS][XEVENTS_WHEEL_SLOTS]; /* Timer wheel slots */
+    xevent_data_t*          pTimerIdle;         /* Fired timers waiting for extend or delete */
+    uint64_t                nTimerTick;         /* Next wheel tick (ms) to be processed */
+    uint32_t                nTimerCount;        /* Number of armed timers in the wheel */
 #endif
 
     xevent_cb_t             eventCallback;      /* Service callback */
@@ -166,9 +232,13 @@ typedef struct XEvents {
     uint32_t                nEventMax;          /* Max allowed file descriptors */
 
     xbool_t                 bResync;            /* Flag to indicate if event loop needs resync */
-    xbool_t                 bUseHash;           /* Flag to enable/disable hash map usage*/
-    xbool_t                 bCheckDup;          /* Flag to enable/disable duplicate check in hash map */
+    xbool_t                 bUseHash;           /* Flag to enable/disable fd lookup map usage */
+    xbool_t                 bCheckDup;          /* Flag to enable/disable duplicate check in lookup map */
+#ifdef _XEVENTS_USE_FD_TABLE
+    xevent_table_t          eventsTable;        /* fd indexed table for events and related data */
+#else
     xhash_t                 eventsMap;          /* Hash map for events and related data */
+#endif
 } xevents_t;
 
 const char *XEvents_GetStatusStr(xevent_status_t status);
@@ -182,6 +252,9 @@ int XEvent_ReadU64(xevent_data_t *pData, uint64_t *pVal);
 
 xevent_data_t* XEvents_NewData(void *pCtx, XSOCKET nFd, int nType);
 xevent_data_t* XEvents_GetData(xevents_t *pEvents, XSOCKET nFd);
+size_t XEvents_GetDataCount(xevents_t *pEvents);
+void XEvents_IterateData(xevents_t *pEvents, xevent_itfunc_t itfunc, void *pCtx);
+void XEvents_DetachData(xevents_t *pEvents);
 
 xevent_data_t* XEvents_CreateEvent(xevents_t *pEvents, void *pCtx);
 xevent_data_t* XEvents_AddTimer(xevents_t *pEvents, void *pContext, int nTimeoutMs);
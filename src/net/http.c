@@ -15,6 +15,39 @@
 #include "http.h"
 #include "crypt.h"
 #include "base64.h"
+#include "cpu.h"
+#include "xtime.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define XHTTP_USE_SIMD
+#define XHTTP_TARGET(arch) __attribute__((target(arch)))
+#endif
+
+/* Returns position of the first byte that matches cA or cB, nSize if none */
+typedef size_t(*xhttp_scan_fn_t)(const char *pData, size_t nSize, char cA, char cB);
+
+typedef struct XHTTPToken {
+    const char *pKey;
+    const char *pValue;
+    size_t nValueLength;
+    size_t nKeyLength;
+} xhttp_token_t;
+
+/* Chunked body decoder states (RFC 7230, section 4.1) */
+typedef enum {
+    XHTTP_CHUNK_SIZE = 0,
+    XHTTP_CHUNK_HEX,
+    XHTTP_CHUNK_EXT,
+    XHTTP_CHUNK_SIZE_LF,
+    XHTTP_CHUNK_DATA,
+    XHTTP_CHUNK_DATA_CR,
+    XHTTP_CHUNK_DATA_LF,
+    XHTTP_CHUNK_TRAILER,
+    XHTTP_CHUNK_TRAILER_LINE,
+    XHTTP_CHUNK_TRAILER_LF,
+    XHTTP_CHUNK_DONE
+} xhttp_chunk_state_t;
 
 typedef struct XHTTPCode {
     const int nCode;
@@ -76,6 +109,140 @@ static xhttp_code_t g_XTTPCodes[] =
     { -1, "Unknown "}
 };
 
+typedef struct XHTTPKnown {
+    const char* pName;
+    const size_t nLength;
+} xhttp_known_t;
+
+/* Must follow the order of xhttp_header_t */
+static const xhttp_known_t g_XHTTPKnown[XHTTP_HDR_KNOWN] =
+{
+    { "host", 4 },
+    { "upgrade", 7 },
+    { "connection", 10 },
+    { "content-type", 12 },
+    { "content-length", 14 },
+    { "transfer-encoding", 17 }
+};
+
+static size_t XHTTP_ScanScalar(const char *pData, size_t nSize, char cA, char cB)
+{
+    size_t i;
+    for (i = 0; i < nSize; i++)
+        if (pData[i] == cA || pData[i] == cB) return i;
+
+    return nSize;
+}
+
+#ifdef XHTTP_USE_SIMD
+XHTTP_TARGET("sse4.2")
+static size_t XHTTP_ScanSSE42(const char *pData, size_t nSize, char cA, char cB)
+{
+    const __m128i set = _mm_setr_epi8(cA, cB, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t i = 0;
+
+    for (; i + 16 <= nSize; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&pData[i]);
+        int nIndex = _mm_cmpestri(set, 2, chunk, 16,
+            _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+
+        if (nIndex < 16) return i + (size_t)nIndex;
+    }
+
+    return i + XHTTP_ScanScalar(&pData[i], nSize - i, cA, cB);
+}
+
+XHTTP_TARGET("avx2")
+static size_t XHTTP_ScanAVX2(const char *pData, size_t nSize, char cA, char cB)
+{
+    const __m256i a = _mm256_set1_epi8(cA);
+    const __m256i b = _mm256_set1_epi8(cB);
+    size_t i = 0;
+
+    for (; i + 32 <= nSize; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)&pData[i]);
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, a), _mm256_cmpeq_epi8(chunk, b));
+
+        uint32_t nMask = (uint32_t)_mm256_movemask_epi8(match);
+        if (nMask) return i + (size_t)__builtin_ctz(nMask);
+    }
+
+    return i + XHTTP_ScanScalar(&pData[i], nSize - i, cA, cB);
+}
+#endif
+
+/*
+    Process-wide kernel selection, the pointer is read by every parser without
+    locking. XHTTP_SetScanner() is init-only, call it (or XHTTP_GetScanner() to
+    resolve the automatic choice) before the parser threads are started.
+*/
+static size_t XHTTP_ScanAuto(const char *pData, size_t nSize, char cA, char cB);
+static xhttp_scan_fn_t g_XHTTPScan = XHTTP_ScanAuto;
+static xhttp_scan_t g_eXHTTPScanner = XHTTP_SCAN_AUTO;
+
+xhttp_scan_t XHTTP_SetScanner(xhttp_scan_t eScanner)
+{
+    uint32_t nFeatures = XCPU_GetFeatures();
+
+    if (eScanner == XHTTP_SCAN_AUTO)
+    {
+        eScanner = (nFeatures & XCPU_AVX2) ? XHTTP_SCAN_AVX2 :
+                   (nFeatures & XCPU_SSE42) ? XHTTP_SCAN_SSE42 :
+                                              XHTTP_SCAN_SCALAR;
+    }
+
+    /* Fall back to the best available kernel below the requested one */
+    if (eScanner == XHTTP_SCAN_AVX2 && !(nFeatures & XCPU_AVX2)) eScanner = XHTTP_SCAN_SSE42;
+    if (eScanner == XHTTP_SCAN_SSE42 && !(nFeatures & XCPU_SSE42)) eScanner = XHTTP_SCAN_SCALAR;
+
+#ifdef XHTTP_USE_SIMD
+    if (eScanner == XHTTP_SCAN_AVX2) g_XHTTPScan = XHTTP_ScanAVX2;
+    else if (eScanner == XHTTP_SCAN_SSE42) g_XHTTPScan = XHTTP_ScanSSE42;
+    else g_XHTTPScan = XHTTP_ScanScalar;
+#else
+    eScanner = XHTTP_SCAN_SCALAR;
+    g_XHTTPScan = XHTTP_ScanScalar;
+#endif
+
+    g_eXHTTPScanner = eScanner;
+    return eScanner;
+}
+
+xhttp_scan_t XHTTP_GetScanner(void)
+{
+    if (g_eXHTTPScanner == XHTTP_SCAN_AUTO)
+        return XHTTP_SetScanner(XHTTP_SCAN_AUTO);
+
+    return g_eXHTTPScanner;
+}
+
+static size_t XHTTP_ScanAuto(const char *pData, size_t nSize, char cA, char cB)
+{
+    XHTTP_SetScanner(XHTTP_SCAN_AUTO);
+    return g_XHTTPScan(pData, nSize, cA, cB);
+}
+
+const char* XHTTP_GetScannerStr(xhttp_scan_t eScanner)
+{
+    switch (eScanner)
+    {
+        case XHTTP_SCAN_AUTO:
+            return "auto";
+        case XHTTP_SCAN_SCALAR:
+            return "scalar";
+        case XHTTP_SCAN_SSE42:
+            return "sse4.2";
+        case XHTTP_SCAN_AVX2:
+            return "avx2";
+        default:
+            break;
+    }
+
+    return "unknown";
+}
+
 const char* XHTTP_GetStatusStr(xhttp_status_t eStatus)
 {
     switch (eStatus)
@@ -151,6 +318,7 @@ const char *XHTTP_GetMethodStr(xhttp_method_t eMethod)
         case XHTTP_POST: return "POST";
         case XHTTP_DELETE: return "DELETE";
         case XHTTP_OPTIONS: return "OPTIONS";
+        case XHTTP_HEAD: return "HEAD";
         case XHTTP_DUMMY: return "DUMMY";
         default: break;
     }
@@ -165,6 +333,7 @@ xhttp_method_t XHTTP_GetMethodType(const char *pData)
     if (!strncmp(pData, "POST", 4)) return XHTTP_POST;
     if (!strncmp(pData, "DELETE", 6)) return XHTTP_DELETE;
     if (!strncmp(pData, "OPTIONS", 7)) return XHTTP_OPTIONS;
+    if (!strncmp(pData, "HEAD", 4)) return XHTTP_HEAD;
     return XHTTP_DUMMY;
 }
 
@@ -238,6 +407,48 @@ static int XHTTP_MapIt(xmap_pair_t *pPair, void *pContext)
     return nStatus;
 }
 
+static void XHTTP_ResetSlices(xhttp_t *pHttp)
+{
+    int i;
+    for (i = 0; i < XHTTP_HDR_KNOWN; i++)
+        pHttp->nKnown[i] = XSTDERR;
+
+    pHttp->nSliceCount = 0;
+}
+
+static xbool_t XHTTP_IsChunked(const char *pEncoding, size_t nLength)
+{
+    /* Chunked must be the final transfer coding applied to the body */
+    while (nLength > 0 && isspace((unsigned char)pEncoding[nLength - 1])) nLength--;
+    return nLength >= 7 && xstrncasecmp(&pEncoding[nLength - 7], "chunked", 7);
+}
+
+static int XHTTP_ChunkedIt(xmap_pair_t *pPair, void *pContext)
+{
+    xbool_t *pChunked = (xbool_t*)pContext;
+    const char *pHeader = (const char *)pPair->pKey;
+    const char *pValue = (const char *)pPair->pData;
+
+    /* Added headers are stored with the case used by the caller */
+    if (strlen(pHeader) != 17 || !xstrncasecmp(pHeader, "Transfer-Encoding", 17)) return XMAP_OK;
+    *pChunked = XHTTP_IsChunked(pValue, strlen(pValue));
+    return XMAP_STOP;
+}
+
+static xbool_t XHTTP_HasChunkedHeader(xhttp_t *pHttp)
+{
+    xbool_t bChunked = XFALSE;
+    XMap_Iterate(&pHttp->headerMap, XHTTP_ChunkedIt, &bChunked);
+    return bChunked;
+}
+
+static void XHTTP_ResetChunks(xhttp_t *pHttp)
+{
+    pHttp->nChunkState = XHTTP_CHUNK_SIZE;
+    pHttp->nChunkSize = 0;
+    pHttp->nChunkRaw = 0;
+}
+
 int XHTTP_SetCallback(xhttp_t *pHttp, xhttp_cb_t callback, void *pCbCtx, uint16_t nCbTypes)
 {
     if (pHttp == NULL) return XSTDERR;
@@ -261,6 +472,11 @@ int XHTTP_Init(xhttp_t *pHttp, xhttp_method_t eMethod, size_t nSize)
     pHttp->nKeepAlive = 0;
     pHttp->nCbTypes = 0;
     pHttp->nTimeout = 0;
+    pHttp->pPool = NULL;
+    pHttp->bSlices = XFALSE;
+    pHttp->bChunked = XFALSE;
+    XHTTP_ResetSlices(pHttp);
+    XHTTP_ResetChunks(pHttp);
 
     pHttp->nContentMax = XHTTP_PACKAGE_MAX;
     pHttp->nHeaderMax = XHTTP_HEADER_MAX;
@@ -270,6 +486,7 @@ int XHTTP_Init(xhttp_t *pHttp, xhttp_method_t eMethod, size_t nSize)
 
     XMap_Init(&pHttp->headerMap, NULL, 0);
     pHttp->headerMap.clearCb = XHTTP_HeaderClearCb;
+    XByteBuffer_Init(&pHttp->chunkData, XSTDNON, XFALSE);
 
     xbyte_buffer_t *pBuffer = &pHttp->rawData;
     return XByteBuffer_Init(pBuffer, nSize, XSTDNON);
@@ -316,6 +533,9 @@ void XHTTP_Reset(xhttp_t *pHttp, xbool_t bHard)
         XByteBuffer_Clear(&pHttp->rawData);
         XByteBuffer_Init(&pHttp->rawData, XSTDNON, XFALSE);
 
+        XByteBuffer_Clear(&pHttp->chunkData);
+        XByteBuffer_Init(&pHttp->chunkData, XSTDNON, XFALSE);
+
         XMap_Destroy(&pHttp->headerMap);
         XMap_Init(&pHttp->headerMap, NULL, XSTDNON);
         pHttp->headerMap.clearCb = XHTTP_HeaderClearCb;
@@ -323,6 +543,7 @@ void XHTTP_Reset(xhttp_t *pHttp, xbool_t bHard)
     else
     {
         XByteBuffer_Reset(&pHttp->rawData);
+        XByteBuffer_Reset(&pHttp->chunkData);
         XMap_Reset(&pHttp->headerMap);
     }
 
@@ -332,6 +553,34 @@ void XHTTP_Reset(xhttp_t *pHttp, xbool_t bHard)
     pHttp->nStatusCode = 0;
     pHttp->nComplete = 0;
     pHttp->sUri[0] = '\0';
+    pHttp->bChunked = XFALSE;
+    XHTTP_ResetSlices(pHttp);
+    XHTTP_ResetChunks(pHttp);
+
+    pHttp->eMethod = XHTTP_DUMMY;
+    pHttp->eType = XHTTP_INITIAL;
+}
+
+void XHTTP_Recycle(xhttp_t *pHttp)
+{
+    /* Borrowed raw data is only detached, owned storage is kept */
+    if (!pHttp->rawData.nSize) XByteBuffer_Init(&pHttp->rawData, XSTDNON, XFALSE);
+    else XByteBuffer_Reset(&pHttp->rawData);
+
+    XByteBuffer_Reset(&pHttp->chunkData);
+    XMap_Reset(&pHttp->headerMap);
+
+    pHttp->nContentLength = 0;
+    pHttp->nHeaderLength = 0;
+    pHttp->nHeaderCount = 0;
+    pHttp->nStatusCode = 0;
+    pHttp->nKeepAlive = 0;
+    pHttp->nComplete = 0;
+    pHttp->sVersion[0] = '\0';
+    pHttp->sUri[0] = '\0';
+    pHttp->bChunked = XFALSE;
+    XHTTP_ResetSlices(pHttp);
+    XHTTP_ResetChunks(pHttp);
 
     pHttp->eMethod = XHTTP_DUMMY;
     pHttp->eType = XHTTP_INITIAL;
@@ -372,7 +621,9 @@ int XHTTP_Copy(xhttp_t *pDst, xhttp_t *pSrc)
     xmap_t *pDstMap = &pDst->headerMap;
     pDstMap->clearCb = XHTTP_HeaderClearCb;
 
-    if (XMap_Iterate(pSrcMap, XHTTP_MapIt, pDstMap) != XMAP_OK)
+    /* Slice mode map only caches values and is rebuilt on demand */
+    if (!pSrc->bSlices && pSrcMap->nCount &&
+        XMap_Iterate(pSrcMap, XHTTP_MapIt, pDstMap) != XMAP_OK)
     {
         XHTTP_Clear(pDst);
         return XSTDERR;
@@ -394,6 +645,26 @@ int XHTTP_Copy(xhttp_t *pDst, xhttp_t *pSrc)
     pDst->nTimeout = pSrc->nTimeout;
     pDst->eType = pSrc->eType;
 
+    /* Slice offsets are valid for the copied raw data as well */
+    memcpy(pDst->slices, pSrc->slices, sizeof(xhttp_slice_t) * pSrc->nSliceCount);
+    memcpy(pDst->nKnown, pSrc->nKnown, sizeof(pSrc->nKnown));
+    pDst->nSliceCount = pSrc->nSliceCount;
+    pDst->bSlices = pSrc->bSlices;
+    if (pDst->bSlices) pDst->nHeaderCount = pSrc->nHeaderCount;
+
+    xbyte_buffer_t *pSrcChunks = &pSrc->chunkData;
+    if (pSrcChunks->nUsed && XByteBuffer_Add(&pDst->chunkData,
+        pSrcChunks->pData, pSrcChunks->nUsed) <= 0)
+    {
+        XHTTP_Clear(pDst);
+        return XSTDERR;
+    }
+
+    pDst->nChunkState = pSrc->nChunkState;
+    pDst->nChunkSize = pSrc->nChunkSize;
+    pDst->nChunkRaw = pSrc->nChunkRaw;
+    pDst->bChunked = pSrc->bChunked;
+
     return XSTDOK;
 }
 
@@ -403,6 +674,7 @@ void XHTTP_Clear(xhttp_t *pHttp)
     pHttp->nComplete = XFALSE;
 
     XMap_Destroy(&pHttp->headerMap);
+    XByteBuffer_Clear(&pHttp->chunkData);
     XByteBuffer_Clear(&pHttp->rawData);
 }
 
@@ -579,7 +851,10 @@ xbyte_buffer_t* XHTTP_Assemble(xhttp_t *pHttp, const uint8_t *pContent, size_t n
     if (nStatus == XSTDERR) return NULL;
     xbool_t nAllowUpdate = pHttp->nAllowUpdate;
 
-    if (nLength > 0)
+    /* Chunked message carries its body as chunks, without Content-Length */
+    xbool_t bChunked = XHTTP_HasChunkedHeader(pHttp);
+
+    if (nLength > 0 && !bChunked)
     {
         pHttp->nAllowUpdate = XTRUE;
         nStatus = XHTTP_AddHeader(pHttp, "Content-Length", "%zu", nLength);
@@ -601,7 +876,9 @@ xbyte_buffer_t* XHTTP_Assemble(xhttp_t *pHttp, const uint8_t *pContent, size_t n
 
     pHttp->nHeaderLength = pBuffer->nUsed;
     pHttp->nHeaderCount = (uint16_t)pHdrMap->nCount;
-    if (nLength > 0 && XByteBuffer_Add(pBuffer, pContent, nLength) <= 0) return NULL;
+
+    if (nLength > 0 && bChunked && XHTTP_AddChunk(pBuffer, pContent, nLength) <= 0) return NULL;
+    else if (nLength > 0 && !bChunked && XByteBuffer_Add(pBuffer, pContent, nLength) <= 0) return NULL;
 
     pHttp->nAllowUpdate = nAllowUpdate;
     pHttp->nContentLength = nLength;
@@ -609,8 +886,241 @@ xbyte_buffer_t* XHTTP_Assemble(xhttp_t *pHttp, const uint8_t *pContent, size_t n
     return pBuffer;
 }
 
+int XHTTP_AddChunk(xbyte_buffer_t *pBuffer, const uint8_t *pData, size_t nLength)
+{
+    XCHECK_NL((pBuffer != NULL), XSTDERR);
+    nLength = (pData != NULL) ? nLength : 0;
+
+    /* Zero length chunk is the last one and terminates the body */
+    if (!nLength) return XByteBuffer_AddFmt(pBuffer, "%s", "0\r\n\r\n");
+
+    if (XByteBuffer_AddFmt(pBuffer, "%zx\r\n", nLength) <= 0 ||
+        XByteBuffer_Add(pBuffer, pData, nLength) <= 0) return XSTDERR;
+
+    return XByteBuffer_AddFmt(pBuffer, "%s", "\r\n");
+}
+
+void XHTTP_InitDate(xhttp_date_t *pDate)
+{
+    XCHECK_VOID_NL((pDate != NULL));
+    pDate->sDate[0] = XSTR_NUL;
+    pDate->nLength = 0;
+    pDate->nTime = 0;
+}
+
+const char* XHTTP_GetDate(xhttp_date_t *pDate, size_t *pLength)
+{
+    XCHECK_NL((pDate != NULL), NULL);
+    time_t nNow = time(NULL);
+
+    /* Format only when the second changes, callers share the same string */
+    if (nNow != pDate->nTime || !pDate->nLength)
+    {
+        struct tm timeinfo;
+#ifdef _WIN32
+        gmtime_s(&timeinfo, &nNow);
+#else
+        gmtime_r(&nNow, &timeinfo);
+#endif
+        pDate->nLength = strftime(pDate->sDate, sizeof(pDate->sDate),
+                            "%a, %d %b %Y %H:%M:%S GMT", &timeinfo);
+        pDate->nTime = nNow;
+    }
+
+    if (pLength != NULL) *pLength = pDate->nLength;
+    return pDate->sDate;
+}
+
+static xbool_t XHTTP_IsHeader(const char *pHeader, const char *pName, size_t nLength)
+{
+    return strlen(pHeader) == nLength &&
+        xstrncasecmp(pHeader, pName, nLength);
+}
+
+static int XHTTP_TemplateWriteCb(xmap_pair_t *pPair, void *pContext)
+{
+    xbyte_buffer_t *pBuffer = (xbyte_buffer_t*)pContext;
+    const char *pHeader = (const char *)pPair->pKey;
+    const char *pValue = (const char *)pPair->pData;
+
+    /* Patched by XHTTP_WriteTemplate() for every response */
+    if (XHTTP_IsHeader(pHeader, "Content-Length", 14) ||
+        XHTTP_IsHeader(pHeader, "Date", 4)) return XMAP_OK;
+
+    return XByteBuffer_AddFmt(pBuffer, "%s: %s\r\n",
+        pHeader, pValue) == XSTDERR ? XMAP_STOP : XMAP_OK;
+}
+
+int XHTTP_InitTemplate(xhttp_template_t *pTemplate, xhttp_t *pHttp, xbool_t bDate)
+{
+    XCHECK((pTemplate != NULL && pHttp != NULL), XSTDINV);
+    XCHECK((pHttp->eType == XHTTP_RESPONSE), XSTDINV);
+
+    /* Template body always has fixed length */
+    xmap_t *pHdrMap = &pHttp->headerMap;
+    XCHECK(!XHTTP_HasChunkedHeader(pHttp), XSTDINV);
+
+    xbyte_buffer_t *pBuffer = &pTemplate->header;
+    XByteBuffer_Init(pBuffer, XSTDNON, XFALSE);
+    pTemplate->bDate = bDate;
+
+    const char *pCodeStr = XHTTP_GetCodeStr(pHttp->nStatusCode);
+    int nStatus = XByteBuffer_AddFmt(pBuffer, "HTTP/%s %d %s\r\n",
+        pHttp->sVersion, pHttp->nStatusCode, pCodeStr);
+
+    if (nStatus > 0 && pHttp->nKeepAlive && XHTTP_GetHeader(pHttp, "Connection") == NULL)
+        nStatus = XByteBuffer_AddFmt(pBuffer, "%s", "Connection: keep-alive\r\n");
+
+    if (nStatus <= 0 || (pHdrMap->nCount > 0 &&
+        XMap_Iterate(pHdrMap, XHTTP_TemplateWriteCb, pBuffer) != XMAP_OK))
+    {
+        XByteBuffer_Clear(pBuffer);
+        return XSTDERR;
+    }
+
+    return (int)pBuffer->nUsed;
+}
+
+static size_t XHTTP_WriteDecimal(char *pDst, size_t nValue)
+{
+    char sDigits[32];
+    size_t nLength = 0;
+
+    do
+    {
+        sDigits[nLength++] = (char)('0' + nValue % 10);
+        nValue /= 10;
+    }
+    while (nValue);
+
+    size_t i;
+    for (i = 0; i < nLength; i++)
+        pDst[i] = sDigits[nLength - i - 1];
+
+    return nLength;
+}
+
+int XHTTP_WriteTemplate(const xhttp_template_t *pTemplate, xbyte_buffer_t *pBuffer, xhttp_date_t *pDate, const uint8_t *pContent, size_t nLength)
+{
+    XCHECK((pTemplate != NULL && pBuffer != NULL), XSTDINV);
+    XCHECK((pTemplate->header.nUsed > 0), XSTDINV);
+    nLength = (pContent != NULL) ? nLength : 0;
+
+    xhttp_date_t date;
+    const char *pDateStr = NULL;
+    size_t nDateLength = 0;
+
+    if (pTemplate->bDate)
+    {
+        if (pDate == NULL)
+        {
+            XHTTP_InitDate(&date);
+            pDate = &date;
+        }
+
+        pDateStr = XHTTP_GetDate(pDate, &nDateLength);
+    }
+
+    /* Fixed part, two patched headers, separator and body in one allocation */
+    size_t nHeader = pTemplate->header.nUsed;
+    size_t nReserve = nHeader + nDateLength + nLength + 64;
+    XCHECK((XByteBuffer_Reserve(pBuffer, nReserve) > 0), XSTDERR);
+
+    char *pDst = (char*)&pBuffer->pData[pBuffer->nUsed];
+    size_t nOffset = nHeader;
+    memcpy(pDst, pTemplate->header.pData, nHeader);
+
+    if (nDateLength)
+    {
+        memcpy(&pDst[nOffset], "Date: ", 6);
+        memcpy(&pDst[nOffset + 6], pDateStr, nDateLength);
+        nOffset += nDateLength + 6;
+        pDst[nOffset++] = '\r';
+        pDst[nOffset++] = '\n';
+    }
+
+    memcpy(&pDst[nOffset], "Content-Length: ", 16);
+    nOffset += 16;
+    nOffset += XHTTP_WriteDecimal(&pDst[nOffset], nLength);
+    memcpy(&pDst[nOffset], "\r\n\r\n", 4);
+    nOffset += 4;
+
+    if (nLength) memcpy(&pDst[nOffset], pContent, nLength);
+    nOffset += nLength;
+
+    pBuffer->nUsed += nOffset;
+    pBuffer->pData[pBuffer->nUsed] = '\0';
+    return (int)nOffset;
+}
+
+void XHTTP_ClearTemplate(xhttp_template_t *pTemplate)
+{
+    XCHECK_VOID_NL((pTemplate != NULL));
+    XByteBuffer_Clear(&pTemplate->header);
+    pTemplate->bDate = XFALSE;
+}
+
+static const char* XHTTP_GetSliceValue(xhttp_t *pHttp, int nIndex, size_t *pLength)
+{
+    const xhttp_slice_t *pSlice = &pHttp->slices[nIndex];
+    if (pLength != NULL) *pLength = pSlice->nValueLength;
+    return (const char*)&pHttp->rawData.pData[pSlice->nValueOffset];
+}
+
+static const char* XHTTP_FindSlice(xhttp_t *pHttp, const char *pHeader, size_t *pLength)
+{
+    const char *pData = (const char*)pHttp->rawData.pData;
+    size_t nLength = strlen(pHeader);
+    int i;
+
+    for (i = 0; i < pHttp->nSliceCount; i++)
+    {
+        const xhttp_slice_t *pSlice = &pHttp->slices[i];
+        if (pSlice->nKeyLength == nLength &&
+            xstrncasecmp(&pData[pSlice->nKeyOffset], pHeader, nLength))
+            return XHTTP_GetSliceValue(pHttp, i, pLength);
+    }
+
+    return NULL;
+}
+
+static char* XHTTP_CacheSlice(xhttp_t *pHttp, const char *pHeader)
+{
+    size_t nLength = 0;
+    const char *pValue = XHTTP_FindSlice(pHttp, pHeader, &nLength);
+    if (pValue == NULL) return NULL;
+
+    char *pKey = xstracase(pHeader, XSTR_LOWER);
+    if (pKey == NULL) return NULL;
+
+    char *pHdr = (char*)XMap_Get(&pHttp->headerMap, pKey);
+    if (pHdr != NULL)
+    {
+        free(pKey);
+        return pHdr;
+    }
+
+    pHdr = (char*)malloc(nLength + 1);
+    XCHECK_CALL(pHdr, free, pKey, NULL);
+
+    memcpy(pHdr, pValue, nLength);
+    pHdr[nLength] = XSTR_NUL;
+
+    if (XMap_Put(&pHttp->headerMap, pKey, pHdr) != XMAP_OK)
+    {
+        free(pKey);
+        free(pHdr);
+        return NULL;
+    }
+
+    return pHdr;
+}
+
 const char* XHTTP_GetHeader(xhttp_t *pHttp, const char* pHeader)
 {
+    /* Slice values are not terminated, keep the copy until the object is cleared */
+    if (pHttp->bSlices) return XHTTP_CacheSlice(pHttp, pHeader);
+
     char *pKey = xstracase(pHeader, XSTR_LOWER);
     if (pKey == NULL) return NULL;
 
@@ -621,6 +1131,34 @@ const char* XHTTP_GetHeader(xhttp_t *pHttp, const char* pHeader)
     return pHdr;
 }
 
+const char* XHTTP_GetHeaderSlice(xhttp_t *pHttp, const char* pHeader, size_t *pLength)
+{
+    if (pLength != NULL) *pLength = XSTDNON;
+    XCHECK_NL((pHttp != NULL && pHeader != NULL), NULL);
+
+    if (pHttp->bSlices)
+        return XHTTP_FindSlice(pHttp, pHeader, pLength);
+
+    const char *pValue = XHTTP_GetHeader(pHttp, pHeader);
+    if (pValue != NULL && pLength != NULL) *pLength = strlen(pValue);
+
+    return pValue;
+}
+
+const char* XHTTP_GetKnownHeader(xhttp_t *pHttp, xhttp_header_t eHeader, size_t *pLength)
+{
+    if (pLength != NULL) *pLength = XSTDNON;
+    XCHECK_NL((pHttp != NULL && eHeader < XHTTP_HDR_KNOWN), NULL);
+
+    if (!pHttp->bSlices)
+        return XHTTP_GetHeaderSlice(pHttp, g_XHTTPKnown[eHeader].pName, pLength);
+
+    int nIndex = pHttp->nKnown[eHeader];
+    if (nIndex < 0) return NULL;
+
+    return XHTTP_GetSliceValue(pHttp, nIndex, pLength);
+}
+
 char* XHTTP_GetHeaderRaw(xhttp_t *pHttp)
 {
     if (pHttp == NULL || !pHttp->nHeaderLength) return NULL;
@@ -650,6 +1188,12 @@ const uint8_t* XHTTP_GetBody(xhttp_t *pHttp)
     XCHECK_NL((pHttp && pHttp->nHeaderLength), NULL);
     xbyte_buffer_t *pBuffer = &pHttp->rawData;
 
+    if (pHttp->bChunked)
+    {
+        pBuffer = &pHttp->chunkData;
+        return pBuffer->nUsed ? pBuffer->pData : NULL;
+    }
+
     XCHECK_NL((pBuffer->nUsed > pHttp->nHeaderLength), NULL);
     return &pBuffer->pData[pHttp->nHeaderLength];
 }
@@ -658,19 +1202,32 @@ size_t XHTTP_GetBodySize(xhttp_t *pHttp)
 {
     XCHECK_NL((pHttp && pHttp->nHeaderLength), XSTDNON);
     const xbyte_buffer_t *pBuffer = &pHttp->rawData;
+    if (pHttp->bChunked) return pHttp->chunkData.nUsed;
 
     XCHECK_NL((pBuffer->nUsed > pHttp->nHeaderLength), XSTDNON);
     return pBuffer->nUsed - pHttp->nHeaderLength;
 }
 
+static size_t XHTTP_GetChunkedExtra(xhttp_t *pHttp)
+{
+    /* Bytes after the last chunk belong to the next message */
+    size_t nPacketLen = pHttp->nHeaderLength + pHttp->nChunkRaw;
+    xbool_t bDone = pHttp->nChunkState == XHTTP_CHUNK_DONE;
+
+    XCHECK_NL((bDone && pHttp->rawData.nUsed > nPacketLen), XSTDNON);
+    return pHttp->rawData.nUsed - nPacketLen;
+}
+
 size_t XHTTP_GetExtraSize(xhttp_t *pHttp)
 {
     XCHECK_NL((pHttp != NULL && pHttp->nHeaderLength), XSTDNON);
+    if (pHttp->bChunked) return XHTTP_GetChunkedExtra(pHttp);
+
     size_t nPayloadSize = XHTTP_GetBodySize(pHttp);
     XCHECK_NL(nPayloadSize, XSTDNON);
 
-    const char *pCntType = XHTTP_GetHeader(pHttp, "Content-Type");
-    const char *pCntLen = XHTTP_GetHeader(pHttp, "Content-Length");
+    const char *pCntType = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_TYPE, NULL);
+    const char *pCntLen = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_LENGTH, NULL);
     XCHECK_NL((pCntType != NULL && pCntLen != NULL), nPayloadSize);
 
     XCHECK_NL((nPayloadSize > pHttp->nContentLength), XSTDNON);
@@ -684,6 +1241,7 @@ const uint8_t* XHTTP_GetExtraData(xhttp_t *pHttp)
 
     size_t nPacketLen = pHttp->nHeaderLength + pHttp->nContentLength;
     const xbyte_buffer_t *pBuffer = &pHttp->rawData;
+    if (pHttp->bChunked) nPacketLen = pHttp->nHeaderLength + pHttp->nChunkRaw;
 
     XCHECK_NL((pBuffer->nUsed > nPacketLen), NULL);
     return &pBuffer->pData[nPacketLen];
@@ -698,11 +1256,12 @@ size_t XHTTP_GetPacketSize(xhttp_t *pHttp)
 
 static int XHTTP_CheckComplete(xhttp_t *pHttp)
 {
-    const char *pCntType = XHTTP_GetHeader(pHttp, "Content-Type");
+    size_t nCntType = XSTDNON;
+    XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_TYPE, &nCntType);
     size_t nPayloadSize = XHTTP_GetBodySize(pHttp);
 
     pHttp->nComplete = ((pHttp->nContentLength && pHttp->nContentLength <= nPayloadSize) ||
-                        (!pHttp->nContentLength && !xstrused(pCntType))) ? XSTDOK : XSTDNON;
+                        (!pHttp->nContentLength && !nCntType)) ? XSTDOK : XSTDNON;
 
     return pHttp->nComplete;
 }
@@ -736,23 +1295,49 @@ static uint16_t XHTTP_ParseCode(xhttp_t *pHttp)
     return (nSize > 0 && nSkip < nSize) ? (uint16_t)atoi(&sField[nSkip]) : 0;
 }
 
-static size_t XHTTP_ParseHeaderLength(const char *pHdrStr)
+static size_t XHTTP_ParseHeaderLength(const char *pData, size_t nSize, size_t nPosit)
 {
-    int nPosit = xstrsrc(pHdrStr, "\r\n\r\n");
-    if (nPosit <= 0) return 0;
-    return (size_t)nPosit + 4;
+    /* Every header line has a LF, check the terminator only there */
+    while (nPosit < nSize)
+    {
+        size_t i = nPosit + g_XHTTPScan(&pData[nPosit], nSize - nPosit, '\n', '\n');
+        if (i >= nSize) break;
+
+        if (i >= 4 &&
+            pData[i - 1] == '\r' &&
+            pData[i - 2] == '\n' &&
+            pData[i - 3] == '\r') return i + 1;
+
+        nPosit = i + 1;
+    }
+
+    return XSTDNON;
 }
 
-static size_t XHTTP_GetContentLength(xhttp_t *pHttp)
+static int XHTTP_GetContentLength(xhttp_t *pHttp, size_t *pValue)
 {
-    const char *pHdr = XHTTP_GetHeader(pHttp, "Content-Length");
-    return (pHdr != NULL) ? atol(pHdr) : XSTDNON;
+    size_t i, nLength = XSTDNON, nValue = XSTDNON;
+    const char *pHdr = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_LENGTH, &nLength);
+
+    for (i = 0; i < nLength; i++)
+    {
+        /* Trailing garbage or wrapped value would desync the pipelined stream */
+        if (!isdigit((unsigned char)pHdr[i])) return XSTDERR;
+        size_t nDigit = (size_t)(pHdr[i] - '0');
+
+        if (nValue > (SIZE_MAX - nDigit) / 10) return XSTDERR;
+        nValue = nValue * 10 + nDigit;
+    }
+
+    *pValue = nValue;
+    return XSTDOK;
 }
 
 static xbool_t XHTTP_GetKeepAlive(xhttp_t *pHttp)
 {
-    const char *pConnHeader = XHTTP_GetHeader(pHttp, "Connection");
-    return xstrncasecmp(pConnHeader, "keep-alive", 10);
+    size_t nLength = XSTDNON;
+    const char *pConnHeader = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONNECTION, &nLength);
+    return nLength >= 10 && xstrncasecmp(pConnHeader, "keep-alive", 10);
 }
 
 static size_t XHTTP_ParseUrl(xhttp_t *pHttp)
@@ -774,78 +1359,310 @@ static size_t XHTTP_ParseUrl(xhttp_t *pHttp)
     return xstrncpy(pHttp->sUri, sizeof(pHttp->sUri), &sTmpUrl[nPosit]);
 }
 
-static int XHTTP_ParseHeaders(xhttp_t *pHttp)
+static size_t XHTTP_SkipStartLine(const char *pData, size_t nEnd)
 {
-    const char *pHeader = (const char *)pHttp->rawData.pData;
-    xarray_t *pArr = xstrsplit(pHeader, "\r\n");
-    if (pArr == NULL) return XSTDERR;
-
-    int nStatus = XSTDOK;
-    unsigned int i;
+    size_t nPosit = g_XHTTPScan(pData, nEnd, '\n', '\n');
+    return nPosit < nEnd ? nPosit + 1 : nEnd;
+}
 
-    for (i = 0; i < pArr->nUsed; i++)
+static xbool_t XHTTP_NextHeader(const char *pData, size_t nEnd, size_t *pPosit, xhttp_token_t *pToken)
+{
+    while (*pPosit < nEnd)
     {
-        char *pData = (char*)XArray_GetData(pArr, i);
-        if (pData != NULL)
-        {
-            int nPosit = xstrsrc(pData, ":");
-            if (nPosit <= 0) continue;
+        const char *pLine = &pData[*pPosit];
+        size_t nAvail = nEnd - *pPosit;
 
-            char* pHeaderStr = xstracasen(pData, XSTR_LOWER, nPosit);
-            if (pHeaderStr == NULL)
-            {
-                nStatus = XSTDERR;
-                break;
-            }
+        /* One pass finds the colon or the end of a line without it */
+        size_t nColon = g_XHTTPScan(pLine, nAvail, ':', '\n');
+        xbool_t bColon = nColon < nAvail && pLine[nColon] == ':';
+        size_t nLength = nColon;
 
-            if (XMap_Get(&pHttp->headerMap, pHeaderStr) != NULL)
-            {
-                free(pHeaderStr);
-                continue;
-            }
+        if (bColon)
+        {
+            size_t nValue = nColon + 1;
+            nLength = nValue + g_XHTTPScan(&pLine[nValue], nAvail - nValue, '\n', '\n');
+        }
 
-            while (pData[nPosit] == ' ' || pData[nPosit] == ':') nPosit++;
-            char *pValue = xstracut(pData, nPosit, strlen(pData) - nPosit);
+        *pPosit += nLength + 1;
+        if (!bColon || !nColon) continue;
 
-            if (pValue == NULL)
-            {
-                free(pHeaderStr);
-                continue;
-            }
+        if (pLine[nLength - 1] == '\r') nLength--;
+        size_t nValuePos = nColon + 1;
 
-            if (pValue[0] == XSTR_SPACE_CHAR) xstrnrm(pValue, 0, 1);
-            if (XMap_Put(&pHttp->headerMap, pHeaderStr, pValue) != XMAP_OK)
-            {
-                nStatus = XSTDERR;
-                free(pHeaderStr);
-                free(pValue);
-                break;
-            }
-        }
+        while (nValuePos < nLength && (pLine[nValuePos] == ' ' || pLine[nValuePos] == '\t')) nValuePos++;
+        while (nLength > nValuePos && (pLine[nLength - 1] == ' ' || pLine[nLength - 1] == '\t')) nLength--;
+
+        pToken->pKey = pLine;
+        pToken->nKeyLength = nColon;
+        pToken->pValue = &pLine[nValuePos];
+        pToken->nValueLength = nLength - nValuePos;
+        return XTRUE;
     }
 
-    pHttp->nHeaderCount = (uint16_t)pHttp->headerMap.nCount;
-    XArray_Destroy(pArr);
-    return nStatus;
+    return XFALSE;
 }
 
-int XHTTP_AppendData(xhttp_t *pHttp, uint8_t* pData, size_t nSize)
+static int XHTTP_ParseHeaders(xhttp_t *pHttp)
 {
-    xbyte_buffer_t *pBuffer = &pHttp->rawData;
-    return XByteBuffer_Add(pBuffer, pData, nSize);
-}
+    const char *pData = (const char *)pHttp->rawData.pData;
+    size_t nEnd = pHttp->nHeaderLength;
+    size_t nPosit = XHTTP_SkipStartLine(pData, nEnd);
+    xhttp_token_t token;
 
-int XHTTP_InitParser(xhttp_t *pHttp, uint8_t* pData, size_t nSize)
-{
-    XHTTP_Init(pHttp, XHTTP_DUMMY, XSTDNON);
+    while (XHTTP_NextHeader(pData, nEnd, &nPosit, &token))
+    {
+        if (!token.nValueLength) continue;
+
+        char* pHeaderStr = xstracasen(token.pKey, XSTR_LOWER, token.nKeyLength);
+        if (pHeaderStr == NULL) return XSTDERR;
+
+        if (XMap_Get(&pHttp->headerMap, pHeaderStr) != NULL)
+        {
+            free(pHeaderStr);
+            continue;
+        }
+
+        char *pValue = (char*)malloc(token.nValueLength + 1);
+        XCHECK_CALL(pValue, free, pHeaderStr, XSTDERR);
+
+        memcpy(pValue, token.pValue, token.nValueLength);
+        pValue[token.nValueLength] = XSTR_NUL;
+
+        if (XMap_Put(&pHttp->headerMap, pHeaderStr, pValue) != XMAP_OK)
+        {
+            free(pHeaderStr);
+            free(pValue);
+            return XSTDERR;
+        }
+
+        pHttp->nHeaderCount = (uint16_t)pHttp->headerMap.nCount;
+    }
+
+    return XSTDOK;
+}
+
+static int XHTTP_GetKnownIndex(const char *pHeader, size_t nLength)
+{
+    int i;
+    for (i = 0; i < XHTTP_HDR_KNOWN; i++)
+    {
+        if (g_XHTTPKnown[i].nLength == nLength &&
+            xstrncasecmp(pHeader, g_XHTTPKnown[i].pName, nLength))
+            return i;
+    }
+
+    return XSTDERR;
+}
+
+static int XHTTP_SliceHeaders(xhttp_t *pHttp)
+{
+    const char *pData = (const char *)pHttp->rawData.pData;
+    size_t nEnd = pHttp->nHeaderLength;
+    size_t nPosit = XHTTP_SkipStartLine(pData, nEnd);
+    xhttp_token_t token;
+
+    XHTTP_ResetSlices(pHttp);
+
+    while (XHTTP_NextHeader(pData, nEnd, &nPosit, &token))
+    {
+        if (pHttp->nSliceCount >= XHTTP_SLICES_MAX) return XSTDEXC;
+        xhttp_slice_t *pSlice = &pHttp->slices[pHttp->nSliceCount];
+
+        pSlice->nKeyOffset = (uint32_t)(token.pKey - pData);
+        pSlice->nKeyLength = (uint32_t)token.nKeyLength;
+        pSlice->nValueOffset = (uint32_t)(token.pValue - pData);
+        pSlice->nValueLength = (uint32_t)token.nValueLength;
+
+        /* Same as map mode, the first occurrence of the header wins */
+        int nKnown = XHTTP_GetKnownIndex(token.pKey, token.nKeyLength);
+        if (nKnown >= 0 && pHttp->nKnown[nKnown] < 0)
+            pHttp->nKnown[nKnown] = (int16_t)pHttp->nSliceCount;
+
+        pHttp->nSliceCount++;
+    }
+
+    pHttp->nHeaderCount = pHttp->nSliceCount;
+    return XSTDOK;
+}
+
+static xhttp_status_t XHTTP_ChunkData(xhttp_t *pHttp, const uint8_t *pData, size_t nSize, xbool_t bCallback)
+{
+    if (bCallback)
+    {
+        int nRetVal = XHTTP_Callback(pHttp, XHTTP_READ_CNT, pData, nSize);
+        if (nRetVal == XSTDERR) return XHTTP_TERMINATED;
+        else if (nRetVal == XSTDNON) return XHTTP_COMPLETE;
+        else if (nRetVal == XSTDOK) return XHTTP_INCOMPLETE;
+    }
+
+    xbyte_buffer_t *pBuffer = &pHttp->chunkData;
+    if (XByteBuffer_Add(pBuffer, pData, nSize) <= 0) return XHTTP_EALLOC;
+    else if (pHttp->nContentMax && pBuffer->nUsed >= pHttp->nContentMax) return XHTTP_BIGCNT;
+
+    return XHTTP_INCOMPLETE;
+}
+
+static int XHTTP_HexValue(uint8_t nChar)
+{
+    if (nChar >= '0' && nChar <= '9') return nChar - '0';
+    else if (nChar >= 'a' && nChar <= 'f') return nChar - 'a' + 10;
+    else if (nChar >= 'A' && nChar <= 'F') return nChar - 'A' + 10;
+    return XSTDERR;
+}
+
+/*
+    Incremental decoder of the chunked transfer coding. Decoded data is passed
+    to the READ_CNT callback when bCallback is set, or buffered in chunkData.
+    The decoder state lives in xhttp_t, so the input can be split at any byte.
+    Chunk extensions and trailer fields are consumed and ignored.
+*/
+static xhttp_status_t XHTTP_DecodeChunks(xhttp_t *pHttp, const uint8_t *pData, size_t nSize, size_t *pUsed, xbool_t bCallback)
+{
+    xhttp_status_t eStatus = XHTTP_INCOMPLETE;
+    size_t nPosit = 0;
+
+    while (nPosit < nSize && pHttp->nChunkState != XHTTP_CHUNK_DONE)
+    {
+        uint8_t nChar = pData[nPosit];
+        int nHex = XSTDERR;
+
+        switch (pHttp->nChunkState)
+        {
+            case XHTTP_CHUNK_SIZE:
+            case XHTTP_CHUNK_HEX:
+                nHex = XHTTP_HexValue(nChar);
+                if (nHex >= 0)
+                {
+                    if (pHttp->nChunkSize > (SIZE_MAX >> 4)) return XHTTP_INVALID;
+                    pHttp->nChunkSize = (pHttp->nChunkSize << 4) | (size_t)nHex;
+                    pHttp->nChunkState = XHTTP_CHUNK_HEX;
+                }
+                else if (pHttp->nChunkState == XHTTP_CHUNK_SIZE) return XHTTP_INVALID;
+                else if (nChar == ';' || nChar == ' ' || nChar == '\t') pHttp->nChunkState = XHTTP_CHUNK_EXT;
+                else if (nChar == '\r') pHttp->nChunkState = XHTTP_CHUNK_SIZE_LF;
+                else return XHTTP_INVALID;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_EXT:
+                if (nChar == '\r') pHttp->nChunkState = XHTTP_CHUNK_SIZE_LF;
+                else if (nChar == '\n') return XHTTP_INVALID;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_SIZE_LF:
+                if (nChar != '\n') return XHTTP_INVALID;
+                pHttp->nChunkState = pHttp->nChunkSize ? XHTTP_CHUNK_DATA : XHTTP_CHUNK_TRAILER;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_DATA:
+            {
+                size_t nAvail = nSize - nPosit;
+                size_t nLength = XSTD_MIN(nAvail, pHttp->nChunkSize);
+
+                pHttp->nChunkSize -= nLength;
+                if (!pHttp->nChunkSize) pHttp->nChunkState = XHTTP_CHUNK_DATA_CR;
+
+                eStatus = XHTTP_ChunkData(pHttp, &pData[nPosit], nLength, bCallback);
+                nPosit += nLength;
+
+                if (eStatus != XHTTP_INCOMPLETE)
+                {
+                    if (pUsed != NULL) *pUsed = nPosit;
+                    return eStatus;
+                }
+
+                break;
+            }
+            case XHTTP_CHUNK_DATA_CR:
+                if (nChar != '\r') return XHTTP_INVALID;
+                pHttp->nChunkState = XHTTP_CHUNK_DATA_LF;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_DATA_LF:
+                if (nChar != '\n') return XHTTP_INVALID;
+                pHttp->nChunkState = XHTTP_CHUNK_SIZE;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_TRAILER:
+                if (nChar == '\r') pHttp->nChunkState = XHTTP_CHUNK_TRAILER_LF;
+                else if (nChar == '\n') return XHTTP_INVALID;
+                else pHttp->nChunkState = XHTTP_CHUNK_TRAILER_LINE;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_TRAILER_LINE:
+                if (nChar == '\n') pHttp->nChunkState = XHTTP_CHUNK_TRAILER;
+                nPosit++;
+                break;
+            case XHTTP_CHUNK_TRAILER_LF:
+                if (nChar != '\n') return XHTTP_INVALID;
+                pHttp->nChunkState = XHTTP_CHUNK_DONE;
+                nPosit++;
+                break;
+            default:
+                return XHTTP_INVALID;
+        }
+    }
+
+    if (pUsed != NULL) *pUsed = nPosit;
+    return pHttp->nChunkState == XHTTP_CHUNK_DONE ?
+        XHTTP_COMPLETE : XHTTP_INCOMPLETE;
+}
+
+static xhttp_status_t XHTTP_ParseChunks(xhttp_t *pHttp)
+{
+    xbyte_buffer_t *pBuffer = &pHttp->rawData;
+    size_t nPosit = pHttp->nHeaderLength + pHttp->nChunkRaw;
+    size_t nUsed = XSTDNON;
+
+    /* Raw data may be borrowed, decode the body without modifying it */
+    const uint8_t *pBody = &pBuffer->pData[nPosit];
+    size_t nSize = pBuffer->nUsed - nPosit;
+
+    /* Decoding continues from the last raw byte consumed by the previous call */
+    xhttp_status_t eStatus = XHTTP_DecodeChunks(pHttp, pBody, nSize, &nUsed, XFALSE);
+    if (eStatus == XHTTP_COMPLETE) pHttp->nComplete = XTRUE;
+
+    pHttp->nChunkRaw += nUsed;
+    return eStatus;
+}
+
+static xhttp_status_t XHTTP_StreamChunks(xhttp_t *pHttp, const uint8_t *pData, size_t nSize)
+{
+    /* Data after the last chunk is not part of this message */
+    if (pHttp->nComplete) return XHTTP_COMPLETE;
+
+    xhttp_status_t eStatus = XHTTP_DecodeChunks(pHttp, pData, nSize, NULL, XTRUE);
+    if (eStatus == XHTTP_COMPLETE) pHttp->nComplete = XTRUE;
+    else if (eStatus != XHTTP_INCOMPLETE &&
+             eStatus != XHTTP_TERMINATED)
+        return XHTTP_StatusCb(pHttp, eStatus);
+
+    return eStatus;
+}
+
+int XHTTP_AppendData(xhttp_t *pHttp, uint8_t* pData, size_t nSize)
+{
+    /* Body of the parsed chunked message is decoded instead of buffered */
+    if (pHttp->bChunked && pHttp->nHeaderLength)
+    {
+        xhttp_status_t eStatus = XHTTP_StreamChunks(pHttp, pData, nSize);
+        return (eStatus == XHTTP_COMPLETE || eStatus == XHTTP_INCOMPLETE) ? XSTDOK : XSTDERR;
+    }
+
+    xbyte_buffer_t *pBuffer = &pHttp->rawData;
+    return XByteBuffer_Add(pBuffer, pData, nSize);
+}
+
+int XHTTP_InitParser(xhttp_t *pHttp, uint8_t* pData, size_t nSize)
+{
+    XHTTP_Init(pHttp, XHTTP_DUMMY, XSTDNON);
     int nStatus = XHTTP_AppendData(pHttp, pData, nSize);
     return nSize > 0 && nStatus <= 0 ? XSTDERR : XSTDOK;
 }
 
-xhttp_status_t XHTTP_Parse(xhttp_t *pHttp)
+static xhttp_status_t XHTTP_ParseFrom(xhttp_t *pHttp, size_t nScanned)
 {
     const char *prawData = (const char*)pHttp->rawData.pData;
-    size_t nHeaderLength = XHTTP_ParseHeaderLength(prawData);
+    size_t nHeaderLength = XHTTP_ParseHeaderLength(prawData, pHttp->rawData.nUsed, nScanned);
     if (!nHeaderLength) return XHTTP_INCOMPLETE;
 
     pHttp->rawData.pData[nHeaderLength - 1] = '\0';
@@ -863,20 +1680,75 @@ xhttp_status_t XHTTP_Parse(xhttp_t *pHttp)
     if (!XHTTP_ParseUrl(pHttp))
         return XHTTP_StatusCb(pHttp, XHTTP_INVALID);
 
-    if (XHTTP_ParseHeaders(pHttp) == XSTDERR)
+    /* Header count over the slice table is parsed into the map instead */
+    if (pHttp->bSlices && XHTTP_SliceHeaders(pHttp) < 0)
+    {
+        XHTTP_ResetSlices(pHttp);
+        pHttp->bSlices = XFALSE;
+    }
+
+    if (!pHttp->bSlices && XHTTP_ParseHeaders(pHttp) == XSTDERR)
         return XHTTP_StatusCb(pHttp, XHTTP_EALLOC);
 
-    pHttp->nContentLength = XHTTP_GetContentLength(pHttp);
+    size_t nEncoding = XSTDNON;
+    const char *pEncoding = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_TRANSFER_ENCODING, &nEncoding);
+    pHttp->bChunked = nEncoding && XHTTP_IsChunked(pEncoding, nEncoding);
+
+    /* Transfer-Encoding overrides Content-Length (RFC 7230, section 3.3.3) */
+    pHttp->nContentLength = XSTDNON;
+    if (!pHttp->bChunked && XHTTP_GetContentLength(pHttp, &pHttp->nContentLength) < 0)
+        return XHTTP_StatusCb(pHttp, XHTTP_INVALID);
     pHttp->nKeepAlive = XHTTP_GetKeepAlive(pHttp);
     pHttp->rawData.pData[nHeaderLength - 1] = '\n';
 
     xhttp_status_t nStatus = XHTTP_StatusCb(pHttp, XHTTP_PARSED);
     if (nStatus == XHTTP_TERMINATED) return XHTTP_TERMINATED;
+
+    if (pHttp->bChunked)
+    {
+        XByteBuffer_Reset(&pHttp->chunkData);
+        XHTTP_ResetChunks(pHttp);
+
+        xhttp_status_t eStatus = XHTTP_ParseChunks(pHttp);
+        if (eStatus == XHTTP_COMPLETE) return XHTTP_COMPLETE;
+        else if (eStatus != XHTTP_INCOMPLETE) return XHTTP_StatusCb(pHttp, eStatus);
+    }
     else if (XHTTP_CheckComplete(pHttp)) return XHTTP_COMPLETE;
 
     return nStatus;
 }
 
+xhttp_status_t XHTTP_Parse(xhttp_t *pHttp)
+{
+    /* Chunked body is already streaming through XHTTP_AppendData() */
+    if (pHttp->bChunked && pHttp->nHeaderLength)
+        return pHttp->nComplete ? XHTTP_COMPLETE : XHTTP_PARSED;
+
+    return XHTTP_ParseFrom(pHttp, XSTDNON);
+}
+
+xhttp_status_t XHTTP_Resume(xhttp_t *pHttp, uint8_t *pData, size_t nSize)
+{
+    /* Owned raw data would be lost, only borrowed data can be re-pointed */
+    XCHECK_NL((pHttp != NULL && !pHttp->rawData.nSize), XHTTP_EINIT);
+    XCHECK_NL((nSize >= pHttp->rawData.nUsed), XHTTP_EINIT);
+
+    /* Bytes received before were already scanned or decoded */
+    size_t nScanned = pHttp->rawData.nUsed;
+    XByteBuffer_SetData(&pHttp->rawData, pData, nSize);
+    if (!pHttp->nHeaderLength) return XHTTP_ParseFrom(pHttp, nScanned);
+
+    if (pHttp->bChunked)
+    {
+        xhttp_status_t eStatus = XHTTP_ParseChunks(pHttp);
+        if (eStatus == XHTTP_COMPLETE) return XHTTP_COMPLETE;
+        else if (eStatus != XHTTP_INCOMPLETE) return XHTTP_StatusCb(pHttp, eStatus);
+    }
+    else if (XHTTP_CheckComplete(pHttp)) return XHTTP_COMPLETE;
+
+    return XHTTP_PARSED;
+}
+
 xhttp_status_t XHTTP_ParseData(xhttp_t *pHttp, uint8_t* pData, size_t nSize)
 {
     int nStatus = XHTTP_InitParser(pHttp, pData, nSize);
@@ -890,6 +1762,14 @@ xhttp_status_t XHTTP_ParseBuff(xhttp_t *pHttp, xbyte_buffer_t *pBuffer)
     return XHTTP_Parse(pHttp);
 }
 
+xhttp_status_t XHTTP_ParseSlices(xhttp_t *pHttp, xbyte_buffer_t *pBuffer)
+{
+    XHTTP_Init(pHttp, XHTTP_DUMMY, XSTDNON);
+    XByteBuffer_Set(&pHttp->rawData, pBuffer);
+    pHttp->bSlices = XTRUE;
+    return XHTTP_Parse(pHttp);
+}
+
 xhttp_status_t XHTTP_ReadHeader(xhttp_t *pHttp, xsock_t *pSock)
 {
     xbyte_buffer_t *pBuffer = (xbyte_buffer_t*)&pHttp->rawData;
@@ -949,6 +1829,22 @@ xhttp_status_t XHTTP_ReadContent(xhttp_t *pHttp, xsock_t *pSock)
     uint8_t sBuffer[XHTTP_RX_SIZE];
     int nRetVal, nBytes = 0;
 
+    if (pHttp->bChunked)
+    {
+        xhttp_status_t eStatus = XHTTP_INCOMPLETE;
+
+        while (eStatus == XHTTP_INCOMPLETE)
+        {
+            nBytes = XSock_Read(pSock, sBuffer, sizeof(sBuffer));
+            if (nBytes <= 0) return XHTTP_StatusCb(pHttp, XHTTP_EREAD);
+
+            eStatus = XHTTP_StreamChunks(pHttp, sBuffer, (size_t)nBytes);
+            if (pSock->eStatus != XSOCK_ERR_NONE || XSock_IsNB(pSock)) break;
+        }
+
+        return eStatus;
+    }
+
     if (pHttp->nContentLength)
     {
         size_t nBodySize = XHTTP_GetBodySize(pHttp);
@@ -989,8 +1885,9 @@ xhttp_status_t XHTTP_ReadContent(xhttp_t *pHttp, xsock_t *pSock)
         return XHTTP_INCOMPLETE;
     }
 
-    const char *pContentType = XHTTP_GetHeader(pHttp, "Content-Type");
-    if (!xstrused(pContentType)) return XHTTP_COMPLETE;
+    size_t nContentType = XSTDNON;
+    XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_TYPE, &nContentType);
+    if (!nContentType) return XHTTP_COMPLETE;
 
     while (XSock_IsOpen(pSock))
     {
@@ -1148,6 +2045,9 @@ xhttp_status_t XHTTP_Connect(xhttp_t *pHttp, xsock_t *pSock, xlink_t *pLink)
 
 xhttp_status_t XHTTP_LinkExchange(xhttp_t *pRequest, xhttp_t *pResponse, xlink_t *pLink)
 {
+    if (pRequest->pPool != NULL)
+        return XHTTP_PoolExchange(pRequest->pPool, pRequest, pResponse, pLink);
+
     xsock_t sock;
     xhttp_status_t eStatus = XHTTP_Connect(pRequest, &sock, pLink);
 
@@ -1195,6 +2095,9 @@ xhttp_status_t XHTTP_Perform(xhttp_t *pHttp, xsock_t *pSock, const uint8_t *pBod
 
 xhttp_status_t XHTTP_LinkPerform(xhttp_t *pHttp, xlink_t *pLink, const uint8_t *pBody, size_t nLength)
 {
+    if (pHttp->pPool != NULL)
+        return XHTTP_PoolPerform(pHttp->pPool, pHttp, pLink, pBody, nLength);
+
     xsock_t sock;
     xhttp_status_t eStatus = XHTTP_Connect(pHttp, &sock, pLink);
 
@@ -1234,3 +2137,333 @@ xhttp_status_t XHTTP_SoloPerform(xhttp_t *pHttp, xhttp_method_t eMethod, const c
 
     return XHTTP_LinkPerform(pHttp, &link, pBody, nLength);
 }
+
+static xbool_t XHTTP_IsReusable(xhttp_t *pHttp)
+{
+    /* Bytes after the response would be mixed with the next one */
+    if (XHTTP_GetExtraSize(pHttp)) return XFALSE;
+
+    size_t nLength = 0;
+    const char *pConnection = XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONNECTION, &nLength);
+    if (pConnection != NULL && nLength >= 5 && xstrncasecmp(pConnection, "close", 5)) return XFALSE;
+    if (!pHttp->nKeepAlive && strncmp(pHttp->sVersion, "1.1", 3)) return XFALSE;
+
+    /* Body must be delimited, otherwise it was read until the peer closed */
+    if (pHttp->bChunked) return pHttp->nChunkState == XHTTP_CHUNK_DONE;
+    if (pHttp->nContentLength) return XHTTP_GetBodySize(pHttp) == pHttp->nContentLength;
+
+    size_t nContentType = 0;
+    XHTTP_GetKnownHeader(pHttp, XHTTP_HDR_CONTENT_TYPE, &nContentType);
+    return nContentType ? XFALSE : XTRUE;
+}
+
+static xbool_t XHTTP_IsAlive(xsock_t *pSock)
+{
+#ifdef _WIN32
+    (void)pSock;
+    return XTRUE;
+#else
+    /* Idle connection has nothing to read, EOF or data means it is stale */
+    if (XSock_MsgPeek(pSock) != XSOCK_NONE) return XFALSE;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? XTRUE : XFALSE;
+#endif
+}
+
+static void XHTTP_CloseConn(xhttp_conn_t *pConn)
+{
+    XSock_Close(&pConn->sock);
+    free(pConn);
+}
+
+static size_t XHTTP_GetPoolKey(xhttp_t *pHttp, xlink_t *pLink, char *pKey, size_t nSize)
+{
+    if (xstrused(pHttp->sUnixAddr)) return xstrncpyf(pKey, nSize, "unix:%s", pHttp->sUnixAddr);
+    xbool_t bSSL = !strncmp(pLink->sProtocol, "https", 5);
+
+    int nPort = pLink->nPort > 0 ? pLink->nPort : bSSL ? XHTTP_SSL_PORT : XHTTP_DEF_PORT;
+    return xstrncpyf(pKey, nSize, "%s:%s:%d", bSSL ? "https" : "http", pLink->sAddr, nPort);
+}
+
+static xhttp_host_t* XHTTP_PoolGetHost(xhttp_pool_t *pPool, const char *pKey)
+{
+    xhttp_host_t *pHost = pPool->pHosts;
+
+    while (pHost != NULL)
+    {
+        if (!strcmp(pHost->sKey, pKey)) return pHost;
+        pHost = pHost->pNext;
+    }
+
+    pHost = (xhttp_host_t*)calloc(1, sizeof(xhttp_host_t));
+    XCHECK_NL((pHost != NULL), NULL);
+
+    xstrncpy(pHost->sKey, sizeof(pHost->sKey), pKey);
+    pHost->pNext = pPool->pHosts;
+    pPool->pHosts = pHost;
+    return pHost;
+}
+
+static xhttp_conn_t* XHTTP_PoolPopIdle(xhttp_pool_t *pPool, xhttp_host_t *pHost)
+{
+    xhttp_conn_t *pConn = NULL;
+    XSync_Lock(&pPool->lock);
+
+    /* Most recently used connection first, it is the most likely alive */
+    if (pHost->pIdle != NULL)
+    {
+        pConn = pHost->pIdle;
+        pHost->pIdle = pConn->pNext;
+        pHost->nIdle--;
+    }
+
+    XSync_Unlock(&pPool->lock);
+    return pConn;
+}
+
+static xhttp_conn_t* XHTTP_PoolAcquire(xhttp_pool_t *pPool, const char *pKey, xbool_t bAllowIdle, xbool_t *pReused)
+{
+    XSync_Lock(&pPool->lock);
+    xhttp_host_t *pHost = XHTTP_PoolGetHost(pPool, pKey);
+    XSync_Unlock(&pPool->lock);
+
+    XCHECK_NL((pHost != NULL), NULL);
+    uint64_t nNow = XTime_GetMs();
+    xhttp_conn_t *pConn = NULL;
+    *pReused = XFALSE;
+
+    while (bAllowIdle && (pConn = XHTTP_PoolPopIdle(pPool, pHost)) != NULL)
+    {
+        xbool_t bExpired = nNow - pConn->nIdleTime >= pPool->nIdleTimeout;
+        if (!bExpired && XHTTP_IsAlive(&pConn->sock))
+        {
+            XSync_Lock(&pPool->lock);
+            pPool->nReused++;
+            XSync_Unlock(&pPool->lock);
+
+            pConn->pNext = NULL;
+            *pReused = XTRUE;
+            return pConn;
+        }
+
+        XSync_Lock(&pPool->lock);
+        pHost->nCount--;
+        XSync_Unlock(&pPool->lock);
+        XHTTP_CloseConn(pConn);
+    }
+
+    pConn = (xhttp_conn_t*)calloc(1, sizeof(xhttp_conn_t));
+    XCHECK_NL((pConn != NULL), NULL);
+
+    XSock_Init(&pConn->sock, XSTDNON, XSOCK_INVALID);
+    pConn->pHost = pHost;
+
+    /* Connections above the per-host limit are used once and closed */
+    XSync_Lock(&pPool->lock);
+    pConn->bPooled = pHost->nCount < pPool->nMaxPerHost;
+    if (pConn->bPooled) pHost->nCount++;
+    pPool->nOpened++;
+    XSync_Unlock(&pPool->lock);
+
+    return pConn;
+}
+
+static void XHTTP_PoolRelease(xhttp_pool_t *pPool, xhttp_conn_t *pConn, xbool_t bReuse)
+{
+    xhttp_host_t *pHost = pConn->pHost;
+    bReuse = bReuse && pConn->bPooled && XSock_IsOpen(&pConn->sock) &&
+             pConn->sock.eStatus == XSOCK_ERR_NONE;
+
+    XSync_Lock(&pPool->lock);
+
+    if (bReuse)
+    {
+        pConn->nIdleTime = XTime_GetMs();
+        pConn->pNext = pHost->pIdle;
+        pHost->pIdle = pConn;
+        pHost->nIdle++;
+    }
+    else if (pConn->bPooled)
+    {
+        pHost->nCount--;
+    }
+
+    XSync_Unlock(&pPool->lock);
+    if (!bReuse) XHTTP_CloseConn(pConn);
+}
+
+XSTATUS XHTTP_PoolInit(xhttp_pool_t *pPool, size_t nMaxPerHost, uint32_t nIdleTimeout)
+{
+    XCHECK((pPool != NULL), XSTDINV);
+    XSync_Init(&pPool->lock);
+    pPool->nIdleTimeout = nIdleTimeout ? nIdleTimeout : XHTTP_POOL_IDLE_MS;
+    pPool->nMaxPerHost = nMaxPerHost ? nMaxPerHost : XHTTP_POOL_HOST_MAX;
+    pPool->pHosts = NULL;
+    pPool->nReused = 0;
+    pPool->nOpened = 0;
+    return XSTDOK;
+}
+
+size_t XHTTP_PoolClean(xhttp_pool_t *pPool)
+{
+    XCHECK_NL((pPool != NULL), XSTDNON);
+    xhttp_conn_t *pExpired = NULL;
+    xhttp_host_t *pHost;
+    size_t nClosed = 0;
+
+    uint64_t nNow = XTime_GetMs();
+    XSync_Lock(&pPool->lock);
+
+    for (pHost = pPool->pHosts; pHost != NULL; pHost = pHost->pNext)
+    {
+        xhttp_conn_t **ppConn = &pHost->pIdle;
+
+        while (*ppConn != NULL)
+        {
+            xhttp_conn_t *pConn = *ppConn;
+
+            if (nNow - pConn->nIdleTime < pPool->nIdleTimeout)
+            {
+                ppConn = &pConn->pNext;
+                continue;
+            }
+
+            *ppConn = pConn->pNext;
+            pConn->pNext = pExpired;
+            pExpired = pConn;
+
+            pHost->nCount--;
+            pHost->nIdle--;
+        }
+    }
+
+    XSync_Unlock(&pPool->lock);
+
+    /* Sockets are closed outside of the lock, TLS shutdown can block */
+    while (pExpired != NULL)
+    {
+        xhttp_conn_t *pNext = pExpired->pNext;
+        XHTTP_CloseConn(pExpired);
+        pExpired = pNext;
+        nClosed++;
+    }
+
+    return nClosed;
+}
+
+void XHTTP_PoolDestroy(xhttp_pool_t *pPool)
+{
+    XCHECK_VOID_NL((pPool != NULL));
+    xhttp_host_t *pHost = pPool->pHosts;
+
+    while (pHost != NULL)
+    {
+        xhttp_host_t *pNextHost = pHost->pNext;
+        xhttp_conn_t *pConn = pHost->pIdle;
+
+        while (pConn != NULL)
+        {
+            xhttp_conn_t *pNext = pConn->pNext;
+            XHTTP_CloseConn(pConn);
+            pConn = pNext;
+        }
+
+        free(pHost);
+        pHost = pNextHost;
+    }
+
+    pPool->pHosts = NULL;
+    XSync_Destroy(&pPool->lock);
+}
+
+void XHTTP_SetPool(xhttp_t *pHttp, xhttp_pool_t *pPool)
+{
+    XCHECK_VOID_NL((pHttp != NULL));
+    pHttp->pPool = pPool;
+}
+
+static xhttp_status_t XHTTP_PoolConnect(xhttp_pool_t *pPool, xhttp_t *pHttp, xlink_t *pLink, const char *pKey,
+                                        xbool_t bAllowIdle, xhttp_conn_t **ppConn, xbool_t *pReused)
+{
+    xbool_t bReused = XFALSE;
+    xhttp_conn_t *pConn = XHTTP_PoolAcquire(pPool, pKey, bAllowIdle, &bReused);
+    if (pConn == NULL) return XHTTP_StatusCb(pHttp, XHTTP_EALLOC);
+
+    xhttp_status_t eStatus = XHTTP_CONNECTED;
+    *pReused = bReused;
+    if (!bReused) eStatus = XHTTP_Connect(pHttp, &pConn->sock, pLink);
+    else if (XHTTP_SetAuthBasic(pHttp, pLink->sUser, pLink->sPass) < 0) eStatus = XHTTP_StatusCb(pHttp, XHTTP_EAUTH);
+
+    if (eStatus != XHTTP_CONNECTED)
+    {
+        XHTTP_PoolRelease(pPool, pConn, XFALSE);
+        return eStatus;
+    }
+
+    *ppConn = pConn;
+    return eStatus;
+}
+
+xhttp_status_t XHTTP_PoolExchange(xhttp_pool_t *pPool, xhttp_t *pRequest, xhttp_t *pResponse, xlink_t *pLink)
+{
+    XCHECK((pPool != NULL && pRequest != NULL && pResponse != NULL && pLink != NULL), XHTTP_EINIT);
+    char sKey[XHTTP_ADDR_MAX];
+    XHTTP_GetPoolKey(pRequest, pLink, sKey, sizeof(sKey));
+
+    xbool_t bAllowIdle = XTRUE;
+
+    for (;;)
+    {
+        xhttp_conn_t *pConn = NULL;
+        xbool_t bReused = XFALSE;
+
+        xhttp_status_t eStatus = XHTTP_PoolConnect(pPool, pRequest, pLink, sKey, bAllowIdle, &pConn, &bReused);
+        if (eStatus != XHTTP_CONNECTED) return eStatus;
+
+        eStatus = XHTTP_Exchange(pRequest, pResponse, &pConn->sock);
+
+        /* Peer may close idle connection at any time, retry once with a new one */
+        if (bReused && eStatus == XHTTP_EWRITE)
+        {
+            XHTTP_PoolRelease(pPool, pConn, XFALSE);
+            bAllowIdle = XFALSE;
+            continue;
+        }
+
+        XHTTP_PoolRelease(pPool, pConn, eStatus == XHTTP_COMPLETE && XHTTP_IsReusable(pResponse));
+        return eStatus;
+    }
+}
+
+xhttp_status_t XHTTP_PoolPerform(xhttp_pool_t *pPool, xhttp_t *pHttp, xlink_t *pLink, const uint8_t *pBody, size_t nLength)
+{
+    XCHECK((pPool != NULL && pHttp != NULL && pLink != NULL), XHTTP_EINIT);
+    char sKey[XHTTP_ADDR_MAX];
+    XHTTP_GetPoolKey(pHttp, pLink, sKey, sizeof(sKey));
+
+    /* Request asks to keep the connection unless it is already assembled */
+    if (!pHttp->nComplete) pHttp->nKeepAlive = XTRUE;
+
+    xbool_t bAllowIdle = XTRUE;
+
+    for (;;)
+    {
+        xhttp_conn_t *pConn = NULL;
+        xbool_t bReused = XFALSE;
+
+        xhttp_status_t eStatus = XHTTP_PoolConnect(pPool, pHttp, pLink, sKey, bAllowIdle, &pConn, &bReused);
+        if (eStatus != XHTTP_CONNECTED) return eStatus;
+
+        /* Request is reset only after successful write, so it can be resent */
+        eStatus = XHTTP_Perform(pHttp, &pConn->sock, pBody, nLength);
+
+        if (bReused && eStatus == XHTTP_EWRITE)
+        {
+            XHTTP_PoolRelease(pPool, pConn, XFALSE);
+            bAllowIdle = XFALSE;
+            continue;
+        }
+
+        XHTTP_PoolRelease(pPool, pConn, eStatus == XHTTP_COMPLETE && XHTTP_IsReusable(pHttp));
+        return eStatus;
+    }
+}
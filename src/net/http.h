@@ -18,6 +18,7 @@
 #include "map.h"
 #include "buf.h"
 #include "type.h"
+#include "sync.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,10 @@ extern "C" {
 #define XHTTP_ADDR_MAX          256
 #define XHTTP_URL_MAX           2048
 #define XHTTP_RX_SIZE           4096
+#define XHTTP_SLICES_MAX        64
+#define XHTTP_DATE_MAX          32
+#define XHTTP_POOL_HOST_MAX     8
+#define XHTTP_POOL_IDLE_MS      30000
 
 #define XHTTP_SSL_PORT          443
 #define XHTTP_DEF_PORT          80
@@ -44,7 +49,8 @@ typedef enum {
     XHTTP_GET,
     XHTTP_POST,
     XHTTP_DELETE,
-    XHTTP_OPTIONS
+    XHTTP_OPTIONS,
+    XHTTP_HEAD
 } xhttp_method_t;
 
 typedef enum {
@@ -80,6 +86,33 @@ typedef enum {
     XHTTP_PARSED
 } xhttp_status_t;
 
+/* Header scanning kernels, selected at runtime by default */
+typedef enum {
+    XHTTP_SCAN_AUTO = 0,
+    XHTTP_SCAN_SCALAR,
+    XHTTP_SCAN_SSE42,
+    XHTTP_SCAN_AVX2
+} xhttp_scan_t;
+
+/* Headers with precomputed slots in slice mode */
+typedef enum {
+    XHTTP_HDR_HOST = 0,
+    XHTTP_HDR_UPGRADE,
+    XHTTP_HDR_CONNECTION,
+    XHTTP_HDR_CONTENT_TYPE,
+    XHTTP_HDR_CONTENT_LENGTH,
+    XHTTP_HDR_TRANSFER_ENCODING,
+    XHTTP_HDR_KNOWN
+} xhttp_header_t;
+
+/* Header name and value offsets in rawData, values are not NUL terminated */
+typedef struct xhttp_slice_ {
+    uint32_t nKeyOffset;
+    uint32_t nValueOffset;
+    uint32_t nValueLength;
+    uint32_t nKeyLength;
+} xhttp_slice_t;
+
 typedef enum
 {
     XHTTP_OTHER = (1 << 0),
@@ -99,6 +132,35 @@ typedef struct xhttp_ctx_ {
 
 struct xhttp_;
 typedef struct xhttp_ xhttp_t;
+
+typedef struct xhttp_host_ xhttp_host_t;
+
+/* Pooled keep-alive connection, see XHTTP_PoolExchange() */
+typedef struct xhttp_conn_ {
+    struct xhttp_conn_ *pNext;
+    xhttp_host_t *pHost;
+    uint64_t nIdleTime;
+    xbool_t bPooled;
+    xsock_t sock;
+} xhttp_conn_t;
+
+struct xhttp_host_ {
+    struct xhttp_host_ *pNext;
+    xhttp_conn_t *pIdle;
+    size_t nCount;
+    size_t nIdle;
+    char sKey[XHTTP_ADDR_MAX];
+};
+
+typedef struct xhttp_pool_ {
+    xsync_mutex_t lock;
+    xhttp_host_t *pHosts;
+    uint32_t nIdleTimeout;
+    size_t nMaxPerHost;
+    size_t nReused;
+    size_t nOpened;
+} xhttp_pool_t;
+
 typedef int(*xhttp_cb_t)(xhttp_t *pHttp, xhttp_ctx_t *pCbCtx);
 
 struct xhttp_ {
@@ -125,20 +187,51 @@ struct xhttp_ {
     xbool_t nAllocated;
     xbool_t nComplete;
 
+    /* Zero-copy header parsing, see XHTTP_ParseSlices() */
+    xhttp_slice_t slices[XHTTP_SLICES_MAX];
+    int16_t nKnown[XHTTP_HDR_KNOWN];
+    uint16_t nSliceCount;
+    xbool_t bSlices;
+
+    /* Keep-alive connection pool of the client helpers, see XHTTP_SetPool() */
+    xhttp_pool_t *pPool;
+
+    /* Chunked transfer coding decoder, see XHTTP_AppendData() */
+    xbyte_buffer_t chunkData;
+    size_t nChunkSize;
+    size_t nChunkRaw;
+    uint8_t nChunkState;
+    xbool_t bChunked;
+
     char sUnixAddr[XHTTP_ADDR_MAX];
     char sVersion[XHTTP_FIELD_MAX];
     char sUri[XHTTP_URL_MAX];
 };
 
+/* Date header value, formatted at most once per second */
+typedef struct xhttp_date_ {
+    char sDate[XHTTP_DATE_MAX];
+    size_t nLength;
+    time_t nTime;
+} xhttp_date_t;
+
+/* Pre-serialized status line and fixed headers of the response */
+typedef struct xhttp_template_ {
+    xbyte_buffer_t header;
+    xbool_t bDate;
+} xhttp_template_t;
+
 xbool_t XHTTP_IsSuccessCode(xhttp_t *pHandle);
 const char* XHTTP_GetCodeStr(int nCode);
 const char* XHTTP_GetMethodStr(xhttp_method_t eMethod);
 const char* XHTTP_GetStatusStr(xhttp_status_t eStatus);
+const char* XHTTP_GetScannerStr(xhttp_scan_t eScanner);
 xhttp_method_t XHTTP_GetMethodType(const char *pData);
 
 void XHTTP_Clear(xhttp_t *pHttp);
 void XHTTP_Free(xhttp_t **pHttp);
 void XHTTP_Reset(xhttp_t *pHttp, xbool_t bHard);
+void XHTTP_Recycle(xhttp_t *pHttp);
 xhttp_t *XHTTP_Alloc(xhttp_method_t eMethod, size_t nDataSize);
 
 int XHTTP_Copy(xhttp_t *pDst, xhttp_t *pSrc);
@@ -152,8 +245,18 @@ size_t XHTTP_GetAuthToken(char *pToken, size_t nSize, const char *pUser, const c
 int XHTTP_SetAuthBasic(xhttp_t *pHttp, const char *pUser, const char *pPwd);
 int XHTTP_AddHeader(xhttp_t *pHttp, const char *pHeader, const char *pStr, ...);
 xbyte_buffer_t* XHTTP_Assemble(xhttp_t *pHttp, const uint8_t *pContent, size_t nLength);
+int XHTTP_AddChunk(xbyte_buffer_t *pBuffer, const uint8_t *pData, size_t nLength);
+
+void XHTTP_InitDate(xhttp_date_t *pDate);
+const char* XHTTP_GetDate(xhttp_date_t *pDate, size_t *pLength);
+
+int XHTTP_InitTemplate(xhttp_template_t *pTemplate, xhttp_t *pHttp, xbool_t bDate);
+int XHTTP_WriteTemplate(const xhttp_template_t *pTemplate, xbyte_buffer_t *pBuffer, xhttp_date_t *pDate, const uint8_t *pContent, size_t nLength);
+void XHTTP_ClearTemplate(xhttp_template_t *pTemplate);
 
 const char* XHTTP_GetHeader(xhttp_t *pHttp, const char* pHeader);
+const char* XHTTP_GetHeaderSlice(xhttp_t *pHttp, const char* pHeader, size_t *pLength);
+const char* XHTTP_GetKnownHeader(xhttp_t *pHttp, xhttp_header_t eHeader, size_t *pLength);
 const uint8_t* XHTTP_GetExtraData(xhttp_t *pHttp);
 const uint8_t* XHTTP_GetBody(xhttp_t *pHttp);
 char* XHTTP_GetHeaderRaw(xhttp_t *pHttp);
@@ -165,8 +268,13 @@ int XHTTP_InitParser(xhttp_t *pHttp, uint8_t* pData, size_t nSize);
 int XHTTP_AppendData(xhttp_t *pHttp, uint8_t* pData, size_t nSize);
 xhttp_status_t XHTTP_ParseData(xhttp_t *pHttp, uint8_t* pData, size_t nSize);
 xhttp_status_t XHTTP_ParseBuff(xhttp_t *pHttp, xbyte_buffer_t *pBuffer);
+xhttp_status_t XHTTP_ParseSlices(xhttp_t *pHttp, xbyte_buffer_t *pBuffer);
+xhttp_status_t XHTTP_Resume(xhttp_t *pHttp, uint8_t *pData, size_t nSize);
 xhttp_status_t XHTTP_Parse(xhttp_t *pHttp);
 
+xhttp_scan_t XHTTP_SetScanner(xhttp_scan_t eScanner);
+xhttp_scan_t XHTTP_GetScanner(void);
+
 int XHTTP_SetCallback(xhttp_t *pHttp, xhttp_cb_t callback, void *pCbCtx, uint16_t nCbTypes);
 xhttp_status_t XHTTP_ReadHeader(xhttp_t *pHttp, xsock_t *pSock);
 xhttp_status_t XHTTP_ReadContent(xhttp_t *pHttp, xsock_t *pSock);
@@ -182,6 +290,14 @@ xhttp_status_t XHTTP_LinkPerform(xhttp_t *pHttp, xlink_t *pLink, const uint8_t *
 xhttp_status_t XHTTP_EasyPerform(xhttp_t *pHttp, const char *pLink, const uint8_t *pBody, size_t nLength);
 xhttp_status_t XHTTP_SoloPerform(xhttp_t *pHttp, xhttp_method_t eMethod, const char *pLink, const uint8_t *pBody, size_t nLength);
 
+XSTATUS XHTTP_PoolInit(xhttp_pool_t *pPool, size_t nMaxPerHost, uint32_t nIdleTimeout);
+void XHTTP_PoolDestroy(xhttp_pool_t *pPool);
+size_t XHTTP_PoolClean(xhttp_pool_t *pPool);
+void XHTTP_SetPool(xhttp_t *pHttp, xhttp_pool_t *pPool);
+
+xhttp_status_t XHTTP_PoolExchange(xhttp_pool_t *pPool, xhttp_t *pRequest, xhttp_t *pResponse, xlink_t *pLink);
+xhttp_status_t XHTTP_PoolPerform(xhttp_pool_t *pPool, xhttp_t *pHttp, xlink_t *pLink, const uint8_t *pBody, size_t nLength);
+
 #ifdef __cplusplus
 }
 #endif
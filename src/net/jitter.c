@@ -0,0 +1,392 @@
+/*!
+ *  @file libxutils/src/net/jitter.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Implementation of the RTP jitter buffer. Reorders packets of
+ * every SSRC in a preallocated ring indexed by the sequence number and
+ * releases them after the adaptive playout delay.
+ */
+
+#include "jitter.h"
+
+#define XJITTER_SLOTS_MAX       32768
+#define XJITTER_NO_SEQ          0x10000
+
+/* Playout delay covers this many jitter estimates */
+#define XJITTER_JITTER_SCALE    4
+
+/* Smoothing of arrival offset and delay decrease, in packets */
+#define XJITTER_OFFSET_GAIN     512.0
+#define XJITTER_DELAY_GAIN      256.0
+
+static size_t XJitter_Hash(uint32_t nSSRC)
+{
+    nSSRC ^= nSSRC >> 16;
+    nSSRC *= 0x45d9f3b;
+    nSSRC ^= nSSRC >> 16;
+    return (size_t)nSSRC;
+}
+
+static size_t XJitter_PowerOfTwo(size_t nValue)
+{
+    size_t nPower = 1;
+    while (nPower < nValue) nPower <<= 1;
+    return nPower;
+}
+
+static size_t XJitter_FindIndex(const xjitter_t *pJitter, uint32_t nSSRC)
+{
+    size_t nMask = pJitter->nTableSize - 1;
+    size_t nIndex = XJitter_Hash(nSSRC) & nMask;
+
+    /* Table is at least twice larger than the stream limit, so it always has a hole */
+    while (pJitter->pStreams[nIndex] != NULL &&
+           pJitter->pStreams[nIndex]->nSSRC != nSSRC)
+        nIndex = (nIndex + 1) & nMask;
+
+    return nIndex;
+}
+
+static void XJitter_FreeStream(xjitter_stream_t *pStream)
+{
+    XCHECK_VOID_NL((pStream != NULL));
+    free(pStream->pBuffer);
+    free(pStream->pSlots);
+    free(pStream);
+}
+
+static void XJitter_Start(xjitter_stream_t *pStream, uint16_t nSequence, uint32_t nTimeStamp, uint64_t nNowMs)
+{
+    /* Flush the window of the previous sequence space */
+    if (pStream->nQueued)
+    {
+        size_t i, nSpan = (uint16_t)(pStream->nHighSeq - pStream->nNextSeq);
+
+        for (i = 0; i <= nSpan; i++)
+        {
+            uint16_t nSlot = (uint16_t)(pStream->nNextSeq + i);
+            pStream->pSlots[nSlot & pStream->nMask].bUsed = XFALSE;
+        }
+
+        pStream->stats.nDropped += pStream->nQueued;
+        pStream->nQueued = 0;
+    }
+
+    pStream->nNextSeq = nSequence;
+    pStream->nHighSeq = (uint16_t)(nSequence - 1);
+    pStream->nBadSeq = XJITTER_NO_SEQ;
+    pStream->bPlaying = XFALSE;
+
+    /* First packet anchors the media time to its arrival */
+    pStream->nLastTs = nTimeStamp;
+    pStream->nLastExtTs = 0;
+    pStream->fTransit = (double)nNowMs * pStream->nClockRate / 1000.0;
+    pStream->fOffset = (double)nNowMs;
+}
+
+static xjitter_stream_t* XJitter_NewStream(xjitter_t *pJitter, uint32_t nSSRC)
+{
+    xjitter_stream_t *pStream = (xjitter_stream_t*)calloc(1, sizeof(xjitter_stream_t));
+    XCHECK((pStream != NULL), NULL);
+
+    pStream->pSlots = (xjitter_slot_t*)calloc(pJitter->nSlots, sizeof(xjitter_slot_t));
+    pStream->pBuffer = (uint8_t*)malloc(pJitter->nSlots * pJitter->nSlotSize);
+
+    XCHECK_CALL((pStream->pSlots != NULL && pStream->pBuffer != NULL),
+                XJitter_FreeStream, pStream, NULL);
+
+    size_t i;
+    for (i = 0; i < pJitter->nSlots; i++)
+        pStream->pSlots[i].pData = &pStream->pBuffer[i * pJitter->nSlotSize];
+
+    pStream->nMask = pJitter->nSlots - 1;
+    pStream->nClockRate = pJitter->nClockRate;
+    pStream->fDelay = (double)pJitter->nMinDelay;
+    pStream->stats.nDelay = pJitter->nMinDelay;
+    pStream->nSSRC = nSSRC;
+
+    return pStream;
+}
+
+static int64_t XJitter_ExtendTs(xjitter_stream_t *pStream, uint32_t nTimeStamp)
+{
+    int64_t nExtTs = pStream->nLastExtTs + (int32_t)(nTimeStamp - pStream->nLastTs);
+
+    if (nExtTs > pStream->nLastExtTs)
+    {
+        pStream->nLastExtTs = nExtTs;
+        pStream->nLastTs = nTimeStamp;
+    }
+
+    return nExtTs;
+}
+
+static double XJitter_PlayTime(const xjitter_stream_t *pStream, int64_t nExtTs)
+{
+    double fMediaTime = (double)nExtTs * 1000.0 / pStream->nClockRate;
+    return fMediaTime + pStream->fOffset + pStream->fDelay;
+}
+
+static void XJitter_UpdateTiming(xjitter_stream_t *pStream, int64_t nExtTs, uint64_t nNowMs)
+{
+    /* RFC 3550 A.8, interarrival jitter in timestamp units */
+    double fTransit = (double)nNowMs * pStream->nClockRate / 1000.0 - (double)nExtTs;
+    double fDiff = fTransit - pStream->fTransit;
+    if (fDiff < 0.) fDiff = -fDiff;
+
+    pStream->fTransit = fTransit;
+    pStream->fJitter += (fDiff - pStream->fJitter) / 16.0;
+    pStream->stats.nJitter = (uint32_t)pStream->fJitter;
+
+    /* Mean offset follows the network delay and the clock drift */
+    double fOffset = fTransit * 1000.0 / pStream->nClockRate;
+    pStream->fOffset += (fOffset - pStream->fOffset) / XJITTER_OFFSET_GAIN;
+}
+
+static void XJitter_AdaptDelay(const xjitter_t *pJitter, xjitter_stream_t *pStream, double fLate)
+{
+    double fTarget = pStream->fJitter * 1000.0 / pStream->nClockRate;
+    fTarget *= XJITTER_JITTER_SCALE;
+
+    /* Grow at once when packets come late or jitter raises, shrink slowly */
+    if (fLate > 0.) pStream->fDelay += fLate;
+    else if (fTarget > pStream->fDelay) pStream->fDelay = fTarget;
+    else pStream->fDelay += (fTarget - pStream->fDelay) / XJITTER_DELAY_GAIN;
+
+    if (pStream->fDelay < pJitter->nMinDelay) pStream->fDelay = pJitter->nMinDelay;
+    if (pStream->fDelay > pJitter->nMaxDelay) pStream->fDelay = pJitter->nMaxDelay;
+    pStream->stats.nDelay = (uint32_t)pStream->fDelay;
+}
+
+XSTATUS XJitter_Init(xjitter_t *pJitter, size_t nMaxStreams, size_t nSlots, uint32_t nClockRate)
+{
+    XCHECK_NL((pJitter != NULL), XSTDINV);
+    memset(pJitter, 0, sizeof(xjitter_t));
+
+    if (!nMaxStreams) nMaxStreams = XJITTER_STREAMS_DEF;
+    if (!nSlots) nSlots = XJITTER_SLOTS_DEF;
+    if (!nClockRate) nClockRate = XJITTER_CLOCK_RATE;
+
+    /* Slots are indexed by the masked 16 bit sequence number */
+    XCHECK_NL((nSlots <= XJITTER_SLOTS_MAX), XSTDINV);
+    pJitter->nSlots = XJitter_PowerOfTwo(nSlots);
+
+    pJitter->nTableSize = XJitter_PowerOfTwo(nMaxStreams * 2);
+    pJitter->pStreams = (xjitter_stream_t**)calloc(pJitter->nTableSize, sizeof(xjitter_stream_t*));
+    XCHECK((pJitter->pStreams != NULL), XSTDERR);
+
+    pJitter->nMaxStreams = nMaxStreams;
+    pJitter->nSlotSize = XJITTER_SLOT_SIZE;
+    pJitter->nMinDelay = XJITTER_DELAY_MIN;
+    pJitter->nMaxDelay = XJITTER_DELAY_MAX;
+    pJitter->nClockRate = nClockRate;
+
+    return XSTDOK;
+}
+
+void XJitter_Destroy(xjitter_t *pJitter)
+{
+    XCHECK_VOID_NL((pJitter != NULL));
+
+    if (pJitter->pStreams != NULL)
+    {
+        size_t i;
+        for (i = 0; i < pJitter->nTableSize; i++)
+            XJitter_FreeStream(pJitter->pStreams[i]);
+
+        free(pJitter->pStreams);
+        pJitter->pStreams = NULL;
+    }
+
+    pJitter->nTableSize = 0;
+    pJitter->nStreams = 0;
+    pJitter->nCursor = 0;
+}
+
+xjitter_stream_t* XJitter_GetStream(xjitter_t *pJitter, uint32_t nSSRC)
+{
+    XCHECK_NL((pJitter != NULL && pJitter->pStreams != NULL), NULL);
+    return pJitter->pStreams[XJitter_FindIndex(pJitter, nSSRC)];
+}
+
+XSTATUS XJitter_Remove(xjitter_t *pJitter, uint32_t nSSRC)
+{
+    XCHECK_NL((pJitter != NULL && pJitter->pStreams != NULL), XSTDINV);
+
+    size_t nMask = pJitter->nTableSize - 1;
+    size_t nHole = XJitter_FindIndex(pJitter, nSSRC);
+    XCHECK_NL((pJitter->pStreams[nHole] != NULL), XSTDNON);
+
+    XJitter_FreeStream(pJitter->pStreams[nHole]);
+    pJitter->pStreams[nHole] = NULL;
+    pJitter->nStreams--;
+
+    /* Shift back the following entries of the probe chain */
+    size_t nIndex = (nHole + 1) & nMask;
+    while (pJitter->pStreams[nIndex] != NULL)
+    {
+        size_t nHome = XJitter_Hash(pJitter->pStreams[nIndex]->nSSRC) & nMask;
+        size_t nDistance = (nIndex - nHome) & nMask;
+
+        if (nDistance >= ((nIndex - nHole) & nMask))
+        {
+            pJitter->pStreams[nHole] = pJitter->pStreams[nIndex];
+            pJitter->pStreams[nIndex] = NULL;
+            nHole = nIndex;
+        }
+
+        nIndex = (nIndex + 1) & nMask;
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XJitter_Push(xjitter_t *pJitter, const uint8_t *pData, size_t nLength, uint64_t nNowMs)
+{
+    XCHECK_NL((pJitter != NULL && pJitter->pStreams != NULL), XSTDINV);
+    XCHECK_NL((nLength <= pJitter->nSlotSize), XSTDINV);
+
+    xrtp_header_t header;
+    XCHECK_NL((XRTP_ParseHeader(&header, pData, nLength) > 0), XSTDINV);
+
+    uint16_t nSequence = (uint16_t)header.nSequence;
+    size_t nIndex = XJitter_FindIndex(pJitter, header.nSSRC);
+    xjitter_stream_t *pStream = pJitter->pStreams[nIndex];
+
+    if (pStream == NULL)
+    {
+        XCHECK_NL((pJitter->nStreams < pJitter->nMaxStreams), XSTDEXC);
+        pStream = XJitter_NewStream(pJitter, header.nSSRC);
+        XCHECK_NL((pStream != NULL), XSTDERR);
+
+        XJitter_Start(pStream, nSequence, header.nTimeStamp, nNowMs);
+        pJitter->pStreams[nIndex] = pStream;
+        pJitter->nStreams++;
+    }
+
+    int nSlots = (int)(pStream->nMask + 1);
+    int nDiff = (int16_t)(uint16_t)(nSequence - pStream->nNextSeq);
+
+    /* Nothing is played yet, so the window can move back for reordered head */
+    if (nDiff < 0 && !pStream->bPlaying &&
+        (uint16_t)(pStream->nHighSeq - nSequence) < nSlots)
+    {
+        pStream->nNextSeq = nSequence;
+        nDiff = 0;
+    }
+
+    /* RFC 3550 A.1, restart only when the next packet confirms a big jump */
+    if (nDiff >= nSlots || nDiff <= -nSlots)
+    {
+        if (nSequence != pStream->nBadSeq)
+        {
+            pStream->nBadSeq = (uint16_t)(nSequence + 1);
+            pStream->stats.nDropped++;
+            return XSTDNON;
+        }
+
+        XJitter_Start(pStream, nSequence, header.nTimeStamp, nNowMs);
+        pStream->stats.nResync++;
+        nDiff = 0;
+    }
+
+    xjitter_slot_t *pSlot = &pStream->pSlots[nSequence & pStream->nMask];
+    if (nDiff >= 0 && pSlot->bUsed)
+    {
+        pStream->stats.nDuplicate++;
+        return XSTDNON;
+    }
+
+    int64_t nExtTs = XJitter_ExtendTs(pStream, header.nTimeStamp);
+    XJitter_UpdateTiming(pStream, nExtTs, nNowMs);
+
+    if (nDiff < 0)
+    {
+        /* Raise the delay enough to play this packet next time */
+        double fLate = (double)nNowMs - XJitter_PlayTime(pStream, nExtTs);
+        XJitter_AdaptDelay(pJitter, pStream, fLate);
+        pStream->stats.nLate++;
+        return XSTDNON;
+    }
+
+    XJitter_AdaptDelay(pJitter, pStream, 0.);
+    memcpy(pSlot->pData, pData, nLength);
+    pSlot->nLength = nLength;
+    pSlot->nExtTs = nExtTs;
+    pSlot->nTimeStamp = header.nTimeStamp;
+    pSlot->nSequence = nSequence;
+    pSlot->bUsed = XTRUE;
+
+    if ((int16_t)(uint16_t)(nSequence - pStream->nHighSeq) > 0) pStream->nHighSeq = nSequence;
+    else pStream->stats.nReordered++;
+
+    pStream->stats.nReceived++;
+    pStream->nQueued++;
+    return XSTDOK;
+}
+
+XSTATUS XJitter_PopStream(xjitter_stream_t *pStream, uint64_t nNowMs, xjitter_packet_t *pPacket)
+{
+    XCHECK_NL((pStream != NULL && pPacket != NULL), XSTDINV);
+    XCHECK_NL((pStream->nQueued > 0), XSTDNON);
+
+    xjitter_slot_t *pSlot = &pStream->pSlots[pStream->nNextSeq & pStream->nMask];
+    uint16_t nSkip = 0;
+
+    /* Head is missing, wait for it until the next queued packet is due */
+    if (!pSlot->bUsed)
+    {
+        uint16_t nSpan = (uint16_t)(pStream->nHighSeq - pStream->nNextSeq);
+
+        for (nSkip = 1; nSkip <= nSpan; nSkip++)
+        {
+            uint16_t nSequence = (uint16_t)(pStream->nNextSeq + nSkip);
+            pSlot = &pStream->pSlots[nSequence & pStream->nMask];
+            if (pSlot->bUsed) break;
+        }
+    }
+
+    XCHECK_NL((XJitter_PlayTime(pStream, pSlot->nExtTs) <= (double)nNowMs), XSTDNON);
+
+    pPacket->pData = pSlot->pData;
+    pPacket->nLength = pSlot->nLength;
+    pPacket->nTimeStamp = pSlot->nTimeStamp;
+    pPacket->nSequence = pSlot->nSequence;
+    pPacket->nSSRC = pStream->nSSRC;
+    pPacket->nLost = nSkip;
+
+    pSlot->bUsed = XFALSE;
+    pStream->nNextSeq = (uint16_t)(pSlot->nSequence + 1);
+    pStream->bPlaying = XTRUE;
+    pStream->nQueued--;
+
+    pStream->stats.nLost += nSkip;
+    pStream->stats.nPlayed++;
+    return XSTDOK;
+}
+
+XSTATUS XJitter_Pop(xjitter_t *pJitter, uint64_t nNowMs, xjitter_packet_t *pPacket)
+{
+    XCHECK_NL((pJitter != NULL && pJitter->pStreams != NULL), XSTDINV);
+    XCHECK_NL((pJitter->nStreams > 0), XSTDNON);
+
+    size_t i, nMask = pJitter->nTableSize - 1;
+
+    for (i = 0; i < pJitter->nTableSize; i++)
+    {
+        size_t nIndex = (pJitter->nCursor + i) & nMask;
+        xjitter_stream_t *pStream = pJitter->pStreams[nIndex];
+        if (pStream == NULL || !pStream->nQueued) continue;
+
+        if (XJitter_PopStream(pStream, nNowMs, pPacket) > 0)
+        {
+            /* Next call starts from the following stream to keep them fair */
+            pJitter->nCursor = (nIndex + 1) & nMask;
+            return XSTDOK;
+        }
+    }
+
+    return XSTDNON;
+}
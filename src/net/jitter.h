@@ -0,0 +1,112 @@
+/*!
+ *  @file libxutils/src/net/jitter.h
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Implementation of the RTP jitter buffer. Reorders packets of
+ * every SSRC in a preallocated ring indexed by the sequence number and
+ * releases them after the adaptive playout delay.
+ */
+
+#ifndef __XUTILS_JITTER_H__
+#define __XUTILS_JITTER_H__
+
+#include "xstd.h"
+#include "rtp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XJITTER_STREAMS_DEF     16
+#define XJITTER_SLOTS_DEF       512
+#define XJITTER_SLOT_SIZE       1500
+#define XJITTER_CLOCK_RATE      90000
+#define XJITTER_DELAY_MIN       20
+#define XJITTER_DELAY_MAX       500
+
+typedef struct XJitterStats {
+    uint64_t nReceived;     // Packets accepted to the ring
+    uint64_t nPlayed;       // Packets released by pop
+    uint64_t nLost;         // Sequence numbers skipped at playout
+    uint64_t nLate;         // Packets arrived after their sequence was played
+    uint64_t nDuplicate;    // Packets already queued in the ring
+    uint64_t nReordered;    // Packets arrived before their predecessor
+    uint64_t nDropped;      // Out of window packets and packets flushed by resync
+    uint64_t nResync;       // Sequence window restarts
+    uint32_t nJitter;       // RFC 3550 interarrival jitter in timestamp units
+    uint32_t nDelay;        // Current playout delay in milliseconds
+} xjitter_stats_t;
+
+typedef struct XJitterPacket {
+    const uint8_t *pData;   // Raw RTP packet, owned by the jitter buffer
+    size_t nLength;
+    uint32_t nTimeStamp;
+    uint32_t nSSRC;
+    uint16_t nSequence;
+    uint16_t nLost;         // Sequence numbers skipped before this packet
+} xjitter_packet_t;
+
+typedef struct XJitterSlot {
+    uint8_t *pData;
+    size_t nLength;
+    int64_t nExtTs;         // Timestamp extended across wraparound
+    uint32_t nTimeStamp;
+    uint16_t nSequence;
+    xbool_t bUsed;
+} xjitter_slot_t;
+
+typedef struct XJitterStream {
+    xjitter_slot_t *pSlots;
+    uint8_t *pBuffer;
+    xjitter_stats_t stats;
+    size_t nQueued;
+    size_t nMask;
+
+    /* Timestamp extension and arrival to media time mapping */
+    int64_t nLastExtTs;
+    uint32_t nLastTs;
+    uint32_t nClockRate;
+    double fTransit;
+    double fOffset;
+    double fJitter;
+    double fDelay;
+
+    uint32_t nSSRC;
+    uint32_t nBadSeq;       // Expected sequence to confirm the resync
+    uint16_t nNextSeq;      // Next sequence number to play
+    uint16_t nHighSeq;      // Highest queued sequence number
+    xbool_t bPlaying;
+} xjitter_stream_t;
+
+typedef struct XJitter {
+    xjitter_stream_t **pStreams;    // Open addressing table keyed by SSRC
+    size_t nTableSize;
+    size_t nMaxStreams;
+    size_t nStreams;
+    size_t nCursor;
+
+    /* Stream settings, can be changed before the first packet of the stream */
+    size_t nSlots;
+    size_t nSlotSize;
+    uint32_t nClockRate;
+    uint32_t nMinDelay;
+    uint32_t nMaxDelay;
+} xjitter_t;
+
+XSTATUS XJitter_Init(xjitter_t *pJitter, size_t nMaxStreams, size_t nSlots, uint32_t nClockRate);
+void XJitter_Destroy(xjitter_t *pJitter);
+
+xjitter_stream_t* XJitter_GetStream(xjitter_t *pJitter, uint32_t nSSRC);
+XSTATUS XJitter_Remove(xjitter_t *pJitter, uint32_t nSSRC);
+
+XSTATUS XJitter_Push(xjitter_t *pJitter, const uint8_t *pData, size_t nLength, uint64_t nNowMs);
+XSTATUS XJitter_Pop(xjitter_t *pJitter, uint64_t nNowMs, xjitter_packet_t *pPacket);
+XSTATUS XJitter_PopStream(xjitter_stream_t *pStream, uint64_t nNowMs, xjitter_packet_t *pPacket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XUTILS_JITTER_H__ */
@@ -92,6 +92,98 @@ static void XPacket_WriteU32LE(uint8_t *pData, uint32_t nValue)
     pData[3] = (uint8_t)((nValue >> 24) & 0xff);
 }
 
+static size_t XPacket_FieldLength(const char *pField, size_t nSize)
+{
+    size_t nLength = 0;
+    while (nLength < nSize - 1 && pField[nLength]) nLength++;
+    return nLength;
+}
+
+static size_t XPacket_WriteBinary(const xpacket_header_t *pHeader, uint8_t *pOutput)
+{
+    size_t nTypeLen = XPacket_FieldLength(pHeader->sPayloadType, sizeof(pHeader->sPayloadType));
+    size_t nTimeLen = XPacket_FieldLength(pHeader->sTime, sizeof(pHeader->sTime));
+    size_t nTZLen = XPacket_FieldLength(pHeader->sTZ, sizeof(pHeader->sTZ));
+
+    /* Fixed width part, strings follow in the same order as their lengths */
+    pOutput[0] = XPACKET_BIN_VERSION;
+    pOutput[1] = (uint8_t)pHeader->eType;
+    pOutput[2] = pHeader->bEncrypted ? XPACKET_BIN_ENCRYPTED : 0;
+    pOutput[3] = (uint8_t)nTypeLen;
+    pOutput[4] = (uint8_t)nTimeLen;
+    pOutput[5] = (uint8_t)nTZLen;
+    pOutput[6] = 0;
+    pOutput[7] = 0;
+
+    XPacket_WriteU32LE(&pOutput[8], pHeader->nPacketID);
+    XPacket_WriteU32LE(&pOutput[12], pHeader->nSessionID);
+    XPacket_WriteU32LE(&pOutput[16], pHeader->nTimeStamp);
+    XPacket_WriteU32LE(&pOutput[20], pHeader->nPayloadSize);
+    XPacket_WriteU32LE(&pOutput[24], pHeader->nSSRCHash);
+
+    size_t nOffset = XPACKET_BIN_HDR_SIZE;
+    memcpy(&pOutput[nOffset], pHeader->sPayloadType, nTypeLen);
+    nOffset += nTypeLen;
+
+    memcpy(&pOutput[nOffset], pHeader->sTime, nTimeLen);
+    nOffset += nTimeLen;
+
+    memcpy(&pOutput[nOffset], pHeader->sTZ, nTZLen);
+    return nOffset + nTZLen;
+}
+
+static xpacket_status_t XPacket_ReadBinary(xpacket_header_t *pHeader, const uint8_t *pInput, size_t nLength)
+{
+    if (nLength < XPACKET_BIN_HDR_SIZE ||
+        pInput[0] != XPACKET_BIN_VERSION ||
+        pInput[1] > XPACKET_TYPE_KA) return XPACKET_INVALID;
+
+    size_t nTypeLen = pInput[3];
+    size_t nTimeLen = pInput[4];
+    size_t nTZLen = pInput[5];
+
+    if (nTypeLen >= sizeof(pHeader->sPayloadType) ||
+        nTimeLen >= sizeof(pHeader->sTime) ||
+        nTZLen >= sizeof(pHeader->sTZ) ||
+        XPACKET_BIN_HDR_SIZE + nTypeLen + nTimeLen + nTZLen > nLength)
+        return XPACKET_INVALID;
+
+    pHeader->eType = (xpacket_type_t)pInput[1];
+    pHeader->bEncrypted = (pInput[2] & XPACKET_BIN_ENCRYPTED) ? XTRUE : XFALSE;
+    pHeader->nPacketID = XPacket_ReadU32LE(&pInput[8]);
+    pHeader->nSessionID = XPacket_ReadU32LE(&pInput[12]);
+    pHeader->nTimeStamp = XPacket_ReadU32LE(&pInput[16]);
+    pHeader->nPayloadSize = XPacket_ReadU32LE(&pInput[20]);
+    pHeader->nSSRCHash = XPacket_ReadU32LE(&pInput[24]);
+
+    /* Header is zeroed by the caller, so strings stay NUL terminated */
+    size_t nOffset = XPACKET_BIN_HDR_SIZE;
+    memcpy(pHeader->sPayloadType, &pInput[nOffset], nTypeLen);
+    nOffset += nTypeLen;
+
+    memcpy(pHeader->sTime, &pInput[nOffset], nTimeLen);
+    nOffset += nTimeLen;
+
+    memcpy(pHeader->sTZ, &pInput[nOffset], nTZLen);
+    return XPACKET_ERR_NONE;
+}
+
+static xpacket_status_t XPacket_Append(xbyte_buffer_t *pBuffer, uint32_t nInfo, const uint8_t *pHeader, size_t nHdrLen, const uint8_t *pData, size_t nSize)
+{
+    uint8_t sInfoBytes[XPACKET_INFO_BYTES];
+    XPacket_WriteU32LE(sInfoBytes, nInfo);
+    if (pData == NULL) nSize = 0;
+
+    /* Reserve the whole packet, so the buffer never holds a partial one */
+    size_t nPacketSize = XPACKET_INFO_BYTES + nHdrLen + nSize;
+    XCHECK_NL((XByteBuffer_Reserve(pBuffer, nPacketSize + 1) > 0), XPACKET_ERR_ALLOC);
+
+    XByteBuffer_Add(pBuffer, sInfoBytes, sizeof(sInfoBytes));
+    XByteBuffer_Add(pBuffer, pHeader, nHdrLen);
+    XByteBuffer_Add(pBuffer, pData, nSize);
+    return XPACKET_ERR_NONE;
+}
+
 void XPacket_Clear(xpacket_t *pPacket)
 {
     XCHECK_VOID_NL(pPacket);
@@ -241,6 +333,7 @@ xpacket_status_t XPacket_Init(xpacket_t *pPacket, uint8_t *pData, uint32_t nSize
     pPacket->nHeaderLength = 0;
     pPacket->nPacketSize = 0;
     pPacket->nAllocated = 0;
+    pPacket->bBinary = XFALSE;
     pPacket->pPayload = pData;
     pPacket->pUserData = NULL;
     pPacket->callback = NULL;
@@ -257,7 +350,7 @@ xpacket_t *XPacket_New(uint8_t *pData, uint32_t nSize)
     XCHECK(pPacket, NULL);
 
     xpacket_status_t nStatus = XPacket_Init(pPacket, pData, nSize);
-    XCHECK_CALL((nStatus != XPACKET_ERR_NONE), free, pPacket, NULL);
+    XCHECK_CALL((nStatus == XPACKET_ERR_NONE), free, pPacket, NULL);
 
     pPacket->nAllocated = 1;
     return pPacket;
@@ -267,87 +360,128 @@ xpacket_status_t XPacket_Create(xbyte_buffer_t *pBuffer, const char *pHeader, si
 {
     XCHECK((pBuffer != NULL), XPACKET_INVALID_ARGS);
     XCHECK((pHeader != NULL ), XPACKET_INVALID_ARGS);
-    XCHECK((nHdrLen > 0), XPACKET_INVALID_ARGS);
+    XCHECK((nHdrLen > 0 && nHdrLen < XPACKET_BINARY_FLAG), XPACKET_INVALID_ARGS);
 
-    uint8_t sInfoBytes[XPACKET_INFO_BYTES];
-    XPacket_WriteU32LE(sInfoBytes, (uint32_t)nHdrLen);
+    xpacket_status_t eStatus = XPacket_Append(pBuffer, (uint32_t)nHdrLen, (const uint8_t*)pHeader, nHdrLen, pData, nSize);
+    if (eStatus != XPACKET_ERR_NONE) XByteBuffer_Clear(pBuffer);
+    return eStatus;
+}
 
-    if ((!XByteBuffer_Add(pBuffer, sInfoBytes, sizeof(sInfoBytes))) ||
-        (!XByteBuffer_Add(pBuffer, (uint8_t*)pHeader, nHdrLen)) ||
-        (pData != NULL && nSize && !XByteBuffer_Add(pBuffer, pData, nSize)))
+xpacket_status_t XPacket_AssembleTo(xpacket_t *pPacket, xbyte_buffer_t *pBuffer)
+{
+    XCHECK((pPacket != NULL && pBuffer != NULL), XPACKET_INVALID_ARGS);
+    xpacket_header_t *pHeader = &pPacket->header;
+
+    if (pPacket->bBinary)
     {
-        XByteBuffer_Clear(pBuffer);
-        return XPACKET_ERR_ALLOC;
-    }
+        uint8_t sHeader[XPACKET_BIN_HDR_SIZE + XPACKET_TYPE_MAX + XPACKET_TIME_MAX + XPACKET_TZ_MAX];
+        if (pPacket->callback != NULL) pPacket->callback(pPacket, XPACKET_CB_UPDATE);
 
-    return XPACKET_ERR_NONE;
-}
+        if (pHeader->eType == XPACKET_TYPE_ERROR ||
+            pHeader->eType == XPACKET_TYPE_INVALID) return XPACKET_INVALID;
 
-xbyte_buffer_t *XPacket_Assemble(xpacket_t *pPacket)
-{
-    xpacket_status_t nStatus = XPacket_UpdateHeader(pPacket);
-    XCHECK((nStatus != XPACKET_ERR_NONE), NULL);
+        size_t nHdrLen = XPacket_WriteBinary(pHeader, sHeader);
+        uint32_t nInfo = XPACKET_BINARY_FLAG | (uint32_t)nHdrLen;
 
-    xpacket_header_t *pHeader = &pPacket->header;
-    xjson_writer_t jsonWriter;
+        return XPacket_Append(pBuffer, nInfo, sHeader, nHdrLen,
+                              pPacket->pPayload, pHeader->nPayloadSize);
+    }
 
+    xpacket_status_t eStatus = XPacket_UpdateHeader(pPacket);
+    if (eStatus != XPACKET_ERR_NONE) return eStatus;
+
+    xjson_writer_t jsonWriter;
     XJSON_InitWriter(&jsonWriter, NULL, NULL, XPACKET_HDR_INITIAL);
-    XByteBuffer_Reset(&pPacket->rawData);
 
-    if (XJSON_WriteObject(pPacket->pHeaderObj, &jsonWriter))
+    if (!XJSON_WriteObject(pPacket->pHeaderObj, &jsonWriter))
     {
-        xpacket_status_t nStatus = XPacket_Create(
-            &pPacket->rawData,
-            jsonWriter.pData,
-            jsonWriter.nLength,
-            pPacket->pPayload,
-            pHeader->nPayloadSize
-        );
-
-        XCHECK((nStatus == XPACKET_ERR_NONE), NULL);
-        pPacket->nHeaderLength = (uint32_t)jsonWriter.nLength;
-        XPacket_ParseHeader(&pPacket->header, pPacket->pHeaderObj);
+        XJSON_DestroyWriter(&jsonWriter);
+        return XPACKET_ERR_ALLOC;
     }
 
+    eStatus = XPacket_Append(pBuffer, (uint32_t)jsonWriter.nLength,
+                             (const uint8_t*)jsonWriter.pData, jsonWriter.nLength,
+                             pPacket->pPayload, pHeader->nPayloadSize);
+
     XJSON_DestroyWriter(&jsonWriter);
-    return &pPacket->rawData;
+    return eStatus;
 }
 
-xpacket_status_t XPacket_Parse(xpacket_t *pPacket, const uint8_t *pData, size_t nSize)
+xbyte_buffer_t *XPacket_Assemble(xpacket_t *pPacket)
 {
-    XCHECK((pPacket != NULL), XPACKET_INVALID_ARGS);
-    XCHECK((pData != NULL), XPACKET_INVALID_ARGS);
-    XCHECK((nSize > 0), XPACKET_INVALID_ARGS);
-    xpacket_header_t *pHdr = &pPacket->header;
+    XCHECK((pPacket != NULL), NULL);
+    XByteBuffer_Reset(&pPacket->rawData);
 
-    if (nSize < XPACKET_INFO_BYTES)
-    {
-        pHdr->eType = XPACKET_TYPE_INCOMPLETE;
-        return XPACKET_INCOMPLETE;
-    }
+    xpacket_status_t nStatus = XPacket_AssembleTo(pPacket, &pPacket->rawData);
+    XCHECK((nStatus == XPACKET_ERR_NONE), NULL);
 
-    pPacket->nHeaderLength = XPacket_ReadU32LE(pData);
-    if ((nSize - XPACKET_INFO_BYTES) < pPacket->nHeaderLength)
-    {
-        pHdr->eType = XPACKET_TYPE_INCOMPLETE;
-        return XPACKET_INCOMPLETE;
-    }
+    /* Info bytes carry the header length for both header formats */
+    uint32_t nInfo = XPacket_ReadU32LE(pPacket->rawData.pData);
+    pPacket->nHeaderLength = nInfo & ~XPACKET_BINARY_FLAG;
+    pPacket->nPacketSize = (uint32_t)pPacket->rawData.nUsed;
+
+    if (!pPacket->bBinary) XPacket_ParseHeader(&pPacket->header, pPacket->pHeaderObj);
+    return &pPacket->rawData;
+}
 
+static void XPacket_ResetParsed(xpacket_t *pPacket)
+{
+    xpacket_header_t *pHdr = &pPacket->header;
     memset(pHdr, 0, sizeof(xpacket_header_t));
-    pHdr->eType = XPACKET_TYPE_INVALID;
+    pHdr->eType = XPACKET_TYPE_INCOMPLETE;
 
     XByteBuffer_Init(&pPacket->rawData, XSTDNON, XFALSE);
     pPacket->pHeaderObj = NULL;
     pPacket->pPayload = NULL;
     pPacket->pUserData = NULL;
     pPacket->callback = NULL;
+    pPacket->nHeaderLength = 0;
     pPacket->nPacketSize = 0;
     pPacket->nAllocated = 0;
+    pPacket->bBinary = XFALSE;
+}
+
+xpacket_status_t XPacket_Parse(xpacket_t *pPacket, const uint8_t *pData, size_t nSize)
+{
+    XCHECK((pPacket != NULL), XPACKET_INVALID_ARGS);
+    XCHECK((pData != NULL), XPACKET_INVALID_ARGS);
+    XCHECK((nSize > 0), XPACKET_INVALID_ARGS);
+    xpacket_header_t *pHdr = &pPacket->header;
+
+    /* Packet is safe to clear even if it is incomplete */
+    XPacket_ResetParsed(pPacket);
+
+    if (nSize < XPACKET_INFO_BYTES) return XPACKET_INCOMPLETE;
+    uint32_t nInfo = XPacket_ReadU32LE(pData);
+    pPacket->nHeaderLength = nInfo & ~XPACKET_BINARY_FLAG;
+
+    if ((nSize - XPACKET_INFO_BYTES) < pPacket->nHeaderLength) return XPACKET_INCOMPLETE;
+    pHdr->eType = XPACKET_TYPE_INVALID;
 
     xstrncpy(pHdr->sVersion, sizeof(pHdr->sVersion), XPACKET_VERSION_STR);
     const char *pHeader = &((char*)pData)[XPACKET_INFO_BYTES];
 
-    if (pPacket->nHeaderLength > 0)
+    if (nInfo & XPACKET_BINARY_FLAG)
+    {
+        /* Fixed width fields, nothing to allocate */
+        xpacket_status_t eStatus = XPacket_ReadBinary(pHdr, (const uint8_t*)pHeader, pPacket->nHeaderLength);
+        if (eStatus != XPACKET_ERR_NONE) return eStatus;
+
+        size_t nPayloadOffset = XPACKET_INFO_BYTES + pPacket->nHeaderLength;
+        if (pHdr->nPayloadSize > UINT32_MAX - nPayloadOffset) return XPACKET_BIGDATA;
+
+        pPacket->nPacketSize = (uint32_t)nPayloadOffset + pHdr->nPayloadSize;
+        pPacket->bBinary = XTRUE;
+
+        if (nSize < pPacket->nPacketSize)
+        {
+            pHdr->eType = XPACKET_TYPE_INCOMPLETE;
+            return XPACKET_INCOMPLETE;
+        }
+
+        if (pHdr->nPayloadSize) pPacket->pPayload = (uint8_t*)&pData[nPayloadOffset];
+    }
+    else if (pPacket->nHeaderLength > 0)
     {
         xjson_t json;
         if (!XJSON_Parse(&json, NULL, pHeader, pPacket->nHeaderLength))
@@ -373,6 +507,11 @@ xpacket_status_t XPacket_Parse(xpacket_t *pPacket, const uint8_t *pData, size_t
         if (pHdr->nPayloadSize) pPacket->pPayload = (uint8_t*)&pData[nPayloadOffset];
         if (pPacket->callback != NULL) pPacket->callback(pPacket, XPACKET_CB_PARSED);
     }
+    else
+    {
+        /* Packet without header still consumes its info bytes */
+        pPacket->nPacketSize = XPACKET_INFO_BYTES;
+    }
 
     return XPACKET_COMPLETE;
 }
@@ -399,3 +538,29 @@ size_t XPacket_GetSize(xpacket_t *pPacket)
     if (pPacket == NULL) return XSTDNON;
     return pPacket->nPacketSize;
 }
+
+void XPacket_InitFramer(xpacket_framer_t *pFramer, const uint8_t *pData, size_t nSize)
+{
+    XCHECK_VOID_NL((pFramer != NULL));
+    pFramer->pData = pData;
+    pFramer->nSize = pData != NULL ? nSize : XSTDNON;
+    pFramer->nOffset = XSTDNON;
+}
+
+xpacket_status_t XPacket_NextFrame(xpacket_framer_t *pFramer, xpacket_t *pPacket)
+{
+    XCHECK((pFramer != NULL && pPacket != NULL), XPACKET_INVALID_ARGS);
+    size_t nLeft = pFramer->nSize - pFramer->nOffset;
+
+    if (!nLeft)
+    {
+        XPacket_ResetParsed(pPacket);
+        return XPACKET_INCOMPLETE;
+    }
+
+    const uint8_t *pData = &pFramer->pData[pFramer->nOffset];
+    xpacket_status_t eStatus = XPacket_Parse(pPacket, pData, nLeft);
+    if (eStatus == XPACKET_COMPLETE) pFramer->nOffset += XPacket_GetSize(pPacket);
+
+    return eStatus;
+}
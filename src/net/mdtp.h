@@ -19,6 +19,12 @@
 #define XPACKET_VERSION_STR     "1.0"
 #define XPACKET_INFO_BYTES      4
 
+/* High bit of the info bytes marks the compact binary header */
+#define XPACKET_BINARY_FLAG     0x80000000
+#define XPACKET_BIN_VERSION     1
+#define XPACKET_BIN_HDR_SIZE    28
+#define XPACKET_BIN_ENCRYPTED   0x01
+
 #define XPACKET_HDR_INITIAL     256
 #define XPACKET_PROTO_MAX       32
 #define XPACKET_TYPE_MAX        128
@@ -84,10 +90,17 @@ struct XPacket {
     uint32_t nHeaderLength;             // The length of raw packet header
     uint32_t nPacketSize;               // The size of whole packet
     uint8_t nAllocated;                 // Flag to check if packet is allocated
+    xbool_t bBinary;                    // Use compact binary header instead of JSON
     uint8_t *pPayload;                  // Payload pointed from original raw data
     void *pUserData;                    // User data pointer for packet extension
 };
 
+typedef struct XPacketFramer {
+    const uint8_t *pData;               // Stream data, not owned by the framer
+    size_t nSize;                       // Size of the stream data
+    size_t nOffset;                     // Bytes consumed by complete packets
+} xpacket_framer_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -106,8 +119,12 @@ xpacket_status_t XPacket_UpdateHeader(xpacket_t *pPacket);
 void XPacket_ParseHeader(xpacket_header_t *pHeader, xjson_obj_t *pHeaderObj);
 
 xpacket_status_t XPacket_Create(xbyte_buffer_t *pBuffer, const char *pHeader, size_t nHdrLen, uint8_t *pData, size_t nSize);
+xpacket_status_t XPacket_AssembleTo(xpacket_t *pPacket, xbyte_buffer_t *pBuffer);
 xbyte_buffer_t *XPacket_Assemble(xpacket_t *pPacket);
 
+void XPacket_InitFramer(xpacket_framer_t *pFramer, const uint8_t *pData, size_t nSize);
+xpacket_status_t XPacket_NextFrame(xpacket_framer_t *pFramer, xpacket_t *pPacket);
+
 const uint8_t *XPacket_GetHeader(xpacket_t *pPacket);
 const uint8_t *XPacket_GetPayload(xpacket_t *pPacket);
 size_t XPacket_GetSize(xpacket_t *pPacket);
@@ -0,0 +1,377 @@
+/*!
+ *  @file libxutils/src/net/router.c
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Implementation of the HTTP request router based on the
+ * compressed radix trie over the request path. Supports parameter
+ * captures like ":id" and trailing catch-all wildcards like "*path".
+ */
+
+#include "router.h"
+#include "str.h"
+
+typedef enum {
+    XROUTER_STATIC = 0,
+    XROUTER_PARAM,
+    XROUTER_WILDCARD
+} xrouter_node_type_t;
+
+struct XRouterNode {
+    /* Static children, indexed by the first byte of their label */
+    xrouter_node_t **pChildren;
+    char *pIndices;
+    uint16_t nChildren;
+
+    /* Capture children, at most one of each kind per node */
+    xrouter_node_t *pParam;
+    xrouter_node_t *pWildcard;
+
+    /* Route data per method, XHTTP_DUMMY slot matches any method */
+    void *pHandlers[XROUTER_METHODS];
+    char *pPattern;
+
+    /* Static path fragment or capture name */
+    char *pLabel;
+    size_t nLength;
+    uint8_t nType;
+};
+
+static xrouter_node_t* XRouter_NewNode(const char *pLabel, size_t nLength, uint8_t nType)
+{
+    xrouter_node_t *pNode = (xrouter_node_t*)calloc(1, sizeof(xrouter_node_t));
+    XCHECK_NL((pNode != NULL), NULL);
+
+    pNode->pLabel = (char*)malloc(nLength + 1);
+    if (pNode->pLabel == NULL)
+    {
+        free(pNode);
+        return NULL;
+    }
+
+    if (nLength) memcpy(pNode->pLabel, pLabel, nLength);
+    pNode->pLabel[nLength] = '\0';
+    pNode->nLength = nLength;
+    pNode->nType = nType;
+    return pNode;
+}
+
+static void XRouter_FreeNode(xrouter_t *pRouter, xrouter_node_t *pNode)
+{
+    XCHECK_VOID_NL((pNode != NULL));
+    uint16_t i;
+
+    for (i = 0; i < pNode->nChildren; i++)
+        XRouter_FreeNode(pRouter, pNode->pChildren[i]);
+
+    XRouter_FreeNode(pRouter, pNode->pParam);
+    XRouter_FreeNode(pRouter, pNode->pWildcard);
+
+    for (i = 0; i < XROUTER_METHODS; i++)
+    {
+        if (pNode->pHandlers[i] != NULL && pRouter->clearCb != NULL)
+            pRouter->clearCb(pRouter->pCtx, pNode->pHandlers[i]);
+    }
+
+    free(pNode->pChildren);
+    free(pNode->pIndices);
+    free(pNode->pPattern);
+    free(pNode->pLabel);
+    free(pNode);
+}
+
+static XSTATUS XRouter_AddChild(xrouter_node_t *pNode, xrouter_node_t *pChild)
+{
+    XCHECK((pNode->nChildren < UINT16_MAX), XSTDERR);
+    size_t nCount = (size_t)pNode->nChildren + 1;
+
+    xrouter_node_t **pChildren = (xrouter_node_t**)realloc(pNode->pChildren, nCount * sizeof(xrouter_node_t*));
+    XCHECK((pChildren != NULL), XSTDERR);
+    pNode->pChildren = pChildren;
+
+    char *pIndices = (char*)realloc(pNode->pIndices, nCount);
+    XCHECK((pIndices != NULL), XSTDERR);
+    pNode->pIndices = pIndices;
+
+    pNode->pChildren[pNode->nChildren] = pChild;
+    pNode->pIndices[pNode->nChildren] = pChild->pLabel[0];
+    pNode->nChildren++;
+
+    return XSTDOK;
+}
+
+static xrouter_node_t* XRouter_FindChild(const xrouter_node_t *pNode, char cFirst)
+{
+    XCHECK_NL(pNode->nChildren, NULL);
+    const char *pIndex = (const char*)memchr(pNode->pIndices, cFirst, pNode->nChildren);
+    return pIndex != NULL ? pNode->pChildren[pIndex - pNode->pIndices] : NULL;
+}
+
+static XSTATUS XRouter_Split(xrouter_node_t *pNode, size_t nCommon)
+{
+    /* Tail takes over the subtree, node keeps only the common prefix */
+    xrouter_node_t *pTail = XRouter_NewNode(&pNode->pLabel[nCommon], pNode->nLength - nCommon, XROUTER_STATIC);
+    XCHECK((pTail != NULL), XSTDERR);
+
+    xrouter_node_t **pChildren = (xrouter_node_t**)malloc(sizeof(xrouter_node_t*));
+    char *pIndices = (char*)malloc(sizeof(char));
+
+    if (pChildren == NULL || pIndices == NULL)
+    {
+        free(pChildren);
+        free(pIndices);
+        free(pTail->pLabel);
+        free(pTail);
+        return XSTDERR;
+    }
+
+    pTail->pChildren = pNode->pChildren;
+    pTail->pIndices = pNode->pIndices;
+    pTail->nChildren = pNode->nChildren;
+    pTail->pParam = pNode->pParam;
+    pTail->pWildcard = pNode->pWildcard;
+    pTail->pPattern = pNode->pPattern;
+    memcpy(pTail->pHandlers, pNode->pHandlers, sizeof(pNode->pHandlers));
+
+    memset(pNode->pHandlers, 0, sizeof(pNode->pHandlers));
+    pNode->pWildcard = NULL;
+    pNode->pPattern = NULL;
+    pNode->pParam = NULL;
+
+    pChildren[0] = pTail;
+    pIndices[0] = pTail->pLabel[0];
+    pNode->pChildren = pChildren;
+    pNode->pIndices = pIndices;
+    pNode->nChildren = 1;
+
+    pNode->pLabel[nCommon] = '\0';
+    pNode->nLength = nCommon;
+    return XSTDOK;
+}
+
+static xrouter_node_t* XRouter_InsertStatic(xrouter_node_t *pNode, const char *pText, size_t nLength)
+{
+    while (nLength > 0)
+    {
+        xrouter_node_t *pChild = XRouter_FindChild(pNode, pText[0]);
+        if (pChild == NULL)
+        {
+            pChild = XRouter_NewNode(pText, nLength, XROUTER_STATIC);
+            XCHECK_NL((pChild != NULL), NULL);
+
+            if (XRouter_AddChild(pNode, pChild) < 0)
+            {
+                free(pChild->pLabel);
+                free(pChild);
+                return NULL;
+            }
+
+            return pChild;
+        }
+
+        size_t nCommon = 1;
+        while (nCommon < pChild->nLength && nCommon < nLength &&
+               pChild->pLabel[nCommon] == pText[nCommon]) nCommon++;
+
+        if (nCommon < pChild->nLength &&
+            XRouter_Split(pChild, nCommon) < 0) return NULL;
+
+        pText += nCommon;
+        nLength -= nCommon;
+        pNode = pChild;
+    }
+
+    return pNode;
+}
+
+static xbool_t XRouter_IsCapture(const char *pPattern, const char *pPos)
+{
+    return ((*pPos == ':' || *pPos == '*') &&
+            pPos > pPattern && pPos[-1] == '/') ?
+                XTRUE : XFALSE;
+}
+
+void XRouter_Init(xrouter_t *pRouter, xrouter_clear_cb_t clearCb, void *pCtx)
+{
+    XCHECK_VOID_NL((pRouter != NULL));
+    pRouter->clearCb = clearCb;
+    pRouter->pCtx = pCtx;
+    pRouter->pRoot = NULL;
+    pRouter->nCount = 0;
+}
+
+void XRouter_Destroy(xrouter_t *pRouter)
+{
+    XCHECK_VOID_NL((pRouter != NULL));
+    XRouter_FreeNode(pRouter, pRouter->pRoot);
+    pRouter->pRoot = NULL;
+    pRouter->nCount = 0;
+}
+
+XSTATUS XRouter_Add(xrouter_t *pRouter, xhttp_method_t eMethod, const char *pPattern, void *pData)
+{
+    XCHECK((pRouter != NULL && pPattern != NULL && pData != NULL), XSTDINV);
+    XCHECK(((int)eMethod >= 0 && (int)eMethod < XROUTER_METHODS), XSTDINV);
+    XCHECK((pPattern[0] == '/'), XSTDINV);
+
+    if (pRouter->pRoot == NULL)
+    {
+        pRouter->pRoot = XRouter_NewNode(NULL, 0, XROUTER_STATIC);
+        XCHECK((pRouter->pRoot != NULL), XSTDERR);
+    }
+
+    xrouter_node_t *pNode = pRouter->pRoot;
+    const char *pPos = pPattern;
+    size_t nParams = 0;
+
+    while (*pPos)
+    {
+        const char *pEnd = pPos;
+        while (*pEnd && !XRouter_IsCapture(pPattern, pEnd)) pEnd++;
+
+        if (pEnd > pPos)
+        {
+            pNode = XRouter_InsertStatic(pNode, pPos, (size_t)(pEnd - pPos));
+            XCHECK((pNode != NULL), XSTDERR);
+
+            pPos = pEnd;
+            continue;
+        }
+
+        uint8_t nType = *pPos++ == ':' ? XROUTER_PARAM : XROUTER_WILDCARD;
+        const char *pName = pPos;
+        size_t nLength = strcspn(pName, "/");
+        pPos += nLength;
+
+        /* Parameters must be named, wildcard must be the last segment */
+        XCHECK((nType != XROUTER_PARAM || nLength), XSTDINV);
+        XCHECK((nType != XROUTER_WILDCARD || !*pPos), XSTDINV);
+        XCHECK((++nParams <= XROUTER_PARAMS_MAX), XSTDINV);
+
+        if (!nLength)
+        {
+            pName = "*";
+            nLength = 1;
+        }
+
+        xrouter_node_t **ppCapture = nType == XROUTER_PARAM ?
+                            &pNode->pParam : &pNode->pWildcard;
+
+        if (*ppCapture == NULL)
+        {
+            *ppCapture = XRouter_NewNode(pName, nLength, nType);
+            XCHECK((*ppCapture != NULL), XSTDERR);
+        }
+
+        /* Captures at the same position must have the same name */
+        XCHECK(((*ppCapture)->nLength == nLength &&
+            !strncmp((*ppCapture)->pLabel, pName, nLength)), XSTDEXC);
+
+        pNode = *ppCapture;
+    }
+
+    XCHECK((pNode->pHandlers[eMethod] == NULL), XSTDEXC);
+
+    if (pNode->pPattern == NULL)
+    {
+        pNode->pPattern = xstrdup(pPattern);
+        XCHECK((pNode->pPattern != NULL), XSTDERR);
+    }
+
+    pNode->pHandlers[eMethod] = pData;
+    pRouter->nCount++;
+    return XSTDOK;
+}
+
+static void* XRouter_GetHandler(const xrouter_node_t *pNode, xhttp_method_t eMethod)
+{
+    void *pData = pNode->pHandlers[eMethod];
+    return pData != NULL ? pData : pNode->pHandlers[XHTTP_DUMMY];
+}
+
+static xbool_t XRouter_Accept(const xrouter_node_t *pNode, void *pData, xrouter_match_t *pMatch)
+{
+    XCHECK_NL((pData != NULL), XFALSE);
+    pMatch->pPattern = pNode->pPattern;
+    pMatch->pData = pData;
+    return XTRUE;
+}
+
+static xbool_t XRouter_Match(const xrouter_node_t *pNode, xhttp_method_t eMethod, const char *pPath, size_t nLength, xrouter_match_t *pMatch)
+{
+    /* Static routes win over parameters, parameters win over wildcards */
+    if (!nLength && XRouter_Accept(pNode, XRouter_GetHandler(pNode, eMethod), pMatch)) return XTRUE;
+
+    if (nLength > 0)
+    {
+        const xrouter_node_t *pChild = XRouter_FindChild(pNode, pPath[0]);
+        if (pChild != NULL && pChild->nLength <= nLength &&
+            !memcmp(pChild->pLabel, pPath, pChild->nLength) &&
+            XRouter_Match(pChild, eMethod, &pPath[pChild->nLength],
+                          nLength - pChild->nLength, pMatch)) return XTRUE;
+
+        if (pNode->pParam != NULL && pPath[0] != '/' &&
+            pMatch->nCount < XROUTER_PARAMS_MAX)
+        {
+            size_t nSegment = 1;
+            while (nSegment < nLength && pPath[nSegment] != '/') nSegment++;
+
+            xrouter_param_t *pParam = &pMatch->params[pMatch->nCount++];
+            pParam->pName = pNode->pParam->pLabel;
+            pParam->nLength = nSegment;
+            pParam->pValue = pPath;
+
+            if (XRouter_Match(pNode->pParam, eMethod, &pPath[nSegment],
+                              nLength - nSegment, pMatch)) return XTRUE;
+
+            pMatch->nCount--;
+        }
+    }
+
+    if (pNode->pWildcard != NULL && pMatch->nCount < XROUTER_PARAMS_MAX &&
+        XRouter_Accept(pNode->pWildcard, XRouter_GetHandler(pNode->pWildcard, eMethod), pMatch))
+    {
+        xrouter_param_t *pParam = &pMatch->params[pMatch->nCount++];
+        pParam->pName = pNode->pWildcard->pLabel;
+        pParam->nLength = nLength;
+        pParam->pValue = pPath;
+        return XTRUE;
+    }
+
+    return XFALSE;
+}
+
+void* XRouter_Find(const xrouter_t *pRouter, xhttp_method_t eMethod, const char *pPath, xrouter_match_t *pMatch)
+{
+    XCHECK_NL((pRouter != NULL && pPath != NULL && pMatch != NULL), NULL);
+    pMatch->pPattern = NULL;
+    pMatch->pData = NULL;
+    pMatch->nCount = 0;
+
+    XCHECK_NL((pRouter->pRoot != NULL), NULL);
+    if ((int)eMethod < 0 || (int)eMethod >= XROUTER_METHODS) eMethod = XHTTP_DUMMY;
+
+    /* Query string and fragment are not part of the route */
+    size_t nLength = strcspn(pPath, "?#");
+    XRouter_Match(pRouter->pRoot, eMethod, pPath, nLength, pMatch);
+    return pMatch->pData;
+}
+
+const char* XRouter_GetParam(const xrouter_match_t *pMatch, const char *pName, size_t *pLength)
+{
+    XCHECK_NL((pMatch != NULL && pName != NULL), NULL);
+    size_t i;
+
+    for (i = 0; i < pMatch->nCount; i++)
+    {
+        const xrouter_param_t *pParam = &pMatch->params[i];
+        if (strcmp(pParam->pName, pName)) continue;
+
+        if (pLength != NULL) *pLength = pParam->nLength;
+        return pParam->pValue;
+    }
+
+    if (pLength != NULL) *pLength = 0;
+    return NULL;
+}
@@ -0,0 +1,59 @@
+/*!
+ *  @file libxutils/src/net/router.h
+ *
+ *  This source is part of "libxutils" project
+ *  2015-2024  Sun Dro (s.kalatoz@gmail.com)
+ *
+ * @brief Implementation of the HTTP request router based on the
+ * compressed radix trie over the request path. Supports parameter
+ * captures like ":id" and trailing catch-all wildcards like "*path".
+ */
+
+#ifndef __XUTILS_ROUTER_H__
+#define __XUTILS_ROUTER_H__
+
+#include "xstd.h"
+#include "http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define XROUTER_PARAMS_MAX      8
+#define XROUTER_METHODS         (XHTTP_HEAD + 1)
+
+typedef struct XRouterNode xrouter_node_t;
+typedef void(*xrouter_clear_cb_t)(void *pCtx, void *pData);
+
+typedef struct XRouterParam {
+    const char *pName;      // Parameter name, owned by the router
+    const char *pValue;     // Points into the matched path, not NUL terminated
+    size_t nLength;
+} xrouter_param_t;
+
+typedef struct XRouterMatch {
+    xrouter_param_t params[XROUTER_PARAMS_MAX];
+    const char *pPattern;   // Registered pattern of the matched route
+    void *pData;            // User data of the matched route
+    size_t nCount;
+} xrouter_match_t;
+
+typedef struct XRouter {
+    xrouter_clear_cb_t clearCb;
+    xrouter_node_t *pRoot;
+    void *pCtx;
+    size_t nCount;
+} xrouter_t;
+
+void XRouter_Init(xrouter_t *pRouter, xrouter_clear_cb_t clearCb, void *pCtx);
+void XRouter_Destroy(xrouter_t *pRouter);
+
+XSTATUS XRouter_Add(xrouter_t *pRouter, xhttp_method_t eMethod, const char *pPattern, void *pData);
+void* XRouter_Find(const xrouter_t *pRouter, xhttp_method_t eMethod, const char *pPath, xrouter_match_t *pMatch);
+const char* XRouter_GetParam(const xrouter_match_t *pMatch, const char *pName, size_t *pLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __XUTILS_ROUTER_H__ */
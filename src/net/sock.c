@@ -19,9 +19,28 @@ typedef SSIZE_T ssize_t;
 
 #include "sock.h"
 #include "sync.h"
+#include "sha256.h"
 #include "str.h"
 #include "xfs.h"
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <netinet/udp.h>
+
+/* Batched datagram syscalls, older headers may miss offload options */
+#if defined(MSG_WAITFORONE)
+#define XSOCK_USE_MMSG
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
 /*
   S.K. >> Note:
     Disable deprecated warnings for gethostbyaddr() function.
@@ -117,6 +136,27 @@ static uint32_t XFlags_Adjust(uint32_t nFlags)
 #ifdef XSOCK_USE_SSL
 static xatomic_t g_nSSLInit = 0;
 
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+/*
+    Every client connection creates its own SSL_CTX, so the internal
+    OpenSSL client cache never sees a second connection. Sessions are
+    collected by the new session callback into this process wide table,
+    keyed by server name (or peer address when there is no SNI) and port.
+    Table is small and the lock only guards a scan, so a spinlock is used.
+*/
+#define XSOCK_USE_SESSIONS
+
+typedef struct XSocketSession {
+    char sKey[XSOCK_INFO_MAX + 8];
+    SSL_SESSION *pSession;
+    uint64_t nStamp;
+} xsock_session_t;
+
+static xsock_session_t g_sessions[XSOCK_SESSION_MAX];
+static xatomic_t g_nSessionLock = 0;
+static uint64_t g_nSessionStamp = 0;
+#endif
+
 typedef struct XSocketPriv {
     xbool_t bConnected;
     void *pSSLCTX;
@@ -283,6 +323,7 @@ void XSock_DeinitSSL(void)
 {
 #ifdef XSOCK_USE_SSL
     if (!XSYNC_ATOMIC_GET(&g_nSSLInit)) return;
+    XSock_ClearSessions();
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
     EVP_cleanup();
@@ -640,6 +681,8 @@ const char* XSock_GetStatusStr(xsock_status_t eStatus)
             return "Failed to load PKCS12 file";
         case XSOCK_ERR_SSLCA:
             return "Can not set SSL CA file";
+        case XSOCK_ERR_SSLSES:
+            return "Can not setup SSL session resumption";
         case XSOCK_ERR_SSLINV:
             return "Invalid SSL object or context";
         case XSOCK_ERR_SSLNEW:
@@ -654,6 +697,8 @@ const char* XSock_GetStatusStr(xsock_status_t eStatus)
             return "Invalid SSL or SSL context";
         case XSOCK_ERR_SYSCALL:
             return "SSL operation failed in syscall";
+        case XSOCK_ERR_FILE:
+            return "Can not read data from the file";
         case XSOCK_WANT_READ:
             return "Wait for read event for non-blocking operation";
         case XSOCK_WANT_WRITE:
@@ -687,6 +732,7 @@ xbool_t XSock_IsSSLError(xsock_status_t eStatus)
             eStatus == XSOCK_ERR_PKCS12 ||
             eStatus == XSOCK_ERR_SSLKEY ||
             eStatus == XSOCK_ERR_SSLCRT ||
+            eStatus == XSOCK_ERR_SSLSES ||
             eStatus == XSOCK_ERR_SSLCA);
 }
 
@@ -1198,6 +1244,14 @@ int XSock_Write(xsock_t *pSock, const void *pData, size_t nLength)
     nBytes = XSock_Send(pSock, pData, nLength);
 #else
     nBytes = write(pSock->nFD, pData, nLength);
+    if (nBytes < 0 && XSock_IsNB(pSock) &&
+        (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        /* Socket buffer is full, wait for write event */
+        pSock->eStatus = XSOCK_WANT_WRITE;
+        return XSOCK_NONE;
+    }
+
     if (nBytes <= 0)
     {
         pSock->eStatus = XSOCK_ERR_WRITE;
@@ -1208,6 +1262,385 @@ int XSock_Write(xsock_t *pSock, const void *pData, size_t nLength)
     return nBytes;
 }
 
+int XSock_WriteV(xsock_t *pSock, const xsock_iov_t *pIov, size_t nCount)
+{
+    if (!XSock_Check(pSock)) return XSOCK_ERROR;
+    else if (!nCount || pIov == NULL) return XSOCK_NONE;
+
+#ifndef _WIN32
+    if (!XFLAGS_CHECK(pSock->nFlags, XSOCK_SSL))
+    {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+
+        msg.msg_iov = (struct iovec*)pIov;
+        msg.msg_iovlen = XSTD_MIN(nCount, XSOCK_IOV_MAX);
+
+        ssize_t nBytes = sendmsg(pSock->nFD, &msg, XMSG_NOSIGNAL);
+        if (nBytes < 0 && XSock_IsNB(pSock) &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            pSock->eStatus = XSOCK_WANT_WRITE;
+            return XSOCK_NONE;
+        }
+
+        if (nBytes <= 0)
+        {
+            pSock->eStatus = XSOCK_ERR_SEND;
+            XSock_Close(pSock);
+        }
+
+        return (int)nBytes;
+    }
+#endif
+
+    /* SSL records can not be gathered, write segments in order */
+    size_t i, nTotal = 0;
+
+    for (i = 0; i < nCount; i++)
+    {
+        /* Partial count keeps the WANT_READ/WANT_WRITE status of the stopped segment */
+        int nBytes = XSock_Write(pSock, pIov[i].iov_base, pIov[i].iov_len);
+        if (nBytes <= 0) return nTotal ? (int)nTotal : nBytes;
+
+        nTotal += (size_t)nBytes;
+        if ((size_t)nBytes < pIov[i].iov_len) break;
+    }
+
+    return (int)nTotal;
+}
+
+XSTATUS XSock_InitBatch(xsock_batch_t *pBatch, size_t nCount, size_t nSize)
+{
+    XCHECK_NL((pBatch != NULL && nCount && nSize), XSTDINV);
+    XCHECK_NL((nSize <= SIZE_MAX / nCount), XSTDINV);
+
+    pBatch->pPackets = (xsock_packet_t*)calloc(nCount, sizeof(xsock_packet_t));
+    pBatch->pBuffer = (uint8_t*)malloc(nCount * nSize);
+    pBatch->nCount = nCount;
+
+    if (pBatch->pPackets == NULL || pBatch->pBuffer == NULL)
+    {
+        XSock_ClearBatch(pBatch);
+        return XSTDERR;
+    }
+
+    size_t i;
+    for (i = 0; i < nCount; i++)
+    {
+        pBatch->pPackets[i].pData = pBatch->pBuffer + i * nSize;
+        pBatch->pPackets[i].nSize = nSize;
+    }
+
+    return XSTDOK;
+}
+
+void XSock_ClearBatch(xsock_batch_t *pBatch)
+{
+    XCHECK_VOID_NL(pBatch);
+    free(pBatch->pPackets);
+    free(pBatch->pBuffer);
+
+    pBatch->pPackets = NULL;
+    pBatch->pBuffer = NULL;
+    pBatch->nCount = 0;
+}
+
+static int XSock_BatchFailed(xsock_t *pSock, xsock_status_t eWant, xsock_status_t eError)
+{
+    if (XSock_IsNB(pSock) && XSOCK_WOULDBLOCK(XSOCK_ERRNO()))
+    {
+        pSock->eStatus = eWant;
+        return XSOCK_NONE;
+    }
+
+    pSock->eStatus = eError;
+    XSock_Close(pSock);
+    return XSOCK_ERROR;
+}
+
+#ifdef XSOCK_USE_MMSG
+typedef union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+} xsock_cmsg_t;
+
+static uint16_t XSock_GetSegment(struct msghdr *pHdr)
+{
+    struct cmsghdr *pCmsg = CMSG_FIRSTHDR(pHdr);
+
+    for (; pCmsg != NULL; pCmsg = CMSG_NXTHDR(pHdr, pCmsg))
+    {
+        if (pCmsg->cmsg_level == SOL_UDP && pCmsg->cmsg_type == UDP_GRO)
+        {
+            int nSegment = 0;
+            memcpy(&nSegment, CMSG_DATA(pCmsg), sizeof(nSegment));
+            return (uint16_t)nSegment;
+        }
+    }
+
+    return 0;
+}
+
+static void XSock_SetSegment(struct msghdr *pHdr, xsock_cmsg_t *pCmsgBuf, uint16_t nSegment)
+{
+    pHdr->msg_control = pCmsgBuf->buffer;
+    pHdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+    struct cmsghdr *pCmsg = CMSG_FIRSTHDR(pHdr);
+    pCmsg->cmsg_level = SOL_UDP;
+    pCmsg->cmsg_type = UDP_SEGMENT;
+    pCmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(pCmsg), &nSegment, sizeof(nSegment));
+}
+#else
+static int XSock_SendSegments(xsock_t *pSock, const xsock_packet_t *pPacket, const xsockaddr_t *pAddr, xsocklen_t nAddrLen)
+{
+    size_t nSegment = pPacket->nSegment ? pPacket->nSegment : pPacket->nLength;
+    size_t nOffset = 0;
+
+    /* No segmentation offload, send every segment as a datagram */
+    do
+    {
+        size_t nLength = XSTD_MIN(nSegment, pPacket->nLength - nOffset);
+        const char *pData = (const char*)pPacket->pData + nOffset;
+
+        int nSent = sendto(pSock->nFD, pData, (int)nLength, XMSG_NOSIGNAL, pAddr, nAddrLen);
+        if (nSent < 0) return XSOCK_ERROR;
+
+        nOffset += nLength;
+    }
+    while (nOffset < pPacket->nLength);
+
+    return XSOCK_SUCCESS;
+}
+#endif
+
+int XSock_RecvBatch(xsock_t *pSock, xsock_packet_t *pPackets, size_t nCount)
+{
+    if (!XSock_Check(pSock)) return XSOCK_ERROR;
+    else if (!nCount || pPackets == NULL) return XSOCK_NONE;
+
+    nCount = XSTD_MIN(nCount, XSOCK_BATCH_MAX);
+    size_t i;
+
+#ifdef XSOCK_USE_MMSG
+    struct mmsghdr msgs[XSOCK_BATCH_MAX];
+    xsock_cmsg_t cmsgs[XSOCK_BATCH_MAX];
+    struct iovec iovs[XSOCK_BATCH_MAX];
+    memset(msgs, 0, sizeof(struct mmsghdr) * nCount);
+
+    for (i = 0; i < nCount; i++)
+    {
+        struct msghdr *pHdr = &msgs[i].msg_hdr;
+        iovs[i].iov_base = pPackets[i].pData;
+        iovs[i].iov_len = pPackets[i].nSize;
+
+        pHdr->msg_name = &pPackets[i].addr;
+        pHdr->msg_namelen = sizeof(pPackets[i].addr);
+        pHdr->msg_control = cmsgs[i].buffer;
+        pHdr->msg_controllen = sizeof(cmsgs[i].buffer);
+        pHdr->msg_iov = &iovs[i];
+        pHdr->msg_iovlen = 1;
+    }
+
+    int nReceived;
+    do nReceived = recvmmsg(pSock->nFD, msgs, (unsigned int)nCount, MSG_WAITFORONE, NULL);
+    while (nReceived < 0 && errno == EINTR);
+
+    if (nReceived < 0)
+        return XSock_BatchFailed(pSock, XSOCK_WANT_READ, XSOCK_ERR_RECV);
+
+    for (i = 0; i < (size_t)nReceived; i++)
+    {
+        xsock_packet_t *pPacket = &pPackets[i];
+        pPacket->nLength = msgs[i].msg_len;
+        pPacket->nSegment = XSock_GetSegment(&msgs[i].msg_hdr);
+        pPacket->bTruncated = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? XTRUE : XFALSE;
+    }
+
+    return nReceived;
+#else
+    /* Blocking socket without MSG_DONTWAIT could wait for the second datagram */
+    if (!XMSG_DONTWAIT && !XSock_IsNB(pSock)) nCount = 1;
+
+    for (i = 0; i < nCount; i++)
+    {
+        xsock_packet_t *pPacket = &pPackets[i];
+        xsocklen_t nAddrLen = sizeof(pPacket->addr);
+        int nFlags = i ? XMSG_DONTWAIT : 0;
+
+        int nBytes = recvfrom(pSock->nFD, (char*)pPacket->pData, (int)pPacket->nSize,
+                              nFlags, (xsockaddr_t*)&pPacket->addr, &nAddrLen);
+
+        if (nBytes < 0)
+        {
+            if (i) break;
+            return XSock_BatchFailed(pSock, XSOCK_WANT_READ, XSOCK_ERR_RECV);
+        }
+
+        pPacket->nLength = (size_t)nBytes;
+        pPacket->bTruncated = XFALSE;
+        pPacket->nSegment = 0;
+    }
+
+    return (int)i;
+#endif
+}
+
+int XSock_SendBatch(xsock_t *pSock, const xsock_packet_t *pPackets, size_t nCount)
+{
+    if (!XSock_Check(pSock)) return XSOCK_ERROR;
+    else if (!nCount || pPackets == NULL) return XSOCK_NONE;
+
+    /* Connected sockets send to the peer, others to the socket address */
+    xbool_t bConnected = XFLAGS_CHECK(pSock->nFlags, XSOCK_CLIENT);
+    xsockaddr_t *pSockAddr = bConnected ? NULL : XSock_GetSockAddr(pSock);
+    xsocklen_t nSockAddrLen = bConnected ? 0 : XSock_GetAddrLen(pSock);
+
+    nCount = XSTD_MIN(nCount, XSOCK_BATCH_MAX);
+    size_t i;
+
+#ifdef XSOCK_USE_MMSG
+    struct mmsghdr msgs[XSOCK_BATCH_MAX];
+    xsock_cmsg_t cmsgs[XSOCK_BATCH_MAX];
+    struct iovec iovs[XSOCK_BATCH_MAX];
+    memset(msgs, 0, sizeof(struct mmsghdr) * nCount);
+
+    for (i = 0; i < nCount; i++)
+    {
+        const xsock_packet_t *pPacket = &pPackets[i];
+        struct msghdr *pHdr = &msgs[i].msg_hdr;
+
+        iovs[i].iov_base = pPacket->pData;
+        iovs[i].iov_len = pPacket->nLength;
+        pHdr->msg_iov = &iovs[i];
+        pHdr->msg_iovlen = 1;
+
+        if (pPacket->addr.sin_family == AF_INET)
+        {
+            pHdr->msg_name = (void*)&pPacket->addr;
+            pHdr->msg_namelen = sizeof(pPacket->addr);
+        }
+        else
+        {
+            pHdr->msg_name = pSockAddr;
+            pHdr->msg_namelen = nSockAddrLen;
+        }
+
+        if (pPacket->nSegment && pPacket->nLength > pPacket->nSegment)
+            XSock_SetSegment(pHdr, &cmsgs[i], pPacket->nSegment);
+    }
+
+    int nSent;
+    do nSent = sendmmsg(pSock->nFD, msgs, (unsigned int)nCount, XMSG_NOSIGNAL);
+    while (nSent < 0 && errno == EINTR);
+
+    if (nSent < 0) return XSock_BatchFailed(pSock, XSOCK_WANT_WRITE, XSOCK_ERR_SEND);
+    return nSent;
+#else
+    for (i = 0; i < nCount; i++)
+    {
+        const xsock_packet_t *pPacket = &pPackets[i];
+        const xsockaddr_t *pAddr = (const xsockaddr_t*)&pPacket->addr;
+        xsocklen_t nAddrLen = sizeof(pPacket->addr);
+
+        if (pPacket->addr.sin_family != AF_INET)
+        {
+            pAddr = pSockAddr;
+            nAddrLen = nSockAddrLen;
+        }
+
+        if (XSock_SendSegments(pSock, pPacket, pAddr, nAddrLen) < 0)
+        {
+            if (i) break;
+            return XSock_BatchFailed(pSock, XSOCK_WANT_WRITE, XSOCK_ERR_SEND);
+        }
+    }
+
+    return (int)i;
+#endif
+}
+
+static int XSock_ReadFile(int nFD, uint8_t *pData, size_t nSize, uint64_t nOffset)
+{
+#ifdef _WIN32
+    if (_lseeki64(nFD, (__int64)nOffset, SEEK_SET) < 0) return XSTDERR;
+    return _read(nFD, pData, (unsigned int)nSize);
+#else
+    return (int)pread(nFD, pData, nSize, (off_t)nOffset);
+#endif
+}
+
+static int XSock_CopyFile(xsock_t *pSock, int nFD, uint64_t nOffset, size_t nLength)
+{
+    uint8_t buffer[XSOCK_FILE_CHUNK];
+    size_t nTotal = 0;
+
+    /*
+        Chunk boundaries only depend on the offset and the remaining
+        length, so a retry after SSL_ERROR_WANT_WRITE reads back the
+        same record content which is what SSL_write() requires.
+    */
+    while (nTotal < nLength)
+    {
+        size_t nChunk = XSOCK_MIN(nLength - nTotal, sizeof(buffer));
+        int nRead = XSock_ReadFile(nFD, buffer, nChunk, nOffset + nTotal);
+
+        if (nRead <= 0)
+        {
+            pSock->eStatus = XSOCK_ERR_FILE;
+            XSock_Close(pSock);
+            return XSOCK_ERROR;
+        }
+
+        int nBytes = XSock_Write(pSock, buffer, (size_t)nRead);
+        if (nBytes <= 0) return nTotal ? (int)nTotal : nBytes;
+
+        nTotal += (size_t)nBytes;
+        if (nBytes < nRead) break;
+    }
+
+    return (int)nTotal;
+}
+
+int XSock_SendFile(xsock_t *pSock, int nFD, uint64_t nOffset, size_t nLength)
+{
+    if (!XSock_Check(pSock)) return XSOCK_ERROR;
+    else if (!nLength || nFD < 0) return XSOCK_NONE;
+
+    /* Limit single call to keep other sessions of the event loop responsive */
+    nLength = XSOCK_MIN(nLength, XSOCK_FILE_MAX);
+
+#ifdef __linux__
+    if (!XFLAGS_CHECK(pSock->nFlags, XSOCK_SSL))
+    {
+        off_t nPosit = (off_t)nOffset;
+        ssize_t nBytes = sendfile(pSock->nFD, nFD, &nPosit, nLength);
+
+        if (nBytes < 0 && XSock_IsNB(pSock) &&
+            (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            pSock->eStatus = XSOCK_WANT_WRITE;
+            return XSOCK_NONE;
+        }
+
+        if (nBytes <= 0)
+        {
+            /* Zero means that the file is shorter than expected */
+            pSock->eStatus = nBytes ? XSOCK_ERR_SEND : XSOCK_ERR_FILE;
+            XSock_Close(pSock);
+            return XSOCK_ERROR;
+        }
+
+        return (int)nBytes;
+    }
+#endif
+
+    /* SSL records must be encrypted in user space */
+    return XSock_CopyFile(pSock, nFD, nOffset, nLength);
+}
+
 int XSock_WriteBuff(xsock_t *pSock, xbyte_buffer_t *pBuffer)
 {
     if (pBuffer == NULL) return XSOCK_NONE;
@@ -1571,6 +2004,27 @@ XSOCKET XSock_ReuseAddr(xsock_t *pSock, xbool_t nEnabled)
     return pSock->nFD;
 }
 
+XSOCKET XSock_ReusePort(xsock_t *pSock, xbool_t nEnabled)
+{
+    if (!XSock_Check(pSock)) return XSOCK_INVALID;
+
+#ifdef SO_REUSEPORT
+    unsigned int nOpt = (unsigned int)nEnabled;
+
+    if (setsockopt(pSock->nFD, SOL_SOCKET, SO_REUSEPORT, (char*)&nOpt, sizeof(nOpt)) < 0)
+    {
+        pSock->eStatus = XSOCK_ERR_SETOPT;
+        XSock_Close(pSock);
+    }
+#else
+    (void)nEnabled;
+    pSock->eStatus = XSOCK_ERR_SUPPORT;
+    XSock_Close(pSock);
+#endif
+
+    return pSock->nFD;
+}
+
 XSOCKET XSock_Linger(xsock_t *pSock, int nSec)
 {
     if (!XSock_Check(pSock)) return XSOCK_INVALID;
@@ -1619,6 +2073,27 @@ XSOCKET XSock_NoDelay(xsock_t *pSock, xbool_t nEnabled)
     return pSock->nFD;
 }
 
+XSOCKET XSock_SetGRO(xsock_t *pSock, xbool_t nEnabled)
+{
+    if (!XSock_Check(pSock)) return XSOCK_INVALID;
+
+#ifdef __linux__
+    int nOpt = (int)nEnabled;
+
+    if (setsockopt(pSock->nFD, SOL_UDP, UDP_GRO, (char*)&nOpt, sizeof(nOpt)) < 0)
+    {
+        pSock->eStatus = XSOCK_ERR_SETOPT;
+        XSock_Close(pSock);
+    }
+#else
+    (void)nEnabled;
+    pSock->eStatus = XSOCK_ERR_SUPPORT;
+    XSock_Close(pSock);
+#endif
+
+    return pSock->nFD;
+}
+
 XSOCKET XSock_Bind(xsock_t *pSock)
 {
     char sUnixTmpPath[sizeof(pSock->sockAddr.unAddr.sun_path)] = { 0 };
@@ -1733,6 +2208,62 @@ XSTATUS XSock_LoadPKCS12(xsock_ssl_cert_t *pCert, const char *p12Path, const cha
     return XSOCK_NONE;
 }
 
+#ifdef XSOCK_USE_SSL
+static void XSock_DeriveTicketKeys(const uint8_t *pSecret, size_t nLength, uint8_t *pKeys, size_t nSize)
+{
+    uint8_t nCounter = 0;
+    size_t nDone = 0;
+
+    /* Expand the secret to key name, HMAC and AES keys of the ticket */
+    while (nDone < nSize)
+    {
+        uint8_t digest[XSHA256_DIGEST_SIZE];
+        xsha256_t xsha;
+
+        XSHA256_Init(&xsha);
+        XSHA256_Update(&xsha, &nCounter, sizeof(nCounter));
+        XSHA256_Update(&xsha, pSecret, nLength);
+        XSHA256_Final(&xsha, digest);
+
+        size_t nCopy = nSize - nDone;
+        if (nCopy > sizeof(digest)) nCopy = sizeof(digest);
+        memcpy(pKeys + nDone, digest, nCopy);
+
+        nDone += nCopy;
+        nCounter++;
+    }
+}
+
+static XSTATUS XSock_SetupSessions(SSL_CTX *pSSLCtx, xsock_cert_t *pCert)
+{
+    /* Resumption is refused without context when client certs are verified */
+    static const uint8_t sContext[] = "libxutils";
+    if (!SSL_CTX_set_session_id_context(pSSLCtx, sContext, sizeof(sContext) - 1)) return XSTDERR;
+
+    if (pCert->nSessionCache < 0) SSL_CTX_set_session_cache_mode(pSSLCtx, SSL_SESS_CACHE_OFF);
+    else if (pCert->nSessionCache > 0) SSL_CTX_sess_set_cache_size(pSSLCtx, pCert->nSessionCache);
+
+    if (pCert->nSessionTimeout > 0) SSL_CTX_set_timeout(pSSLCtx, pCert->nSessionTimeout);
+    XCHECK_NL((pCert->pTicketKey != NULL), XSTDOK);
+    XCHECK_NL((pCert->nTicketKeyLen >= XSOCK_TICKET_MIN), XSTDERR);
+
+#ifdef SSL_CTRL_SET_TLSEXT_TICKET_KEYS
+    /* Listeners with the same secret decrypt tickets issued by each other */
+    uint8_t keys[XSHA256_DIGEST_SIZE * 4];
+    long nLength = SSL_CTX_get_tlsext_ticket_keys(pSSLCtx, NULL, 0);
+    XCHECK_NL((nLength > 0 && (size_t)nLength <= sizeof(keys)), XSTDERR);
+
+    XSock_DeriveTicketKeys(pCert->pTicketKey, pCert->nTicketKeyLen, keys, (size_t)nLength);
+    int nStatus = (int)SSL_CTX_set_tlsext_ticket_keys(pSSLCtx, keys, nLength);
+
+    memset(keys, 0, sizeof(keys));
+    return nStatus > 0 ? XSTDOK : XSTDERR;
+#else
+    return XSTDERR;
+#endif
+}
+#endif
+
 void XSock_InitCert(xsock_cert_t *pCert)
 {
     pCert->pCertPath = NULL;
@@ -1742,6 +2273,10 @@ void XSock_InitCert(xsock_cert_t *pCert)
     pCert->p12Path = NULL;
     pCert->p12Pass = NULL;
     pCert->nVerifyFlags = 0;
+    pCert->pTicketKey = NULL;
+    pCert->nTicketKeyLen = 0;
+    pCert->nSessionCache = 0;
+    pCert->nSessionTimeout = 0;
 }
 
 XSOCKET XSock_SetSSLCert(xsock_t *pSock, xsock_cert_t *pCert)
@@ -1855,6 +2390,14 @@ XSOCKET XSock_SetSSLCert(xsock_t *pSock, xsock_cert_t *pCert)
         }
     }
 
+    if (XFLAGS_CHECK(pSock->nFlags, XSOCK_SERVER) &&
+        XSock_SetupSessions(pSSLCtx, pCert) < 0)
+    {
+        pSock->eStatus = XSOCK_ERR_SSLSES;
+        XSock_Close(pSock);
+        return XSOCK_INVALID;
+    }
+
     return pSock->nFD;
 #else
     (void)pCert;
@@ -1908,6 +2451,42 @@ XSOCKET XSock_SSLConnect(xsock_t *pSock)
     return XSOCK_INVALID;
 }
 
+XSTATUS XSock_CheckConnect(xsock_t *pSock)
+{
+    if (!XSock_Check(pSock)) return XSOCK_ERROR;
+    xbool_t bHandshake = XFALSE;
+
+#ifdef XSOCK_USE_SSL
+    bHandshake = XSock_GetSSL(pSock) != NULL;
+#endif
+
+    if (!bHandshake)
+    {
+        xsocklen_t nLength = sizeof(int);
+        int nError = 0;
+
+        if (getsockopt(pSock->nFD, SOL_SOCKET, SO_ERROR, (char*)&nError, &nLength) < 0 || nError)
+        {
+            pSock->eStatus = XSOCK_ERR_CONNECT;
+            XSock_Close(pSock);
+            return XSOCK_ERROR;
+        }
+
+        pSock->eStatus = XSOCK_ERR_NONE;
+        if (!XFLAGS_CHECK(pSock->nFlags, XSOCK_SSL)) return XSOCK_SUCCESS;
+        if (XSock_InitSSLClient(pSock, pSock->sName) == XSOCK_INVALID) return XSOCK_ERROR;
+    }
+    else
+    {
+        pSock->eStatus = XSOCK_ERR_NONE;
+        if (XSock_SSLConnect(pSock) == XSOCK_INVALID) return XSOCK_ERROR;
+    }
+
+    return (pSock->eStatus == XSOCK_WANT_READ ||
+            pSock->eStatus == XSOCK_WANT_WRITE) ?
+                XSOCK_NONE : XSOCK_SUCCESS;
+}
+
 XSOCKET XSock_SSLAccept(xsock_t *pSock)
 {
 #ifdef XSOCK_USE_SSL
@@ -2017,6 +2596,118 @@ static void XSock_LoadWinRootCerts(SSL_CTX *pSSLCtx)
 }
 #endif /* _WIN32 && XSOCK_USE_SSL */
 
+#ifdef XSOCK_USE_SESSIONS
+static void XSock_LockSessions(void)
+{
+    while (XSYNC_ATOMIC_SET(&g_nSessionLock, 1));
+}
+
+static void XSock_UnlockSessions(void)
+{
+    /* Release barrier, cache stores are visible before the lock is free */
+    XSYNC_ATOMIC_RELEASE(&g_nSessionLock);
+}
+
+static size_t XSock_GetSessionKey(SSL *pSSL, char *pKey, size_t nSize)
+{
+    struct sockaddr_in peerAddr;
+    xsocklen_t nLength = sizeof(peerAddr);
+
+    XSOCKET nFD = (XSOCKET)SSL_get_fd(pSSL);
+    if (getpeername(nFD, (struct sockaddr*)&peerAddr, &nLength) < 0 ||
+        peerAddr.sin_family != AF_INET) return XSTDNON;
+
+    uint16_t nPort = ntohs(peerAddr.sin_port);
+    const char *pName = SSL_get_servername(pSSL, TLSEXT_NAMETYPE_host_name);
+    if (xstrused(pName)) return xstrncpyf(pKey, nSize, "%s:%u", pName, nPort);
+
+    char sAddr[XSOCK_ADDR_MAX];
+    XSock_SinAddr(peerAddr.sin_addr, sAddr, sizeof(sAddr));
+    return xstrncpyf(pKey, nSize, "%s:%u", sAddr, nPort);
+}
+
+static int XSock_NewSessionCb(SSL *pSSL, SSL_SESSION *pSession)
+{
+    char sKey[XSOCK_INFO_MAX + 8];
+    if (!XSock_GetSessionKey(pSSL, sKey, sizeof(sKey))) return 0;
+
+    XSock_LockSessions();
+    xsock_session_t *pSlot = &g_sessions[0];
+    size_t i;
+
+    /* Replace the session of the same host or the least recently stored */
+    for (i = 0; i < XSOCK_SESSION_MAX; i++)
+    {
+        xsock_session_t *pEntry = &g_sessions[i];
+        if (pEntry->pSession != NULL && !strcmp(pEntry->sKey, sKey)) { pSlot = pEntry; break; }
+        if (pEntry->nStamp < pSlot->nStamp) pSlot = pEntry;
+    }
+
+    SSL_SESSION *pOld = pSlot->pSession;
+    xstrncpy(pSlot->sKey, sizeof(pSlot->sKey), sKey);
+    pSlot->nStamp = ++g_nSessionStamp;
+    pSlot->pSession = pSession;
+    XSock_UnlockSessions();
+
+    if (pOld != NULL) SSL_SESSION_free(pOld);
+    return 1;
+}
+
+static void XSock_ResumeSession(SSL *pSSL)
+{
+    char sKey[XSOCK_INFO_MAX + 8];
+    if (!XSock_GetSessionKey(pSSL, sKey, sizeof(sKey))) return;
+
+    SSL_SESSION *pSession = NULL;
+    size_t i;
+
+    XSock_LockSessions();
+    for (i = 0; i < XSOCK_SESSION_MAX; i++)
+    {
+        xsock_session_t *pEntry = &g_sessions[i];
+        if (pEntry->pSession == NULL || strcmp(pEntry->sKey, sKey)) continue;
+        pSession = pEntry->pSession;
+
+        /* TLS 1.3 tickets are single use, take it out of the table */
+        if (SSL_SESSION_get_protocol_version(pSession) >= TLS1_3_VERSION)
+        {
+            pEntry->pSession = NULL;
+            pEntry->nStamp = 0;
+        }
+        else SSL_SESSION_up_ref(pSession);
+        break;
+    }
+    XSock_UnlockSessions();
+
+    XCHECK_VOID_NL((pSession != NULL));
+    long nAge = (long)time(NULL) - (long)SSL_SESSION_get_time(pSession);
+
+    if (SSL_SESSION_is_resumable(pSession) &&
+        nAge < (long)SSL_SESSION_get_timeout(pSession))
+        SSL_set_session(pSSL, pSession);
+
+    SSL_SESSION_free(pSession);
+}
+#endif
+
+void XSock_ClearSessions(void)
+{
+#ifdef XSOCK_USE_SESSIONS
+    size_t i;
+    XSock_LockSessions();
+
+    for (i = 0; i < XSOCK_SESSION_MAX; i++)
+    {
+        xsock_session_t *pEntry = &g_sessions[i];
+        if (pEntry->pSession != NULL) SSL_SESSION_free(pEntry->pSession);
+        pEntry->pSession = NULL;
+        pEntry->nStamp = 0;
+    }
+
+    XSock_UnlockSessions();
+#endif
+}
+
 XSOCKET XSock_InitSSLClient(xsock_t *pSock, const char *pAddr)
 {
 #ifdef XSOCK_USE_SSL
@@ -2049,6 +2740,15 @@ XSOCKET XSock_InitSSLClient(xsock_t *pSock, const char *pAddr)
     SSL_CTX_set_verify(pSSLCtx, SSL_VERIFY_NONE, NULL);
 #endif
 
+#ifdef XSOCK_USE_SESSIONS
+    xbool_t bSessions = !XFLAGS_CHECK(pSock->nFlags, XSOCK_NOCACHE);
+    if (bSessions)
+    {
+        SSL_CTX_set_session_cache_mode(pSSLCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(pSSLCtx, XSock_NewSessionCb);
+    }
+#endif
+
     SSL *pSSL = SSL_new(pSSLCtx);
     if (pSSL == NULL)
     {
@@ -2110,6 +2810,10 @@ XSOCKET XSock_InitSSLClient(xsock_t *pSock, const char *pAddr)
     SSL_set_options(pSSL, nOpts);
 #endif
 
+#ifdef XSOCK_USE_SESSIONS
+    if (bSessions) XSock_ResumeSession(pSSL);
+#endif
+
     XCHECK_CALL2((XSock_SetSSLCTX(pSock, pSSLCtx) >= 0),
         SSL_free, pSSL, SSL_CTX_free, pSSLCtx, XSOCK_INVALID);
 
@@ -2148,14 +2852,29 @@ static XSOCKET XSock_SetupStream(xsock_t *pSock, const char *pAddr, size_t nFdMa
         xsockaddr_t* pSockAddr = XSock_GetSockAddr(pSock);
         xsocklen_t nAddrLen = XSock_GetAddrLen(pSock);
 
+        xbool_t bAsync = XFLAGS_CHECK(pSock->nFlags, XSOCK_ASYNC);
+
         if (connect(pSock->nFD, pSockAddr, nAddrLen) < 0)
         {
+#ifdef _WIN32
+            xbool_t bPending = WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+            xbool_t bPending = errno == EINPROGRESS;
+#endif
+            if (bAsync && bPending)
+            {
+                /* Completion is reported by the write readiness */
+                pSock->eStatus = XSOCK_WANT_WRITE;
+                return pSock->nFD;
+            }
+
             pSock->eStatus = XSOCK_ERR_CONNECT;
             XSock_Close(pSock);
             return XSOCK_INVALID;
         }
 
-        if (XFLAGS_CHECK(pSock->nFlags, XSOCK_SSL))
+        /* Handshake of the async socket is done by XSock_CheckConnect() */
+        if (XFLAGS_CHECK(pSock->nFlags, XSOCK_SSL) && !bAsync)
             XSock_InitSSLClient(pSock, pSock->sName);
     }
 
@@ -2235,6 +2954,10 @@ static int XSock_SetupAddr(xsock_t *pSock, const char *pAddr, uint16_t nPort)
     if (XFLAGS_CHECK(pSock->nFlags, XSOCK_REUSEADDR))
         XSock_ReuseAddr(pSock, XTRUE);
 
+    if (XFLAGS_CHECK(pSock->nFlags, XSOCK_REUSEPORT) &&
+        XSock_ReusePort(pSock, XTRUE) == XSOCK_INVALID)
+        return XSTDERR;
+
     return XSTDOK;
 }
 
@@ -2281,6 +3004,10 @@ XSOCKET XSock_CreateAdv(xsock_t *pSock, uint32_t nFlags, size_t nFdMax, const ch
     if (xstrused(pName)) xstrncpy(pSock->sName, sizeof(pSock->sName), pName);
     xbool_t bReuseAddr = XFLAGS_CHECK(pSock->nFlags, XSOCK_REUSEADDR);
 
+    if (XFLAGS_CHECK(pSock->nFlags, XSOCK_ASYNC) &&
+        XSock_NonBlock(pSock, XTRUE) == XSOCK_INVALID)
+        return XSOCK_INVALID;
+
     if (pSock->nType == SOCK_STREAM) XSock_SetupStream(pSock, pAddr, nFdMax);
     else if (pSock->nType == SOCK_DGRAM) XSock_SetupDgram(pSock, bReuseAddr);
 
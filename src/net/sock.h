@@ -53,6 +53,15 @@ typedef int                 XSOCKET;
 #define XSOCK_INVALID       XSTDERR
 #endif
 
+#ifdef _WIN32
+typedef struct XSockIOVec {
+    void *iov_base;
+    size_t iov_len;
+} xsock_iov_t;
+#else
+typedef struct iovec        xsock_iov_t;
+#endif
+
 #define XSOCK_SUCCESS       XSTDOK
 #define XSOCK_ERROR         XSTDERR
 #define XSOCK_NONE          XSTDNON
@@ -63,6 +72,12 @@ typedef int                 XSOCKET;
 #define XSOCK_FD_MAX        120000
 #define XSOCK_INFO_MAX      256
 #define XSOCK_ADDR_MAX      128
+#define XSOCK_IOV_MAX       64
+#define XSOCK_BATCH_MAX     64
+#define XSOCK_FILE_CHUNK    (1024 * 16)
+#define XSOCK_FILE_MAX      (1024 * 1024 * 4)
+#define XSOCK_SESSION_MAX   64
+#define XSOCK_TICKET_MIN    16
 
 /* Socket errors */
 typedef enum {
@@ -105,7 +120,9 @@ typedef enum {
     XSOCK_ERR_SYSCALL,
     XSOCK_WANT_READ,
     XSOCK_WANT_WRITE,
-    XSOCK_EOF
+    XSOCK_EOF,
+    XSOCK_ERR_FILE,
+    XSOCK_ERR_SSLSES
 } xsock_status_t;
 
 typedef enum {
@@ -137,6 +154,13 @@ typedef enum {
     XSOCK_NB = (1 << 14),
     XSOCK_FORCE = (1 << 15),
     XSOCK_REUSEADDR = (1 << 16),
+    XSOCK_REUSEPORT = (1 << 17),
+
+    /* Client connect() does not wait, see XSock_CheckConnect() */
+    XSOCK_ASYNC = (1 << 18),
+
+    /* Client does not resume or cache TLS sessions */
+    XSOCK_NOCACHE = (1 << 19),
 
     XSOCK_UNDEFINED = 0
 } xsock_flags_t;
@@ -165,6 +189,12 @@ typedef struct XSocketCert {
     const char *p12Path;
     const char *p12Pass;
     int nVerifyFlags;
+
+    /* Server session resumption, see XSock_SetSSLCert() */
+    const uint8_t *pTicketKey;  // Secret shared by all listeners and workers
+    size_t nTicketKeyLen;       // At least XSOCK_TICKET_MIN bytes
+    int nSessionCache;          // Cached sessions, 0 keeps default, <0 disables
+    int nSessionTimeout;        // Session lifetime in seconds, 0 keeps default
 } xsock_cert_t;
 
 typedef union {
@@ -190,6 +220,23 @@ typedef struct XSocket {
     void *pPrivate;
 } xsock_t;
 
+/* Datagram of the batch I/O, see XSock_RecvBatch() */
+typedef struct XSocketPacket {
+    struct sockaddr_in addr;    // Source on receive, destination on send
+    uint8_t *pData;
+    size_t nSize;               // Buffer capacity
+    size_t nLength;             // Datagram (or GSO/GRO super packet) length
+    uint16_t nSegment;          // GSO/GRO segment size, 0 for single datagram
+    xbool_t bTruncated;
+} xsock_packet_t;
+
+/* Packets with buffers from one allocation, reused for every batch */
+typedef struct XSocketBatch {
+    xsock_packet_t *pPackets;
+    uint8_t *pBuffer;
+    size_t nCount;
+} xsock_batch_t;
+
 // Backward compatibility
 #define XSOCK_TCP_PEER (XSOCK_TCP | XSOCK_PEER)
 #define XSOCK_TCP_SERVER (XSOCK_TCP | XSOCK_SERVER)
@@ -259,6 +306,7 @@ XSTATUS XSock_Init(xsock_t* pSock, uint32_t nFlags, XSOCKET nFD);
 
 void XSock_InitSSL(void);
 void XSock_DeinitSSL(void);
+void XSock_ClearSessions(void);
 int XSock_LastSSLError(char* pDst, size_t nSize);
 
 XSTATUS XSock_LoadPKCS12(xsock_ssl_cert_t* pCert, const char* p12Path, const char* p12Pass);
@@ -269,6 +317,7 @@ XSOCKET XSock_InitSSLServer(xsock_t* pSock, int nVerifyFlags);
 XSOCKET XSock_InitSSLClient(xsock_t* pSock, const char* pAddr);
 
 XSOCKET XSock_SSLConnect(xsock_t *pSock);
+XSTATUS XSock_CheckConnect(xsock_t *pSock);
 XSOCKET XSock_SSLAccept(xsock_t *pSock);
 
 int XSock_SSLRead(xsock_t* pSock, void* pData, size_t nSize, xbool_t nExact);
@@ -280,9 +329,17 @@ int XSock_SendChunk(xsock_t* pSock, void* pData, size_t nLength);
 int XSock_RecvChunk(xsock_t* pSock, void* pData, size_t nSize);
 int XSock_Send(xsock_t* pSock, const void* pData, size_t nLength);
 int XSock_Write(xsock_t* pSock, const void* pData, size_t nLength);
+int XSock_WriteV(xsock_t* pSock, const xsock_iov_t* pIov, size_t nCount);
+int XSock_SendFile(xsock_t* pSock, int nFD, uint64_t nOffset, size_t nLength);
 int XSock_Read(xsock_t* pSock, void* pData, size_t nSize);
 int XSock_Recv(xsock_t* pSock, void* pData, size_t nSize);
 
+XSTATUS XSock_InitBatch(xsock_batch_t *pBatch, size_t nCount, size_t nSize);
+void XSock_ClearBatch(xsock_batch_t *pBatch);
+
+int XSock_RecvBatch(xsock_t *pSock, xsock_packet_t *pPackets, size_t nCount);
+int XSock_SendBatch(xsock_t *pSock, const xsock_packet_t *pPackets, size_t nCount);
+
 XSOCKET XSock_Accept(xsock_t* pSock, xsock_t* pNewSock);
 XSOCKET XSock_AcceptNB(xsock_t* pSock);
 
@@ -298,9 +355,11 @@ XSTATUS XSock_GetAddr(xsock_info_t* pInfo, struct sockaddr_in* pAddr, size_t nSi
 
 XSOCKET XSock_AddMembership(xsock_t* pSock, const char* pGroup);
 XSOCKET XSock_ReuseAddr(xsock_t* pSock, xbool_t nEnabled);
+XSOCKET XSock_ReusePort(xsock_t* pSock, xbool_t nEnabled);
 XSOCKET XSock_Oobinline(xsock_t* pSock, xbool_t nEnabled);
 XSOCKET XSock_NonBlock(xsock_t* pSock, xbool_t nNonBlock);
 XSOCKET XSock_NoDelay(xsock_t* pSock, xbool_t nEnabled);
+XSOCKET XSock_SetGRO(xsock_t* pSock, xbool_t nEnabled);
 XSOCKET XSock_TimeOutR(xsock_t* pSock, int nSec, int nUsec);
 XSOCKET XSock_TimeOutS(xsock_t* pSock, int nSec, int nUsec);
 XSOCKET XSock_Linger(xsock_t* pSock, int nSec);
@@ -9,6 +9,18 @@
  */
 
 #include "ws.h"
+#include "cpu.h"
+#include "str.h"
+
+#ifdef _XUTILS_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define XWS_USE_SIMD
+#define XWS_TARGET(arch) __attribute__((target(arch)))
+#endif
 
 #ifdef _WIN32
 #if defined(_MSC_VER)
@@ -25,11 +37,46 @@
 /* Biggest possible frame header: 2 bytes + 8 byte length + 4 byte mask key */
 #define XWS_MAX_HEADER_SIZE 14
 
+/* Extension elements with more parameters are refused */
+#define XWS_EXT_PARAMS_MAX  8
+
+#ifdef _XUTILS_USE_ZLIB
+/* RFC 7692: sender strips and receiver appends the empty stored block */
+static const uint8_t g_wsDeflateTail[] = { 0x00, 0x00, 0xFF, 0xFF };
+#endif
+
+/* XORs payload with the mask key, key bytes are in the wire order */
+typedef void(*xws_mask_fn_t)(uint8_t *pData, size_t nLength, uint32_t nMaskKey);
+
 typedef struct xws_frame_code_ {
     const xws_frame_type_t eType;
     const uint8_t nOpCode;
 } xws_frame_code_t;
 
+typedef struct xws_ext_param_ {
+    const char *pName;
+    const char *pValue;
+    size_t nNameLength;
+    size_t nValueLength;
+} xws_ext_param_t;
+
+typedef struct xws_extension_ {
+    xws_ext_param_t params[XWS_EXT_PARAMS_MAX];
+    const char *pName;
+    size_t nNameLength;
+    size_t nParams;
+    xbool_t bInvalid;
+} xws_extension_t;
+
+struct xws_zstream_ {
+    struct xws_zstream_ *pNext;
+#ifdef _XUTILS_USE_ZLIB
+    z_stream zstream;
+#endif
+    xbool_t bDeflate;
+    uint8_t nBits;
+};
+
 static const xws_frame_code_t g_wsFrameCodes[] =
 {
     { 0x0, XWS_CONTINUATION },
@@ -82,6 +129,12 @@ const char* XWebSock_GetStatusStr(xws_status_t eStatus)
             return "Invalid or uninitialized frame type";
         case XWS_INVALID_ARGS:
             return "Invalid or uninitialized arguments";
+        case XWS_ERR_DEFLATE:
+            return "Failed to compress web socket message";
+        case XWS_ERR_INFLATE:
+            return "Failed to decompress web socket message";
+        case XWS_ERR_EXTENSION:
+            return "Invalid or unsupported web socket extension";
         default:
             break;
     }
@@ -154,6 +207,141 @@ uint8_t XWS_OpCode(xws_frame_type_t eType)
     return 0;
 }
 
+static void XWS_MaskScalar(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    /* Same key bytes repeat in every 4 bytes, so the word layout does not matter */
+    uint64_t nKey64 = ((uint64_t)nMaskKey << 32) | nMaskKey;
+    const uint8_t *pMaskKey = (const uint8_t*)&nMaskKey;
+    size_t i = 0;
+
+    for (; i + 8 <= nLength; i += 8)
+    {
+        uint64_t nWord;
+        memcpy(&nWord, &pData[i], 8);
+        nWord ^= nKey64;
+        memcpy(&pData[i], &nWord, 8);
+    }
+
+    for (; i < nLength; i++)
+        pData[i] ^= pMaskKey[i % 4];
+}
+
+#ifdef XWS_USE_SIMD
+XWS_TARGET("sse2")
+static void XWS_MaskSSE2(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    const __m128i key = _mm_set1_epi32((int)nMaskKey);
+    size_t i = 0;
+
+    for (; i + 16 <= nLength; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)&pData[i]);
+        _mm_storeu_si128((__m128i*)&pData[i], _mm_xor_si128(chunk, key));
+    }
+
+    XWS_MaskScalar(&pData[i], nLength - i, nMaskKey);
+}
+
+XWS_TARGET("avx2")
+static void XWS_MaskAVX2(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    const __m256i key = _mm256_set1_epi32((int)nMaskKey);
+    size_t i = 0;
+
+    for (; i + 64 <= nLength; i += 64)
+    {
+        __m256i first = _mm256_loadu_si256((const __m256i*)&pData[i]);
+        __m256i second = _mm256_loadu_si256((const __m256i*)&pData[i + 32]);
+        _mm256_storeu_si256((__m256i*)&pData[i], _mm256_xor_si256(first, key));
+        _mm256_storeu_si256((__m256i*)&pData[i + 32], _mm256_xor_si256(second, key));
+    }
+
+    for (; i + 32 <= nLength; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)&pData[i]);
+        _mm256_storeu_si256((__m256i*)&pData[i], _mm256_xor_si256(chunk, key));
+    }
+
+    XWS_MaskScalar(&pData[i], nLength - i, nMaskKey);
+}
+#endif
+
+/*
+    Process-wide kernel selection, the pointer is read by every frame parser
+    without locking. XWS_SetMasker() is init-only, call it (or XWS_GetMasker()
+    to resolve the automatic choice) before the threads are started.
+*/
+static void XWS_MaskAuto(uint8_t *pData, size_t nLength, uint32_t nMaskKey);
+static xws_mask_fn_t g_XWSMask = XWS_MaskAuto;
+static xws_mask_t g_eXWSMasker = XWS_MASK_AUTO;
+
+xws_mask_t XWS_SetMasker(xws_mask_t eMasker)
+{
+    uint32_t nFeatures = XCPU_GetFeatures();
+
+    if (eMasker == XWS_MASK_AUTO)
+    {
+        eMasker = (nFeatures & XCPU_AVX2) ? XWS_MASK_AVX2 :
+                  (nFeatures & XCPU_SSE2) ? XWS_MASK_SSE2 :
+                                            XWS_MASK_SCALAR;
+    }
+
+    /* Fall back to the best available kernel below the requested one */
+    if (eMasker == XWS_MASK_AVX2 && !(nFeatures & XCPU_AVX2)) eMasker = XWS_MASK_SSE2;
+    if (eMasker == XWS_MASK_SSE2 && !(nFeatures & XCPU_SSE2)) eMasker = XWS_MASK_SCALAR;
+
+#ifdef XWS_USE_SIMD
+    if (eMasker == XWS_MASK_AVX2) g_XWSMask = XWS_MaskAVX2;
+    else if (eMasker == XWS_MASK_SSE2) g_XWSMask = XWS_MaskSSE2;
+    else g_XWSMask = XWS_MaskScalar;
+#else
+    eMasker = XWS_MASK_SCALAR;
+    g_XWSMask = XWS_MaskScalar;
+#endif
+
+    g_eXWSMasker = eMasker;
+    return eMasker;
+}
+
+xws_mask_t XWS_GetMasker(void)
+{
+    if (g_eXWSMasker == XWS_MASK_AUTO)
+        return XWS_SetMasker(XWS_MASK_AUTO);
+
+    return g_eXWSMasker;
+}
+
+static void XWS_MaskAuto(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    XWS_SetMasker(XWS_MASK_AUTO);
+    g_XWSMask(pData, nLength, nMaskKey);
+}
+
+const char* XWS_GetMaskerStr(xws_mask_t eMasker)
+{
+    switch (eMasker)
+    {
+        case XWS_MASK_AUTO:
+            return "auto";
+        case XWS_MASK_SCALAR:
+            return "scalar";
+        case XWS_MASK_SSE2:
+            return "sse2";
+        case XWS_MASK_AVX2:
+            return "avx2";
+        default:
+            break;
+    }
+
+    return "unknown";
+}
+
+void XWS_MaskData(uint8_t *pData, size_t nLength, uint32_t nMaskKey)
+{
+    XCHECK_VOID_NL((pData != NULL && nLength));
+    g_XWSMask(pData, nLength, nMaskKey);
+}
+
 static uint32_t XWS_GenerateMaskKey(void)
 {
     static xbool_t bSeeded = XFALSE;
@@ -242,6 +430,7 @@ void XWebFrame_Init(xws_frame_t *pFrame)
     pFrame->nMaskKey = XSTDNON;
     pFrame->nOpCode = XSTDNON;
 
+    pFrame->bCompressed = XFALSE;
     pFrame->bComplete = XFALSE;
     pFrame->bAlloc = XFALSE;
     pFrame->bMask = XFALSE;
@@ -438,14 +627,12 @@ xws_status_t XWebFrame_Mask(xws_frame_t *pFrame)
     pFrame->bMask = XTRUE;
 
     uint8_t *pPayload = pFrame->buffer.pData + pFrame->nHeaderSize;
-    size_t i, nPayloadLen = pFrame->nPayloadLength;
+    size_t nPayloadLen = pFrame->nPayloadLength;
 
     /* Never mask more bytes than the buffer actually holds */
     XCHECK_NL((pFrame->buffer.nUsed - pFrame->nHeaderSize >= nPayloadLen), XWS_FRAME_INCOMPLETE);
 
-    for (i = 0; i < nPayloadLen; i++)
-        pPayload[i] ^= pMaskKey[i % 4];
-
+    XWS_MaskData(pPayload, nPayloadLen, pFrame->nMaskKey);
     return XWS_ERR_NONE;
 }
 
@@ -456,7 +643,7 @@ xws_status_t XWebFrame_Unmask(xws_frame_t *pFrame)
 
     XCHECK((pFrame->buffer.pData != NULL), XWS_INVALID_ARGS);
     XCHECK_NL((pFrame->buffer.nUsed >= pFrame->nHeaderSize), XWS_FRAME_INCOMPLETE);
-    size_t i, nPayloadLen = pFrame->nPayloadLength;
+    size_t nPayloadLen = pFrame->nPayloadLength;
 
     if (!nPayloadLen)
     {
@@ -468,10 +655,7 @@ xws_status_t XWebFrame_Unmask(xws_frame_t *pFrame)
     XCHECK_NL((pFrame->buffer.nUsed - pFrame->nHeaderSize >= nPayloadLen), XWS_FRAME_INCOMPLETE);
 
     uint8_t *pPayload = pFrame->buffer.pData + pFrame->nHeaderSize;
-    uint8_t *pMaskKey = (uint8_t*)&pFrame->nMaskKey;
-
-    for (i = 0; i < nPayloadLen; i++)
-        pPayload[i] ^= pMaskKey[i % 4];
+    XWS_MaskData(pPayload, nPayloadLen, pFrame->nMaskKey);
 
     pFrame->bMask = XFALSE;
     return XWS_ERR_NONE;
@@ -493,6 +677,7 @@ xws_status_t XWebFrame_Parse(xws_frame_t *pFrame)
 
     pFrame->bFin = (nStartByte & 0x80) >> 7;
     pFrame->bMask = (nNextByte & 0x80) >> 7;
+    pFrame->bCompressed = (nStartByte & XWS_RSV1) ? XTRUE : XFALSE;
     pFrame->nOpCode = nStartByte & 0x0F;
 
     pFrame->eType = XWS_FrameType(pFrame->nOpCode);
@@ -569,9 +754,526 @@ xws_status_t XWebFrame_ParseData(xws_frame_t *pFrame, uint8_t* pData, size_t nSi
     return XWebFrame_TryParse(pFrame, pData, nSize);
 }
 
-xws_status_t XWebFrame_ParseBuff(xws_frame_t *pFrame, xbyte_buffer_t *pBuffer)
+xws_status_t XWebFrame_ParseView(xws_frame_t *pFrame, uint8_t *pData, size_t nSize)
 {
+    /* Frame borrows the data, complete payload is unmasked in place */
     XWebFrame_Init(pFrame);
-    XByteBuffer_Set(&pFrame->buffer, pBuffer);
+    XByteBuffer_SetData(&pFrame->buffer, pData, nSize);
     return XWebFrame_Parse(pFrame);
 }
+
+xws_status_t XWebFrame_ParseBuff(xws_frame_t *pFrame, xbyte_buffer_t *pBuffer)
+{
+    XCHECK(pBuffer, XWS_INVALID_ARGS);
+    return XWebFrame_ParseView(pFrame, pBuffer->pData, pBuffer->nUsed);
+}
+
+xws_status_t XWebFrame_CreateDeflated(xws_frame_t *pFrame, xws_zstream_t *pStream, const uint8_t *pPayload,
+                                      size_t nLength, xws_frame_type_t eType, xbool_t bMask, xbool_t bReset)
+{
+    XCHECK(pFrame, XWS_INVALID_ARGS);
+    XCHECK((eType == XWS_TEXT || eType == XWS_BINARY), XWS_INVALID_TYPE);
+
+    xbyte_buffer_t deflated;
+    XByteBuffer_Init(&deflated, XSTDNON, XFALSE);
+
+    xws_status_t eStatus = XWS_Deflate(pStream, pPayload, nLength, &deflated, bReset);
+    if (eStatus == XWS_ERR_NONE) eStatus = XWebFrame_Create(pFrame, deflated.pData, deflated.nUsed, eType, XFALSE, XTRUE);
+
+    XByteBuffer_Clear(&deflated);
+    XCHECK_NL((eStatus == XWS_ERR_NONE), eStatus);
+
+    /* RSV1 marks the compressed message */
+    pFrame->buffer.pData[0] |= XWS_RSV1;
+    pFrame->bCompressed = XTRUE;
+
+    return bMask ? XWebFrame_Mask(pFrame) : XWS_ERR_NONE;
+}
+
+xbool_t XWS_HaveDeflate(void)
+{
+#ifdef _XUTILS_USE_ZLIB
+    return XTRUE;
+#else
+    return XFALSE;
+#endif
+}
+
+void XWS_InitDeflate(xws_deflate_t *pParams)
+{
+    XCHECK_VOID_NL((pParams != NULL));
+    pParams->nServerBits = XWS_DEFLATE_BITS_MAX;
+    pParams->nClientBits = XWS_DEFLATE_BITS_MAX;
+    pParams->bServerNoTakeover = XFALSE;
+    pParams->bClientNoTakeover = XFALSE;
+}
+
+size_t XWS_GetDeflateHeader(const xws_deflate_t *pParams, xbool_t bOffer, char *pOutput, size_t nSize)
+{
+    XCHECK_NL((pParams != NULL && pOutput != NULL && nSize), XSTDNON);
+    char sServerBits[XSTR_TINY] = XSTR_INIT;
+    char sClientBits[XSTR_TINY] = XSTR_INIT;
+
+    /* Accepted server window is always announced, client asks only for the smaller one */
+    if (!bOffer || pParams->nServerBits < XWS_DEFLATE_BITS_MAX)
+        xstrncpyf(sServerBits, sizeof(sServerBits), "; server_max_window_bits=%u", (unsigned)pParams->nServerBits);
+
+    /* Client offer tells that it can limit its window, server may limit it */
+    if (pParams->nClientBits < XWS_DEFLATE_BITS_MAX)
+        xstrncpyf(sClientBits, sizeof(sClientBits), "; client_max_window_bits=%u", (unsigned)pParams->nClientBits);
+    else if (bOffer)
+        xstrncpy(sClientBits, sizeof(sClientBits), "; client_max_window_bits");
+
+    return xstrncpyf(pOutput, nSize, "%s%s%s%s%s", XWS_DEFLATE_NAME,
+        pParams->bServerNoTakeover ? "; server_no_context_takeover" : "",
+        pParams->bClientNoTakeover ? "; client_no_context_takeover" : "",
+        sServerBits, sClientBits);
+}
+
+static const char* XWS_SkipSpace(const char *pStr)
+{
+    while (*pStr == ' ' || *pStr == '\t') pStr++;
+    return pStr;
+}
+
+/* Reads token or quoted string and returns the position after it */
+static const char* XWS_ReadToken(const char *pStr, const char **pToken, size_t *pLength)
+{
+    pStr = XWS_SkipSpace(pStr);
+    *pToken = pStr;
+
+    if (*pStr == '"')
+    {
+        *pToken = ++pStr;
+        while (*pStr != XSTR_NUL && *pStr != '"') pStr++;
+        *pLength = (size_t)(pStr - *pToken);
+        if (*pStr == '"') pStr++;
+    }
+    else
+    {
+        while (*pStr != XSTR_NUL && strchr(" \t,;=\"", *pStr) == NULL) pStr++;
+        *pLength = (size_t)(pStr - *pToken);
+    }
+
+    return XWS_SkipSpace(pStr);
+}
+
+/* Parses one element of the extension list, returns the start of the next one */
+static const char* XWS_ParseExtension(const char *pStr, xws_extension_t *pExt)
+{
+    memset(pExt, 0, sizeof(xws_extension_t));
+    pStr = XWS_ReadToken(pStr, &pExt->pName, &pExt->nNameLength);
+
+    while (*pStr == ';')
+    {
+        xws_ext_param_t param;
+        memset(&param, 0, sizeof(param));
+
+        pStr = XWS_ReadToken(pStr + 1, &param.pName, &param.nNameLength);
+        if (*pStr == '=')
+        {
+            pStr = XWS_ReadToken(pStr + 1, &param.pValue, &param.nValueLength);
+            if (!param.nValueLength) pExt->bInvalid = XTRUE;
+        }
+
+        if (!param.nNameLength || pExt->nParams >= XWS_EXT_PARAMS_MAX) pExt->bInvalid = XTRUE;
+        else pExt->params[pExt->nParams++] = param;
+    }
+
+    if (*pStr != ',' && *pStr != XSTR_NUL) pExt->bInvalid = XTRUE;
+    if (!pExt->nNameLength && (pExt->nParams || *pStr != ',')) pExt->bInvalid = XTRUE;
+
+    while (*pStr != XSTR_NUL && *pStr != ',') pStr++;
+    return *pStr == ',' ? pStr + 1 : pStr;
+}
+
+static xbool_t XWS_IsToken(const char *pStr, size_t nLength, const char *pToken)
+{
+    return nLength == strlen(pToken) && xstrncasecmp(pStr, pToken, nLength);
+}
+
+static int XWS_ParseWindowBits(const xws_ext_param_t *pParam)
+{
+    XCHECK_NL((pParam->nValueLength && pParam->nValueLength <= 2), XSTDERR);
+    XCHECK_NL((pParam->pValue[0] != '0'), XSTDERR);
+    int nBits = 0;
+    size_t i;
+
+    for (i = 0; i < pParam->nValueLength; i++)
+    {
+        XCHECK_NL(isdigit((unsigned char)pParam->pValue[i]), XSTDERR);
+        nBits = nBits * 10 + (pParam->pValue[i] - '0');
+    }
+
+    /* RFC 7692 allows 8 to 15, callers handle what zlib can not */
+    return (nBits >= 8 && nBits <= XWS_DEFLATE_BITS_MAX) ? nBits : XSTDERR;
+}
+
+/* Window bits are zero when missing, pClientBits is set for client_max_window_bits without value too */
+static XSTATUS XWS_ReadDeflate(const xws_extension_t *pExt, xws_deflate_t *pParams, xbool_t *pClientBits)
+{
+    xbool_t bServerBits = XFALSE;
+    size_t i;
+
+    memset(pParams, 0, sizeof(xws_deflate_t));
+    *pClientBits = XFALSE;
+
+    for (i = 0; i < pExt->nParams; i++)
+    {
+        const xws_ext_param_t *pParam = &pExt->params[i];
+        const char *pName = pParam->pName;
+        size_t nLength = pParam->nNameLength;
+
+        if (XWS_IsToken(pName, nLength, "server_no_context_takeover"))
+        {
+            XCHECK_NL((!pParams->bServerNoTakeover && pParam->pValue == NULL), XSTDERR);
+            pParams->bServerNoTakeover = XTRUE;
+        }
+        else if (XWS_IsToken(pName, nLength, "client_no_context_takeover"))
+        {
+            XCHECK_NL((!pParams->bClientNoTakeover && pParam->pValue == NULL), XSTDERR);
+            pParams->bClientNoTakeover = XTRUE;
+        }
+        else if (XWS_IsToken(pName, nLength, "server_max_window_bits"))
+        {
+            int nBits = XWS_ParseWindowBits(pParam);
+            XCHECK_NL((!bServerBits && nBits > 0), XSTDERR);
+
+            pParams->nServerBits = (uint8_t)nBits;
+            bServerBits = XTRUE;
+        }
+        else if (XWS_IsToken(pName, nLength, "client_max_window_bits"))
+        {
+            int nBits = pParam->pValue != NULL ? XWS_ParseWindowBits(pParam) : XSTDNON;
+            XCHECK_NL((!*pClientBits && nBits >= 0), XSTDERR);
+
+            pParams->nClientBits = (uint8_t)nBits;
+            *pClientBits = XTRUE;
+        }
+        else
+        {
+            /* Unknown parameter */
+            return XSTDERR;
+        }
+    }
+
+    return XSTDOK;
+}
+
+XSTATUS XWS_AcceptDeflate(const xws_deflate_t *pConfig, const char *pHeader, xws_deflate_t *pAgreed)
+{
+    XCHECK((pConfig != NULL && pAgreed != NULL), XSTDINV);
+    XCHECK_NL((XWS_HaveDeflate() && xstrused(pHeader)), XSTDNON);
+
+    while (*pHeader != XSTR_NUL)
+    {
+        xws_extension_t ext;
+        xws_deflate_t offer;
+        xbool_t bClientBits;
+
+        /* Offers are in the order of client preference, first acceptable one wins */
+        pHeader = XWS_ParseExtension(pHeader, &ext);
+        if (ext.bInvalid || !XWS_IsToken(ext.pName, ext.nNameLength, XWS_DEFLATE_NAME)) continue;
+        if (XWS_ReadDeflate(&ext, &offer, &bClientBits) < 0) continue;
+
+        /* zlib does not compress with 256 byte window */
+        if (offer.nServerBits && offer.nServerBits < XWS_DEFLATE_BITS_MIN) continue;
+
+        pAgreed->bServerNoTakeover = offer.bServerNoTakeover || pConfig->bServerNoTakeover;
+        pAgreed->bClientNoTakeover = offer.bClientNoTakeover || pConfig->bClientNoTakeover;
+        pAgreed->nServerBits = offer.nServerBits ? XSTD_MIN(offer.nServerBits, pConfig->nServerBits) : pConfig->nServerBits;
+        pAgreed->nClientBits = XWS_DEFLATE_BITS_MAX;
+
+        /* Client window can be limited only when the client supports it */
+        if (bClientBits)
+        {
+            uint8_t nBits = offer.nClientBits ? offer.nClientBits : XWS_DEFLATE_BITS_MAX;
+            nBits = XSTD_MIN(nBits, pConfig->nClientBits);
+            if (nBits >= XWS_DEFLATE_BITS_MIN) pAgreed->nClientBits = nBits;
+        }
+
+        return XSTDOK;
+    }
+
+    return XSTDNON;
+}
+
+XSTATUS XWS_CheckDeflate(const xws_deflate_t *pOffer, const char *pHeader, xws_deflate_t *pAgreed)
+{
+    XCHECK((pOffer != NULL && pAgreed != NULL), XSTDINV);
+    XCHECK_NL(xstrused(pHeader), XSTDNON);
+    xbool_t bFound = XFALSE;
+
+    while (*pHeader != XSTR_NUL)
+    {
+        xws_extension_t ext;
+        xws_deflate_t answer;
+        xbool_t bClientBits;
+
+        pHeader = XWS_ParseExtension(pHeader, &ext);
+        if (!ext.bInvalid && !ext.nNameLength) continue;
+
+        /* Server must not answer with anything that was not offered */
+        XCHECK_NL((!ext.bInvalid && !bFound), XSTDERR);
+        XCHECK_NL(XWS_IsToken(ext.pName, ext.nNameLength, XWS_DEFLATE_NAME), XSTDERR);
+        XCHECK_NL((XWS_ReadDeflate(&ext, &answer, &bClientBits) == XSTDOK), XSTDERR);
+
+        /* Requested limits must be confirmed, client window must fit zlib */
+        XCHECK_NL((answer.bServerNoTakeover || !pOffer->bServerNoTakeover), XSTDERR);
+        XCHECK_NL((pOffer->nServerBits >= XWS_DEFLATE_BITS_MAX ||
+                  (answer.nServerBits && answer.nServerBits <= pOffer->nServerBits)), XSTDERR);
+        XCHECK_NL((!bClientBits || (answer.nClientBits >= XWS_DEFLATE_BITS_MIN &&
+                   answer.nClientBits <= pOffer->nClientBits)), XSTDERR);
+
+        /* Inflate window is never smaller than the one of the peer */
+        pAgreed->nServerBits = answer.nServerBits ? XSTD_MAX(answer.nServerBits, XWS_DEFLATE_BITS_MIN) : XWS_DEFLATE_BITS_MAX;
+        pAgreed->nClientBits = bClientBits ? answer.nClientBits : pOffer->nClientBits;
+        pAgreed->bServerNoTakeover = answer.bServerNoTakeover;
+        pAgreed->bClientNoTakeover = answer.bClientNoTakeover || pOffer->bClientNoTakeover;
+        bFound = XTRUE;
+    }
+
+    return bFound ? XSTDOK : XSTDNON;
+}
+
+void XWS_InitZPool(xws_zpool_t *pPool, xbool_t bDeflate, int nLevel, size_t nMaxFree)
+{
+    XCHECK_VOID_NL((pPool != NULL));
+    pPool->pFree = NULL;
+    pPool->nMaxFree = nMaxFree;
+    pPool->nFree = XSTDNON;
+    pPool->nHits = XSTDNON;
+    pPool->nMisses = XSTDNON;
+    pPool->bDeflate = bDeflate;
+    pPool->nLevel = nLevel;
+}
+
+static void XWS_FreeZStream(xws_zstream_t *pStream)
+{
+#ifdef _XUTILS_USE_ZLIB
+    if (pStream->bDeflate) deflateEnd(&pStream->zstream);
+    else inflateEnd(&pStream->zstream);
+#endif
+    free(pStream);
+}
+
+void XWS_DestroyZPool(xws_zpool_t *pPool)
+{
+    XCHECK_VOID_NL((pPool != NULL));
+
+    while (pPool->pFree != NULL)
+    {
+        xws_zstream_t *pNext = pPool->pFree->pNext;
+        XWS_FreeZStream(pPool->pFree);
+        pPool->pFree = pNext;
+    }
+
+    pPool->nFree = XSTDNON;
+}
+
+xws_zstream_t* XWS_GetZStream(xws_zpool_t *pPool, uint8_t nBits)
+{
+    XCHECK((pPool != NULL), NULL);
+    XCHECK((nBits >= XWS_DEFLATE_BITS_MIN && nBits <= XWS_DEFLATE_BITS_MAX), NULL);
+
+#ifdef _XUTILS_USE_ZLIB
+    xws_zstream_t **pLink = &pPool->pFree;
+    xws_zstream_t *pStream = NULL;
+
+    /* Streams of the same window are interchangeable, they are reset on put */
+    while (*pLink != NULL)
+    {
+        pStream = *pLink;
+        if (pStream->nBits == nBits)
+        {
+            *pLink = pStream->pNext;
+            pStream->pNext = NULL;
+            pPool->nFree--;
+            pPool->nHits++;
+            return pStream;
+        }
+
+        pLink = &pStream->pNext;
+    }
+
+    pStream = (xws_zstream_t*)malloc(sizeof(xws_zstream_t));
+    XCHECK((pStream != NULL), NULL);
+
+    memset(&pStream->zstream, 0, sizeof(z_stream));
+    pStream->bDeflate = pPool->bDeflate;
+    pStream->nBits = nBits;
+    pStream->pNext = NULL;
+
+    /* Negative window bits select raw deflate without zlib header */
+    int nStatus = pStream->bDeflate ?
+        deflateInit2(&pStream->zstream, pPool->nLevel, Z_DEFLATED, -(int)nBits, 8, Z_DEFAULT_STRATEGY) :
+        inflateInit2(&pStream->zstream, -(int)nBits);
+
+    XCHECK_CALL((nStatus == Z_OK), free, pStream, NULL);
+    pPool->nMisses++;
+
+    return pStream;
+#else
+    return NULL;
+#endif
+}
+
+void XWS_ResetZStream(xws_zstream_t *pStream)
+{
+    XCHECK_VOID_NL((pStream != NULL));
+#ifdef _XUTILS_USE_ZLIB
+    if (pStream->bDeflate) deflateReset(&pStream->zstream);
+    else inflateReset(&pStream->zstream);
+#endif
+}
+
+void XWS_PutZStream(xws_zpool_t *pPool, xws_zstream_t *pStream)
+{
+    XCHECK_VOID_NL((pStream != NULL));
+
+    if (pPool == NULL ||
+        pPool->nFree >= pPool->nMaxFree ||
+        pPool->bDeflate != pStream->bDeflate)
+    {
+        XWS_FreeZStream(pStream);
+        return;
+    }
+
+    XWS_ResetZStream(pStream);
+    pStream->pNext = pPool->pFree;
+    pPool->pFree = pStream;
+    pPool->nFree++;
+}
+
+xws_status_t XWS_Deflate(xws_zstream_t *pStream, const uint8_t *pData, size_t nLength, xbyte_buffer_t *pOutput, xbool_t bReset)
+{
+    XCHECK((pStream != NULL && pStream->bDeflate), XWS_INVALID_ARGS);
+    XCHECK((pOutput != NULL && (pData != NULL || !nLength)), XWS_INVALID_ARGS);
+    XCHECK((nLength <= UINT_MAX), XWS_ERR_SIZE);
+
+#ifdef _XUTILS_USE_ZLIB
+    z_stream *pZStream = &pStream->zstream;
+    size_t nOffset = pOutput->nUsed;
+    int nStatus = Z_OK;
+
+    pZStream->next_in = (Bytef*)pData;
+    pZStream->avail_in = (uInt)nLength;
+
+    /* Output usually fits in one pass, sync flush adds few bytes to the bound */
+    size_t nChunk = deflateBound(pZStream, (uLong)nLength) + XWS_MAX_HEADER_SIZE;
+
+    do
+    {
+        if (XByteBuffer_Reserve(pOutput, nChunk) <= 0)
+        {
+            deflateReset(pZStream);
+            return XWS_ERR_ALLOC;
+        }
+
+        size_t nAvail = XSTD_MIN(pOutput->nSize - pOutput->nUsed, (size_t)UINT_MAX);
+        pZStream->next_out = pOutput->pData + pOutput->nUsed;
+        pZStream->avail_out = (uInt)nAvail;
+
+        nStatus = deflate(pZStream, Z_SYNC_FLUSH);
+        pOutput->nUsed += nAvail - pZStream->avail_out;
+    }
+    while (nStatus == Z_OK && pZStream->avail_out == 0);
+
+    if (nStatus != Z_OK && nStatus != Z_BUF_ERROR)
+    {
+        pOutput->nUsed = nOffset;
+        deflateReset(pZStream);
+        return XWS_ERR_DEFLATE;
+    }
+
+    size_t nDeflated = pOutput->nUsed - nOffset;
+    const size_t nTail = sizeof(g_wsDeflateTail);
+
+    if (nDeflated >= nTail && !memcmp(pOutput->pData + pOutput->nUsed - nTail, g_wsDeflateTail, nTail))
+        pOutput->nUsed -= nTail;
+
+    if (bReset) deflateReset(pZStream);
+    return XWS_ERR_NONE;
+#else
+    (void)bReset;
+    return XWS_ERR_DEFLATE;
+#endif
+}
+
+#ifdef _XUTILS_USE_ZLIB
+static xws_status_t XWS_InflateInput(z_stream *pZStream, xbyte_buffer_t *pOutput, size_t nOffset, size_t nMaxSize)
+{
+    int nStatus = Z_OK;
+
+    do
+    {
+        size_t nInflated = pOutput->nUsed - nOffset;
+        XCHECK_NL((nInflated <= nMaxSize), XWS_FRAME_TOOBIG);
+
+        /* One byte over the limit is enough to detect too big message */
+        size_t nChunk = XSTD_MAX((size_t)pZStream->avail_in * 4, (size_t)XSTR_MIN);
+        nChunk = XSTD_MIN(nChunk, nMaxSize - nInflated + 1);
+        nChunk = XSTD_MIN(nChunk, (size_t)UINT_MAX);
+
+        XCHECK_NL((XByteBuffer_Reserve(pOutput, nChunk) > 0), XWS_ERR_ALLOC);
+        pZStream->next_out = pOutput->pData + pOutput->nUsed;
+        pZStream->avail_out = (uInt)nChunk;
+
+        nStatus = inflate(pZStream, Z_SYNC_FLUSH);
+        pOutput->nUsed += nChunk - pZStream->avail_out;
+
+        /* Message may end with the final block, next one starts the new stream */
+        if (nStatus == Z_STREAM_END)
+        {
+            inflateReset(pZStream);
+            pZStream->avail_in = 0;
+            break;
+        }
+    }
+    while (nStatus == Z_OK && (pZStream->avail_in || !pZStream->avail_out));
+
+    XCHECK_NL((nStatus == Z_OK || nStatus == Z_BUF_ERROR || nStatus == Z_STREAM_END), XWS_ERR_INFLATE);
+    XCHECK_NL((pOutput->nUsed - nOffset <= nMaxSize), XWS_FRAME_TOOBIG);
+    return XWS_ERR_NONE;
+}
+#endif
+
+xws_status_t XWS_Inflate(xws_zstream_t *pStream, const uint8_t *pData, size_t nLength,
+                         xbyte_buffer_t *pOutput, size_t nMaxSize, xbool_t bReset)
+{
+    XCHECK((pStream != NULL && !pStream->bDeflate), XWS_INVALID_ARGS);
+    XCHECK((pOutput != NULL && (pData != NULL || !nLength)), XWS_INVALID_ARGS);
+    XCHECK((nLength <= UINT_MAX), XWS_FRAME_TOOBIG);
+
+#ifdef _XUTILS_USE_ZLIB
+    z_stream *pZStream = &pStream->zstream;
+    xws_status_t eStatus = XWS_ERR_NONE;
+    size_t nOffset = pOutput->nUsed;
+
+    /* Compressed message is followed by the tail stripped by the sender */
+    pZStream->next_in = (Bytef*)pData;
+    pZStream->avail_in = (uInt)nLength;
+    eStatus = XWS_InflateInput(pZStream, pOutput, nOffset, nMaxSize);
+
+    if (eStatus == XWS_ERR_NONE)
+    {
+        pZStream->next_in = (Bytef*)g_wsDeflateTail;
+        pZStream->avail_in = sizeof(g_wsDeflateTail);
+        eStatus = XWS_InflateInput(pZStream, pOutput, nOffset, nMaxSize);
+    }
+
+    if (eStatus != XWS_ERR_NONE)
+    {
+        pOutput->nUsed = nOffset;
+        inflateReset(pZStream);
+        return eStatus;
+    }
+
+    if (bReset) inflateReset(pZStream);
+    return XWS_ERR_NONE;
+#else
+    (void)nMaxSize;
+    (void)bReset;
+    return XWS_ERR_INFLATE;
+#endif
+}
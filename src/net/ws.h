@@ -22,6 +22,14 @@ extern "C" {
 #define XWS_NONCE_LENGTH    16
 #define XWS_GUID            "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 
+/* RFC 7692 permessage-deflate, available with _XUTILS_USE_ZLIB */
+#define XWS_DEFLATE_NAME        "permessage-deflate"
+#define XWS_DEFLATE_BITS_MIN    9
+#define XWS_DEFLATE_BITS_MAX    15
+#define XWS_DEFLATE_THRESHOLD   128
+#define XWS_DEFLATE_LEVEL       6
+#define XWS_RSV1                0x40
+
 typedef enum {
     XWS_ERR_NONE,
     XWS_ERR_ALLOC,
@@ -37,7 +45,10 @@ typedef enum {
     XWS_FRAME_PARSED,
     XWS_FRAME_INVALID,
     XWS_FRAME_COMPLETE,
-    XWS_FRAME_INCOMPLETE
+    XWS_FRAME_INCOMPLETE,
+    XWS_ERR_DEFLATE,
+    XWS_ERR_INFLATE,
+    XWS_ERR_EXTENSION
 } xws_status_t;
 
 typedef enum {
@@ -60,6 +71,14 @@ typedef enum {
     XWS_INVALID
 } xws_frame_type_t;
 
+/* Masking kernels, selected at runtime by default */
+typedef enum {
+    XWS_MASK_AUTO = 0,
+    XWS_MASK_SCALAR,
+    XWS_MASK_SSE2,
+    XWS_MASK_AVX2
+} xws_mask_t;
+
 typedef struct xweb_frame_ {
     xws_frame_type_t eType;
     xbyte_buffer_t buffer;
@@ -70,14 +89,41 @@ typedef struct xweb_frame_ {
     uint32_t nMaskKey;
     uint8_t nOpCode;
 
+    xbool_t bCompressed;
     xbool_t bComplete;
     xbool_t bAlloc;
     xbool_t bMask;
     xbool_t bFin;
 } xws_frame_t;
 
+/* Extension parameters, "server" and "client" name the compressing side */
+typedef struct xws_deflate_ {
+    uint8_t nServerBits;
+    uint8_t nClientBits;
+    xbool_t bServerNoTakeover;
+    xbool_t bClientNoTakeover;
+} xws_deflate_t;
+
+typedef struct xws_zstream_ xws_zstream_t;
+
+/* Free list of zlib streams, all streams of one pool share the direction and level */
+typedef struct xws_zpool_ {
+    xws_zstream_t *pFree;
+    size_t nMaxFree;
+    size_t nFree;
+    size_t nHits;
+    size_t nMisses;
+    xbool_t bDeflate;
+    int nLevel;
+} xws_zpool_t;
+
 const char* XWebSock_GetStatusStr(xws_status_t eStatus);
 const char* XWS_FrameTypeStr(xws_frame_type_t eType);
+const char* XWS_GetMaskerStr(xws_mask_t eMasker);
+
+xws_mask_t XWS_SetMasker(xws_mask_t eMasker);
+xws_mask_t XWS_GetMasker(void);
+void XWS_MaskData(uint8_t *pData, size_t nLength, uint32_t nMaskKey);
 
 xws_frame_type_t XWS_FrameType(uint8_t nOpCode);
 uint8_t XWS_OpCode(xws_frame_type_t eType);
@@ -98,6 +144,7 @@ xws_status_t XWebFrame_AppendData(xws_frame_t *pFrame, uint8_t* pData, size_t nS
 xws_status_t XWebFrame_ParseData(xws_frame_t *pFrame, uint8_t* pData, size_t nSize);
 xws_status_t XWebFrame_TryParse(xws_frame_t *pFrame, uint8_t* pData, size_t nSize);
 xws_status_t XWebFrame_ParseBuff(xws_frame_t *pFrame, xbyte_buffer_t *pBuffer);
+xws_status_t XWebFrame_ParseView(xws_frame_t *pFrame, uint8_t *pData, size_t nSize);
 xws_status_t XWebFrame_Parse(xws_frame_t *pFrame);
 xws_status_t XWebFrame_Mask(xws_frame_t *pFrame);
 xws_status_t XWebFrame_Unmask(xws_frame_t *pFrame);
@@ -112,6 +159,25 @@ const uint8_t* XWebFrame_GetPayload(xws_frame_t *pFrame);
 XSTATUS XWebFrame_GetExtraData(xws_frame_t *pFrame, xbyte_buffer_t *pBuffer, xbool_t bAppend);
 XSTATUS XWebFrame_CutExtraData(xws_frame_t *pFrame);
 
+xws_status_t XWebFrame_CreateDeflated(xws_frame_t *pFrame, xws_zstream_t *pStream, const uint8_t *pPayload,
+                                      size_t nLength, xws_frame_type_t eType, xbool_t bMask, xbool_t bReset);
+
+xbool_t XWS_HaveDeflate(void);
+void XWS_InitDeflate(xws_deflate_t *pParams);
+size_t XWS_GetDeflateHeader(const xws_deflate_t *pParams, xbool_t bOffer, char *pOutput, size_t nSize);
+XSTATUS XWS_AcceptDeflate(const xws_deflate_t *pConfig, const char *pHeader, xws_deflate_t *pAgreed);
+XSTATUS XWS_CheckDeflate(const xws_deflate_t *pOffer, const char *pHeader, xws_deflate_t *pAgreed);
+
+void XWS_InitZPool(xws_zpool_t *pPool, xbool_t bDeflate, int nLevel, size_t nMaxFree);
+void XWS_DestroyZPool(xws_zpool_t *pPool);
+xws_zstream_t* XWS_GetZStream(xws_zpool_t *pPool, uint8_t nBits);
+void XWS_PutZStream(xws_zpool_t *pPool, xws_zstream_t *pStream);
+void XWS_ResetZStream(xws_zstream_t *pStream);
+
+xws_status_t XWS_Deflate(xws_zstream_t *pStream, const uint8_t *pData, size_t nLength, xbyte_buffer_t *pOutput, xbool_t bReset);
+xws_status_t XWS_Inflate(xws_zstream_t *pStream, const uint8_t *pData, size_t nLength,
+                         xbyte_buffer_t *pOutput, size_t nMaxSize, xbool_t bReset);
+
 #ifdef __cplusplus
 }
 #endif
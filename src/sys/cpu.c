@@ -19,7 +19,33 @@
 #define XCPU_INFO_FILE      "/proc/cpuinfo"
 #define XCPU_KEYWORD        "processor"
 
+#define XCPU_FEATURES_INIT  (1 << 8)
+
 static xatomic_t g_nCPUCount = 0;
+static xatomic_t g_nFeatures = 0;
+
+uint32_t XCPU_GetFeatures(void)
+{
+    xatomic_t nFeatures = XSYNC_ATOMIC_GET(&g_nFeatures);
+    if (nFeatures) return (uint32_t)nFeatures & ~XCPU_FEATURES_INIT;
+    nFeatures = XCPU_FEATURES_INIT;
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) nFeatures |= XCPU_SSE2;
+    if (__builtin_cpu_supports("sse4.2")) nFeatures |= XCPU_SSE42;
+    if (__builtin_cpu_supports("avx2")) nFeatures |= XCPU_AVX2;
+#endif
+
+    XSYNC_ATOMIC_SET(&g_nFeatures, nFeatures);
+    return (uint32_t)nFeatures & ~XCPU_FEATURES_INIT;
+}
+
+xbool_t XCPU_HasFeature(xcpu_feature_t eFeature)
+{
+    uint32_t nFeatures = XCPU_GetFeatures();
+    return (nFeatures & (uint32_t)eFeature) ? XTRUE : XFALSE;
+}
 
 int XCPU_GetCount(void)
 {
@@ -18,6 +18,16 @@ extern "C" {
 
 #define XCPU_CALLER_PID     -1
 
+/* SIMD features detected at runtime */
+typedef enum {
+    XCPU_SSE42 = (1 << 0),
+    XCPU_AVX2 = (1 << 1),
+    XCPU_SSE2 = (1 << 2)
+} xcpu_feature_t;
+
+uint32_t XCPU_GetFeatures(void);
+xbool_t XCPU_HasFeature(xcpu_feature_t eFeature);
+
 int XCPU_GetCount(void);
 int XCPU_SetSingle(int nCPU, xpid_t nPID);
 int XCPU_SetAffinity(int *pCPUs, size_t nCount, xpid_t nPID);
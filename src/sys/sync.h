@@ -43,15 +43,17 @@ typedef struct XSyncBar {
 } xsync_bar_t;
 
 #ifdef _WIN32
-#define XSYNC_ATOMIC_ADD(dst,val) InterlockedExchangeAdd(dst, val)
-#define XSYNC_ATOMIC_SUB(dst,val) InterlockedExchangeSubtract(dst, val)
+#define XSYNC_ATOMIC_ADD(dst,val) InterlockedAdd(dst, val)
+#define XSYNC_ATOMIC_SUB(dst,val) InterlockedAdd(dst, -(val))
 #define XSYNC_ATOMIC_SET(dst,val) InterlockedExchange(dst, val)
 #define XSYNC_ATOMIC_GET(dst) InterlockedExchangeAdd(dst, 0)
+#define XSYNC_ATOMIC_RELEASE(dst) InterlockedExchange(dst, 0)
 #else
 #define XSYNC_ATOMIC_ADD(dst,val) __sync_add_and_fetch(dst, val)
 #define XSYNC_ATOMIC_SUB(dst,val) __sync_sub_and_fetch(dst, val)
 #define XSYNC_ATOMIC_SET(dst,val) __sync_lock_test_and_set(dst, val)
 #define XSYNC_ATOMIC_GET(dst) __sync_add_and_fetch(dst, 0)
+#define XSYNC_ATOMIC_RELEASE(dst) __sync_lock_release(dst)
 #endif
 
 void xusleep(uint32_t nUsecs);
@@ -45,6 +45,7 @@
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 
 #include <netinet/tcp.h>